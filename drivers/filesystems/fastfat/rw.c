@@ -634,6 +634,20 @@ VfatCommonRead(
             goto ByeBye;
         }
 
+        // the cache may hold newer data than the disk, write it out first
+        if (!PagingIo && !IsVolume &&
+            Fcb->SectionObjectPointers.DataSectionObject != NULL)
+        {
+            IO_STATUS_BLOCK IoStatus;
+
+            CcFlushCache(&Fcb->SectionObjectPointers, &ByteOffset, Length, &IoStatus);
+            if (!NT_SUCCESS(IoStatus.Status))
+            {
+                Status = IoStatus.Status;
+                goto ByeBye;
+            }
+        }
+
         if (ByteOffset.QuadPart + Length > ROUND_UP_64(Fcb->RFCB.FileSize.QuadPart, BytesPerSector))
         {
             Length = (ULONG)(ROUND_UP_64(Fcb->RFCB.FileSize.QuadPart, BytesPerSector) - ByteOffset.QuadPart);
@@ -1143,6 +1157,22 @@ VfatWrite(
             CcZeroData(IrpContext->FileObject, &OldFileSize, &ByteOffset, TRUE);
         }
 
+        // write out the cached data and drop it, so the cache doesn't keep stale data
+        if (!PagingIo && !IsVolume &&
+            Fcb->SectionObjectPointers.DataSectionObject != NULL)
+        {
+            IO_STATUS_BLOCK IoStatus;
+
+            CcFlushCache(&Fcb->SectionObjectPointers, &ByteOffset, Length, &IoStatus);
+            if (!NT_SUCCESS(IoStatus.Status))
+            {
+                Status = IoStatus.Status;
+                goto ByeBye;
+            }
+
+            CcPurgeCacheSection(&Fcb->SectionObjectPointers, &ByteOffset, Length, FALSE);
+        }
+
         if (!IsVolume)
         {
             vfatAddToStat(IrpContext->DeviceExt, Fat.NonCachedWrites, 1);
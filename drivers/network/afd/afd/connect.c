@@ -255,6 +255,31 @@ WarmSocketForConnection(PAFD_FCB FCB) {
     return Status;
 }
 
+NTSTATUS
+SetTransportBufferSizes(PAFD_FCB FCB) {
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    /* Stream sockets don't size AFD's buffers, SO_RCVBUF and SO_SNDBUF
+     * size the transport's receive window and send buffer instead */
+    if (FCB->TransportRecvWindow)
+    {
+        Status = TdiSetConnectionInformation(FCB->Connection.Object,
+                                             TCP_SOCKET_WINDOW,
+                                             FCB->TransportRecvWindow);
+        if (!NT_SUCCESS(Status))
+            return Status;
+    }
+
+    if (FCB->TransportSendBuffer)
+    {
+        Status = TdiSetConnectionInformation(FCB->Connection.Object,
+                                             TCP_SOCKET_SEND_BUFFER,
+                                             FCB->TransportSendBuffer);
+    }
+
+    return Status;
+}
+
 NTSTATUS
 MakeSocketIntoConnection(PAFD_FCB FCB) {
     NTSTATUS Status;
@@ -299,6 +324,11 @@ MakeSocketIntoConnection(PAFD_FCB FCB) {
 
     FCB->State = SOCKET_STATE_CONNECTED;
 
+    /* Buffer sizes set before the connection existed */
+    Status = SetTransportBufferSizes(FCB);
+    if (!NT_SUCCESS(Status))
+        AFD_DbgPrint(MIN_TRACE,("Failed to set the transport buffer sizes (%x)\n", Status));
+
     Status = TdiReceive( &FCB->ReceiveIrp.InFlightRequest,
                          FCB->Connection.Object,
                          TDI_RECEIVE_NORMAL,
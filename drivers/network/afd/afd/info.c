@@ -32,12 +32,19 @@ AfdGetInfo( PDEVICE_OBJECT DeviceObject, PIRP Irp,
     _SEH2_TRY {
         switch( InfoReq->InformationClass ) {
         case AFD_INFO_RECEIVE_WINDOW_SIZE:
-            InfoReq->Information.Ulong = FCB->Recv.Size;
+            /* Stream sockets report what was asked of the transport */
+            if (!(FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS) && FCB->TransportRecvWindow)
+                InfoReq->Information.Ulong = FCB->TransportRecvWindow;
+            else
+                InfoReq->Information.Ulong = FCB->Recv.Size;
             break;
 
         case AFD_INFO_SEND_WINDOW_SIZE:
-            InfoReq->Information.Ulong = FCB->Send.Size;
-            AFD_DbgPrint(MID_TRACE,("Send window size %u\n", FCB->Send.Size));
+            if (!(FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS) && FCB->TransportSendBuffer)
+                InfoReq->Information.Ulong = FCB->TransportSendBuffer;
+            else
+                InfoReq->Information.Ulong = FCB->Send.Size;
+            AFD_DbgPrint(MID_TRACE,("Send window size %u\n", InfoReq->Information.Ulong));
             break;
 
         case AFD_INFO_GROUP_ID_TYPE:
@@ -124,8 +131,17 @@ AfdSetInfo( PDEVICE_OBJECT DeviceObject, PIRP Irp,
                 FCB->OobInline = InfoReq->Information.Boolean;
                 break;
             case AFD_INFO_RECEIVE_WINDOW_SIZE:
-                if (FCB->State == SOCKET_STATE_CONNECTED ||
-                    FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS)
+                if (!(FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS))
+                {
+                    /* The receive window of a stream socket belongs to the transport,
+                     * AFD's buffer keeps its size. Remember it for later connections. */
+                    if (InfoReq->Information.Ulong > 0)
+                        FCB->TransportRecvWindow = InfoReq->Information.Ulong;
+
+                    if (FCB->State == SOCKET_STATE_CONNECTED)
+                        Status = SetTransportBufferSizes(FCB);
+                }
+                else
                 {
                     /* FIXME: likely not right, check tcpip.sys for TDI_QUERY_MAX_DATAGRAM_INFO */
                     if (InfoReq->Information.Ulong > 0 && InfoReq->Information.Ulong < 0xFFFF &&
@@ -164,14 +180,17 @@ AfdSetInfo( PDEVICE_OBJECT DeviceObject, PIRP Irp,
                         Status = STATUS_SUCCESS;
                     }
                 }
-                else
-                {
-                    Status = STATUS_INVALID_PARAMETER;
-                }
                 break;
             case AFD_INFO_SEND_WINDOW_SIZE:
-                if (FCB->State == SOCKET_STATE_CONNECTED ||
-                    FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS)
+                if (!(FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS))
+                {
+                    if (InfoReq->Information.Ulong > 0)
+                        FCB->TransportSendBuffer = InfoReq->Information.Ulong;
+
+                    if (FCB->State == SOCKET_STATE_CONNECTED)
+                        Status = SetTransportBufferSizes(FCB);
+                }
+                else
                 {
                     if (InfoReq->Information.Ulong > 0 && InfoReq->Information.Ulong < 0xFFFF &&
                         InfoReq->Information.Ulong != FCB->Send.Size)
@@ -209,10 +228,6 @@ AfdSetInfo( PDEVICE_OBJECT DeviceObject, PIRP Irp,
                         Status = STATUS_SUCCESS;
                     }
                 }
-                else
-                {
-                    Status = STATUS_INVALID_PARAMETER;
-                }
                 break;
             default:
                 AFD_DbgPrint(MIN_TRACE,("Unknown request %u\n", InfoReq->InformationClass));
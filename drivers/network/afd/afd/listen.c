@@ -349,6 +349,7 @@ NTSTATUS AfdAccept( PDEVICE_OBJECT DeviceObject, PIRP Irp,
     if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
 
     FCB->EventSelectDisabled &= ~AFD_EVENT_ACCEPT;
+    FCB->PollRegisterDisabled &= ~AFD_EVENT_ACCEPT;
 
     for( PendingConn = FCB->PendingConnections.Flink;
          PendingConn != &FCB->PendingConnections;
@@ -438,6 +438,7 @@ AfdConnectedSocketReadData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
 
     FCB->EventSelectDisabled &= ~AFD_EVENT_RECEIVE;
+    FCB->PollRegisterDisabled &= ~AFD_EVENT_RECEIVE;
 
     if( !(FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS) &&
         FCB->State != SOCKET_STATE_CONNECTED &&
@@ -717,6 +718,7 @@ AfdPacketSocketReadData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
 
     FCB->EventSelectDisabled &= ~AFD_EVENT_RECEIVE;
+    FCB->PollRegisterDisabled &= ~AFD_EVENT_RECEIVE;
 
     /* Check that the socket is bound */
     if( FCB->State != SOCKET_STATE_BOUND )
@@ -68,6 +68,8 @@ VOID SignalSocket(
     {
         KeCancelTimer( &Poll->Timer );
         RemoveEntryList( &Poll->ListEntry );
+        for( i = 0; i < Poll->WaiterCount; i++ )
+            RemoveEntryList( &Poll->Waiters[i].ListEntry );
         ExFreePoolWithTag(Poll, TAG_AFD_ACTIVE_POLL);
     }
 
@@ -122,37 +124,53 @@ static VOID NTAPI SelectTimeout( PKDPC Dpc,
     AFD_DbgPrint(MID_TRACE,("Timeout\n"));
 }
 
+/* Returns the first waiter of the next poll in an FCB's waiter list.
+ * A poll that lists the same socket more than once has adjacent waiters
+ * (they are all linked while holding the lock), so stepping over them
+ * lets the caller free the poll. Events receives what the poll waits for
+ * on this socket. */
+static PLIST_ENTRY NextPollWaiter( PLIST_ENTRY ListHead,
+                                   PLIST_ENTRY ListEntry,
+                                   PULONG Events ) {
+    PAFD_POLL_WAITER Waiter = CONTAINING_RECORD(ListEntry, AFD_POLL_WAITER, ListEntry);
+    PAFD_ACTIVE_POLL Poll = Waiter->Poll;
+    PAFD_POLL_INFO PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
+
+    *Events = 0;
+    do {
+        *Events |= PollReq->Handles[Waiter - Poll->Waiters].Events;
+        ListEntry = ListEntry->Flink;
+        Waiter = CONTAINING_RECORD(ListEntry, AFD_POLL_WAITER, ListEntry);
+    } while( ListEntry != ListHead && Waiter->Poll == Poll );
+
+    return ListEntry;
+}
+
 VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         PFILE_OBJECT FileObject,
                         BOOLEAN OnlyExclusive ) {
     KIRQL OldIrql;
     PLIST_ENTRY ListEntry;
     PAFD_ACTIVE_POLL Poll;
-    PIRP Irp;
     PAFD_POLL_INFO PollReq;
-    PAFD_HANDLE HandleArray;
-    UINT i;
+    PAFD_FCB FCB = FileObject->FsContext;
+    ULONG Events;
 
     AFD_DbgPrint(MID_TRACE,("Killing selects that refer to %p\n", FileObject));
 
+    if( !FCB ) return;
+
     KeAcquireSpinLock( &DeviceExt->Lock, &OldIrql );
 
-    ListEntry = DeviceExt->Polls.Flink;
-    while ( ListEntry != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD(ListEntry, AFD_ACTIVE_POLL, ListEntry);
-        ListEntry = ListEntry->Flink;
-        Irp = Poll->Irp;
-        PollReq = Irp->AssociatedIrp.SystemBuffer;
-        HandleArray = AFD_HANDLES(PollReq);
+    ListEntry = FCB->PollWaiters.Flink;
+    while ( ListEntry != &FCB->PollWaiters ) {
+        Poll = CONTAINING_RECORD(ListEntry, AFD_POLL_WAITER, ListEntry)->Poll;
+        ListEntry = NextPollWaiter( &FCB->PollWaiters, ListEntry, &Events );
+        PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
 
-        for( i = 0; i < PollReq->HandleCount; i++ ) {
-            AFD_DbgPrint(MAX_TRACE,("Req: %u, This %p\n",
-                                    HandleArray[i].Handle, FileObject));
-            if( (PVOID)HandleArray[i].Handle == FileObject &&
-                (!OnlyExclusive || (OnlyExclusive && Poll->Exclusive)) ) {
-                ZeroEvents( PollReq->Handles, PollReq->HandleCount );
-                SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
-            }
+        if( !OnlyExclusive || Poll->Exclusive ) {
+            ZeroEvents( PollReq->Handles, PollReq->HandleCount );
+            SignalSocket( Poll, NULL, PollReq, STATUS_CANCELLED );
         }
     }
 
@@ -189,6 +207,21 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
         return STATUS_NO_MEMORY;
     }
 
+    /* The waiters are linked into each FCB, so every handle must be a socket */
+    for( i = 0; i < PollReq->HandleCount; i++ ) {
+        if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
+
+        FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+        if( FileObject->DeviceObject != DeviceObject || !FileObject->FsContext ) {
+            AFD_DbgPrint(MIN_TRACE,("Handle %u is not a socket\n", i));
+            UnlockHandles( AFD_HANDLES(PollReq), PollReq->HandleCount );
+            Irp->IoStatus.Status = STATUS_INVALID_HANDLE;
+            Irp->IoStatus.Information = 0;
+            IoCompleteRequest( Irp, IO_NETWORK_INCREMENT );
+            return STATUS_INVALID_HANDLE;
+        }
+    }
+
     if( Exclusive ) {
         for( i = 0; i < PollReq->HandleCount; i++ ) {
             if( !AFD_HANDLES(PollReq)[i].Handle ) continue;
@@ -229,13 +262,29 @@ AfdSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
        PAFD_ACTIVE_POLL Poll = NULL;
 
        Poll = ExAllocatePoolWithTag(NonPagedPool,
-                                    sizeof(AFD_ACTIVE_POLL),
+                                    FIELD_OFFSET(AFD_ACTIVE_POLL, Waiters) +
+                                    sizeof(AFD_POLL_WAITER) * max(PollReq->HandleCount, 1),
                                     TAG_AFD_ACTIVE_POLL);
 
        if (Poll){
           Poll->Irp = Irp;
           Poll->DeviceExt = DeviceExt;
           Poll->Exclusive = Exclusive;
+          Poll->WaiterCount = PollReq->HandleCount;
+
+          /* Only the watched sockets will look at this poll again */
+          for( i = 0; i < PollReq->HandleCount; i++ ) {
+              Poll->Waiters[i].Poll = Poll;
+
+              if( !AFD_HANDLES(PollReq)[i].Handle ) {
+                  InitializeListHead( &Poll->Waiters[i].ListEntry );
+                  continue;
+              }
+
+              FileObject = (PFILE_OBJECT)AFD_HANDLES(PollReq)[i].Handle;
+              FCB = FileObject->FsContext;
+              InsertTailList( &FCB->PollWaiters, &Poll->Waiters[i].ListEntry );
+          }
 
           KeInitializeTimerEx( &Poll->Timer, NotificationTimer );
 
@@ -404,12 +453,38 @@ static BOOLEAN UpdatePollWithFCB( PAFD_ACTIVE_POLL Poll, PFILE_OBJECT FileObject
     return Signalled ? 1 : 0;
 }
 
+/* Queues a completion packet for a socket registered with
+ * IOCTL_AFD_POLL_REGISTER if one of its events is pending. Like event
+ * select, a reported event stays quiet until its re-enabling function
+ * (recv, send, accept) is called again */
+static VOID SignalPollRegistration( PAFD_FCB FCB ) {
+    PIO_COMPLETION_CONTEXT CompletionContext = FCB->FileObject->CompletionContext;
+    ULONG Events = FCB->PollState & FCB->PollRegisterEvents &
+                   ~FCB->PollRegisterDisabled;
+    NTSTATUS Status;
+
+    if( !Events || !CompletionContext ) return;
+
+    AFD_DbgPrint(MID_TRACE,("Queuing events %x for %p\n", Events, FCB));
+
+    Status = IoSetIoCompletion( CompletionContext->Port,
+                                CompletionContext->Key,
+                                FCB->PollRegisterContext,
+                                STATUS_SUCCESS,
+                                Events,
+                                FALSE );
+
+    if( NT_SUCCESS(Status) )
+        FCB->PollRegisterDisabled |= Events;
+}
+
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
     PAFD_ACTIVE_POLL Poll = NULL;
     PLIST_ENTRY ThePollEnt = NULL;
     PAFD_FCB FCB;
     KIRQL OldIrql;
     PAFD_POLL_INFO PollReq;
+    ULONG Events;
 
     AFD_DbgPrint(MID_TRACE,("Called: DeviceExt %p FileObject %p\n",
                             DeviceExt, FileObject));
@@ -424,20 +499,22 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
         return;
     }
 
-    /* Now signal normal select irps */
-    ThePollEnt = DeviceExt->Polls.Flink;
+    /* Now signal normal select irps waiting on this socket */
+    ThePollEnt = FCB->PollWaiters.Flink;
 
-    while( ThePollEnt != &DeviceExt->Polls ) {
-        Poll = CONTAINING_RECORD( ThePollEnt, AFD_ACTIVE_POLL, ListEntry );
+    while( ThePollEnt != &FCB->PollWaiters ) {
+        Poll = CONTAINING_RECORD( ThePollEnt, AFD_POLL_WAITER, ListEntry )->Poll;
+        ThePollEnt = NextPollWaiter( &FCB->PollWaiters, ThePollEnt, &Events );
         PollReq = Poll->Irp->AssociatedIrp.SystemBuffer;
         AFD_DbgPrint(MID_TRACE,("Checking poll %p\n", Poll));
 
-        if( UpdatePollWithFCB( Poll, FileObject ) ) {
-            ThePollEnt = ThePollEnt->Flink;
+        /* The other sockets of the poll were not ready when it was queued
+         * and would have completed it themselves, so only look at the whole
+         * set once this one matches */
+        if( (Events & FCB->PollState) && UpdatePollWithFCB( Poll, FileObject ) ) {
             AFD_DbgPrint(MID_TRACE,("Signalling socket\n"));
             SignalSocket( Poll, NULL, PollReq, STATUS_SUCCESS );
-        } else
-            ThePollEnt = ThePollEnt->Flink;
+        }
     }
 
     KeReleaseSpinLock( &DeviceExt->Lock, OldIrql );
@@ -451,5 +528,48 @@ VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceExt, PFILE_OBJECT FileObject ) {
         KeSetEvent( FCB->EventSelect, IO_NETWORK_INCREMENT, FALSE );
     }
 
+    SignalPollRegistration( FCB );
+
     AFD_DbgPrint(MID_TRACE,("Leaving\n"));
 }
+
+NTSTATUS NTAPI
+AfdPollRegister( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+                 PIO_STACK_LOCATION IrpSp ) {
+    PFILE_OBJECT FileObject = IrpSp->FileObject;
+    NTSTATUS Status = STATUS_SUCCESS;
+    PAFD_POLL_REGISTER_INFO RegisterInfo =
+        (PAFD_POLL_REGISTER_INFO)LockRequest( Irp, IrpSp, FALSE, NULL );
+    PAFD_FCB FCB = FileObject->FsContext;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    if( !SocketAcquireStateLock( FCB ) ) {
+        return LostSocket( Irp );
+    }
+
+    if ( !RegisterInfo ) {
+         return UnlockAndMaybeComplete( FCB, STATUS_NO_MEMORY, Irp,
+                                        0 );
+    }
+    AFD_DbgPrint(MID_TRACE,("Called (Events %x Context %p)\n",
+                            RegisterInfo->Events,
+                            RegisterInfo->Context));
+
+    /* Events go to the completion port the socket is associated with */
+    if( RegisterInfo->Events && !FileObject->CompletionContext ) {
+        Status = STATUS_INVALID_PARAMETER;
+    } else {
+        FCB->PollRegisterEvents = RegisterInfo->Events;
+        FCB->PollRegisterContext = RegisterInfo->Context;
+        FCB->PollRegisterDisabled = 0;
+
+        /* Report what is already pending right away */
+        SignalPollRegistration( FCB );
+    }
+
+    AFD_DbgPrint(MID_TRACE,("Returning %x\n", Status));
+
+    return UnlockAndMaybeComplete( FCB, Status, Irp,
+                                   0 );
+}
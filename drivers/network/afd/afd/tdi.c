@@ -759,6 +759,41 @@ NTSTATUS TdiQueryInformationEx(
                                  OutputLength);                             /* Return information */
 }
 
+NTSTATUS TdiSetConnectionInformation(
+    PFILE_OBJECT ConnectionObject,
+    ULONG Id,
+    ULONG Value)
+/*
+ * FUNCTION: Sets a TCP connection option
+ * ARGUMENTS:
+ *     ConnectionObject = Pointer to connection endpoint file object
+ *     Id               = Connection option (TCP_SOCKET_*)
+ *     Value            = New value of the option
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Buffer[(sizeof(TCP_REQUEST_SET_INFORMATION_EX) + 2 * sizeof(ULONG) - 1) / sizeof(ULONG)];
+    PTCP_REQUEST_SET_INFORMATION_EX SetInfo = (PTCP_REQUEST_SET_INFORMATION_EX)Buffer;
+
+    RtlZeroMemory(Buffer, sizeof(Buffer));
+    SetInfo->ID.toi_entity.tei_entity   = CO_TL_ENTITY;
+    SetInfo->ID.toi_entity.tei_instance = 0;
+    SetInfo->ID.toi_class = INFO_CLASS_PROTOCOL;
+    SetInfo->ID.toi_type  = INFO_TYPE_CONNECTION;
+    SetInfo->ID.toi_id    = Id;
+    SetInfo->BufferSize   = sizeof(ULONG);
+    RtlCopyMemory(SetInfo->Buffer, &Value, sizeof(ULONG));
+
+    return TdiQueryDeviceControl(ConnectionObject,                  /* Connection object */
+                                 IOCTL_TCP_SET_INFORMATION_EX,      /* Control code */
+                                 SetInfo,                           /* Input buffer */
+                                 sizeof(Buffer),                    /* Input buffer length */
+                                 NULL,                              /* Output buffer */
+                                 0,                                 /* Output buffer length */
+                                 NULL);                             /* Return information */
+}
+
 NTSTATUS TdiQueryAddress(
     PFILE_OBJECT FileObject,
     PULONG Address)
@@ -10,6 +10,9 @@
 
 #include "afd.h"
 
+/* Stream sends of at least this size skip the send window */
+#define AFD_DIRECT_SEND_THRESHOLD 0x10000
+
 static IO_COMPLETION_ROUTINE SendComplete;
 static NTSTATUS NTAPI SendComplete
 ( PDEVICE_OBJECT DeviceObject,
@@ -325,6 +328,96 @@ static NTSTATUS NTAPI PacketSocketSendComplete
     return STATUS_SUCCESS;
 }
 
+static IO_COMPLETION_ROUTINE DirectSendComplete;
+static NTSTATUS NTAPI DirectSendComplete
+( PDEVICE_OBJECT DeviceObject,
+  PIRP Irp,
+  PVOID Context ) {
+    NTSTATUS Status = Irp->IoStatus.Status;
+    PAFD_FCB FCB = (PAFD_FCB)Context;
+    PLIST_ENTRY NextIrpEntry;
+    PIRP NextIrp;
+    PAFD_SEND_INFO SendReq;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    AFD_DbgPrint(MID_TRACE,("Called, status %x, %u bytes sent\n",
+                            Irp->IoStatus.Status,
+                            Irp->IoStatus.Information));
+
+    if( !SocketAcquireStateLock( FCB ) )
+        return STATUS_FILE_CLOSED;
+
+    ASSERT(FCB->SendIrp.InFlightRequest == Irp);
+    FCB->SendIrp.InFlightRequest = NULL;
+    /* Request is not in flight any longer */
+
+    if( FCB->State == SOCKET_STATE_CLOSED )
+        Status = STATUS_FILE_CLOSED;
+
+    /* The transport completes on acknowledgement, the user may have cancelled by now */
+    NextIrp = FCB->DirectSendIrp;
+    FCB->DirectSendIrp = NULL;
+    if (NextIrp)
+    {
+        RemoveEntryList(&NextIrp->Tail.Overlay.ListEntry);
+
+        SendReq = GetLockedData(NextIrp, IoGetCurrentIrpStackLocation(NextIrp));
+
+        NextIrp->IoStatus.Status = Status;
+        NextIrp->IoStatus.Information = NT_SUCCESS(Status) ? Irp->IoStatus.Information : 0;
+
+        (void)IoSetCancelRoutine(NextIrp, NULL);
+
+        UnlockBuffers(SendReq->BufferArray, SendReq->BufferCount, FALSE);
+
+        if (NextIrp->MdlAddress) UnlockRequest(NextIrp, IoGetCurrentIrpStackLocation(NextIrp));
+
+        IoCompleteRequest(NextIrp, IO_NETWORK_INCREMENT);
+    }
+
+    if( !NT_SUCCESS(Status) ) {
+        /* Complete all following send IRPs with error */
+        while( !IsListEmpty( &FCB->PendingIrpList[FUNCTION_SEND] ) ) {
+            NextIrpEntry = RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]);
+            NextIrp = CONTAINING_RECORD(NextIrpEntry, IRP, Tail.Overlay.ListEntry);
+            SendReq = GetLockedData(NextIrp, IoGetCurrentIrpStackLocation(NextIrp));
+            NextIrp->IoStatus.Status = Status;
+            NextIrp->IoStatus.Information = 0;
+            UnlockBuffers(SendReq->BufferArray, SendReq->BufferCount, FALSE);
+            if( NextIrp->MdlAddress ) UnlockRequest( NextIrp, IoGetCurrentIrpStackLocation( NextIrp ) );
+            (void)IoSetCancelRoutine(NextIrp, NULL);
+            IoCompleteRequest( NextIrp, IO_NETWORK_INCREMENT );
+        }
+
+        RetryDisconnectCompletion(FCB);
+
+        SocketStateUnlock( FCB );
+        return STATUS_SUCCESS;
+    }
+
+    /* Sends queued behind this one were copied to the send window */
+    if( FCB->Send.BytesUsed )
+    {
+        TdiSend( &FCB->SendIrp.InFlightRequest,
+                 FCB->Connection.Object,
+                 0,
+                 FCB->Send.Window,
+                 FCB->Send.BytesUsed,
+                 SendComplete,
+                 FCB );
+    }
+    else
+    {
+        /* Nothing is waiting so try to complete a pending disconnect */
+        RetryDisconnectCompletion(FCB);
+    }
+
+    SocketStateUnlock( FCB );
+
+    return STATUS_SUCCESS;
+}
+
 NTSTATUS NTAPI
 AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
                             PIO_STACK_LOCATION IrpSp, BOOLEAN Short) {
@@ -343,6 +436,7 @@ AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
 
     FCB->EventSelectDisabled &= ~AFD_EVENT_SEND;
+    FCB->PollRegisterDisabled &= ~AFD_EVENT_SEND;
 
     if( FCB->Flags & AFD_ENDPOINT_CONNECTIONLESS )
     {
@@ -472,6 +566,45 @@ AfdConnectedSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
         SendLength += SendReq->BufferArray[i].len;
     }
 
+    /* Large blocking sends go out from the user's pages when nothing else is queued.
+     * The transport completes them once the data is acknowledged */
+    if (SendReq->BufferCount == 1 &&
+        SendLength >= AFD_DIRECT_SEND_THRESHOLD &&
+        !((SendReq->AfdFlags & AFD_IMMEDIATE) || (FCB->NonBlocking)) &&
+        FCB->Send.BytesUsed == 0 &&
+        !FCB->SendIrp.InFlightRequest &&
+        IsListEmpty(&FCB->PendingIrpList[FUNCTION_SEND]))
+    {
+        Status = QueueUserModeIrp(FCB, Irp, FUNCTION_SEND);
+        if (Status == STATUS_PENDING)
+        {
+            FCB->DirectSendIrp = Irp;
+
+            Status = TdiSend(&FCB->SendIrp.InFlightRequest,
+                             FCB->Connection.Object,
+                             TDI_SEND_NO_COPY,
+                             SendReq->BufferArray[0].buf,
+                             SendLength,
+                             DirectSendComplete,
+                             FCB);
+            if (Status != STATUS_PENDING)
+            {
+                FCB->DirectSendIrp = NULL;
+                NT_VERIFY(RemoveHeadList(&FCB->PendingIrpList[FUNCTION_SEND]) == &Irp->Tail.Overlay.ListEntry);
+                Irp->IoStatus.Status = Status;
+                Irp->IoStatus.Information = 0;
+                (void)IoSetCancelRoutine(Irp, NULL);
+                UnlockBuffers(SendReq->BufferArray, SendReq->BufferCount, FALSE);
+                UnlockRequest(Irp, IoGetCurrentIrpStackLocation(Irp));
+                IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
+            }
+        }
+
+        SocketStateUnlock(FCB);
+
+        return STATUS_PENDING;
+    }
+
     /* Make sure we've got the space */
     if (SendLength > SpaceAvail)
     {
@@ -577,6 +710,7 @@ AfdPacketSocketWriteData(PDEVICE_OBJECT DeviceObject, PIRP Irp,
     if( !SocketAcquireStateLock( FCB ) ) return LostSocket( Irp );
 
     FCB->EventSelectDisabled &= ~AFD_EVENT_SEND;
+    FCB->PollRegisterDisabled &= ~AFD_EVENT_SEND;
 
     /* Check that the socket is bound */
     if( FCB->State != SOCKET_STATE_BOUND &&
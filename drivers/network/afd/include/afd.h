@@ -13,6 +13,7 @@
 
 #include <ntifs.h>
 #include <ndk/obtypes.h>
+#include <ndk/iofuncs.h>
 #include <tdi.h>
 #include <tcpioctl.h>
 #define _WINBASE_
@@ -113,6 +114,14 @@ typedef struct _AFD_DEVICE_EXTENSION {
     KSPIN_LOCK Lock;
 } AFD_DEVICE_EXTENSION, *PAFD_DEVICE_EXTENSION;
 
+struct _AFD_ACTIVE_POLL;
+
+/* Links a pending select to one of the sockets it watches */
+typedef struct _AFD_POLL_WAITER {
+    LIST_ENTRY ListEntry;
+    struct _AFD_ACTIVE_POLL *Poll;
+} AFD_POLL_WAITER, *PAFD_POLL_WAITER;
+
 typedef struct _AFD_ACTIVE_POLL {
     LIST_ENTRY ListEntry;
     PIRP Irp;
@@ -121,6 +130,8 @@ typedef struct _AFD_ACTIVE_POLL {
     KTIMER Timer;
     PKEVENT EventObject;
     BOOLEAN Exclusive;
+    UINT WaiterCount;
+    AFD_POLL_WAITER Waiters[1]; /* One per handle, in FCB->PollWaiters */
 } AFD_ACTIVE_POLL, *PAFD_ACTIVE_POLL;
 
 typedef struct _IRP_LIST {
@@ -175,7 +186,9 @@ typedef struct _AFD_FCB {
     PTDI_CONNECTION_INFORMATION AddressFrom, ConnectCallInfo, ConnectReturnInfo;
     AFD_TDI_OBJECT AddressFile, Connection;
     AFD_IN_FLIGHT_REQUEST ConnectIrp, ListenIrp, ReceiveIrp, SendIrp, DisconnectIrp;
+    PIRP DirectSendIrp; /* Send whose buffer the transport uses directly (FCB->SendIrp) */
     AFD_DATA_WINDOW Send, Recv;
+    ULONG TransportSendBuffer, TransportRecvWindow; /* SO_SNDBUF/SO_RCVBUF of stream sockets */
     KMUTEX Mutex;
     PKEVENT EventSelect;
     DWORD EventSelectTriggers;
@@ -184,6 +197,10 @@ typedef struct _AFD_FCB {
     PVOID Context;
     DWORD PollState;
     NTSTATUS PollStatus[FD_MAX_EVENTS];
+    LIST_ENTRY PollWaiters; /* Protected by DeviceExt->Lock */
+    DWORD PollRegisterEvents;
+    DWORD PollRegisterDisabled;
+    PVOID PollRegisterContext;
     NTSTATUS LastReceiveStatus;
     UINT ContextSize;
     PVOID ConnectData;
@@ -213,6 +230,7 @@ AfdBindSocket(PDEVICE_OBJECT DeviceObject, PIRP Irp,
 /* connect.c */
 
 NTSTATUS MakeSocketIntoConnection( PAFD_FCB FCB );
+NTSTATUS SetTransportBufferSizes( PAFD_FCB FCB );
 NTSTATUS WarmSocketForConnection( PAFD_FCB FCB );
 NTSTATUS NTAPI
 AfdStreamSocketConnect(PDEVICE_OBJECT DeviceObject, PIRP Irp,
@@ -328,6 +346,9 @@ AfdEventSelect( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 NTSTATUS NTAPI
 AfdEnumEvents( PDEVICE_OBJECT DeviceObject, PIRP Irp,
 	       PIO_STACK_LOCATION IrpSp );
+NTSTATUS NTAPI
+AfdPollRegister( PDEVICE_OBJECT DeviceObject, PIRP Irp,
+		 PIO_STACK_LOCATION IrpSp );
 VOID PollReeval( PAFD_DEVICE_EXTENSION DeviceObject, PFILE_OBJECT FileObject );
 VOID KillSelectsForFCB( PAFD_DEVICE_EXTENSION DeviceExt,
                         PFILE_OBJECT FileObject, BOOLEAN ExclusiveOnly );
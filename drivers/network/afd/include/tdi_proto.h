@@ -43,3 +43,8 @@ NTSTATUS TdiQueryDeviceControl(
     PVOID OutputBuffer,
     ULONG OutputBufferLength,
     PULONG Return);
+
+NTSTATUS TdiSetConnectionInformation(
+    PFILE_OBJECT ConnectionObject,
+    ULONG Id,
+    ULONG Value);
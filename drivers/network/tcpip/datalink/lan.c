@@ -20,14 +20,6 @@ UINT TransferDataCompleteCalled = 0;
 #define CCS_ROOT L"\\Registry\\Machine\\SYSTEM\\CurrentControlSet"
 #define TCPIP_GUID L"{4D36E972-E325-11CE-BFC1-08002BE10318}"
 
-typedef struct _LAN_WQ_ITEM {
-    LIST_ENTRY ListEntry;
-    PNDIS_PACKET Packet;
-    PLAN_ADAPTER Adapter;
-    UINT BytesTransferred;
-    BOOLEAN LegacyReceive;
-} LAN_WQ_ITEM, *PLAN_WQ_ITEM;
-
 typedef struct _RECONFIGURE_CONTEXT {
     ULONG State;
     PLAN_ADAPTER Adapter;
@@ -304,33 +296,17 @@ VOID NTAPI ProtocolSendComplete(
     FreeNdisPacket(Packet);
 }
 
-VOID LanReceiveWorker( PVOID Context ) {
+static VOID LanReceivePacket( PLAN_ADAPTER Adapter, PLAN_RECV_ENTRY Entry ) {
     ULONG PacketType;
-    PLAN_WQ_ITEM WorkItem = (PLAN_WQ_ITEM)Context;
-    PNDIS_PACKET Packet;
-    PLAN_ADAPTER Adapter;
-    UINT BytesTransferred;
     IP_PACKET IPPacket;
-    BOOLEAN LegacyReceive;
-    PIP_INTERFACE Interface;
-
-    TI_DbgPrint(DEBUG_DATALINK, ("Called.\n"));
-
-    Packet = WorkItem->Packet;
-    Adapter = WorkItem->Adapter;
-    BytesTransferred = WorkItem->BytesTransferred;
-    LegacyReceive = WorkItem->LegacyReceive;
-
-    ExFreePoolWithTag(WorkItem, WQ_CONTEXT_TAG);
-
-    Interface = Adapter->Context;
+    PIP_INTERFACE Interface = Adapter->Context;
 
     IPInitializePacket(&IPPacket, 0);
 
-    IPPacket.NdisPacket = Packet;
-    IPPacket.ReturnPacket = !LegacyReceive;
+    IPPacket.NdisPacket = Entry->Packet;
+    IPPacket.ReturnPacket = !Entry->LegacyReceive;
 
-    if (LegacyReceive)
+    if (Entry->LegacyReceive)
     {
         /* Packet type is precomputed */
         PacketType = PC(IPPacket.NdisPacket)->PacketType;
@@ -339,7 +315,7 @@ VOID LanReceiveWorker( PVOID Context ) {
         IPPacket.Position = 0;
 
         /* Packet size is determined by bytes transferred */
-        IPPacket.TotalSize = BytesTransferred;
+        IPPacket.TotalSize = Entry->BytesTransferred;
     }
     else
     {
@@ -385,26 +361,128 @@ VOID LanReceiveWorker( PVOID Context ) {
     }
 }
 
-VOID LanSubmitReceiveWork(
+VOID LanReceiveWorker( PVOID Context ) {
+    PLAN_ADAPTER Adapter = Context;
+    LAN_RECV_ENTRY Batch[LAN_RECV_BATCH];
+    UINT Count, i;
+    KIRQL OldIrql;
+
+    TI_DbgPrint(DEBUG_DATALINK, ("Called.\n"));
+
+    /* Keep draining the ring until the indications stop, so a busy adapter
+     * only costs us one work item */
+    for (;;)
+    {
+        TcpipAcquireSpinLock(&Adapter->ReceiveLock, &OldIrql);
+
+        Count = min(Adapter->ReceiveCount, LAN_RECV_BATCH);
+        if (Count == 0)
+        {
+            /* The next indication queues a new worker */
+            Adapter->ReceiveWorkerQueued = FALSE;
+            KeSetEvent(&Adapter->ReceiveIdle, 0, FALSE);
+            TcpipReleaseSpinLock(&Adapter->ReceiveLock, OldIrql);
+            break;
+        }
+
+        for (i = 0; i < Count; i++)
+        {
+            Batch[i] = Adapter->ReceiveRing[Adapter->ReceiveHead];
+            Adapter->ReceiveHead = (Adapter->ReceiveHead + 1) & (IP_MAX_RECV_BACKLOG - 1);
+        }
+        Adapter->ReceiveCount -= Count;
+
+        Adapter->ReceiveBatches++;
+        Adapter->ReceivePackets += Count;
+        if (Count > Adapter->ReceiveMaxBatch)
+            Adapter->ReceiveMaxBatch = Count;
+
+        TcpipReleaseSpinLock(&Adapter->ReceiveLock, OldIrql);
+
+        for (i = 0; i < Count; i++)
+            LanReceivePacket(Adapter, &Batch[i]);
+    }
+}
+
+BOOLEAN LanSubmitReceiveWork(
     NDIS_HANDLE BindingContext,
     PNDIS_PACKET Packet,
     UINT BytesTransferred,
-    BOOLEAN LegacyReceive) {
-    PLAN_WQ_ITEM WQItem = ExAllocatePoolWithTag(NonPagedPool, sizeof(LAN_WQ_ITEM),
-                                                WQ_CONTEXT_TAG);
+    BOOLEAN LegacyReceive)
+/*
+ * FUNCTION: Queues a received packet for the receive worker
+ * RETURNS:
+ *     FALSE if the packet was dropped, it is still owned by the caller then
+ */
+{
     PLAN_ADAPTER Adapter = (PLAN_ADAPTER)BindingContext;
+    PLAN_RECV_ENTRY Entry;
+    BOOLEAN Queued = FALSE;
+    KIRQL OldIrql;
 
     TI_DbgPrint(DEBUG_DATALINK,("called\n"));
 
-    if (!WQItem) return;
+    TcpipAcquireSpinLock(&Adapter->ReceiveLock, &OldIrql);
+
+    if (Adapter->ReceiveStopped)
+    {
+        TcpipReleaseSpinLock(&Adapter->ReceiveLock, OldIrql);
+        return FALSE;
+    }
+
+    if (Adapter->ReceiveCount < IP_MAX_RECV_BACKLOG)
+    {
+        Entry = &Adapter->ReceiveRing[(Adapter->ReceiveHead + Adapter->ReceiveCount) &
+                                      (IP_MAX_RECV_BACKLOG - 1)];
+        Entry->Packet = Packet;
+        Entry->BytesTransferred = BytesTransferred;
+        Entry->LegacyReceive = LegacyReceive;
+        Adapter->ReceiveCount++;
+        Queued = TRUE;
+    }
+    else
+    {
+        TI_DbgPrint(MID_TRACE, ("Receive ring is full, dropping packet\n"));
+        Adapter->ReceiveDrops++;
+        ((PIP_INTERFACE)Adapter->Context)->Stats.InDiscarded++;
+    }
+
+    /* Also retried when the ring is full, in case an earlier attempt failed */
+    if (!Adapter->ReceiveWorkerQueued && ChewCreate(LanReceiveWorker, Adapter))
+    {
+        Adapter->ReceiveWorkerQueued = TRUE;
+        KeClearEvent(&Adapter->ReceiveIdle);
+    }
+
+    TcpipReleaseSpinLock(&Adapter->ReceiveLock, OldIrql);
+
+    return Queued;
+}
+
+static VOID LanFlushReceiveRing( PLAN_ADAPTER Adapter ) {
+    PLAN_RECV_ENTRY Entry;
+    KIRQL OldIrql;
+
+    /* Only packets we could not queue a worker for are left */
+    TcpipAcquireSpinLock(&Adapter->ReceiveLock, &OldIrql);
+
+    while (Adapter->ReceiveCount)
+    {
+        Entry = &Adapter->ReceiveRing[Adapter->ReceiveHead];
+        Adapter->ReceiveHead = (Adapter->ReceiveHead + 1) & (IP_MAX_RECV_BACKLOG - 1);
+        Adapter->ReceiveCount--;
+
+        if (Entry->LegacyReceive)
+            FreeNdisPacket(Entry->Packet);
+        else
+            NdisReturnPackets(&Entry->Packet, 1);
+    }
 
-    WQItem->Packet = Packet;
-    WQItem->Adapter = Adapter;
-    WQItem->BytesTransferred = BytesTransferred;
-    WQItem->LegacyReceive = LegacyReceive;
+    TcpipReleaseSpinLock(&Adapter->ReceiveLock, OldIrql);
 
-    if (!ChewCreate( LanReceiveWorker, WQItem ))
-        ExFreePoolWithTag(WQItem, WQ_CONTEXT_TAG);
+    TI_DbgPrint(DEBUG_DATALINK, ("Received %u packets in %u batches (largest %u), dropped %u\n",
+                                 Adapter->ReceivePackets, Adapter->ReceiveBatches,
+                                 Adapter->ReceiveMaxBatch, Adapter->ReceiveDrops));
 }
 
 VOID NTAPI ProtocolTransferDataComplete(
@@ -433,10 +511,13 @@ VOID NTAPI ProtocolTransferDataComplete(
 
     if( Status != NDIS_STATUS_SUCCESS ) return;
 
-    LanSubmitReceiveWork(BindingContext,
-                         Packet,
-                         BytesTransferred,
-                         TRUE);
+    if (!LanSubmitReceiveWork(BindingContext,
+                              Packet,
+                              BytesTransferred,
+                              TRUE))
+    {
+        FreeNdisPacket(Packet);
+    }
 }
 
 INT NTAPI ProtocolReceivePacket(
@@ -450,10 +531,14 @@ INT NTAPI ProtocolReceivePacket(
         return 0;
     }
 
-    LanSubmitReceiveWork(BindingContext,
-                         NdisPacket,
-                         0, /* Unused */
-                         FALSE);
+    if (!LanSubmitReceiveWork(BindingContext,
+                              NdisPacket,
+                              0, /* Unused */
+                              FALSE))
+    {
+        /* Dropped, the miniport keeps the packet */
+        return 0;
+    }
 
     /* Hold 1 reference on this packet */
     return 1;
@@ -1509,6 +1594,10 @@ NDIS_STATUS LANRegisterAdapter(
 
     KeInitializeEvent(&IF->Event, SynchronizationEvent, FALSE);
 
+    /* Initialize the receive ring */
+    KeInitializeSpinLock(&IF->ReceiveLock);
+    KeInitializeEvent(&IF->ReceiveIdle, NotificationEvent, TRUE);
+
     /* Initialize array with media IDs we support */
     MediaArray[MEDIA_ETH] = NdisMedium802_3;
 
@@ -1620,6 +1709,19 @@ NDIS_STATUS LANUnregisterAdapter(
     /* Unlink the adapter from the list */
     RemoveEntryList(&Adapter->ListEntry);
 
+    /* Stop queueing packets and let the worker pass up those already queued
+     * while the interface is still there */
+    TcpipAcquireSpinLock(&Adapter->ReceiveLock, &OldIrql);
+    Adapter->ReceiveStopped = TRUE;
+    TcpipReleaseSpinLock(&Adapter->ReceiveLock, OldIrql);
+
+    TcpipWaitForSingleObject(&Adapter->ReceiveIdle,
+                             UserRequest,
+                             KernelMode,
+                             FALSE,
+                             NULL);
+    LanFlushReceiveRing(Adapter);
+
     /* Unbind adapter from IP layer */
     UnbindAdapter(Adapter);
 
@@ -7,7 +7,11 @@
 
 #pragma once
 
+/* Address files by protocol and port, protected by AddressFileListLock */
+#define ADDR_FILE_HASH_SIZE 2048
+
 extern LIST_ENTRY AddressFileListHead;
+extern LIST_ENTRY AddressFileHashTable[ADDR_FILE_HASH_SIZE];
 extern KSPIN_LOCK AddressFileListLock;
 extern LIST_ENTRY ConnectionEndpointListHead;
 extern KSPIN_LOCK ConnectionEndpointListLock;
@@ -32,8 +32,18 @@ typedef struct ETH_HEADER {
 /* Offset of broadcast address */
 #define BCAST_ETH_OFFSET 0x00
 
-/* Max packets queued for a single adapter */
-#define IP_MAX_RECV_BACKLOG 0x20
+/* Max packets queued for a single adapter, must be a power of 2 */
+#define IP_MAX_RECV_BACKLOG 0x100
+
+/* Max packets the receive worker takes off the ring at once */
+#define LAN_RECV_BATCH 0x20
+
+/* Received packet waiting for the receive worker */
+typedef struct LAN_RECV_ENTRY {
+    PNDIS_PACKET Packet;                    /* Packet from the miniport or our transfer packet */
+    UINT BytesTransferred;                  /* Size of a transferred packet */
+    BOOLEAN LegacyReceive;                  /* Packet was transferred by ProtocolReceive */
+} LAN_RECV_ENTRY, *PLAN_RECV_ENTRY;
 
 /* Per adapter information */
 typedef struct LAN_ADAPTER {
@@ -59,6 +69,17 @@ typedef struct LAN_ADAPTER {
     UINT MacOptions;                        /* MAC options for NIC driver/adapter */
     UINT Speed;                             /* Link speed */
     UINT PacketFilter;                      /* Packet filter for this adapter */
+    KSPIN_LOCK ReceiveLock;                 /* Lock for the receive ring */
+    LAN_RECV_ENTRY ReceiveRing[IP_MAX_RECV_BACKLOG]; /* Received packets */
+    UINT ReceiveHead;                       /* Oldest packet in the ring */
+    UINT ReceiveCount;                      /* Number of packets in the ring */
+    BOOLEAN ReceiveWorkerQueued;            /* Receive worker is queued or running */
+    BOOLEAN ReceiveStopped;                 /* Adapter is going away */
+    KEVENT ReceiveIdle;                     /* Set while no receive worker is queued */
+    ULONG ReceiveBatches;                   /* Batches passed up by the receive worker */
+    ULONG ReceivePackets;                   /* Packets passed up by the receive worker */
+    ULONG ReceiveMaxBatch;                  /* Largest batch */
+    ULONG ReceiveDrops;                     /* Packets dropped because the ring was full */
 } LAN_ADAPTER, *PLAN_ADAPTER;
 
 /* LAN adapter state constants */
@@ -15,6 +15,8 @@ typedef struct _PORT_SET {
     PVOID ProtoBitBuffer;
     UINT StartingPort;
     UINT PortsToOversee;
+    ULONG NextPort;      /* Where the next search for a free port starts */
+    ULONG Seed;          /* Picks the first port of a search at random */
     KSPIN_LOCK Lock;
 } PORT_SET, *PPORT_SET;
 
@@ -188,6 +188,10 @@ BOOLEAN TCPRemoveIRP( PCONNECTION_ENDPOINT Connection, PIRP Irp );
 
 NTSTATUS TCPSetNoDelay(PCONNECTION_ENDPOINT Connection, BOOLEAN Set);
 
+NTSTATUS TCPSetReceiveWindow(PCONNECTION_ENDPOINT Connection, ULONG Size);
+
+NTSTATUS TCPSetSendBuffer(PCONNECTION_ENDPOINT Connection, ULONG Size);
+
 VOID
 TCPUpdateInterfaceLinkStatus(PIP_INTERFACE IF);
 
@@ -206,6 +210,9 @@ FlushReceiveQueue(PCONNECTION_ENDPOINT Connection, const NTSTATUS Status, const
 VOID
 FlushSendQueue(PCONNECTION_ENDPOINT Connection, const NTSTATUS Status, const BOOLEAN interlocked);
 
+VOID
+CompleteAcknowledgedSends(PCONNECTION_ENDPOINT Connection, const BOOLEAN interlocked);
+
 VOID
 FlushShutdownQueue(PCONNECTION_ENDPOINT Connection, const NTSTATUS Status, const BOOLEAN interlocked);
 
@@ -129,6 +129,7 @@ typedef struct _DATAGRAM_SEND_REQUEST {
    field holds a pointer to this structure */
 typedef struct _ADDRESS_FILE {
     LIST_ENTRY ListEntry;                 /* Entry on list */
+    LIST_ENTRY HashEntry;                 /* Entry on hash chain of its port */
     LONG RefCount;                        /* Reference count */
     OBJECT_FREE_ROUTINE Free;             /* Routine to use to free resources for the object */
     KSPIN_LOCK Lock;                      /* Spin lock to manipulate this structure */
@@ -201,6 +202,7 @@ typedef struct _ADDRESS_FILE {
 
 /* Structure used to search through Address Files */
 typedef struct _AF_SEARCH {
+    PLIST_ENTRY Head;       /* Hash chain being searched */
     PLIST_ENTRY Next;       /* Next address file to check */
     PIP_ADDRESS Address;    /* Pointer to address to be found */
     USHORT Port;            /* Network port */
@@ -252,6 +254,8 @@ typedef struct _TDI_BUCKET {
     TDI_REQUEST Request;
     NTSTATUS Status;
     ULONG Information;
+    ULONG Flags;                /* TDI_SEND_* flags of a send request */
+    ULONG Sequence;             /* Zero-copy sends: sequence number after their last byte */
 } TDI_BUCKET, *PTDI_BUCKET;
 
 /* Transport connection context structure A.K.A. Transmission Control Block
@@ -273,6 +277,7 @@ typedef struct _CONNECTION_ENDPOINT {
     LIST_ENTRY ReceiveRequest; /* Queued receive requests */
     LIST_ENTRY SendRequest;    /* Queued send requests */
     LIST_ENTRY ShutdownRequest;/* Queued shutdown requests */
+    LIST_ENTRY SendAckRequest; /* Zero-copy sends waiting for their data to be acknowledged */
 
     LIST_ENTRY PacketQueue;    /* Queued received packets waiting to be processed */
     
@@ -24,6 +24,18 @@ TDI_STATUS SetConnectionInfo(TDIObjectID *ID,
             Set = *(BOOLEAN*)Buffer;
             return TCPSetNoDelay(Connection, Set);
         }
+        case TCP_SOCKET_WINDOW:
+        {
+            if (BufferSize < sizeof(ULONG))
+                return TDI_INVALID_PARAMETER;
+            return TCPSetReceiveWindow(Connection, *(PULONG)Buffer);
+        }
+        case TCP_SOCKET_SEND_BUFFER:
+        {
+            if (BufferSize < sizeof(ULONG))
+                return TDI_INVALID_PARAMETER;
+            return TCPSetSendBuffer(Connection, *(PULONG)Buffer);
+        }
         default:
             DbgPrint("TCPIP: Unknown connection info ID: %u.\n", ID->toi_id);
     }
@@ -1518,6 +1518,15 @@ NTSTATUS DispTdiSetInformationEx(
         break;
 
     case TDI_CONNECTION_FILE:
+        /* Connection options sent to a connection endpoint apply to it directly */
+        if (Info->ID.toi_class == INFO_CLASS_PROTOCOL &&
+            Info->ID.toi_type == INFO_TYPE_CONNECTION)
+        {
+            return SetConnectionInfo(&Info->ID,
+                                     TranContext->Handle.ConnectionContext,
+                                     &Info->Buffer,
+                                     Info->BufferSize);
+        }
         Request.Handle.ConnectionContext = TranContext->Handle.ConnectionContext;
         break;
 
@@ -10,6 +10,8 @@
 
 #include "precomp.h"
 
+#include <fileobjs.h>
+
 /* FIXME: including pstypes.h without ntifs fails */
 #include <ntifs.h>
 #include <ndk/pstypes.h>
@@ -21,6 +23,35 @@
 LIST_ENTRY AddressFileListHead;
 KSPIN_LOCK AddressFileListLock;
 
+/* Hash chains of the address files that receive datagrams. TCP address
+   files are only on the global list, lwIP demultiplexes TCP segments and
+   they may get their port after they were opened */
+LIST_ENTRY AddressFileHashTable[ADDR_FILE_HASH_SIZE];
+
+static
+PLIST_ENTRY
+AddrFileHashHead(
+    USHORT Port,
+    USHORT Protocol)
+{
+    if (Protocol == IPPROTO_TCP)
+        return &AddressFileListHead;
+
+    return &AddressFileHashTable[(WN2H(Port) + Protocol) & (ADDR_FILE_HASH_SIZE - 1)];
+}
+
+static
+PADDRESS_FILE
+AddrFileFromEntry(
+    PLIST_ENTRY Head,
+    PLIST_ENTRY Entry)
+{
+    if (Head == &AddressFileListHead)
+        return CONTAINING_RECORD(Entry, ADDRESS_FILE, ListEntry);
+
+    return CONTAINING_RECORD(Entry, ADDRESS_FILE, HashEntry);
+}
+
 /* List of all connection endpoint file objects managed by this driver */
 LIST_ENTRY ConnectionEndpointListHead;
 KSPIN_LOCK ConnectionEndpointListLock;
@@ -46,13 +77,14 @@ PADDRESS_FILE AddrSearchFirst(
     SearchContext->Address  = Address;
     SearchContext->Port     = Port;
     SearchContext->Protocol = Protocol;
+    SearchContext->Head     = AddrFileHashHead(Port, Protocol);
 
     TcpipAcquireSpinLock(&AddressFileListLock, &OldIrql);
 
-    SearchContext->Next = AddressFileListHead.Flink;
+    SearchContext->Next = SearchContext->Head->Flink;
 
-    if (!IsListEmpty(&AddressFileListHead))
-        ReferenceObject(CONTAINING_RECORD(SearchContext->Next, ADDRESS_FILE, ListEntry));
+    if (!IsListEmpty(SearchContext->Head))
+        ReferenceObject(AddrFileFromEntry(SearchContext->Head, SearchContext->Next));
 
     TcpipReleaseSpinLock(&AddressFileListLock, OldIrql);
 
@@ -192,15 +224,17 @@ PADDRESS_FILE AddrFindShared(
     USHORT Port,
     USHORT Protocol)
 {
-    PLIST_ENTRY CurrentEntry;
+    PLIST_ENTRY CurrentEntry, Head;
     KIRQL OldIrql;
     PADDRESS_FILE Current = NULL;
 
+    Head = AddrFileHashHead(Port, Protocol);
+
     TcpipAcquireSpinLock(&AddressFileListLock, &OldIrql);
 
-    CurrentEntry = AddressFileListHead.Flink;
-    while (CurrentEntry != &AddressFileListHead) {
-        Current = CONTAINING_RECORD(CurrentEntry, ADDRESS_FILE, ListEntry);
+    CurrentEntry = Head->Flink;
+    while (CurrentEntry != Head) {
+        Current = AddrFileFromEntry(Head, CurrentEntry);
 
         /* See if this address matches the search criteria */
         if ((Current->Port == Port) &&
@@ -240,19 +274,19 @@ PADDRESS_FILE AddrSearchNext(
     
     TcpipAcquireSpinLock(&AddressFileListLock, &OldIrql);
 
-    if (SearchContext->Next == &AddressFileListHead)
+    if (SearchContext->Next == SearchContext->Head)
     {
         TcpipReleaseSpinLock(&AddressFileListLock, OldIrql);
         return NULL;
     }
 
     /* Save this pointer so we can dereference it later */
-    StartingAddrFile = CONTAINING_RECORD(SearchContext->Next, ADDRESS_FILE, ListEntry);
+    StartingAddrFile = AddrFileFromEntry(SearchContext->Head, SearchContext->Next);
 
     CurrentEntry = SearchContext->Next;
 
-    while (CurrentEntry != &AddressFileListHead) {
-        Current = CONTAINING_RECORD(CurrentEntry, ADDRESS_FILE, ListEntry);
+    while (CurrentEntry != SearchContext->Head) {
+        Current = AddrFileFromEntry(SearchContext->Head, CurrentEntry);
 
         IPAddress = &Current->Address;
 
@@ -279,10 +313,10 @@ PADDRESS_FILE AddrSearchNext(
     {
         SearchContext->Next = CurrentEntry->Flink;
 
-        if (SearchContext->Next != &AddressFileListHead)
+        if (SearchContext->Next != SearchContext->Head)
         {
             /* Reference the next address file to prevent the link from disappearing behind our back */
-            ReferenceObject(CONTAINING_RECORD(SearchContext->Next, ADDRESS_FILE, ListEntry));
+            ReferenceObject(AddrFileFromEntry(SearchContext->Head, SearchContext->Next));
         }
 
         /* Reference the returned address file before dereferencing the starting
@@ -318,9 +352,10 @@ VOID AddrFileFree(
   /* We should not be associated with a connection here */
   ASSERT(!AddrFile->Connection);
 
-  /* Remove address file from the global list */
+  /* Remove address file from the global list and its hash chain */
   TcpipAcquireSpinLock(&AddressFileListLock, &OldIrql);
   RemoveEntryList(&AddrFile->ListEntry);
+  RemoveEntryList(&AddrFile->HashEntry);
   TcpipReleaseSpinLock(&AddressFileListLock, OldIrql);
 
   /* FIXME: Kill TCP connections on this address file object */
@@ -396,6 +431,7 @@ NTSTATUS FileOpenAddress(
   PVOID Options)
 {
   PADDRESS_FILE AddrFile;
+  KIRQL OldIrql;
 
   TI_DbgPrint(MID_TRACE, ("Called (Proto %d).\n", Protocol));
 
@@ -558,11 +594,14 @@ NTSTATUS FileOpenAddress(
   /* Return address file object */
   Request->Handle.AddressHandle = AddrFile;
 
-  /* Add address file to global list */
-  ExInterlockedInsertTailList(
-    &AddressFileListHead,
-    &AddrFile->ListEntry,
-    &AddressFileListLock);
+  /* Add address file to global list, and to the hash chain of its port */
+  TcpipAcquireSpinLock(&AddressFileListLock, &OldIrql);
+  InsertTailList(&AddressFileListHead, &AddrFile->ListEntry);
+  if (Protocol == IPPROTO_TCP)
+      InitializeListHead(&AddrFile->HashEntry);
+  else
+      InsertTailList(AddrFileHashHead(AddrFile->Port, Protocol), &AddrFile->HashEntry);
+  TcpipReleaseSpinLock(&AddressFileListLock, OldIrql);
 
   TI_DbgPrint(MAX_TRACE, ("Leaving.\n"));
 
@@ -631,6 +631,7 @@ DriverEntry(
     UNICODE_STRING strNdisDeviceName = RTL_CONSTANT_STRING(TCPIP_PROTOCOL_NAME);
     NDIS_STATUS NdisStatus;
     LARGE_INTEGER DueTime;
+    ULONG i;
 
     TI_DbgPrint(MAX_TRACE, ("[TCPIP, DriverEntry] Called\n"));
 
@@ -709,8 +710,10 @@ DriverEntry(
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    /* Initialize address file list and protecting spin lock */
+    /* Initialize address file list, hash table and protecting spin lock */
     InitializeListHead(&AddressFileListHead);
+    for (i = 0; i < ADDR_FILE_HASH_SIZE; i++)
+        InitializeListHead(&AddressFileHashTable[i]);
     KeInitializeSpinLock(&AddressFileListLock);
 
     /* Initialize connection endpoint list and protecting spin lock */
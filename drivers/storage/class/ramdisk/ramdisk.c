@@ -40,6 +40,9 @@
 
 #define TOC_DATA_TRACK              (0x04)
 
+/* Largest boot disk kept mapped for its whole lifetime, 8K system PTEs on x86 */
+#define RAMDISK_MAX_PERMANENT_VIEW  (0x2000000u)
+
 typedef enum _RAMDISK_DEVICE_TYPE
 {
     RamdiskBus,
@@ -104,6 +107,10 @@ typedef struct _RAMDISK_DRIVE_EXTENSION
     WCHAR DriveLetter;
     ULONG BasePage;
 
+    /* Boot disks stay mapped for their lifetime, if the view fits */
+    PVOID MappedBase;
+    SIZE_T MappedLength;
+
     /* Data we get from the disk */
     ULONG BytesPerSector;
     ULONG SectorsPerTrack;
@@ -284,6 +291,13 @@ RamdiskMapPages(IN PRAMDISK_DRIVE_EXTENSION DeviceExtension,
     /* Calculate the actual offset in the drive */
     ActualOffset.QuadPart = DeviceExtension->DiskOffset + Offset.QuadPart;
 
+    /* Use the persistent view if we have one */
+    if (DeviceExtension->MappedBase)
+    {
+        *OutputLength = Length;
+        return (PVOID)((ULONG_PTR)DeviceExtension->MappedBase + ActualOffset.LowPart);
+    }
+
     /* Convert to pages */
     ActualPages.QuadPart = ActualOffset.QuadPart >> PAGE_SHIFT;
 
@@ -325,6 +339,9 @@ RamdiskUnmapPages(IN PRAMDISK_DRIVE_EXTENSION DeviceExtension,
     /* We only support boot disks for now */
     ASSERT(DeviceExtension->DiskType == RAMDISK_BOOT_DISK);
 
+    /* The persistent view is only unmapped with the disk */
+    if (DeviceExtension->MappedBase) return;
+
     /* Calculate the actual offset in the drive */
     ActualOffset.QuadPart = DeviceExtension->DiskOffset + Offset.QuadPart;
 
@@ -344,6 +361,34 @@ RamdiskUnmapPages(IN PRAMDISK_DRIVE_EXTENSION DeviceExtension,
     MmUnmapIoSpace(BaseAddress, ActualLength);
 }
 
+VOID
+NTAPI
+RamdiskMapDisk(IN PRAMDISK_DRIVE_EXTENSION DeviceExtension)
+{
+    PHYSICAL_ADDRESS PhysicalAddress;
+    ULONGLONG ActualLength;
+
+    /* We only support boot disks for now */
+    ASSERT(DeviceExtension->DiskType == RAMDISK_BOOT_DISK);
+
+    /* The view covers the whole disk, starting at the base page */
+    ActualLength = DeviceExtension->DiskOffset + DeviceExtension->DiskLength.QuadPart;
+    ActualLength = (ActualLength + PAGE_SIZE - 1) & ~(ULONGLONG)(PAGE_SIZE - 1);
+
+    /* Don't eat up system PTEs for big disks, they get mapped per request */
+    if (ActualLength > min(MaximumPerDiskViewLength, RAMDISK_MAX_PERMANENT_VIEW)) return;
+
+    /* Map the I/O Space from the loader once and for all */
+    PhysicalAddress.QuadPart = (ULONGLONG)DeviceExtension->BasePage << PAGE_SHIFT;
+    DeviceExtension->MappedBase = MmMapIoSpace(PhysicalAddress,
+                                               (SIZE_T)ActualLength,
+                                               MmCached);
+    if (DeviceExtension->MappedBase)
+    {
+        DeviceExtension->MappedLength = (SIZE_T)ActualLength;
+    }
+}
+
 NTSTATUS
 NTAPI
 RamdiskCreateDiskDevice(IN PRAMDISK_BUS_EXTENSION DeviceExtension,
@@ -526,10 +571,15 @@ RamdiskCreateDiskDevice(IN PRAMDISK_BUS_EXTENSION DeviceExtension,
         DriveExtension->DiskLength = DiskLength;
         DriveExtension->DiskOffset = Input->DiskOffset;
         DriveExtension->BasePage = Input->BasePage;
+        DriveExtension->MappedBase = NULL;
+        DriveExtension->MappedLength = 0;
         DriveExtension->BytesPerSector = 0;
         DriveExtension->SectorsPerTrack = 0;
         DriveExtension->NumberOfHeads = 0;
 
+        /* Boot disks are in RAM already, keep them mapped if we can */
+        if (Input->DiskType == RAMDISK_BOOT_DISK) RamdiskMapDisk(DriveExtension);
+
         /* Make sure we don't free it later */
         DeviceName.Buffer = NULL;
         SymbolicLinkName.Buffer = NULL;
@@ -940,34 +990,11 @@ RamdiskReadWriteReal(IN PIRP Irp,
                      IN PRAMDISK_DRIVE_EXTENSION DeviceExtension)
 {
     PMDL Mdl;
-    PVOID CurrentBase, SystemVa, BaseAddress;
+    PVOID CurrentBase, BaseAddress;
     PIO_STACK_LOCATION IoStackLocation;
     LARGE_INTEGER CurrentOffset;
     ULONG BytesRead, BytesLeft, CopyLength;
     PVOID Source, Destination;
-    NTSTATUS Status;
-
-    /* Get the MDL and check if it's mapped */
-    Mdl = Irp->MdlAddress;
-    if (Mdl->MdlFlags & (MDL_MAPPED_TO_SYSTEM_VA | MDL_SOURCE_IS_NONPAGED_POOL))
-    {
-        /* Use the mapped address */
-        SystemVa = Mdl->MappedSystemVa;
-    }
-    else
-    {
-        /* Map it ourselves */
-        SystemVa = MmMapLockedPagesSpecifyCache(Mdl,
-                                                0,
-                                                MmCached,
-                                                NULL,
-                                                0,
-                                                NormalPagePriority);
-    }
-
-    /* Make sure we were able to map it */
-    CurrentBase = SystemVa;
-    if (!SystemVa) return STATUS_INSUFFICIENT_RESOURCES;
 
     /* Initialize default */
     Irp->IoStatus.Information = 0;
@@ -977,57 +1004,62 @@ RamdiskReadWriteReal(IN PIRP Irp,
     CurrentOffset = IoStackLocation->Parameters.Read.ByteOffset;
     BytesLeft = IoStackLocation->Parameters.Read.Length;
     if (!BytesLeft) return STATUS_INVALID_PARAMETER;
+    if ((IoStackLocation->MajorFunction != IRP_MJ_READ) &&
+        (IoStackLocation->MajorFunction != IRP_MJ_WRITE))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Don't go past the end of the disk */
+    if ((CurrentOffset.QuadPart < 0) ||
+        (CurrentOffset.QuadPart + BytesLeft > DeviceExtension->DiskLength.QuadPart))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
 
-    /* Do the copy loop */
-    while (TRUE)
+    /* Do the copy loop, one MDL of the chain at a time */
+    for (Mdl = Irp->MdlAddress; (Mdl) && (BytesLeft); Mdl = Mdl->Next)
     {
-        /* Map the pages */
+        /* Get a system address for this part of the buffer */
+        CurrentBase = MmGetSystemAddressForMdlSafe(Mdl, NormalPagePriority);
+        if (!CurrentBase) return STATUS_INSUFFICIENT_RESOURCES;
+        CopyLength = min(MmGetMdlByteCount(Mdl), BytesLeft);
+
+        /* Map the pages, this is free if the disk has a persistent view */
         BaseAddress = RamdiskMapPages(DeviceExtension,
                                       CurrentOffset,
-                                      BytesLeft,
+                                      CopyLength,
                                       &BytesRead);
         if (!BaseAddress) return STATUS_INSUFFICIENT_RESOURCES;
 
-        /* Update our lengths */
-        Irp->IoStatus.Information += BytesRead;
-        CopyLength = BytesRead;
-
         /* Check if this was a read or write */
-        Status = STATUS_SUCCESS;
         if (IoStackLocation->MajorFunction == IRP_MJ_READ)
         {
             /* Set our copy parameters */
             Destination = CurrentBase;
             Source = BaseAddress;
-            goto DoCopy;
         }
-        else if (IoStackLocation->MajorFunction == IRP_MJ_WRITE)
+        else
         {
             /* Set our copy parameters */
             Destination = BaseAddress;
             Source = CurrentBase;
-DoCopy:
-            /* Copy the data */
-            RtlCopyMemory(Destination, Source, CopyLength);
-        }
-        else
-        {
-            /* Prepare us for failure */
-            BytesLeft = CopyLength;
-            Status = STATUS_INVALID_PARAMETER;
         }
 
+        /* Copy the data */
+        RtlCopyMemory(Destination, Source, BytesRead);
+
         /* Unmap the pages */
         RamdiskUnmapPages(DeviceExtension, BaseAddress, CurrentOffset, BytesRead);
 
         /* Update offset and bytes left */
+        Irp->IoStatus.Information += BytesRead;
         BytesLeft -= BytesRead;
         CurrentOffset.QuadPart += BytesRead;
-        CurrentBase = (PVOID)((ULONG_PTR)CurrentBase + BytesRead);
-
-        /* Check if we are done */
-        if (!BytesLeft) return Status;
     }
+
+    /* The MDL chain must describe the whole transfer */
+    return BytesLeft ? STATUS_INVALID_PARAMETER : STATUS_SUCCESS;
 }
 
 NTSTATUS
@@ -1067,9 +1099,7 @@ RamdiskReadWrite(IN PDEVICE_OBJECT DeviceObject,
     // Length = IoStackLocation->Parameters.Read.Length;
     // ByteOffset = IoStackLocation->Parameters.Read.ByteOffset;
 
-    /* FIXME: Validate offset */
-
-    /* FIXME: Validate sector */
+    /* The offset is validated against the disk when doing the copy */
 
     /* Validate write */
     if ((IoStackLocation->MajorFunction == IRP_MJ_WRITE) &&
@@ -1080,7 +1110,8 @@ RamdiskReadWrite(IN PDEVICE_OBJECT DeviceObject,
         goto Complete;
     }
 
-    /* See if we want to do this sync or async */
+    /* See if we want to do this sync or async. Disks living in RAM are
+     * copied right away in the caller's context, no need for a thread */
     if (DeviceExtension->DiskType > RAMDISK_MEMORY_MAPPED_DISK)
     {
         /* Do it sync */
@@ -1679,9 +1679,10 @@ NTSTATUS NTAPI ClassReadWrite(IN PDEVICE_OBJECT DeviceObject, IN PIRP Irp)
 
                         /*
                          *  Perform the actual transfer(s) on the hardware
-                         *  to service this request.
+                         *  to service this request, possibly merged with
+                         *  adjacent ones by the elevator.
                          */
-                        ServiceTransferRequest(DeviceObject, Irp);
+                        ClasspElevatorSubmit(DeviceObject, Irp);
                         status = STATUS_PENDING;
                     }
                     else {
@@ -5520,6 +5521,46 @@ ClassDeviceControl(
         break;
     }
 
+    case IOCTL_STORAGE_GET_ELEVATOR_STATISTICS: {
+
+        PFUNCTIONAL_DEVICE_EXTENSION fdoExtension =
+            commonExtension->PartitionZeroExtension;
+        PCLASS_PRIVATE_FDO_DATA fdoData = fdoExtension->PrivateFdoData;
+
+        if(srb) {
+            ExFreePool(srb);
+        }
+
+        if(irpStack->Parameters.DeviceIoControl.OutputBufferLength >=
+           sizeof(STORAGE_ELEVATOR_STATISTICS)) {
+
+            KIRQL oldIrql;
+
+            //
+            // Statistics are kept for the whole disk.
+            //
+
+            KeAcquireSpinLock(&fdoData->Elevator.Lock, &oldIrql);
+            RtlCopyMemory(Irp->AssociatedIrp.SystemBuffer,
+                          &fdoData->Elevator.Stats,
+                          sizeof(STORAGE_ELEVATOR_STATISTICS));
+            KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+
+            status = STATUS_SUCCESS;
+            Irp->IoStatus.Information = sizeof(STORAGE_ELEVATOR_STATISTICS);
+
+        } else {
+            status = STATUS_BUFFER_TOO_SMALL;
+            Irp->IoStatus.Information = 0;
+        }
+
+        Irp->IoStatus.Status = status;
+        ClassReleaseRemoveLock(DeviceObject, Irp);
+        ClassCompleteRequest(DeviceObject, Irp, IO_NO_INCREMENT);
+
+        break;
+    }
+
     case IOCTL_STORAGE_GET_DEVICE_NUMBER: {
 
         if(srb) {
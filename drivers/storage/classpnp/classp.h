@@ -82,6 +82,7 @@ extern GUID ClassGuidQueryRegInfoEx;
 #define CLASS_TAG_PRIVATE_DATA              'CPcS'
 #define CLASS_TAG_PRIVATE_DATA_FDO          'FPcS'
 #define CLASS_TAG_PRIVATE_DATA_PDO          'PPcS'
+#define CLASS_TAG_ELEVATOR_MERGE            'EPcS'
 
 struct _MEDIA_CHANGE_DETECTION_INFO {
 
@@ -379,6 +380,16 @@ typedef struct _TRANSFER_PACKET {
 #define MIN_WORKINGSET_TRANSFER_PACKETS_Enterprise    256
 #define MAX_WORKINGSET_TRANSFER_PACKETS_Enterprise   2048
 
+/*
+ *  The elevator holds client read/write irps back once this many
+ *  transfers are outstanding at the device, so that it can sort and
+ *  merge them.  Adapters that queue commands in hardware get more.
+ *  CLASS_ELEVATOR_MAX_MERGE is the most client irps in one transfer.
+ */
+#define CLASS_ELEVATOR_TAGGED_DEPTH         32
+#define CLASS_ELEVATOR_UNTAGGED_DEPTH       2
+#define CLASS_ELEVATOR_MAX_MERGE            32
+
 
 //
 // add to the front of this structure to help prevent illegal
@@ -447,6 +458,19 @@ struct _CLASS_PRIVATE_FDO_DATA {
      */
     ULONG HwMaxXferLen;
 
+    /*
+     *  Elevator for client read/write irps (see elevator.c).
+     *  The queue holds the irps sorted by disk offset; the lock also
+     *  protects the statistics.
+     */
+    struct {
+        KSPIN_LOCK Lock;
+        LIST_ENTRY Queue;
+        LONGLONG NextOffset;
+        LARGE_INTEGER Frequency;
+        STORAGE_ELEVATOR_STATISTICS Stats;
+    } Elevator;
+
     /*
      *  SCSI_REQUEST_BLOCK template preconfigured with the constant values.
      *  This is slapped into the SRB in the TRANSFER_PACKET for each transfer.
@@ -866,6 +890,10 @@ PMDL NTAPI BuildDeviceInputMdl(PVOID Buffer, ULONG BufferLen);
 VOID NTAPI FreeDeviceInputMdl(PMDL Mdl);
 NTSTATUS NTAPI InitializeTransferPackets(PDEVICE_OBJECT Fdo);
 VOID NTAPI DestroyAllTransferPackets(PDEVICE_OBJECT Fdo);
+VOID NTAPI ClasspInitializeElevator(PDEVICE_OBJECT Fdo);
+VOID NTAPI ClasspElevatorSubmit(PDEVICE_OBJECT Fdo, PIRP Irp);
+VOID NTAPI ClasspElevatorTransferDone(PCLASS_PRIVATE_FDO_DATA FdoData, PIRP Irp);
+VOID NTAPI ClasspElevatorStartNext(PDEVICE_OBJECT Fdo);
 
 #include "debug.h"
 
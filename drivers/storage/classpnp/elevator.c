@@ -0,0 +1,436 @@
+/*
+ * PROJECT:     ReactOS Storage Stack
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Elevator for client read/write requests
+ *
+ *  While the device has enough transfers outstanding, client read/write
+ *  irps are held back in a queue sorted by disk offset.  As transfers
+ *  complete, the queue is serviced in ascending order from where the last
+ *  transfer ended (C-LOOK), and irps that continue each other on the disk
+ *  and in memory are sent down as a single transfer of up to HwMaxXferLen.
+ */
+
+#include "classp.h"
+
+/*
+ *  A client irp that went through the elevator points to the
+ *  elevator's FDO data and remembers when it arrived.
+ */
+#define ELEVATOR_IRP_OWNER(Irp)       ((Irp)->Tail.Overlay.DriverContext[1])
+#define ELEVATOR_IRP_START_TIME(Irp)  (*(PLARGE_INTEGER)&(Irp)->Tail.Overlay.DriverContext[2])
+
+/*
+ *  Completion context of a merged transfer.  The private irp's own list
+ *  entry is not free to hold the client irps, since the transfer packet
+ *  engine queues the irp by it when it runs out of packets.
+ */
+typedef struct _ELEVATOR_MERGE_CONTEXT {
+    PDEVICE_OBJECT Fdo;
+    LIST_ENTRY ClientIrps;
+} ELEVATOR_MERGE_CONTEXT, *PELEVATOR_MERGE_CONTEXT;
+
+static NTSTATUS NTAPI ClasspElevatorMergedComplete(IN PDEVICE_OBJECT NullFdo, IN PIRP Irp, IN PVOID Context);
+
+
+/*
+ *  ClasspInitializeElevator
+ *
+ *      Called when the transfer packets are initialized, once
+ *      HwMaxXferLen is known.
+ */
+VOID NTAPI ClasspInitializeElevator(PDEVICE_OBJECT Fdo)
+{
+    PCOMMON_DEVICE_EXTENSION commonExt = Fdo->DeviceExtension;
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_PRIVATE_FDO_DATA fdoData = fdoExt->PrivateFdoData;
+    PSTORAGE_ADAPTER_DESCRIPTOR adapterDesc = commonExt->PartitionZeroExtension->AdapterDescriptor;
+
+    KeInitializeSpinLock(&fdoData->Elevator.Lock);
+    InitializeListHead(&fdoData->Elevator.Queue);
+    fdoData->Elevator.NextOffset = 0;
+    KeQueryPerformanceCounter(&fdoData->Elevator.Frequency);
+
+    RtlZeroMemory(&fdoData->Elevator.Stats, sizeof(STORAGE_ELEVATOR_STATISTICS));
+    fdoData->Elevator.Stats.MaxOutstanding = adapterDesc->CommandQueueing ?
+                                             CLASS_ELEVATOR_TAGGED_DEPTH :
+                                             CLASS_ELEVATOR_UNTAGGED_DEPTH;
+}
+
+
+/*
+ *  ClasspElevatorRecordLatency
+ *
+ *      Account a completing client irp in the latency histogram.
+ */
+static VOID ClasspElevatorRecordLatency(PCLASS_PRIVATE_FDO_DATA FdoData, PIRP Irp)
+{
+    LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+    ULONGLONG usecs, v;
+    ULONG bucket = 0;
+
+    usecs = (ULONGLONG)(now.QuadPart - ELEVATOR_IRP_START_TIME(Irp).QuadPart) * 1000000 /
+            FdoData->Elevator.Frequency.QuadPart;
+    for (v = usecs >> 5; v && (bucket < STORAGE_ELEVATOR_LATENCY_BUCKETS-1); v >>= 1){
+        bucket++;
+    }
+
+    InterlockedIncrement((PLONG)&FdoData->Elevator.Stats.LatencyHistogram[bucket]);
+    ELEVATOR_IRP_OWNER(Irp) = NULL;
+}
+
+
+/*
+ *  ClasspElevatorCanMerge
+ *
+ *      Returns TRUE if NextIrp continues PrevIrp both on the disk and
+ *      in memory, such that one MDL can describe both buffers.
+ *      Must be called with the elevator lock held.
+ */
+static BOOLEAN ClasspElevatorCanMerge(PCLASS_PRIVATE_FDO_DATA FdoData, PIRP PrevIrp, PIRP NextIrp, ULONG MergedLen)
+{
+    PIO_STACK_LOCATION prevSp = IoGetCurrentIrpStackLocation(PrevIrp);
+    PIO_STACK_LOCATION nextSp = IoGetCurrentIrpStackLocation(NextIrp);
+    ULONG prevLen = prevSp->Parameters.Read.Length;
+    ULONG nextLen = nextSp->Parameters.Read.Length;
+
+    if ((prevSp->MajorFunction != nextSp->MajorFunction) ||
+        (prevSp->Flags != nextSp->Flags) ||
+        ((PrevIrp->Flags ^ NextIrp->Flags) & IRP_PAGING_IO)){
+        return FALSE;
+    }
+
+    if ((prevSp->Parameters.Read.ByteOffset.QuadPart + prevLen != nextSp->Parameters.Read.ByteOffset.QuadPart) ||
+        (MergedLen + nextLen > FdoData->HwMaxXferLen)){
+        return FALSE;
+    }
+
+    /*
+     *  The previous buffer must end on a page boundary
+     *  and the next one start on one.
+     */
+    if (PrevIrp->MdlAddress->Next || NextIrp->MdlAddress->Next ||
+        ((MmGetMdlByteOffset(PrevIrp->MdlAddress) + prevLen) & (PAGE_SIZE-1)) ||
+        MmGetMdlByteOffset(NextIrp->MdlAddress)){
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/*
+ *  ClasspElevatorSendMerged
+ *
+ *      Send the client irps in MergedList down as a single transfer.
+ *      A private irp with an MDL made up of the clients' pages
+ *      goes through the transfer packet engine in their place.
+ */
+static VOID ClasspElevatorSendMerged(PDEVICE_OBJECT Fdo, PLIST_ENTRY MergedList, ULONG NumIrps, ULONG MergedLen)
+{
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_PRIVATE_FDO_DATA fdoData = fdoExt->PrivateFdoData;
+    PIRP firstIrp = CONTAINING_RECORD(MergedList->Flink, IRP, Tail.Overlay.ListEntry);
+    PIO_STACK_LOCATION firstSp = IoGetCurrentIrpStackLocation(firstIrp);
+    PIO_STACK_LOCATION sp;
+    PLIST_ENTRY listEntry;
+    PELEVATOR_MERGE_CONTEXT context;
+    PPFN_NUMBER pages;
+    KIRQL oldIrql;
+    PIRP irp, clientIrp;
+    PMDL mdl;
+
+    context = ExAllocatePoolWithTag(NonPagedPool, sizeof(ELEVATOR_MERGE_CONTEXT), CLASS_TAG_ELEVATOR_MERGE);
+    irp = IoAllocateIrp(1, FALSE);
+    mdl = IoAllocateMdl(MmGetMdlVirtualAddress(firstIrp->MdlAddress), MergedLen, FALSE, FALSE, NULL);
+    if (!context || !irp || !mdl){
+        /*
+         *  Send the client irps down one by one instead.
+         */
+        DBGWARN(("ClasspElevatorSendMerged: no memory, sending %d irps unmerged", NumIrps));
+        if (context) ExFreePool(context);
+        if (irp) IoFreeIrp(irp);
+        if (mdl) IoFreeMdl(mdl);
+
+        KeAcquireSpinLock(&fdoData->Elevator.Lock, &oldIrql);
+        fdoData->Elevator.Stats.Outstanding += NumIrps-1;
+        fdoData->Elevator.Stats.TransferCount += NumIrps-1;
+        fdoData->Elevator.Stats.MergedCount -= NumIrps-1;
+        KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+
+        while (!IsListEmpty(MergedList)){
+            listEntry = RemoveHeadList(MergedList);
+            clientIrp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+            ServiceTransferRequest(Fdo, clientIrp);
+        }
+        return;
+    }
+
+    /*
+     *  The clients' pages are locked for as long as their irps are
+     *  outstanding, so the merged MDL describes them the way a partial
+     *  MDL would.  Only the first buffer may start inside a page.
+     */
+    pages = MmGetMdlPfnArray(mdl);
+    for (listEntry = MergedList->Flink; listEntry != MergedList; listEntry = listEntry->Flink){
+        PMDL clientMdl;
+        ULONG numPages;
+
+        clientIrp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+        clientMdl = clientIrp->MdlAddress;
+        numPages = ADDRESS_AND_SIZE_TO_SPAN_PAGES(MmGetMdlVirtualAddress(clientMdl),
+                                                  IoGetCurrentIrpStackLocation(clientIrp)->Parameters.Read.Length);
+        RtlCopyMemory(pages, MmGetMdlPfnArray(clientMdl), numPages*sizeof(PFN_NUMBER));
+        pages += numPages;
+    }
+    mdl->MdlFlags |= MDL_PARTIAL | (firstIrp->MdlAddress->MdlFlags & MDL_IO_PAGE_READ);
+
+    context->Fdo = Fdo;
+    InitializeListHead(&context->ClientIrps);
+    while (!IsListEmpty(MergedList)){
+        InsertTailList(&context->ClientIrps, RemoveHeadList(MergedList));
+    }
+
+    irp->MdlAddress = mdl;
+    irp->Flags |= firstIrp->Flags & IRP_PAGING_IO;
+    IoSetCompletionRoutine(irp, ClasspElevatorMergedComplete, context, TRUE, TRUE, TRUE);
+    IoSetNextIrpStackLocation(irp);
+
+    sp = IoGetCurrentIrpStackLocation(irp);
+    sp->MajorFunction = firstSp->MajorFunction;
+    sp->Flags = firstSp->Flags;
+    sp->Parameters.Read.ByteOffset = firstSp->Parameters.Read.ByteOffset;
+    sp->Parameters.Read.Length = MergedLen;
+    sp->DeviceObject = Fdo;
+
+    /*
+     *  The transfer packet engine releases this when the transfer completes.
+     */
+    ClassAcquireRemoveLock(Fdo, irp);
+    ServiceTransferRequest(Fdo, irp);
+}
+
+
+/*
+ *  ClasspElevatorMergedComplete
+ *
+ *      Completion routine for the private irp of a merged transfer.
+ */
+static NTSTATUS NTAPI ClasspElevatorMergedComplete(IN PDEVICE_OBJECT NullFdo, IN PIRP Irp, IN PVOID Context)
+{
+    PELEVATOR_MERGE_CONTEXT context = Context;
+    PDEVICE_OBJECT Fdo = context->Fdo;
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_PRIVATE_FDO_DATA fdoData = fdoExt->PrivateFdoData;
+    NTSTATUS status = Irp->IoStatus.Status;
+    PLIST_ENTRY listEntry;
+    PIRP clientIrp;
+    KIRQL oldIrql;
+
+    while (!IsListEmpty(&context->ClientIrps)){
+        listEntry = RemoveHeadList(&context->ClientIrps);
+        clientIrp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+
+        if (NT_SUCCESS(status)){
+            clientIrp->IoStatus.Status = STATUS_SUCCESS;
+            clientIrp->IoStatus.Information = IoGetCurrentIrpStackLocation(clientIrp)->Parameters.Read.Length;
+            ClasspElevatorRecordLatency(fdoData, clientIrp);
+            ClassReleaseRemoveLock(Fdo, clientIrp);
+            ClassCompleteRequest(Fdo, clientIrp, IO_DISK_INCREMENT);
+        }
+        else {
+            /*
+             *  Let each client irp succeed or fail on its own,
+             *  so that errors are reported against the right request.
+             */
+            KeAcquireSpinLock(&fdoData->Elevator.Lock, &oldIrql);
+            fdoData->Elevator.Stats.Outstanding++;
+            fdoData->Elevator.Stats.TransferCount++;
+            KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+
+            ServiceTransferRequest(Fdo, clientIrp);
+        }
+    }
+
+    ExFreePool(context);
+    IoFreeMdl(Irp->MdlAddress);
+    IoFreeIrp(Irp);
+
+    KeAcquireSpinLock(&fdoData->Elevator.Lock, &oldIrql);
+    ASSERT(fdoData->Elevator.Stats.Outstanding > 0);
+    fdoData->Elevator.Stats.Outstanding--;
+    KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+
+    ClasspElevatorStartNext(Fdo);
+
+    return STATUS_MORE_PROCESSING_REQUIRED;
+}
+
+
+/*
+ *  ClasspElevatorSubmit
+ *
+ *      Entry point for client read/write irps to the FDO.
+ *      Sends the irp down right away unless the device is busy
+ *      or other irps are already waiting.
+ */
+VOID NTAPI ClasspElevatorSubmit(PDEVICE_OBJECT Fdo, PIRP Irp)
+{
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_PRIVATE_FDO_DATA fdoData = fdoExt->PrivateFdoData;
+    PIO_STACK_LOCATION currentSp = IoGetCurrentIrpStackLocation(Irp);
+    LONGLONG offset = currentSp->Parameters.Read.ByteOffset.QuadPart;
+    PLIST_ENTRY listEntry;
+    KIRQL oldIrql;
+
+    ELEVATOR_IRP_OWNER(Irp) = fdoData;
+    ELEVATOR_IRP_START_TIME(Irp) = KeQueryPerformanceCounter(NULL);
+
+    KeAcquireSpinLock(&fdoData->Elevator.Lock, &oldIrql);
+
+    if (currentSp->MajorFunction == IRP_MJ_READ){
+        fdoData->Elevator.Stats.ReadCount++;
+    }
+    else {
+        fdoData->Elevator.Stats.WriteCount++;
+    }
+
+    if ((fdoData->Elevator.Stats.Outstanding < fdoData->Elevator.Stats.MaxOutstanding) &&
+        IsListEmpty(&fdoData->Elevator.Queue)){
+
+        fdoData->Elevator.Stats.Outstanding++;
+        fdoData->Elevator.Stats.TransferCount++;
+        fdoData->Elevator.NextOffset = offset + currentSp->Parameters.Read.Length;
+        KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+
+        ServiceTransferRequest(Fdo, Irp);
+        return;
+    }
+
+    /*
+     *  Insert the irp in disk offset order, after any irps at the same offset.
+     */
+    IoMarkIrpPending(Irp);
+    for (listEntry = fdoData->Elevator.Queue.Blink; listEntry != &fdoData->Elevator.Queue; listEntry = listEntry->Blink){
+        PIRP queuedIrp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+        if (IoGetCurrentIrpStackLocation(queuedIrp)->Parameters.Read.ByteOffset.QuadPart <= offset){
+            break;
+        }
+    }
+    InsertHeadList(listEntry, &Irp->Tail.Overlay.ListEntry);
+
+    fdoData->Elevator.Stats.QueuedCount++;
+    fdoData->Elevator.Stats.QueueDepth++;
+    fdoData->Elevator.Stats.PeakQueueDepth = MAX(fdoData->Elevator.Stats.PeakQueueDepth,
+                                                 fdoData->Elevator.Stats.QueueDepth);
+
+    KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+
+    /*
+     *  A transfer may have completed while we were queuing.
+     */
+    ClasspElevatorStartNext(Fdo);
+}
+
+
+/*
+ *  ClasspElevatorTransferDone
+ *
+ *      Called by the transfer packet engine before it completes a client irp.
+ *      Does nothing for irps that did not come through the elevator.
+ */
+VOID NTAPI ClasspElevatorTransferDone(PCLASS_PRIVATE_FDO_DATA FdoData, PIRP Irp)
+{
+    KIRQL oldIrql;
+
+    if (ELEVATOR_IRP_OWNER(Irp) != FdoData){
+        return;
+    }
+
+    ClasspElevatorRecordLatency(FdoData, Irp);
+
+    KeAcquireSpinLock(&FdoData->Elevator.Lock, &oldIrql);
+    ASSERT(FdoData->Elevator.Stats.Outstanding > 0);
+    FdoData->Elevator.Stats.Outstanding--;
+    KeReleaseSpinLock(&FdoData->Elevator.Lock, oldIrql);
+}
+
+
+/*
+ *  ClasspElevatorStartNext
+ *
+ *      Send down queued irps while the device has room for more transfers.
+ */
+VOID NTAPI ClasspElevatorStartNext(PDEVICE_OBJECT Fdo)
+{
+    PFUNCTIONAL_DEVICE_EXTENSION fdoExt = Fdo->DeviceExtension;
+    PCLASS_PRIVATE_FDO_DATA fdoData = fdoExt->PrivateFdoData;
+    PLIST_ENTRY queue = &fdoData->Elevator.Queue;
+    PLIST_ENTRY listEntry, nextEntry;
+    LIST_ENTRY mergedList;
+    PIRP irp, lastIrp;
+    ULONG numIrps, mergedLen;
+    KIRQL oldIrql;
+
+    while (TRUE){
+        KeAcquireSpinLock(&fdoData->Elevator.Lock, &oldIrql);
+
+        if ((fdoData->Elevator.Stats.Outstanding >= fdoData->Elevator.Stats.MaxOutstanding) ||
+            IsListEmpty(queue)){
+            KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+            break;
+        }
+
+        /*
+         *  Continue from where the last transfer ended,
+         *  or wrap around to the lowest offset.
+         */
+        for (listEntry = queue->Flink; listEntry != queue; listEntry = listEntry->Flink){
+            irp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+            if (IoGetCurrentIrpStackLocation(irp)->Parameters.Read.ByteOffset.QuadPart >=
+                fdoData->Elevator.NextOffset){
+                break;
+            }
+        }
+        if (listEntry == queue){
+            listEntry = queue->Flink;
+        }
+
+        /*
+         *  Take the irp and all the following ones that continue it.
+         */
+        InitializeListHead(&mergedList);
+        numIrps = 0;
+        mergedLen = 0;
+        lastIrp = NULL;
+        do {
+            irp = CONTAINING_RECORD(listEntry, IRP, Tail.Overlay.ListEntry);
+            if (lastIrp && !ClasspElevatorCanMerge(fdoData, lastIrp, irp, mergedLen)){
+                break;
+            }
+
+            nextEntry = listEntry->Flink;
+            RemoveEntryList(listEntry);
+            InsertTailList(&mergedList, listEntry);
+            mergedLen += IoGetCurrentIrpStackLocation(irp)->Parameters.Read.Length;
+            numIrps++;
+            lastIrp = irp;
+            listEntry = nextEntry;
+        } while ((listEntry != queue) && (numIrps < CLASS_ELEVATOR_MAX_MERGE));
+
+        fdoData->Elevator.Stats.QueueDepth -= numIrps;
+        fdoData->Elevator.Stats.MergedCount += numIrps-1;
+        fdoData->Elevator.Stats.TransferCount++;
+        fdoData->Elevator.Stats.Outstanding++;
+        fdoData->Elevator.NextOffset = IoGetCurrentIrpStackLocation(lastIrp)->Parameters.Read.ByteOffset.QuadPart +
+                                       IoGetCurrentIrpStackLocation(lastIrp)->Parameters.Read.Length;
+
+        KeReleaseSpinLock(&fdoData->Elevator.Lock, oldIrql);
+
+        if (numIrps == 1){
+            ServiceTransferRequest(Fdo, lastIrp);
+        }
+        else {
+            ClasspElevatorSendMerged(Fdo, &mergedList, numIrps, mergedLen);
+        }
+    }
+}
@@ -62,6 +62,10 @@ VOID NTAPI ClassSplitRequest(IN PDEVICE_OBJECT Fdo, IN PIRP Irp, IN ULONG Maximu
         fdoData->HwMaxXferLen = MAX(MaximumBytes, PAGE_SIZE);
     }
 
+    /*
+     *  StartIo already serializes these, so they bypass the elevator.
+     */
+    Irp->Tail.Overlay.DriverContext[1] = NULL;
     ServiceTransferRequest(Fdo, Irp);
 } 
 
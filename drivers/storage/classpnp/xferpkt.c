@@ -78,6 +78,7 @@ NTSTATUS NTAPI InitializeTransferPackets(PDEVICE_OBJECT Fdo)
     InitializeSListHead(&fdoData->FreeTransferPacketsList);
     InitializeListHead(&fdoData->AllTransferPacketsList);
     InitializeListHead(&fdoData->DeferredClientIrpList);
+    ClasspInitializeElevator(Fdo);
         
     /*
      *  Set the packet threshold numbers based on the Windows SKU.
@@ -140,6 +141,7 @@ VOID NTAPI DestroyAllTransferPackets(PDEVICE_OBJECT Fdo)
     PAGED_CODE();
     
     ASSERT(IsListEmpty(&fdoData->DeferredClientIrpList));
+    ASSERT(IsListEmpty(&fdoData->Elevator.Queue));
 
     while ((pkt = DequeueFreeTransferPacket(Fdo, FALSE))){
         DestroyTransferPacket(pkt);
@@ -650,6 +652,7 @@ NTSTATUS NTAPI TransferPktComplete(IN PDEVICE_OBJECT NullFdo, IN PIRP Irp, IN PV
                     ASSERT((ULONG)pkt->OriginalIrp->IoStatus.Information == origCurrentSp->Parameters.Read.Length);
                     ClasspPerfIncrementSuccessfulIo(fdoExt);
                 }
+                ClasspElevatorTransferDone(fdoData, pkt->OriginalIrp);
                 ClassReleaseRemoveLock(pkt->Fdo, pkt->OriginalIrp);
 
                 ClassCompleteRequest(pkt->Fdo, pkt->OriginalIrp, IO_DISK_INCREMENT);
@@ -702,6 +705,11 @@ NTSTATUS NTAPI TransferPktComplete(IN PDEVICE_OBJECT NullFdo, IN PIRP Irp, IN PV
             ServiceTransferRequest(pkt->Fdo, deferredIrp);
         }
 
+        /*
+         *  A transfer is done, so the elevator may send down more.
+         */
+        ClasspElevatorStartNext(Fdo);
+
         ClassReleaseRemoveLock(Fdo, (PIRP)&uniqueAddr);        
     }
 
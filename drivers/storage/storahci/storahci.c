@@ -608,6 +608,110 @@ AhciCompleteIssuedSrb (
     return;
 }// -- AhciCompleteIssuedSrb();
 
+/**
+ * @name AhciNcqErrorRecovery
+ * @implemented
+ *
+ * Restart the port after a fatal error while native queued commands were outstanding,
+ * InterruptLock must be held. PxSACT is not cleared by the HBA in this state, so without
+ * this every queued command on the port would hang. READ LOG EXT page 10h is not used,
+ * all outstanding queued commands are completed with SRB_STATUS_BUS_RESET for a retry.
+ *
+ * @param PortExtension
+ *
+ */
+VOID
+AhciNcqErrorRecovery (
+    __in PAHCI_PORT_EXTENSION PortExtension
+    )
+{
+    ULONG index, i, NCS, failedSlots;
+    AHCI_PORT_CMD cmd;
+    AHCI_SERIAL_ATA_STATUS ssts;
+    AHCI_SERIAL_ATA_CONTROL sctl;
+    PSCSI_REQUEST_BLOCK Srb;
+    PAHCI_ADAPTER_EXTENSION AdapterExtension;
+
+    AhciDebugPrint("AhciNcqErrorRecovery()\n");
+
+    AdapterExtension = PortExtension->AdapterExtension;
+    NCS = AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP);
+
+    // section 6.2.2.1
+    // clear PxCMD.ST and wait for PxCMD.CR to clear, this also clears PxCI and PxSACT
+    cmd.Status = StorPortReadRegisterUlong(AdapterExtension, &PortExtension->Port->CMD);
+    cmd.ST = 0;
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->CMD, cmd.Status);
+
+    index = 0;
+    do
+    {
+        StorPortStallExecution(1000);
+        cmd.Status = StorPortReadRegisterUlong(AdapterExtension, &PortExtension->Port->CMD);
+        index++;
+    }
+    while ((cmd.CR != 0) && (index < 500));
+
+    // section 10.4.2
+    // perform COMRESET, the device doesn't take new commands after a queued command failed
+    sctl.Status = StorPortReadRegisterUlong(AdapterExtension, &PortExtension->Port->SCTL);
+    sctl.DET = 1;
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->SCTL, sctl.Status);
+
+    StorPortStallExecution(1000);
+
+    sctl.Status = StorPortReadRegisterUlong(AdapterExtension, &PortExtension->Port->SCTL);
+    sctl.DET = 0;
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->SCTL, sctl.Status);
+
+    index = 0;
+    do
+    {
+        StorPortStallExecution(1000);
+        ssts.Status = StorPortReadRegisterUlong(AdapterExtension, &PortExtension->Port->SSTS);
+        index++;
+    }
+    while ((ssts.DET != 0x3) && (index < 30));
+
+    // clear the errors and pending interrupts
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->SERR, (ULONG)~0);
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->IS, (ULONG)~0);
+
+    // start the port again
+    cmd.Status = StorPortReadRegisterUlong(AdapterExtension, &PortExtension->Port->CMD);
+    cmd.ST = 1;
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->CMD, cmd.Status);
+
+    if (ssts.DET != 0x3)
+    {
+        AhciDebugPrint("\tDevice did not come back after COMRESET, DET == %x\n", ssts.DET);
+    }
+
+    // the queued commands are lost, let the class driver retry them
+    failedSlots = PortExtension->CommandIssuedSlots & PortExtension->NcqSlots;
+    for (i = 0; i < NCS; i++)
+    {
+        if (((1 << i) & failedSlots) == 0)
+        {
+            continue;
+        }
+
+        Srb = PortExtension->Slot[i];
+        if (Srb == NULL)
+        {
+            continue;
+        }
+
+        Srb->SrbStatus = SRB_STATUS_BUS_RESET;
+        StorPortNotification(RequestComplete, AdapterExtension, Srb);
+    }
+
+    PortExtension->CommandIssuedSlots &= ~failedSlots;
+    PortExtension->NcqSlots &= ~failedSlots;
+
+    return;
+}// -- AhciNcqErrorRecovery();
+
 /**
  * @name AhciInterruptHandler
  * @not_implemented
@@ -622,7 +726,7 @@ AhciInterruptHandler (
     __in PAHCI_PORT_EXTENSION PortExtension
     )
 {
-    ULONG is, ci, sact, outstanding;
+    ULONG is, ci, sact, outstanding, completed;
     AHCI_INTERRUPT_STATUS PxIS;
     AHCI_INTERRUPT_STATUS PxISMasked;
     PAHCI_ADAPTER_EXTENSION AdapterExtension;
@@ -663,6 +767,19 @@ AhciInterruptHandler (
         // non-queued commands were being issued or native command queuing commands were being issued.
 
         AhciDebugPrint("\tFatal Error: %x\n", PxIS.Status);
+
+        if (PortExtension->NcqSlots & PortExtension->CommandIssuedSlots)
+        {
+            // section 6.2.2.2
+            // native command queuing error, restart the port and fail the queued commands
+            AhciNcqErrorRecovery(PortExtension);
+            StorPortWriteRegisterUlong(AdapterExtension, AdapterExtension->IS, (1 << PortExtension->PortNumber));
+
+            // whatever waited in the queue can go now
+            AhciFillCommandSlots(PortExtension);
+            AhciActivatePort(PortExtension);
+            return;
+        }
     }
 
     // Normal Command Completion
@@ -693,10 +810,17 @@ AhciInterruptHandler (
     sact = StorPortReadRegisterUlong(AdapterExtension, &PortExtension->Port->SACT);
 
     outstanding = ci | sact; // NOTE: Including both non-NCQ and NCQ based commands
-    if ((PortExtension->CommandIssuedSlots & (~outstanding)) != 0)
+    completed = PortExtension->CommandIssuedSlots & (~outstanding);
+    if (completed != 0)
     {
-        AhciCompleteIssuedSrb(PortExtension, (PortExtension->CommandIssuedSlots & (~outstanding)));
+        AhciCompleteIssuedSrb(PortExtension, completed);
         PortExtension->CommandIssuedSlots &= outstanding;
+        PortExtension->NcqSlots &= ~completed;
+
+        // freed slots can take the Srbs waiting in the queue
+        // we already hold the InterruptLock here
+        AhciFillCommandSlots(PortExtension);
+        AhciActivatePort(PortExtension);
     }
 
     return;
@@ -1247,6 +1371,12 @@ AhciATA_CFIS (
     cmdTable->CFIS[AHCI_ATA_CFIS_SectorCountLow] = SrbExtension->SectorCountLow;
     cmdTable->CFIS[AHCI_ATA_CFIS_SectorCountHigh] = SrbExtension->SectorCountHigh;
 
+    if ((SrbExtension->Flags & ATA_FLAGS_NCQ_COMMAND) != 0)
+    {
+        // FPDMA QUEUED: the tag (our command slot) goes into the count field
+        cmdTable->CFIS[AHCI_ATA_CFIS_SectorCountLow] = (UCHAR)(SrbExtension->SlotIndex << 3);
+    }
+
     return 5;
 }// -- AhciATA_CFIS();
 
@@ -1468,6 +1598,11 @@ AhciProcessSrb (
     // mark this slot
     PortExtension->Slot[SlotIndex] = Srb;
     PortExtension->QueueSlots |= 1 << SlotIndex;
+
+    if ((SrbExtension->Flags & ATA_FLAGS_NCQ_COMMAND) != 0)
+    {
+        PortExtension->NcqSlots |= 1 << SlotIndex;
+    }
     return;
 }// -- AhciProcessSrb();
 
@@ -1492,7 +1627,7 @@ AhciActivatePort (
     )
 {
     AHCI_PORT_CMD cmd;
-    ULONG QueueSlots, slotToActivate, tmp;
+    ULONG QueueSlots, ncqSlots;
     PAHCI_ADAPTER_EXTENSION AdapterExtension;
 
     AhciDebugPrint("AhciActivatePort()\n");
@@ -1514,23 +1649,24 @@ AhciActivatePort (
         return;
     }
 
-    // get the lowest set bit
-    tmp = QueueSlots & (QueueSlots - 1);
-
-    if (tmp == 0)
-        slotToActivate = QueueSlots;
-    else
-        slotToActivate = (QueueSlots & (~tmp));
-
-    // mark that bit off in QueueSlots
+    // issue all the assigned slots at once
+    // mark them off in QueueSlots
     // so we can know we it is really needed to activate port or not
-    PortExtension->QueueSlots &= ~slotToActivate;
-    // mark this CommandIssuedSlots
+    PortExtension->QueueSlots = 0;
+    // mark them in CommandIssuedSlots
     // to validate in completeIssuedCommand
-    PortExtension->CommandIssuedSlots |= slotToActivate;
+    PortExtension->CommandIssuedSlots |= QueueSlots;
 
-    // tell the HBA to issue this Command Slot to the given port
-    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->CI, slotToActivate);
+    // section 5.3.2.1
+    // for native queued commands, the PxSACT bit must be set before the PxCI bit
+    ncqSlots = QueueSlots & PortExtension->NcqSlots;
+    if (ncqSlots != 0)
+    {
+        StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->SACT, ncqSlots);
+    }
+
+    // tell the HBA to issue these Command Slots to the given port
+    StorPortWriteRegisterUlong(AdapterExtension, &PortExtension->Port->CI, QueueSlots);
 
     return;
 }// -- AhciActivatePort();
@@ -1539,6 +1675,80 @@ AhciActivatePort (
     #pragma warning(pop)
 #endif
 
+/**
+ * @name AhciFillCommandSlots
+ * @implemented
+ *
+ * Assign pending Srbs to free command slots, InterruptLock must be held.
+ * Native queued and non-queued commands can't be outstanding at the same time,
+ * so a command of the other kind waits in the queue until the port has drained.
+ *
+ * @param PortExtension
+ *
+ */
+VOID
+AhciFillCommandSlots (
+    __in PAHCI_PORT_EXTENSION PortExtension
+    )
+{
+    PSCSI_REQUEST_BLOCK Srb;
+    PAHCI_SRB_EXTENSION SrbExtension;
+    ULONG occupiedSlots, slotIndex, slotMask, NCS;
+
+    AhciDebugPrint("AhciFillCommandSlots()\n");
+
+    NCS = AHCI_Global_Port_CAP_NCS(PortExtension->AdapterExtension->CAP);
+    slotMask = AHCI_SLOT_MASK(NCS); // slots implemented by the HBA
+
+    // iterate over HBA port slots
+    for (slotIndex = 0; slotIndex < NCS; slotIndex++)
+    {
+        occupiedSlots = (PortExtension->QueueSlots | PortExtension->CommandIssuedSlots); // Busy command slots for given port
+        if ((slotMask & ~occupiedSlots) == 0)
+        {
+            // no free slot left
+            break;
+        }
+
+        if ((occupiedSlots & (1 << slotIndex)) != 0)
+        {
+            continue;
+        }
+
+        Srb = PeekQueue(&PortExtension->SrbQueue);
+        if (Srb == NULL)
+        {
+            break;
+        }
+
+        SrbExtension = GetSrbExtension(Srb);
+        if ((SrbExtension->Flags & ATA_FLAGS_NCQ_COMMAND) != 0)
+        {
+            if ((occupiedSlots & ~PortExtension->NcqSlots) != 0)
+            {
+                break;
+            }
+
+            // the slot is the tag, the drive takes no tag above its queue depth
+            // StorPortSetDeviceQueueDepth doesn't limit anything for us
+            if (slotIndex >= PortExtension->MaxPortQueueDepth)
+            {
+                break;
+            }
+        }
+        else if (PortExtension->NcqSlots != 0)
+        {
+            break;
+        }
+
+        Srb = RemoveQueue(&PortExtension->SrbQueue);
+        NT_ASSERT(Srb->PathId == PortExtension->PortNumber);
+        AhciProcessSrb(PortExtension, Srb, slotIndex);
+    }
+
+    return;
+}// -- AhciFillCommandSlots();
+
 /**
  * @name AhciProcessIO
  * @implemented
@@ -1558,10 +1768,8 @@ AhciProcessIO (
     __in PSCSI_REQUEST_BLOCK Srb
     )
 {
-    PSCSI_REQUEST_BLOCK tmpSrb;
     STOR_LOCK_HANDLE lockhandle = {0};
     PAHCI_PORT_EXTENSION PortExtension;
-    ULONG commandSlotMask, occupiedSlots, slotIndex, NCS;
 
     AhciDebugPrint("AhciProcessIO()\n");
     AhciDebugPrint("\tPathId: %d\n", PathId);
@@ -1583,36 +1791,8 @@ AhciProcessIO (
         return; // we should wait for device to get active
     }
 
-    occupiedSlots = (PortExtension->QueueSlots | PortExtension->CommandIssuedSlots); // Busy command slots for given port
-    NCS = AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP);
-    commandSlotMask = (1 << NCS) - 1; // available slots mask
-
-    commandSlotMask = (commandSlotMask & ~occupiedSlots);
-    if(commandSlotMask != 0)
-    {
-        // iterate over HBA port slots
-        for (slotIndex = 0; slotIndex < NCS; slotIndex++)
-        {
-            // find first free slot
-            if ((commandSlotMask & (1 << slotIndex)) != 0)
-            {
-                tmpSrb = RemoveQueue(&PortExtension->SrbQueue);
-                if (tmpSrb != NULL)
-                {
-                    NT_ASSERT(tmpSrb->PathId == PathId);
-                    AhciProcessSrb(PortExtension, tmpSrb, slotIndex);
-                }
-                else
-                {
-                    break;
-                }
-            }
-            else
-            {
-                break;
-            }
-        }
-    }
+    // assign free command slots
+    AhciFillCommandSlots(PortExtension);
 
     // program HBA port
     AhciActivatePort(PortExtension);
@@ -1735,6 +1915,19 @@ InquiryCompletion (
             PortExtension->DeviceParams.Lba48BitMode = 1;
         }
 
+        // READ/WRITE FPDMA QUEUED always use 48 bit addresses
+        if (IsAdapterCAPSNCQ(AdapterExtension->CAP) &&
+            IdentifyDeviceData->SerialAtaCapabilities.NCQ &&
+            PortExtension->DeviceParams.Lba48BitMode)
+        {
+            PortExtension->DeviceParams.NcqSupported = 1;
+
+            // IDENTIFY reports the maximum queue depth - 1
+            PortExtension->MaxPortQueueDepth = min(PortExtension->MaxPortQueueDepth,
+                                                   IdentifyDeviceData->QueueDepth + 1UL);
+            AhciDebugPrint("\tNCQ supported, queue depth %d\n", PortExtension->MaxPortQueueDepth);
+        }
+
         PortExtension->DeviceParams.AccessType = DIRECT_ACCESS_DEVICE;
 
         /* Device max address lba */
@@ -1798,7 +1991,7 @@ InquiryCompletion (
     // prepare data to send
     InquiryData->Versions = 2;
     InquiryData->Wide32Bit = 1;
-    InquiryData->CommandQueue = 0; // NCQ not supported
+    InquiryData->CommandQueue = PortExtension->DeviceParams.NcqSupported;
     InquiryData->ResponseDataFormat = 0x2;
     InquiryData->DeviceTypeModifier = 0;
     InquiryData->DeviceTypeQualifier = DEVICE_CONNECTED;
@@ -1820,7 +2013,7 @@ InquiryCompletion (
                                          Srb->PathId,
                                          Srb->TargetId,
                                          Srb->Lun,
-                                         AHCI_Global_Port_CAP_NCS(AdapterExtension->CAP));
+                                         PortExtension->MaxPortQueueDepth);
 
     NT_ASSERT(status == TRUE);
     return;
@@ -2027,7 +2220,7 @@ DeviceRequestReadWrite (
     NT_ASSERT(SectorCount > 0);
 
     SrbExtension->AtaFunction = ATA_FUNCTION_ATA_READ;
-    SrbExtension->Flags |= ATA_FLAGS_USE_DMA;
+    SrbExtension->Flags = ATA_FLAGS_USE_DMA;
     SrbExtension->CompletionRoutine = NULL;
 
     if (IsReading)
@@ -2076,6 +2269,19 @@ DeviceRequestReadWrite (
 
     NT_ASSERT(SectorCount < 0x100);
 
+    if (PortExtension->DeviceParams.NcqSupported)
+    {
+        // READ/WRITE FPDMA QUEUED
+        // the sector count moves to the features field, AhciATA_CFIS puts the tag into the count field
+        SrbExtension->Flags |= ATA_FLAGS_NCQ_COMMAND;
+        SrbExtension->CommandReg = IsReading ? IDE_COMMAND_READ_FPDMA_QUEUED : IDE_COMMAND_WRITE_FPDMA_QUEUED;
+        SrbExtension->Device = IDE_LBA_MODE;
+        SrbExtension->FeaturesLow = SrbExtension->SectorCountLow;
+        SrbExtension->FeaturesHigh = SrbExtension->SectorCountHigh;
+        SrbExtension->SectorCountLow = 0;
+        SrbExtension->SectorCountHigh = 0;
+    }
+
     SrbExtension->pSgl = (PLOCAL_SCATTER_GATHER_LIST)StorPortGetScatterGatherList(AdapterExtension, Srb);
 
     return SRB_STATUS_PENDING;
@@ -2547,6 +2753,33 @@ RemoveQueue (
     return Srb;
 }// -- RemoveQueue();
 
+/**
+ * @name PeekQueue
+ * @implemented
+ *
+ * Return the next Srb from Queue without removing it
+ *
+ * @param Queue
+ *
+ * @return
+ * return Srb
+ *
+ */
+__inline
+PVOID
+PeekQueue (
+    __in PAHCI_QUEUE Queue
+    )
+{
+    NT_ASSERT(Queue->Head < MAXIMUM_QUEUE_BUFFER_SIZE);
+    NT_ASSERT(Queue->Tail < MAXIMUM_QUEUE_BUFFER_SIZE);
+
+    if (Queue->Head == Queue->Tail)
+        return NULL;
+
+    return Queue->Buffer[Queue->Tail];
+}// -- PeekQueue();
+
 /**
  * @name GetSrbExtension
  * @implemented
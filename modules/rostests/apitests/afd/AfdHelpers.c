@@ -384,6 +384,112 @@ AfdSendTo(
     return Status;
 }
 
+NTSTATUS
+AfdRecvFrom(
+    _In_ HANDLE SocketHandle,
+    _Out_ void *Buffer,
+    _In_ ULONG BufferLength,
+    _Out_opt_ PULONG ReceivedLength)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    AFD_RECV_INFO_UDP RecvInfo;
+    HANDLE Event;
+    AFD_WSABUF AfdBuffer;
+    SOCKADDR_STORAGE Address;
+    INT AddressLength = sizeof(Address);
+
+    Status = NtCreateEvent(&Event,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           NotificationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    AfdBuffer.buf = Buffer;
+    AfdBuffer.len = BufferLength;
+    RtlZeroMemory(&RecvInfo, sizeof(RecvInfo));
+    RecvInfo.BufferArray = &AfdBuffer;
+    RecvInfo.BufferCount = 1;
+    RecvInfo.AfdFlags = 0;
+    RecvInfo.TdiFlags = TDI_RECEIVE_NORMAL;
+    RecvInfo.Address = &Address;
+    RecvInfo.AddressLength = &AddressLength;
+
+    Status = NtDeviceIoControlFile(SocketHandle,
+                                   Event,
+                                   NULL,
+                                   NULL,
+                                   &IoStatus,
+                                   IOCTL_AFD_RECV_DATAGRAM,
+                                   &RecvInfo,
+                                   sizeof(RecvInfo),
+                                   NULL,
+                                   0);
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(Event, FALSE, NULL);
+        Status = IoStatus.Status;
+    }
+
+    if (NT_SUCCESS(Status) && ReceivedLength)
+    {
+        *ReceivedLength = (ULONG)IoStatus.Information;
+    }
+
+    NtClose(Event);
+
+    return Status;
+}
+
+NTSTATUS
+AfdPollRegister(
+    _In_ HANDLE SocketHandle,
+    _In_ ULONG Events,
+    _In_opt_ PVOID Context)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    AFD_POLL_REGISTER_INFO RegisterInfo;
+    HANDLE Event;
+
+    Status = NtCreateEvent(&Event,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           NotificationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    RegisterInfo.Events = Events;
+    RegisterInfo.Context = Context;
+
+    Status = NtDeviceIoControlFile(SocketHandle,
+                                   Event,
+                                   NULL,
+                                   NULL,
+                                   &IoStatus,
+                                   IOCTL_AFD_POLL_REGISTER,
+                                   &RegisterInfo,
+                                   sizeof(RegisterInfo),
+                                   NULL,
+                                   0);
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(Event, FALSE, NULL);
+        Status = IoStatus.Status;
+    }
+
+    NtClose(Event);
+
+    return Status;
+}
+
 NTSTATUS
 AfdSetInformation(
     _In_ HANDLE SocketHandle,
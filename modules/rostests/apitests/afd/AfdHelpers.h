@@ -41,6 +41,19 @@ AfdSendTo(
     _In_ const struct sockaddr *Address,
     _In_ ULONG AddressLength);
 
+NTSTATUS
+AfdRecvFrom(
+    _In_ HANDLE SocketHandle,
+    _Out_ void *Buffer,
+    _In_ ULONG BufferLength,
+    _Out_opt_ PULONG ReceivedLength);
+
+NTSTATUS
+AfdPollRegister(
+    _In_ HANDLE SocketHandle,
+    _In_ ULONG Events,
+    _In_opt_ PVOID Context);
+
 NTSTATUS
 AfdSetInformation(
     _In_ HANDLE SocketHandle,
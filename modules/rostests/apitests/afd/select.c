@@ -0,0 +1,381 @@
+/*
+ * PROJECT:     ReactOS API Tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Tests and benchmark for IOCTL_AFD_SELECT/IOCTL_AFD_POLL_REGISTER
+ *              with many idle sockets
+ */
+
+#include "precomp.h"
+
+#define IDLE_SOCKETS    10000
+#define ACTIVE_SOCKETS  4
+#define ACTIVE_PORT     45000
+#define BENCH_LOOPS     2000
+#define SELECT_LOOPS    100
+
+static HANDLE IdleSockets[IDLE_SOCKETS];
+static HANDLE ActiveSockets[ACTIVE_SOCKETS];
+static struct sockaddr_in ActiveAddresses[ACTIVE_SOCKETS];
+static HANDLE SenderSocket;
+
+static
+BOOLEAN
+CreateSockets(void)
+{
+    NTSTATUS Status;
+    struct sockaddr_in addr;
+    UINT i;
+
+    for (i = 0; i < IDLE_SOCKETS; i++)
+    {
+        Status = AfdCreateSocket(&IdleSockets[i], AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (!NT_SUCCESS(Status))
+        {
+            ok(0, "AfdCreateSocket %u failed with %lx\n", i, Status);
+            return FALSE;
+        }
+    }
+
+    for (i = 0; i < ACTIVE_SOCKETS; i++)
+    {
+        Status = AfdCreateSocket(&ActiveSockets[i], AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+        if (!NT_SUCCESS(Status))
+            return FALSE;
+
+        memset(&ActiveAddresses[i], 0, sizeof(ActiveAddresses[i]));
+        ActiveAddresses[i].sin_family = AF_INET;
+        ActiveAddresses[i].sin_addr.s_addr = inet_addr("127.0.0.1");
+        ActiveAddresses[i].sin_port = htons(ACTIVE_PORT + i);
+
+        Status = AfdBind(ActiveSockets[i], (const struct sockaddr *)&ActiveAddresses[i], sizeof(ActiveAddresses[i]));
+        ok(Status == STATUS_SUCCESS, "AfdBind failed with %lx\n", Status);
+        if (!NT_SUCCESS(Status))
+            return FALSE;
+    }
+
+    Status = AfdCreateSocket(&SenderSocket, AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Status == STATUS_SUCCESS, "AfdCreateSocket failed with %lx\n", Status);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    addr.sin_port = htons(0);
+
+    Status = AfdBind(SenderSocket, (const struct sockaddr *)&addr, sizeof(addr));
+    ok(Status == STATUS_SUCCESS, "AfdBind failed with %lx\n", Status);
+    return NT_SUCCESS(Status);
+}
+
+static
+void
+CloseSockets(void)
+{
+    UINT i;
+
+    for (i = 0; i < IDLE_SOCKETS; i++)
+    {
+        if (IdleSockets[i])
+            NtClose(IdleSockets[i]);
+    }
+    for (i = 0; i < ACTIVE_SOCKETS; i++)
+    {
+        if (ActiveSockets[i])
+            NtClose(ActiveSockets[i]);
+    }
+    if (SenderSocket)
+        NtClose(SenderSocket);
+}
+
+static
+NTSTATUS
+SendToActive(UINT Index)
+{
+    CHAR Buffer[16] = "select";
+
+    return AfdSendTo(SenderSocket, Buffer, sizeof(Buffer),
+                     (const struct sockaddr *)&ActiveAddresses[Index], sizeof(ActiveAddresses[Index]));
+}
+
+static
+NTSTATUS
+RecvFromActive(UINT Index)
+{
+    CHAR Buffer[16];
+
+    return AfdRecvFrom(ActiveSockets[Index], Buffer, sizeof(Buffer), NULL);
+}
+
+static
+PAFD_POLL_INFO
+AllocatePollInfo(BOOLEAN WithActive, PULONG PollInfoLength)
+{
+    PAFD_POLL_INFO PollInfo;
+    ULONG HandleCount = IDLE_SOCKETS + (WithActive ? ACTIVE_SOCKETS : 0);
+    UINT i;
+
+    *PollInfoLength = FIELD_OFFSET(AFD_POLL_INFO, Handles) + HandleCount * sizeof(AFD_HANDLE);
+    PollInfo = RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, *PollInfoLength);
+    if (!PollInfo)
+        return NULL;
+
+    PollInfo->HandleCount = HandleCount;
+    for (i = 0; i < HandleCount; i++)
+    {
+        PollInfo->Handles[i].Handle = (SOCKET)(i < IDLE_SOCKETS ? IdleSockets[i] : ActiveSockets[i - IDLE_SOCKETS]);
+        PollInfo->Handles[i].Events = AFD_EVENT_RECEIVE;
+    }
+
+    return PollInfo;
+}
+
+static
+void
+RunStateChangeBenchmark(BOOLEAN PendingSelect)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus, CancelStatus;
+    LARGE_INTEGER Frequency, Start, End, Zero;
+    PAFD_POLL_INFO PollInfo = NULL;
+    ULONG PollInfoLength;
+    HANDLE Event = NULL;
+    UINT i, Errors = 0;
+
+    /* Every socket state change used to look at every handle of every pending select */
+    if (PendingSelect)
+    {
+        PollInfo = AllocatePollInfo(FALSE, &PollInfoLength);
+        ok(PollInfo != NULL, "Out of memory\n");
+        if (!PollInfo)
+            return;
+
+        Status = NtCreateEvent(&Event, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE);
+        ok(Status == STATUS_SUCCESS, "NtCreateEvent failed with %lx\n", Status);
+
+        PollInfo->Timeout.QuadPart = -600 * 10000000LL;
+        Status = NtDeviceIoControlFile(IdleSockets[0], Event, NULL, NULL, &IoStatus,
+                                       IOCTL_AFD_SELECT, PollInfo, PollInfoLength,
+                                       PollInfo, PollInfoLength);
+        ok(Status == STATUS_PENDING, "IOCTL_AFD_SELECT returned %lx\n", Status);
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        if (!NT_SUCCESS(SendToActive(i % ACTIVE_SOCKETS)) ||
+            !NT_SUCCESS(RecvFromActive(i % ACTIVE_SOCKETS)))
+        {
+            Errors++;
+        }
+    }
+    QueryPerformanceCounter(&End);
+    ok(Errors == 0, "Send/receive failed %u times\n", Errors);
+
+    trace("Datagram round trips, %s select on %u idle sockets: %I64d per second\n",
+          PendingSelect ? "pending" : "no", IDLE_SOCKETS,
+          BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    if (PendingSelect)
+    {
+        Zero.QuadPart = 0;
+        ok(NtWaitForSingleObject(Event, FALSE, &Zero) == STATUS_TIMEOUT,
+           "Select on idle sockets completed\n");
+
+        NtCancelIoFile(IdleSockets[0], &CancelStatus);
+        NtWaitForSingleObject(Event, FALSE, NULL);
+        ok(IoStatus.Status == STATUS_CANCELLED, "Select returned %lx\n", IoStatus.Status);
+
+        NtClose(Event);
+        RtlFreeHeap(RtlGetProcessHeap(), 0, PollInfo);
+    }
+}
+
+static
+void
+RunSelectBenchmark(void)
+{
+    NTSTATUS Status;
+    IO_STATUS_BLOCK IoStatus;
+    LARGE_INTEGER Frequency, Start, End;
+    PAFD_POLL_INFO PollInfo;
+    ULONG PollInfoLength;
+    HANDLE Event;
+    UINT i, j, Errors = 0;
+
+    PollInfo = AllocatePollInfo(TRUE, &PollInfoLength);
+    ok(PollInfo != NULL, "Out of memory\n");
+    if (!PollInfo)
+        return;
+
+    Status = NtCreateEvent(&Event, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE);
+    ok(Status == STATUS_SUCCESS, "NtCreateEvent failed with %lx\n", Status);
+
+    /* One datagram stays queued, every select completes right away */
+    Status = SendToActive(ACTIVE_SOCKETS - 1);
+    ok(Status == STATUS_SUCCESS, "AfdSendTo failed with %lx\n", Status);
+    Sleep(100);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < SELECT_LOOPS; i++)
+    {
+        /* The events come back in place, like select() rebuilding its sets */
+        PollInfo->Timeout.QuadPart = -10 * 10000000LL;
+        for (j = 0; j < PollInfo->HandleCount; j++)
+            PollInfo->Handles[j].Events = AFD_EVENT_RECEIVE;
+        Status = NtDeviceIoControlFile(IdleSockets[0], Event, NULL, NULL, &IoStatus,
+                                       IOCTL_AFD_SELECT, PollInfo, PollInfoLength,
+                                       PollInfo, PollInfoLength);
+        if (Status == STATUS_PENDING)
+        {
+            NtWaitForSingleObject(Event, FALSE, NULL);
+            Status = IoStatus.Status;
+        }
+
+        if (Status != STATUS_SUCCESS ||
+            !(PollInfo->Handles[IDLE_SOCKETS + ACTIVE_SOCKETS - 1].Events & AFD_EVENT_RECEIVE))
+        {
+            Errors++;
+        }
+    }
+    QueryPerformanceCounter(&End);
+    ok(Errors == 0, "Select failed %u times\n", Errors);
+
+    trace("Select on %u sockets, one ready: %I64d calls per second\n", IDLE_SOCKETS + ACTIVE_SOCKETS,
+          SELECT_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    Status = RecvFromActive(ACTIVE_SOCKETS - 1);
+    ok(Status == STATUS_SUCCESS, "AfdRecvFrom failed with %lx\n", Status);
+
+    NtClose(Event);
+    RtlFreeHeap(RtlGetProcessHeap(), 0, PollInfo);
+}
+
+static
+void
+TestPollRegister(void)
+{
+    NTSTATUS Status;
+    LARGE_INTEGER Frequency, Start, End;
+    HANDLE Port;
+    ULONG_PTR Key;
+    DWORD Bytes;
+    LPOVERLAPPED Overlapped;
+    UINT i, Index, Errors = 0;
+    BOOL Ret;
+
+    /* Registration needs a completion port */
+    Status = AfdPollRegister(ActiveSockets[0], AFD_EVENT_RECEIVE, NULL);
+    if (Status == STATUS_NOT_SUPPORTED)
+    {
+        skip("IOCTL_AFD_POLL_REGISTER is not supported\n");
+        return;
+    }
+    ok(Status == STATUS_INVALID_PARAMETER, "AfdPollRegister returned %lx\n", Status);
+
+    Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+    ok(Port != NULL, "CreateIoCompletionPort failed with %lu\n", GetLastError());
+    if (!Port)
+        return;
+
+    for (i = 0; i < ACTIVE_SOCKETS; i++)
+    {
+        ok(CreateIoCompletionPort(ActiveSockets[i], Port, i, 0) == Port,
+           "CreateIoCompletionPort failed with %lu\n", GetLastError());
+    }
+
+    Status = AfdPollRegister(ActiveSockets[0], AFD_EVENT_RECEIVE, &ActiveAddresses[0]);
+    ok(Status == STATUS_SUCCESS, "AfdPollRegister failed with %lx\n", Status);
+
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 0);
+    ok(!Ret && GetLastError() == WAIT_TIMEOUT, "Got a packet for an idle socket\n");
+
+    Status = SendToActive(0);
+    ok(Status == STATUS_SUCCESS, "AfdSendTo failed with %lx\n", Status);
+
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 5000);
+    ok(Ret, "GetQueuedCompletionStatus failed with %lu\n", GetLastError());
+    ok(Key == 0, "Got key %lu\n", (ULONG)Key);
+    ok(Bytes == AFD_EVENT_RECEIVE, "Got events %lx\n", Bytes);
+    ok(Overlapped == (LPOVERLAPPED)&ActiveAddresses[0], "Got context %p\n", Overlapped);
+
+    /* Nothing more until the event is re-enabled by a receive */
+    Status = SendToActive(0);
+    ok(Status == STATUS_SUCCESS, "AfdSendTo failed with %lx\n", Status);
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 100);
+    ok(!Ret && GetLastError() == WAIT_TIMEOUT, "Got a packet before re-enabling\n");
+
+    /* The receive re-enables the event, and data is still pending */
+    RecvFromActive(0);
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 5000);
+    ok(Ret && Key == 0 && Bytes == AFD_EVENT_RECEIVE, "No packet after re-enabling\n");
+    RecvFromActive(0);
+
+    /* The registration stays armed */
+    Status = SendToActive(0);
+    ok(Status == STATUS_SUCCESS, "AfdSendTo failed with %lx\n", Status);
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 5000);
+    ok(Ret && Key == 0 && Bytes == AFD_EVENT_RECEIVE, "No packet for a registered socket\n");
+
+    /* Already pending events are reported at registration */
+    Status = AfdPollRegister(ActiveSockets[0], AFD_EVENT_RECEIVE, NULL);
+    ok(Status == STATUS_SUCCESS, "AfdPollRegister failed with %lx\n", Status);
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 0);
+    ok(Ret && Key == 0 && Bytes == AFD_EVENT_RECEIVE, "No packet for a pending event\n");
+
+    RecvFromActive(0);
+
+    /* Removing the registration */
+    Status = AfdPollRegister(ActiveSockets[1], AFD_EVENT_RECEIVE, NULL);
+    ok(Status == STATUS_SUCCESS, "AfdPollRegister failed with %lx\n", Status);
+    Status = AfdPollRegister(ActiveSockets[1], 0, NULL);
+    ok(Status == STATUS_SUCCESS, "AfdPollRegister failed with %lx\n", Status);
+    SendToActive(1);
+    Ret = GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 100);
+    ok(!Ret && GetLastError() == WAIT_TIMEOUT, "Got a packet after unregistering\n");
+    RecvFromActive(1);
+
+    /* Event delivery while the idle sockets exist */
+    for (i = 0; i < ACTIVE_SOCKETS; i++)
+    {
+        Status = AfdPollRegister(ActiveSockets[i], AFD_EVENT_RECEIVE, NULL);
+        ok(Status == STATUS_SUCCESS, "AfdPollRegister failed with %lx\n", Status);
+    }
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        Index = i % ACTIVE_SOCKETS;
+
+        if (!NT_SUCCESS(SendToActive(Index)) ||
+            !GetQueuedCompletionStatus(Port, &Bytes, &Key, &Overlapped, 5000) ||
+            Key != Index ||
+            !NT_SUCCESS(RecvFromActive(Index)))
+        {
+            Errors++;
+        }
+    }
+    QueryPerformanceCounter(&End);
+    ok(Errors == 0, "Registered poll failed %u times\n", Errors);
+
+    trace("Registered poll with %u idle sockets: %I64d events per second\n", IDLE_SOCKETS,
+          BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    CloseHandle(Port);
+}
+
+START_TEST(select)
+{
+    if (CreateSockets())
+    {
+        RunStateChangeBenchmark(FALSE);
+        RunStateChangeBenchmark(TRUE);
+        RunSelectBenchmark();
+        TestPollRegister();
+    }
+
+    CloseSockets();
+}
@@ -0,0 +1,122 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and benchmark for creating and deleting GDI objects
+ */
+
+#include "precomp.h"
+
+#define MAX_THREADS     4
+#define BENCH_LOOPS     100000
+
+typedef struct _BENCH_DATA
+{
+    HANDLE hStart;
+    BOOL bRegions;
+    UINT cFailures;
+} BENCH_DATA, *PBENCH_DATA;
+
+static
+DWORD
+WINAPI
+BenchThread(LPVOID lpParameter)
+{
+    PBENCH_DATA Data = lpParameter;
+    HGDIOBJ hobj;
+    UINT i;
+
+    WaitForSingleObject(Data->hStart, INFINITE);
+
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        if (Data->bRegions)
+            hobj = CreateRectRgn(0, 0, i & 0xff, 10);
+        else
+            hobj = CreateHatchBrush(HS_CROSS, RGB(i & 0xff, 0, 0));
+
+        if (!hobj || !DeleteObject(hobj))
+            Data->cFailures++;
+    }
+
+    return 0;
+}
+
+static
+void
+RunBenchmark(UINT cThreads, BOOL bRegions)
+{
+    BENCH_DATA Data[MAX_THREADS];
+    HANDLE hThreads[MAX_THREADS];
+    HANDLE hStart;
+    LARGE_INTEGER Frequency, Start, End;
+    UINT i;
+
+    QueryPerformanceFrequency(&Frequency);
+    hStart = CreateEventW(NULL, TRUE, FALSE, NULL);
+
+    for (i = 0; i < cThreads; i++)
+    {
+        Data[i].hStart = hStart;
+        Data[i].bRegions = bRegions;
+        Data[i].cFailures = 0;
+        hThreads[i] = CreateThread(NULL, 0, BenchThread, &Data[i], 0, NULL);
+    }
+
+    QueryPerformanceCounter(&Start);
+    SetEvent(hStart);
+    WaitForMultipleObjects(cThreads, hThreads, TRUE, INFINITE);
+    QueryPerformanceCounter(&End);
+
+    for (i = 0; i < cThreads; i++)
+    {
+        ok(Data[i].cFailures == 0, "Thread %u failed %u times\n", i, Data[i].cFailures);
+        CloseHandle(hThreads[i]);
+    }
+    CloseHandle(hStart);
+
+    trace("%s, %u threads: %I64d objects per second\n",
+          bRegions ? "CreateRectRgn/DeleteObject" : "CreateHatchBrush/DeleteObject", cThreads,
+          cThreads * BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+}
+
+static
+void
+Test_StaleHandles(void)
+{
+    HGDIOBJ ahobj[64];
+    HBRUSH hbr;
+    UINT i;
+
+    /* Deleted handles must stay invalid, even if their entries are reused */
+    for (i = 0; i < ARRAYSIZE(ahobj); i++)
+    {
+        ahobj[i] = CreateHatchBrush(HS_CROSS, RGB(i, 0, 0));
+        ok(ahobj[i] != NULL, "CreateHatchBrush failed\n");
+    }
+    for (i = 0; i < ARRAYSIZE(ahobj); i++)
+    {
+        ok(DeleteObject(ahobj[i]), "DeleteObject failed\n");
+    }
+
+    for (i = 0; i < ARRAYSIZE(ahobj); i++)
+    {
+        hbr = CreateHatchBrush(HS_CROSS, RGB(i, 0, 0));
+        ok(hbr != ahobj[i], "Got the same handle %p again\n", hbr);
+        ok(GetObjectType(ahobj[i]) == 0, "Deleted handle %p is still valid\n", ahobj[i]);
+        ok(GetObjectType(hbr) == OBJ_BRUSH, "Wrong type %lu\n", GetObjectType(hbr));
+        DeleteObject(hbr);
+    }
+}
+
+START_TEST(DeleteObject)
+{
+    UINT cThreads;
+
+    Test_StaleHandles();
+
+    for (cThreads = 1; cThreads <= MAX_THREADS; cThreads *= 2)
+    {
+        RunBenchmark(cThreads, FALSE);
+        RunBenchmark(cThreads, TRUE);
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and benchmark for batched GDI fills and text
+ */
+
+#include "precomp.h"
+
+#define BENCH_LOOPS     20000
+
+static
+void
+Test_BatchedAttributes(HDC hdc)
+{
+    HBRUSH hbrRed, hbrBlue, hbrOld;
+    HPEN hpenOld;
+    RECT rc;
+
+    hbrRed = CreateSolidBrush(RGB(255, 0, 0));
+    hbrBlue = CreateSolidBrush(RGB(0, 0, 255));
+    PatBlt(hdc, 0, 0, 16, 16, WHITENESS);
+
+    /* Each queued call draws with the objects selected when it was made */
+    hpenOld = SelectObject(hdc, GetStockObject(NULL_PEN));
+    hbrOld = SelectObject(hdc, hbrRed);
+    ok(Rectangle(hdc, 0, 0, 5, 5), "Rectangle failed\n");
+    SelectObject(hdc, hbrBlue);
+    ok(Rectangle(hdc, 4, 0, 9, 5), "Rectangle failed\n");
+    SelectObject(hdc, GetStockObject(DC_BRUSH));
+    SetDCBrushColor(hdc, RGB(0, 255, 0));
+    SetRect(&rc, 8, 0, 12, 4);
+    FillRect(hdc, &rc, GetStockObject(DC_BRUSH));
+    SetDCBrushColor(hdc, RGB(0, 0, 0));
+    ok(Rectangle(hdc, 12, 0, 17, 5), "Rectangle failed\n");
+
+    /* Changing the ROP2 must not affect the rectangles already queued */
+    SelectObject(hdc, GetStockObject(WHITE_PEN));
+    SelectObject(hdc, GetStockObject(NULL_BRUSH));
+    ok(Rectangle(hdc, 0, 8, 4, 12), "Rectangle failed\n");
+    SetROP2(hdc, R2_NOT);
+    ok(Rectangle(hdc, 8, 8, 12, 12), "Rectangle failed\n");
+    SetROP2(hdc, R2_COPYPEN);
+
+    ok_long(GetPixel(hdc, 1, 1), RGB(255, 0, 0));
+    ok_long(GetPixel(hdc, 5, 1), RGB(0, 0, 255));
+    ok_long(GetPixel(hdc, 9, 1), RGB(0, 255, 0));
+    ok_long(GetPixel(hdc, 13, 1), RGB(0, 0, 0));
+    ok_long(GetPixel(hdc, 0, 8), RGB(255, 255, 255));
+    ok_long(GetPixel(hdc, 8, 8), RGB(0, 0, 0));
+
+    SelectObject(hdc, hbrOld);
+    SelectObject(hdc, hpenOld);
+    DeleteObject(hbrRed);
+    DeleteObject(hbrBlue);
+}
+
+static
+void
+RunBenchmark(HDC hdc, DWORD dwLimit)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    HBRUSH ahbr[2];
+    HBRUSH hbrOld;
+    RECT rc;
+    DWORD dwOldLimit;
+    UINT i;
+
+    ahbr[0] = CreateSolidBrush(RGB(255, 0, 0));
+    ahbr[1] = CreateSolidBrush(RGB(0, 0, 255));
+    hbrOld = SelectObject(hdc, ahbr[0]);
+    dwOldLimit = GdiSetBatchLimit(dwLimit);
+
+    QueryPerformanceFrequency(&Frequency);
+
+    /* A run of fills with the same brush */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        SetRect(&rc, i & 31, 0, (i & 31) + 8, 8);
+        FillRect(hdc, &rc, ahbr[0]);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+    trace("FillRect, batch limit %lu: %I64d calls per second\n", dwLimit,
+          BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    /* Rectangles with alternating brushes */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        SelectObject(hdc, ahbr[i & 1]);
+        Rectangle(hdc, i & 31, 8, (i & 31) + 8, 16);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+    trace("SelectObject/Rectangle, batch limit %lu: %I64d calls per second\n", dwLimit,
+          BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    /* Colored text */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        SetTextColor(hdc, (i & 1) ? RGB(0, 0, 0) : RGB(0, 128, 0));
+        ExtTextOutW(hdc, i & 31, 16, 0, NULL, L"Batch", 5, NULL);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+    trace("SetTextColor/ExtTextOut, batch limit %lu: %I64d calls per second\n", dwLimit,
+          BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    GdiSetBatchLimit(dwOldLimit);
+    SelectObject(hdc, hbrOld);
+    DeleteObject(ahbr[0]);
+    DeleteObject(ahbr[1]);
+}
+
+START_TEST(GdiSetBatchLimit)
+{
+    HDC hdcScreen, hdc;
+    HBITMAP hbmp, hbmpOld;
+
+    /* A compatible bitmap, DIB sections are not batched */
+    hdcScreen = GetDC(NULL);
+    hdc = CreateCompatibleDC(hdcScreen);
+    hbmp = CreateCompatibleBitmap(hdcScreen, 64, 32);
+    ReleaseDC(NULL, hdcScreen);
+    ok(hdc != NULL && hbmp != NULL, "Failed to create the DC\n");
+    if (!hdc || !hbmp)
+        return;
+    hbmpOld = SelectObject(hdc, hbmp);
+
+    Test_BatchedAttributes(hdc);
+
+    RunBenchmark(hdc, GdiGetBatchLimit());
+    RunBenchmark(hdc, 1);
+
+    SelectObject(hdc, hbmpOld);
+    DeleteObject(hbmp);
+    DeleteDC(hdc);
+}
@@ -0,0 +1,218 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and benchmark for PtInRegion/RectInRegion on complex regions
+ */
+
+#include "precomp.h"
+
+/* A checkerboard of CELLS x CELLS cells, half of them in the region */
+#define CELL_SIZE   4
+#define CELLS       64
+#define RECT_COUNT  (CELLS * CELLS / 2)
+#define BENCH_LOOPS 100000
+
+static
+BOOL
+IsInCheckerboard(INT x, INT y)
+{
+    if (x < 0 || y < 0 || x >= CELLS * CELL_SIZE || y >= CELLS * CELL_SIZE)
+        return FALSE;
+
+    return (((x / CELL_SIZE) + (y / CELL_SIZE)) & 1) == 0;
+}
+
+static
+INT
+NextRandom(PULONG Seed)
+{
+    *Seed = *Seed * 1103515245 + 12345;
+    return (*Seed >> 16) & 0x7FFF;
+}
+
+static
+HRGN
+CreateCheckerboardRgn(VOID)
+{
+    PRGNDATA RgnData;
+    PRECT Rects;
+    HRGN hrgn;
+    INT x, y;
+
+    RgnData = HeapAlloc(GetProcessHeap(), 0, sizeof(RGNDATAHEADER) + RECT_COUNT * sizeof(RECT));
+    if (!RgnData)
+        return NULL;
+
+    RgnData->rdh.dwSize = sizeof(RGNDATAHEADER);
+    RgnData->rdh.iType = RDH_RECTANGLES;
+    RgnData->rdh.nCount = RECT_COUNT;
+    RgnData->rdh.nRgnSize = RECT_COUNT * sizeof(RECT);
+    SetRect(&RgnData->rdh.rcBound, 0, 0, CELLS * CELL_SIZE, CELLS * CELL_SIZE);
+
+    Rects = (PRECT)RgnData->Buffer;
+    for (y = 0; y < CELLS; y++)
+    {
+        for (x = y & 1; x < CELLS; x += 2)
+        {
+            SetRect(Rects++,
+                    x * CELL_SIZE,
+                    y * CELL_SIZE,
+                    (x + 1) * CELL_SIZE,
+                    (y + 1) * CELL_SIZE);
+        }
+    }
+
+    hrgn = ExtCreateRegion(NULL, sizeof(RGNDATAHEADER) + RECT_COUNT * sizeof(RECT), RgnData);
+    HeapFree(GetProcessHeap(), 0, RgnData);
+    return hrgn;
+}
+
+static
+void
+Test_PtInRegion(HRGN hrgn)
+{
+    INT x, y, Errors = 0;
+
+    for (y = -2; y < CELLS * CELL_SIZE + 2; y++)
+    {
+        for (x = -2; x < CELLS * CELL_SIZE + 2; x++)
+        {
+            if (PtInRegion(hrgn, x, y) != IsInCheckerboard(x, y))
+                Errors++;
+        }
+    }
+
+    ok(Errors == 0, "PtInRegion was wrong for %d points\n", Errors);
+}
+
+static
+void
+Test_RectInRegion(HRGN hrgn)
+{
+    RECT rc;
+
+    /* Inside a cell that is in the region */
+    SetRect(&rc, 1, 1, 2, 2);
+    ok(RectInRegion(hrgn, &rc), "Expected TRUE\n");
+
+    /* Inside a cell that isn't */
+    SetRect(&rc, CELL_SIZE + 1, 1, CELL_SIZE + 3, 3);
+    ok(!RectInRegion(hrgn, &rc), "Expected FALSE\n");
+
+    /* Touching a region cell only with its edges */
+    SetRect(&rc, CELL_SIZE, 0, 2 * CELL_SIZE, CELL_SIZE);
+    ok(!RectInRegion(hrgn, &rc), "Expected FALSE\n");
+
+    /* Spanning two cells of the same band */
+    SetRect(&rc, CELL_SIZE + 1, 1, 2 * CELL_SIZE + 1, 2);
+    ok(RectInRegion(hrgn, &rc), "Expected TRUE\n");
+
+    /* Spanning two bands, in the last column */
+    SetRect(&rc, (CELLS - 1) * CELL_SIZE, CELL_SIZE - 1, CELLS * CELL_SIZE, CELL_SIZE + 1);
+    ok(RectInRegion(hrgn, &rc), "Expected TRUE\n");
+
+    /* Unordered coordinates */
+    SetRect(&rc, 2, 2, 1, 1);
+    ok(RectInRegion(hrgn, &rc), "Expected TRUE\n");
+
+    /* Outside of the bounds */
+    SetRect(&rc, -10, -10, 0, 0);
+    ok(!RectInRegion(hrgn, &rc), "Expected FALSE\n");
+    SetRect(&rc, CELLS * CELL_SIZE, 0, CELLS * CELL_SIZE + 10, 10);
+    ok(!RectInRegion(hrgn, &rc), "Expected FALSE\n");
+}
+
+static
+void
+Test_Benchmark(HRGN hrgn)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    BITMAPINFO bmi;
+    HBITMAP hbmp;
+    HDC hdc;
+    PVOID pvBits;
+    RECT rc;
+    ULONG Seed = 1;
+    INT i, x, y, Hits = 0;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        x = NextRandom(&Seed) % (CELLS * CELL_SIZE);
+        y = NextRandom(&Seed) % (CELLS * CELL_SIZE);
+        Hits += PtInRegion(hrgn, x, y);
+    }
+    QueryPerformanceCounter(&End);
+    ok(Hits > 0 && Hits < BENCH_LOOPS, "Got %d hits\n", Hits);
+    trace("PtInRegion, %d rects: %I64d calls per second\n", RECT_COUNT,
+          BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS; i++)
+    {
+        x = NextRandom(&Seed) % (CELLS * CELL_SIZE);
+        y = NextRandom(&Seed) % (CELLS * CELL_SIZE);
+        SetRect(&rc, x, y, x + 2, y + 2);
+        Hits += RectInRegion(hrgn, &rc);
+    }
+    QueryPerformanceCounter(&End);
+    trace("RectInRegion, %d rects: %I64d calls per second\n", RECT_COUNT,
+          BENCH_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    /* Overlapping blits make the engine enumerate the clip rects bottom-up */
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = CELLS * CELL_SIZE;
+    bmi.bmiHeader.biHeight = CELLS * CELL_SIZE;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC(NULL);
+    hbmp = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &pvBits, NULL, 0);
+    if (!hdc || !hbmp)
+    {
+        skip("Failed to create the DIB section\n");
+        if (hdc) DeleteDC(hdc);
+        return;
+    }
+    SelectObject(hdc, hbmp);
+    SelectClipRgn(hdc, hrgn);
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < BENCH_LOOPS / 100; i++)
+    {
+        BitBlt(hdc, 1, 1, CELLS * CELL_SIZE - 1, CELLS * CELL_SIZE - 1, hdc, 0, 0, SRCCOPY);
+        BitBlt(hdc, 0, 0, CELLS * CELL_SIZE - 1, CELLS * CELL_SIZE - 1, hdc, 1, 1, SRCCOPY);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+    trace("Overlapping BitBlt, %d clip rects: %I64d blits per second\n", RECT_COUNT,
+          2 * (BENCH_LOOPS / 100) * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    DeleteDC(hdc);
+    DeleteObject(hbmp);
+}
+
+START_TEST(PtInRegion)
+{
+    HRGN hrgn;
+    DWORD Size;
+
+    hrgn = CreateCheckerboardRgn();
+    ok(hrgn != NULL, "ExtCreateRegion failed\n");
+    if (!hrgn)
+        return;
+
+    /* Make sure no rectangles were merged */
+    Size = GetRegionData(hrgn, 0, NULL);
+    ok(Size == sizeof(RGNDATAHEADER) + RECT_COUNT * sizeof(RECT), "Wrong size: %lu\n", Size);
+
+    Test_PtInRegion(hrgn);
+    Test_RectInRegion(hrgn);
+    Test_Benchmark(hrgn);
+
+    DeleteObject(hrgn);
+}
@@ -19,6 +19,7 @@ extern void func_CreateFontIndirect(void);
 extern void func_CreateIconIndirect(void);
 extern void func_CreatePen(void);
 extern void func_CreateRectRgn(void);
+extern void func_DeleteObject(void);
 extern void func_DPtoLP(void);
 extern void func_EngAcquireSemaphore(void);
 extern void func_EngCreateSemaphore(void);
@@ -40,6 +41,7 @@ extern void func_GdiGetLocalBrush(void);
 extern void func_GdiGetLocalDC(void);
 extern void func_GdiReleaseLocalDC(void);
 extern void func_GdiSetAttrs(void);
+extern void func_GdiSetBatchLimit(void);
 extern void func_GetClipBox(void);
 extern void func_GetClipRgn(void);
 extern void func_GetCurrentObject(void);
@@ -62,6 +64,7 @@ extern void func_OffsetClipRgn(void);
 extern void func_OffsetRgn(void);
 extern void func_PaintRgn(void);
 extern void func_PatBlt(void);
+extern void func_PtInRegion(void);
 extern void func_Rectangle(void);
 extern void func_RealizePalette(void);
 extern void func_SelectObject(void);
@@ -95,6 +98,7 @@ const struct test winetest_testlist[] =
     { "CreateIconIndirect", func_CreateIconIndirect },
     { "CreatePen", func_CreatePen },
     { "CreateRectRgn", func_CreateRectRgn },
+    { "DeleteObject", func_DeleteObject },
     { "DPtoLP", func_DPtoLP },
     { "EngAcquireSemaphore", func_EngAcquireSemaphore },
     { "EngCreateSemaphore", func_EngCreateSemaphore },
@@ -116,6 +120,7 @@ const struct test winetest_testlist[] =
     { "GdiGetLocalDC", func_GdiGetLocalDC },
     { "GdiReleaseLocalDC", func_GdiReleaseLocalDC },
     { "GdiSetAttrs", func_GdiSetAttrs },
+    { "GdiSetBatchLimit", func_GdiSetBatchLimit },
     { "GetClipBox", func_GetClipBox },
     { "GetClipRgn", func_GetClipRgn },
     { "GetCurrentObject", func_GetCurrentObject },
@@ -138,6 +143,7 @@ const struct test winetest_testlist[] =
     { "OffsetRgn", func_OffsetRgn },
     { "PaintRgn", func_PaintRgn },
     { "PatBlt", func_PatBlt },
+    { "PtInRegion", func_PtInRegion },
     { "Rectangle", func_Rectangle },
     { "RealizePalette", func_RealizePalette },
     { "SelectObject", func_SelectObject },
@@ -0,0 +1,127 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Benchmark for sequential read throughput of a disk volume
+ */
+
+#include "precomp.h"
+#include <winioctl.h>
+
+#define MAX_BLOCK_SIZE  (1024 * 1024)
+#define BENCH_BYTES     (64 * 1024 * 1024)
+
+static const DWORD BlockSizes[] = { 4096, 64 * 1024, MAX_BLOCK_SIZE };
+
+static
+HANDLE
+OpenVolume(PCHAR Name, DWORD Size)
+{
+    CHAR SystemDir[MAX_PATH];
+
+    /* The system volume, which is the ramdisk when booted from one,
+       unless DISKTHROUGHPUT_DISK names another one, e.g. \\.\D: */
+    if (!GetEnvironmentVariableA("DISKTHROUGHPUT_DISK", Name, Size))
+    {
+        if (!GetSystemDirectoryA(SystemDir, sizeof(SystemDir)))
+            return INVALID_HANDLE_VALUE;
+        StringCchPrintfA(Name, Size, "\\\\.\\%c:", SystemDir[0]);
+    }
+
+    return CreateFileA(Name,
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_NO_BUFFERING,
+                       NULL);
+}
+
+static
+ULONGLONG
+GetVolumeLength(HANDLE hVolume)
+{
+    GET_LENGTH_INFORMATION LengthInfo;
+    DWORD Returned;
+
+    if (!DeviceIoControl(hVolume, IOCTL_DISK_GET_LENGTH_INFO, NULL, 0,
+                         &LengthInfo, sizeof(LengthInfo), &Returned, NULL))
+    {
+        return 0;
+    }
+
+    return LengthInfo.Length.QuadPart;
+}
+
+static
+void
+RunBlockSize(HANDLE hVolume, PVOID Buffer, ULONGLONG Length, DWORD BlockSize)
+{
+    LARGE_INTEGER Frequency, Start, End, Offset;
+    ULONGLONG Total = 0;
+    DWORD Read;
+
+    /* Wrap around on volumes smaller than the amount we read */
+    Length -= Length % BlockSize;
+    Offset.QuadPart = 0;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    while (Total < BENCH_BYTES)
+    {
+        if (Offset.QuadPart >= (LONGLONG)Length)
+        {
+            Offset.QuadPart = 0;
+            if (!SetFilePointerEx(hVolume, Offset, NULL, FILE_BEGIN))
+                break;
+        }
+
+        if (!ReadFile(hVolume, Buffer, BlockSize, &Read, NULL) || Read != BlockSize)
+            break;
+
+        Total += Read;
+        Offset.QuadPart += Read;
+    }
+
+    QueryPerformanceCounter(&End);
+
+    ok(Total >= BENCH_BYTES, "Read stopped after %I64u bytes: %lu\n", Total, GetLastError());
+    trace("%7lu byte reads: %I64u KB/s, %I64u reads per second\n", BlockSize,
+          Total / 1024 * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1),
+          Total / BlockSize * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    Offset.QuadPart = 0;
+    SetFilePointerEx(hVolume, Offset, NULL, FILE_BEGIN);
+}
+
+START_TEST(DiskThroughput)
+{
+    CHAR Name[MAX_PATH];
+    HANDLE hVolume;
+    ULONGLONG Length;
+    PVOID Buffer;
+    ULONG i;
+
+    hVolume = OpenVolume(Name, sizeof(Name));
+    if (hVolume == INVALID_HANDLE_VALUE)
+    {
+        skip("Failed to open %s: %lu\n", Name, GetLastError());
+        return;
+    }
+
+    Length = GetVolumeLength(hVolume);
+    ok(Length >= MAX_BLOCK_SIZE, "Failed to get the size of %s: %lu\n", Name, GetLastError());
+
+    Buffer = VirtualAlloc(NULL, MAX_BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    ok(Buffer != NULL, "No memory\n");
+
+    if (Length >= MAX_BLOCK_SIZE && Buffer)
+    {
+        trace("Reading %s\n", Name);
+        for (i = 0; i < _countof(BlockSizes); i++)
+            RunBlockSize(hVolume, Buffer, Length, BlockSizes[i]);
+    }
+
+    if (Buffer) VirtualFree(Buffer, 0, MEM_RELEASE);
+    CloseHandle(hVolume);
+}
@@ -0,0 +1,196 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Benchmark for random 4 KB reads from a disk at queue depths 1 to 32
+ */
+
+#include "precomp.h"
+#include <winioctl.h>
+#include <ntddstor.h>
+
+#define BLOCK_SIZE      4096
+#define MAX_QUEUE_DEPTH 32
+#define BENCH_READS     4096
+
+static
+HANDLE
+OpenDisk(PCHAR Name, DWORD Size)
+{
+    /* The first disk, unless RANDOMREAD_DISK names another one, e.g. \\.\PhysicalDrive1 */
+    if (!GetEnvironmentVariableA("RANDOMREAD_DISK", Name, Size))
+        StringCchCopyA(Name, Size, "\\\\.\\PhysicalDrive0");
+
+    return CreateFileA(Name,
+                       GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE,
+                       NULL,
+                       OPEN_EXISTING,
+                       FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED,
+                       NULL);
+}
+
+static
+BOOL
+QueryDisk(HANDLE hDisk, DWORD IoControlCode, PVOID Buffer, DWORD Size)
+{
+    OVERLAPPED Overlapped;
+    DWORD Returned;
+    BOOL Ret;
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!Overlapped.hEvent)
+        return FALSE;
+
+    Ret = DeviceIoControl(hDisk, IoControlCode, NULL, 0, Buffer, Size, &Returned, &Overlapped);
+    if (!Ret && GetLastError() == ERROR_IO_PENDING)
+        Ret = GetOverlappedResult(hDisk, &Overlapped, &Returned, TRUE);
+    CloseHandle(Overlapped.hEvent);
+
+    return Ret;
+}
+
+static
+ULONGLONG
+GetDiskBlocks(HANDLE hDisk)
+{
+    DISK_GEOMETRY Geometry;
+
+    if (!QueryDisk(hDisk, IOCTL_DISK_GET_DRIVE_GEOMETRY, &Geometry, sizeof(Geometry)))
+        return 0;
+
+    return Geometry.Cylinders.QuadPart * Geometry.TracksPerCylinder *
+           Geometry.SectorsPerTrack * Geometry.BytesPerSector / BLOCK_SIZE;
+}
+
+static
+void
+TraceElevatorStatistics(HANDLE hDisk)
+{
+    STORAGE_ELEVATOR_STATISTICS Stats;
+    ULONG i;
+
+    /* Only class drivers built on classpnp keep these */
+    if (!QueryDisk(hDisk, IOCTL_STORAGE_GET_ELEVATOR_STATISTICS, &Stats, sizeof(Stats)))
+    {
+        skip("No elevator statistics: %lu\n", GetLastError());
+        return;
+    }
+
+    trace("Elevator: %lu reads, %lu writes, %lu queued, %lu merged, %lu transfers, peak queue depth %lu, up to %lu transfers at the disk\n",
+          Stats.ReadCount, Stats.WriteCount, Stats.QueuedCount, Stats.MergedCount,
+          Stats.TransferCount, Stats.PeakQueueDepth, Stats.MaxOutstanding);
+    for (i = 0; i < STORAGE_ELEVATOR_LATENCY_BUCKETS; i++)
+    {
+        if (Stats.LatencyHistogram[i] && i < STORAGE_ELEVATOR_LATENCY_BUCKETS - 1)
+            trace("Latency  < %7lu us: %lu\n", 32UL << i, Stats.LatencyHistogram[i]);
+        else if (Stats.LatencyHistogram[i])
+            trace("Latency >= %7lu us: %lu\n", 32UL << (i - 1), Stats.LatencyHistogram[i]);
+    }
+}
+
+static
+BOOL
+IssueRead(HANDLE hDisk, LPOVERLAPPED Overlapped, PVOID Buffer, ULONGLONG Blocks, PULONG Seed)
+{
+    ULARGE_INTEGER Offset;
+
+    Offset.QuadPart = (((ULONGLONG)RtlRandom(Seed) << 31) | RtlRandom(Seed)) % Blocks * BLOCK_SIZE;
+
+    ZeroMemory(Overlapped, sizeof(*Overlapped));
+    Overlapped->Offset = Offset.LowPart;
+    Overlapped->OffsetHigh = Offset.HighPart;
+
+    return ReadFile(hDisk, Buffer, BLOCK_SIZE, NULL, Overlapped) ||
+           GetLastError() == ERROR_IO_PENDING;
+}
+
+static
+void
+RunQueueDepth(HANDLE hDisk, HANDLE Port, ULONGLONG Blocks, ULONG Depth)
+{
+    OVERLAPPED Overlapped[MAX_QUEUE_DEPTH];
+    LARGE_INTEGER Frequency, Start, End;
+    LPOVERLAPPED Completed;
+    ULONG_PTR Key;
+    PUCHAR Buffers;
+    ULONG Issued, Done, Failed = 0, Seed = Depth, i;
+    DWORD Transferred;
+
+    Buffers = VirtualAlloc(NULL, Depth * BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!Buffers)
+    {
+        skip("No memory\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    /* Keep Depth reads outstanding, each completion issues the next read */
+    for (Issued = 0; Issued < Depth; Issued++)
+    {
+        if (!IssueRead(hDisk, &Overlapped[Issued], Buffers + Issued * BLOCK_SIZE, Blocks, &Seed))
+            break;
+    }
+
+    for (Done = 0; Done < Issued; Done++)
+    {
+        if (!GetQueuedCompletionStatus(Port, &Transferred, &Key, &Completed, 10000))
+        {
+            if (!Completed)
+                break;
+            Failed++;
+        }
+
+        if (Issued < BENCH_READS)
+        {
+            i = (ULONG)(Completed - Overlapped);
+            if (IssueRead(hDisk, Completed, Buffers + i * BLOCK_SIZE, Blocks, &Seed))
+                Issued++;
+        }
+    }
+
+    QueryPerformanceCounter(&End);
+
+    ok(Done == BENCH_READS, "Only %lu of %u reads completed\n", Done, BENCH_READS);
+    ok(Failed == 0, "%lu reads failed\n", Failed);
+    trace("Queue depth %2lu: %I64d reads per second\n", Depth,
+          Done * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    /* Don't free buffers the disk may still write to */
+    if (Done == Issued)
+        VirtualFree(Buffers, 0, MEM_RELEASE);
+}
+
+START_TEST(RandomRead)
+{
+    CHAR Name[MAX_PATH];
+    HANDLE hDisk, Port;
+    ULONGLONG Blocks;
+    ULONG Depth;
+
+    hDisk = OpenDisk(Name, sizeof(Name));
+    if (hDisk == INVALID_HANDLE_VALUE)
+    {
+        skip("Failed to open %s: %lu\n", Name, GetLastError());
+        return;
+    }
+
+    Blocks = GetDiskBlocks(hDisk);
+    ok(Blocks != 0, "Failed to get the size of %s: %lu\n", Name, GetLastError());
+
+    Port = CreateIoCompletionPort(hDisk, NULL, 0, 1);
+    ok(Port != NULL, "CreateIoCompletionPort failed: %lu\n", GetLastError());
+
+    if (Blocks && Port)
+    {
+        for (Depth = 1; Depth <= MAX_QUEUE_DEPTH; Depth *= 2)
+            RunQueueDepth(hDisk, Port, Blocks, Depth);
+
+        TraceElevatorStatistics(hDisk);
+    }
+
+    if (Port) CloseHandle(Port);
+    CloseHandle(hDisk);
+}
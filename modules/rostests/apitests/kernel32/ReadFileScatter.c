@@ -0,0 +1,272 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and benchmark for ReadFileScatter/WriteFileGather
+ */
+
+#include "precomp.h"
+
+#define SEGMENT_COUNT   16
+#define FILE_PAGES      256
+#define BENCH_LOOPS     64
+
+static DWORD PageSize;
+static PUCHAR Pages[SEGMENT_COUNT];
+
+static
+HANDLE
+OpenTestFile(PCHAR FileName)
+{
+    CHAR TempPath[MAX_PATH];
+
+    if (!GetTempPathA(MAX_PATH, TempPath) ||
+        !GetTempFileNameA(TempPath, "sg", 0, FileName))
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    return CreateFileA(FileName,
+                       GENERIC_READ | GENERIC_WRITE,
+                       0,
+                       NULL,
+                       CREATE_ALWAYS,
+                       FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED | FILE_FLAG_DELETE_ON_CLOSE,
+                       NULL);
+}
+
+static
+BOOL
+FillTestFile(HANDLE hFile)
+{
+    OVERLAPPED Overlapped;
+    DWORD i, Written;
+
+    /* Each page of the file starts with its own index */
+    for (i = 0; i < FILE_PAGES; i++)
+    {
+        FillMemory(Pages[0], PageSize, (UCHAR)i);
+        *(PDWORD)Pages[0] = i;
+
+        ZeroMemory(&Overlapped, sizeof(Overlapped));
+        Overlapped.Offset = i * PageSize;
+        if (!WriteFile(hFile, Pages[0], PageSize, &Written, &Overlapped))
+        {
+            if (GetLastError() != ERROR_IO_PENDING ||
+                !GetOverlappedResult(hFile, &Overlapped, &Written, TRUE))
+            {
+                return FALSE;
+            }
+        }
+        if (Written != PageSize) return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+BOOL
+WaitForCompletion(HANDLE Port, LPOVERLAPPED Expected, PDWORD Transferred)
+{
+    ULONG_PTR Key;
+    LPOVERLAPPED Overlapped;
+
+    if (!GetQueuedCompletionStatus(Port, Transferred, &Key, &Overlapped, 5000))
+        return FALSE;
+
+    ok(Key == 0x5C47, "Wrong completion key: %Ix\n", Key);
+    ok(Overlapped == Expected, "Wrong overlapped: %p, expected %p\n", Overlapped, Expected);
+    return TRUE;
+}
+
+static
+void
+Test_ScatterGather(HANDLE hFile, HANDLE Port)
+{
+    FILE_SEGMENT_ELEMENT Segments[SEGMENT_COUNT + 1];
+    OVERLAPPED Overlapped;
+    DWORD i, Transferred;
+    ULONG_PTR Key;
+    LPOVERLAPPED Completed;
+    BOOL Ret;
+
+    /* Read pages 32..47 of the file into our scattered pages */
+    ZeroMemory(Segments, sizeof(Segments));
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        FillMemory(Pages[i], PageSize, 0xCC);
+        Segments[i].Alignment = (ULONG_PTR)Pages[i];
+    }
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Overlapped.Offset = 32 * PageSize;
+    Ret = ReadFileScatter(hFile, Segments, SEGMENT_COUNT * PageSize, NULL, &Overlapped);
+    ok(Ret || GetLastError() == ERROR_IO_PENDING, "ReadFileScatter failed: %lu\n", GetLastError());
+    if (!Ret && GetLastError() != ERROR_IO_PENDING)
+        return;
+
+    /* Exactly one completion for the whole request */
+    ok(WaitForCompletion(Port, &Overlapped, &Transferred), "No completion: %lu\n", GetLastError());
+    ok(Transferred == SEGMENT_COUNT * PageSize, "Transferred %lu\n", Transferred);
+    ok(!GetQueuedCompletionStatus(Port, &Transferred, &Key, &Completed, 0),
+       "Got an extra completion packet\n");
+
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        ok(*(PDWORD)Pages[i] == 32 + i, "Segment %lu has page %lu\n", i, *(PDWORD)Pages[i]);
+        ok(Pages[i][PageSize - 1] == (UCHAR)(32 + i), "Segment %lu has wrong data\n", i);
+    }
+
+    /* Write them back, swapped around, to pages 0..15 */
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        Segments[i].Alignment = (ULONG_PTR)Pages[SEGMENT_COUNT - 1 - i];
+    }
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Ret = WriteFileGather(hFile, Segments, SEGMENT_COUNT * PageSize, NULL, &Overlapped);
+    ok(Ret || GetLastError() == ERROR_IO_PENDING, "WriteFileGather failed: %lu\n", GetLastError());
+    if (!Ret && GetLastError() != ERROR_IO_PENDING)
+        return;
+    ok(WaitForCompletion(Port, &Overlapped, &Transferred), "No completion: %lu\n", GetLastError());
+    ok(Transferred == SEGMENT_COUNT * PageSize, "Transferred %lu\n", Transferred);
+
+    /* And read them back in order */
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        Segments[i].Alignment = (ULONG_PTR)Pages[i];
+    }
+
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    Ret = ReadFileScatter(hFile, Segments, SEGMENT_COUNT * PageSize, NULL, &Overlapped);
+    ok(Ret || GetLastError() == ERROR_IO_PENDING, "ReadFileScatter failed: %lu\n", GetLastError());
+    if (!Ret && GetLastError() != ERROR_IO_PENDING)
+        return;
+    ok(WaitForCompletion(Port, &Overlapped, &Transferred), "No completion: %lu\n", GetLastError());
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        ok(*(PDWORD)Pages[i] == 32 + SEGMENT_COUNT - 1 - i, "Segment %lu has page %lu\n", i, *(PDWORD)Pages[i]);
+    }
+
+    /* Segments must be page aligned */
+    Segments[0].Alignment = (ULONG_PTR)(Pages[0] + 512);
+    ZeroMemory(&Overlapped, sizeof(Overlapped));
+    SetLastError(0xdeadbeef);
+    Ret = ReadFileScatter(hFile, Segments, SEGMENT_COUNT * PageSize, NULL, &Overlapped);
+    ok(!Ret && GetLastError() == ERROR_INVALID_PARAMETER, "Ret %d, error %lu\n", Ret, GetLastError());
+}
+
+static
+void
+Test_Benchmark(HANDLE hFile, HANDLE Port)
+{
+    FILE_SEGMENT_ELEMENT Segments[SEGMENT_COUNT + 1];
+    OVERLAPPED Overlapped[SEGMENT_COUNT];
+    LARGE_INTEGER Frequency, Start, Scatter, Loop;
+    DWORD i, j, Transferred;
+    ULONG_PTR Key;
+    LPOVERLAPPED Completed;
+    BOOL Ret;
+
+    ZeroMemory(Segments, sizeof(Segments));
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        Segments[i].Alignment = (ULONG_PTR)Pages[i];
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+
+    /* One request for all the segments */
+    QueryPerformanceCounter(&Start);
+    for (j = 0; j < BENCH_LOOPS; j++)
+    {
+        ZeroMemory(&Overlapped[0], sizeof(Overlapped[0]));
+        Overlapped[0].Offset = ((j * SEGMENT_COUNT) % FILE_PAGES) * PageSize;
+        Ret = ReadFileScatter(hFile, Segments, SEGMENT_COUNT * PageSize, NULL, &Overlapped[0]);
+        if (!Ret && GetLastError() != ERROR_IO_PENDING) break;
+        if (!WaitForCompletion(Port, &Overlapped[0], &Transferred)) break;
+    }
+    QueryPerformanceCounter(&Scatter);
+    ok(j == BENCH_LOOPS, "ReadFileScatter failed at loop %lu: %lu\n", j, GetLastError());
+    Scatter.QuadPart -= Start.QuadPart;
+
+    /* One request per segment */
+    QueryPerformanceCounter(&Start);
+    for (j = 0; j < BENCH_LOOPS; j++)
+    {
+        for (i = 0; i < SEGMENT_COUNT; i++)
+        {
+            ZeroMemory(&Overlapped[i], sizeof(Overlapped[i]));
+            Overlapped[i].Offset = ((j * SEGMENT_COUNT + i) % FILE_PAGES) * PageSize;
+            Ret = ReadFile(hFile, Pages[i], PageSize, NULL, &Overlapped[i]);
+            if (!Ret && GetLastError() != ERROR_IO_PENDING) break;
+        }
+        if (i != SEGMENT_COUNT) break;
+        for (i = 0; i < SEGMENT_COUNT; i++)
+        {
+            if (!GetQueuedCompletionStatus(Port, &Transferred, &Key, &Completed, 5000))
+                break;
+        }
+        if (i != SEGMENT_COUNT) break;
+    }
+    QueryPerformanceCounter(&Loop);
+    ok(j == BENCH_LOOPS, "ReadFile failed at loop %lu: %lu\n", j, GetLastError());
+    Loop.QuadPart -= Start.QuadPart;
+
+    trace("%u x %u pages: ReadFileScatter %I64u us, ReadFile loop %I64u us\n",
+          BENCH_LOOPS, SEGMENT_COUNT,
+          Scatter.QuadPart * 1000000 / Frequency.QuadPart,
+          Loop.QuadPart * 1000000 / Frequency.QuadPart);
+}
+
+START_TEST(ReadFileScatter)
+{
+    CHAR FileName[MAX_PATH];
+    SYSTEM_INFO SystemInfo;
+    HANDLE hFile, Port;
+    DWORD i;
+
+    GetSystemInfo(&SystemInfo);
+    PageSize = SystemInfo.dwPageSize;
+
+    /* Allocate the pages one by one, so that they're scattered */
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        Pages[i] = VirtualAlloc(NULL, PageSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!Pages[i])
+        {
+            skip("Failed to allocate page %lu\n", i);
+            goto Cleanup;
+        }
+    }
+
+    hFile = OpenTestFile(FileName);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        skip("Failed to create test file: %lu\n", GetLastError());
+        goto Cleanup;
+    }
+
+    if (!FillTestFile(hFile))
+    {
+        skip("Failed to fill test file: %lu\n", GetLastError());
+        CloseHandle(hFile);
+        goto Cleanup;
+    }
+
+    Port = CreateIoCompletionPort(hFile, NULL, 0x5C47, 1);
+    ok(Port != NULL, "CreateIoCompletionPort failed: %lu\n", GetLastError());
+    if (Port)
+    {
+        Test_ScatterGather(hFile, Port);
+        Test_Benchmark(hFile, Port);
+        CloseHandle(Port);
+    }
+
+    CloseHandle(hFile);
+
+Cleanup:
+    for (i = 0; i < SEGMENT_COUNT; i++)
+    {
+        if (Pages[i]) VirtualFree(Pages[i], 0, MEM_RELEASE);
+    }
+}
@@ -7,13 +7,85 @@
 
 #include "precomp.h"
 
+static
+void
+Test_WorkingSetAging(void)
+{
+    NTSTATUS Status;
+    ULONG ReturnLength;
+    SYSTEM_WS_AGING_INFORMATION Header;
+    PSYSTEM_WS_AGING_INFORMATION AgingInfo;
+    ULONG Pages;
+    ULONG i, j;
+    BOOLEAN FoundSelf = FALSE;
+
+    /* The aging statistics are a ReactOS private class */
+    ReturnLength = 0;
+    Status = NtQuerySystemInformation(SystemWorkingSetAgingInformation, &Header, sizeof(Header), &ReturnLength);
+    if (Status != STATUS_INFO_LENGTH_MISMATCH || ReturnLength <= sizeof(Header))
+    {
+        skip("Working set aging information not available (Status 0x%lx)\n", Status);
+        return;
+    }
+
+    /* Leave some room for processes created in between */
+    ReturnLength += 16 * sizeof(SYSTEM_WS_AGING_PROCESS_INFORMATION);
+    AgingInfo = HeapAlloc(GetProcessHeap(), 0, ReturnLength);
+    if (!AgingInfo)
+    {
+        skip("Out of memory\n");
+        return;
+    }
+
+    Status = NtQuerySystemInformation(SystemWorkingSetAgingInformation, AgingInfo, ReturnLength, &ReturnLength);
+    ok_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        ok(AgingInfo->NumberOfProcesses != 0, "No processes\n");
+        ok_size_t(ReturnLength, FIELD_OFFSET(SYSTEM_WS_AGING_INFORMATION, Processes[AgingInfo->NumberOfProcesses]));
+
+        Pages = 0;
+        for (i = 0; i < SYSTEM_WS_AGE_BUCKETS; i++)
+            Pages += AgingInfo->AgeHistogram[i];
+        ok_long(Pages, AgingInfo->UserPages);
+
+        for (i = 0; i < AgingInfo->NumberOfProcesses; i++)
+        {
+            if (AgingInfo->Processes[i].UniqueProcessId != NtCurrentTeb()->ClientId.UniqueProcess)
+                continue;
+
+            FoundSelf = TRUE;
+            Pages = 0;
+            for (j = 0; j < SYSTEM_WS_AGE_BUCKETS; j++)
+                Pages += AgingInfo->Processes[i].AgeHistogram[j];
+            ok(Pages != 0, "No pages for the current process\n");
+        }
+        ok(FoundSelf, "Current process not found\n");
+    }
+
+    HeapFree(GetProcessHeap(), 0, AgingInfo);
+}
+
 START_TEST(NtQuerySystemInformation)
 {
     NTSTATUS Status;
+    BOOLEAN WasEnabled;
 
     Status = NtQuerySystemInformation(0, NULL, 0, NULL);
     ok_hex(Status, STATUS_INFO_LENGTH_MISMATCH);
     
     Status = NtQuerySystemInformation(0x80000000, NULL, 0, NULL);
     ok_hex(Status, STATUS_INVALID_INFO_CLASS);
+
+    /* Walking the pages of every process needs the profile privilege */
+    Status = RtlAdjustPrivilege(SE_PROF_SINGLE_PROCESS_PRIVILEGE, TRUE, FALSE, &WasEnabled);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("RtlAdjustPrivilege(SE_PROF_SINGLE_PROCESS_PRIVILEGE) failed (Status 0x%08lx)\n", Status);
+    }
+    else
+    {
+        Test_WorkingSetAging();
+        RtlAdjustPrivilege(SE_PROF_SINGLE_PROCESS_PRIVILEGE, WasEnabled, FALSE, &WasEnabled);
+    }
 }
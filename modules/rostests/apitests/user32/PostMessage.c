@@ -0,0 +1,279 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and benchmark for posting messages between threads
+ */
+
+#include "precomp.h"
+
+#define MAX_PAIRS       4
+#define BENCH_MESSAGES  20000
+#define WM_BENCH        (WM_APP + 1)
+#define WM_BENCH_DONE   (WM_APP + 2)
+#define BACKLOG_SIZE    5000
+#define FILTER_LOOPS    10000
+
+typedef struct _PAIR_DATA
+{
+    HANDLE hReceiver;
+    HANDLE hPoster;
+    DWORD dwReceiverId;
+    HANDLE hReady;
+    HANDLE hStart;
+    BOOL bUseWindow;
+    HWND hwnd;
+    UINT cReceived;
+    UINT cOutOfOrder;
+} PAIR_DATA, *PPAIR_DATA;
+
+static
+LRESULT
+CALLBACK
+BenchWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    return DefWindowProcW(hwnd, uMsg, wParam, lParam);
+}
+
+static
+DWORD
+WINAPI
+ReceiverThread(LPVOID lpParameter)
+{
+    PPAIR_DATA Pair = lpParameter;
+    MSG msg;
+    UINT uExpected = 0;
+
+    /* Create the queue (and the window) before the poster starts */
+    PeekMessageW(&msg, NULL, 0, 0, PM_NOREMOVE);
+    if (Pair->bUseWindow)
+    {
+        Pair->hwnd = CreateWindowW(L"PostMessageBench", NULL, 0, 0, 0, 0, 0,
+                                   HWND_MESSAGE, NULL, GetModuleHandleW(NULL), NULL);
+    }
+    SetEvent(Pair->hReady);
+
+    while (GetMessageW(&msg, NULL, 0, 0) > 0)
+    {
+        if (msg.message == WM_BENCH_DONE)
+            break;
+
+        if (msg.message == WM_BENCH)
+        {
+            /* Messages from one poster come out in the order they went in */
+            if (msg.wParam != uExpected)
+                Pair->cOutOfOrder++;
+            uExpected = (UINT)msg.wParam + 1;
+            Pair->cReceived++;
+        }
+        DispatchMessageW(&msg);
+    }
+
+    if (Pair->hwnd)
+        DestroyWindow(Pair->hwnd);
+    return 0;
+}
+
+static
+DWORD
+WINAPI
+PosterThread(LPVOID lpParameter)
+{
+    PPAIR_DATA Pair = lpParameter;
+    UINT i;
+
+    WaitForSingleObject(Pair->hStart, INFINITE);
+
+    for (i = 0; i < BENCH_MESSAGES; i++)
+    {
+        /* Back off while the receiver's queue is full */
+        while (!(Pair->bUseWindow ?
+                 PostMessageW(Pair->hwnd, WM_BENCH, i, 0) :
+                 PostThreadMessageW(Pair->dwReceiverId, WM_BENCH, i, 0)))
+        {
+            Sleep(0);
+        }
+    }
+
+    if (Pair->bUseWindow)
+        PostMessageW(Pair->hwnd, WM_BENCH_DONE, 0, 0);
+    else
+        PostThreadMessageW(Pair->dwReceiverId, WM_BENCH_DONE, 0, 0);
+    return 0;
+}
+
+static
+void
+RunBenchmark(UINT cPairs, BOOL bUseWindow)
+{
+    PAIR_DATA Pairs[MAX_PAIRS];
+    HANDLE hThreads[MAX_PAIRS * 2];
+    HANDLE hStart;
+    LARGE_INTEGER Frequency, Start, End;
+    UINT i;
+
+    QueryPerformanceFrequency(&Frequency);
+
+    hStart = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ZeroMemory(Pairs, sizeof(Pairs));
+
+    for (i = 0; i < cPairs; i++)
+    {
+        Pairs[i].hStart = hStart;
+        Pairs[i].bUseWindow = bUseWindow;
+        Pairs[i].hReady = CreateEventW(NULL, FALSE, FALSE, NULL);
+        Pairs[i].hReceiver = CreateThread(NULL, 0, ReceiverThread, &Pairs[i], 0, &Pairs[i].dwReceiverId);
+        WaitForSingleObject(Pairs[i].hReady, INFINITE);
+        CloseHandle(Pairs[i].hReady);
+        ok(!bUseWindow || Pairs[i].hwnd != NULL, "Failed to create the window\n");
+
+        Pairs[i].hPoster = CreateThread(NULL, 0, PosterThread, &Pairs[i], 0, NULL);
+        hThreads[2 * i] = Pairs[i].hReceiver;
+        hThreads[2 * i + 1] = Pairs[i].hPoster;
+    }
+
+    QueryPerformanceCounter(&Start);
+    SetEvent(hStart);
+    WaitForMultipleObjects(2 * cPairs, hThreads, TRUE, 60000);
+    QueryPerformanceCounter(&End);
+
+    for (i = 0; i < cPairs; i++)
+    {
+        ok(Pairs[i].cReceived == BENCH_MESSAGES, "Pair %u received %u messages\n", i, Pairs[i].cReceived);
+        ok(Pairs[i].cOutOfOrder == 0, "Pair %u got %u messages out of order\n", i, Pairs[i].cOutOfOrder);
+        CloseHandle(Pairs[i].hReceiver);
+        CloseHandle(Pairs[i].hPoster);
+    }
+    CloseHandle(hStart);
+
+    trace("%s, %u thread pairs: %I64d messages per second\n",
+          bUseWindow ? "PostMessage" : "PostThreadMessage", cPairs,
+          cPairs * BENCH_MESSAGES * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+}
+
+static
+void
+Test_PostToSelf(void)
+{
+    MSG msg;
+    UINT i;
+
+    /* Drain the queue */
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE));
+
+    for (i = 0; i < 10; i++)
+        ok(PostThreadMessageW(GetCurrentThreadId(), WM_BENCH, i, i * 2), "PostThreadMessage failed\n");
+
+    /* Filtered peek without removing */
+    ok(PeekMessageW(&msg, NULL, WM_BENCH, WM_BENCH, PM_NOREMOVE), "No message\n");
+    ok(msg.wParam == 0, "Got wParam %lu\n", (ULONG)msg.wParam);
+
+    /* A filter that matches nothing */
+    ok(!PeekMessageW(&msg, NULL, WM_BENCH_DONE, WM_BENCH_DONE, PM_REMOVE), "Got message 0x%x\n", msg.message);
+
+    for (i = 0; i < 10; i++)
+    {
+        ok(PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE), "No message %u\n", i);
+        ok(msg.message == WM_BENCH, "Got message 0x%x\n", msg.message);
+        ok(msg.wParam == i, "Got wParam %lu, expected %u\n", (ULONG)msg.wParam, i);
+        ok(msg.lParam == i * 2, "Got lParam %ld, expected %u\n", (LONG)msg.lParam, i * 2);
+    }
+
+    ok(!PeekMessageW(&msg, NULL, WM_BENCH, WM_BENCH, PM_REMOVE), "Queue not empty\n");
+}
+
+static
+void
+Test_FilteredPeek(void)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    HWND hwnd;
+    MSG msg;
+    UINT i, Errors = 0;
+
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE));
+
+    hwnd = CreateWindowW(L"PostMessageBench", NULL, 0, 0, 0, 0, 0,
+                         HWND_MESSAGE, NULL, GetModuleHandleW(NULL), NULL);
+    ok(hwnd != NULL, "Failed to create the window\n");
+    if (!hwnd)
+        return;
+
+    /* Mix thread and window messages of different ranges */
+    for (i = 0; i < 30; i++)
+    {
+        switch (i % 3)
+        {
+            case 0: PostThreadMessageW(GetCurrentThreadId(), WM_BENCH, i, 0); break;
+            case 1: PostMessageW(hwnd, WM_TIMER, i, 0); break;
+            case 2: PostMessageW(hwnd, WM_BENCH, i, 0); break;
+        }
+    }
+
+    /* Each filter returns its messages in posting order */
+    for (i = 1; i < 30; i += 3)
+    {
+        ok(PeekMessageW(&msg, NULL, WM_TIMER, WM_TIMER, PM_REMOVE), "No message %u\n", i);
+        ok(msg.hwnd == hwnd && msg.wParam == i, "Got hwnd %p wParam %lu, expected %u\n", msg.hwnd, (ULONG)msg.wParam, i);
+    }
+    for (i = 2; i < 30; i += 3)
+    {
+        ok(PeekMessageW(&msg, hwnd, 0, 0, PM_REMOVE), "No message %u\n", i);
+        ok(msg.message == WM_BENCH && msg.wParam == i, "Got message 0x%x wParam %lu, expected %u\n", msg.message, (ULONG)msg.wParam, i);
+    }
+    ok(!PeekMessageW(&msg, hwnd, 0, 0, PM_REMOVE), "Got message 0x%x\n", msg.message);
+    for (i = 0; i < 30; i += 3)
+    {
+        ok(PeekMessageW(&msg, (HWND)-1, 0, 0, PM_REMOVE), "No message %u\n", i);
+        ok(msg.hwnd == NULL && msg.wParam == i, "Got hwnd %p wParam %lu, expected %u\n", msg.hwnd, (ULONG)msg.wParam, i);
+    }
+
+    /* Filtered retrieval must not depend on how many other messages are queued */
+    for (i = 0; i < BACKLOG_SIZE; i++)
+        PostThreadMessageW(GetCurrentThreadId(), WM_BENCH, i, 0);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < FILTER_LOOPS; i++)
+    {
+        PostMessageW(hwnd, WM_TIMER, i, 0);
+        if (!PeekMessageW(&msg, hwnd, WM_TIMER, WM_TIMER, PM_REMOVE | PM_NOYIELD) || msg.wParam != i)
+            Errors++;
+    }
+    QueryPerformanceCounter(&End);
+    ok(Errors == 0, "Filtered peek failed %u times\n", Errors);
+    trace("Filtered PeekMessage, %u other messages queued: %I64d messages per second\n", BACKLOG_SIZE,
+          FILTER_LOOPS * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    for (i = 0; i < BACKLOG_SIZE; i++)
+    {
+        if (!PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE) || msg.wParam != i)
+            Errors++;
+    }
+    ok(Errors == 0, "Backlog was wrong %u times\n", Errors);
+
+    DestroyWindow(hwnd);
+}
+
+START_TEST(PostMessage)
+{
+    WNDCLASSW wc;
+    UINT cPairs;
+
+    Test_PostToSelf();
+
+    ZeroMemory(&wc, sizeof(wc));
+    wc.lpfnWndProc = BenchWndProc;
+    wc.hInstance = GetModuleHandleW(NULL);
+    wc.lpszClassName = L"PostMessageBench";
+    ok(RegisterClassW(&wc) != 0, "RegisterClass failed\n");
+
+    Test_FilteredPeek();
+
+    for (cPairs = 1; cPairs <= MAX_PAIRS; cPairs *= 2)
+    {
+        RunBenchmark(cPairs, FALSE);
+        RunBenchmark(cPairs, TRUE);
+    }
+
+    UnregisterClassW(L"PostMessageBench", GetModuleHandleW(NULL));
+}
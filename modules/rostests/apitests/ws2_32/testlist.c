@@ -15,6 +15,9 @@ extern void func_nostartup(void);
 extern void func_open_osfhandle(void);
 extern void func_recv(void);
 extern void func_send(void);
+extern void func_throughput(void);
+extern void func_udpdemux(void);
+extern void func_udprate(void);
 extern void func_WSAAsync(void);
 extern void func_WSAIoctl(void);
 extern void func_WSARecv(void);
@@ -34,6 +37,9 @@ const struct test winetest_testlist[] =
     { "open_osfhandle", func_open_osfhandle },
     { "recv", func_recv },
     { "send", func_send },
+    { "throughput", func_throughput },
+    { "udpdemux", func_udpdemux },
+    { "udprate", func_udprate },
     { "WSAAsync", func_WSAAsync },
     { "WSAIoctl", func_WSAIoctl },
     { "WSARecv", func_WSARecv },
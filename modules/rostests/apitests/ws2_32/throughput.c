@@ -0,0 +1,397 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test and benchmark for TCP bulk transfers and message round trips
+ */
+
+#include "ws2_32.h"
+#include <intrin.h>
+
+#define TRANSFER_SIZE   (32 * 1024 * 1024)
+#define CHUNK_SIZE      (256 * 1024)
+#define SMALL_CHUNK     (16 * 1024)
+#define MAX_MESSAGE     (64 * 1024)
+#define ROUND_TRIPS     10000
+#define ECHO_BYTES      (64 * 1024 * 1024)
+
+typedef struct _RECEIVER_DATA
+{
+    SOCKET Socket;
+    ULONGLONG Received;
+    UINT Corrupted;
+} RECEIVER_DATA, *PRECEIVER_DATA;
+
+static
+DWORD
+WINAPI
+ReceiverThread(LPVOID lpParameter)
+{
+    PRECEIVER_DATA Data = lpParameter;
+    PUCHAR Buffer;
+    int Ret, i;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, CHUNK_SIZE);
+    if (!Buffer)
+        return 1;
+
+    for (;;)
+    {
+        Ret = recv(Data->Socket, (char *)Buffer, CHUNK_SIZE, 0);
+        if (Ret <= 0)
+            break;
+
+        /* Every byte carries the low bits of its stream offset */
+        for (i = 0; i < Ret; i++)
+        {
+            if (Buffer[i] != (UCHAR)(Data->Received + i))
+            {
+                Data->Corrupted++;
+                break;
+            }
+        }
+        Data->Received += Ret;
+    }
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    return 0;
+}
+
+static
+BOOL
+CreateConnectedPair(SOCKET *Client, SOCKET *Server, int BufferSize)
+{
+    SOCKET Listener;
+    struct sockaddr_in addr;
+    int addrlen = sizeof(addr);
+
+    *Client = *Server = INVALID_SOCKET;
+
+    Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(Listener != INVALID_SOCKET, "socket failed with %d\n", WSAGetLastError());
+    if (Listener == INVALID_SOCKET)
+        return FALSE;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(Listener, (struct sockaddr *)&addr, sizeof(addr)) ||
+        getsockname(Listener, (struct sockaddr *)&addr, &addrlen) ||
+        listen(Listener, 1))
+    {
+        ok(0, "Failed to set up the listener: %d\n", WSAGetLastError());
+        closesocket(Listener);
+        return FALSE;
+    }
+
+    *Client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(*Client != INVALID_SOCKET, "socket failed with %d\n", WSAGetLastError());
+
+    /* Set before connecting, it is applied once the connection is up */
+    if (BufferSize)
+        setsockopt(*Client, SOL_SOCKET, SO_SNDBUF, (char *)&BufferSize, sizeof(BufferSize));
+
+    if (*Client != INVALID_SOCKET &&
+        connect(*Client, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        *Server = accept(Listener, NULL, NULL);
+        ok(*Server != INVALID_SOCKET, "accept failed with %d\n", WSAGetLastError());
+    }
+    else
+    {
+        ok(0, "connect failed with %d\n", WSAGetLastError());
+    }
+    closesocket(Listener);
+
+    if (*Server == INVALID_SOCKET)
+    {
+        if (*Client != INVALID_SOCKET)
+            closesocket(*Client);
+        return FALSE;
+    }
+
+    if (BufferSize)
+    {
+        /* Applies to the connection itself */
+        ok(setsockopt(*Server, SOL_SOCKET, SO_RCVBUF, (char *)&BufferSize, sizeof(BufferSize)) == 0,
+           "setsockopt(SO_RCVBUF) failed with %d\n", WSAGetLastError());
+    }
+
+    return TRUE;
+}
+
+static
+ULONGLONG
+GetBusyTime(void)
+{
+    FILETIME Idle, Kernel, User;
+
+    /* Kernel time includes the idle time. The stack runs in system threads,
+       so the process times would miss most of it */
+    if (!GetSystemTimes(&Idle, &Kernel, &User))
+        return 0;
+
+    return (((ULONGLONG)Kernel.dwHighDateTime << 32) | Kernel.dwLowDateTime) +
+           (((ULONGLONG)User.dwHighDateTime << 32) | User.dwLowDateTime) -
+           (((ULONGLONG)Idle.dwHighDateTime << 32) | Idle.dwLowDateTime);
+}
+
+static
+void
+RunTransfer(int BufferSize, int ChunkSize)
+{
+    SOCKET Client, Server;
+    RECEIVER_DATA Data;
+    HANDLE hThread;
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG BusyStart, BusyEnd, CyclesStart, CyclesEnd;
+    double CyclesPerSecond;
+    PUCHAR Buffer;
+    ULONGLONG Sent = 0;
+    int Ret, i;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, ChunkSize);
+    if (!Buffer)
+    {
+        skip("No memory\n");
+        return;
+    }
+
+    if (!CreateConnectedPair(&Client, &Server, BufferSize))
+    {
+        skip("No connection\n");
+        HeapFree(GetProcessHeap(), 0, Buffer);
+        return;
+    }
+
+    Data.Socket = Server;
+    Data.Received = 0;
+    Data.Corrupted = 0;
+    hThread = CreateThread(NULL, 0, ReceiverThread, &Data, 0, NULL);
+    ok(hThread != NULL, "CreateThread failed\n");
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    BusyStart = GetBusyTime();
+    CyclesStart = __rdtsc();
+    while (hThread && Sent < TRANSFER_SIZE)
+    {
+        /* Stream sends must not be truncated, whatever their size */
+        for (i = 0; i < ChunkSize; i++)
+            Buffer[i] = (UCHAR)(Sent + i);
+
+        Ret = send(Client, (char *)Buffer, ChunkSize, 0);
+        if (Ret <= 0)
+        {
+            ok(0, "send failed with %d\n", WSAGetLastError());
+            break;
+        }
+        ok(Ret == ChunkSize, "send returned %d\n", Ret);
+        Sent += Ret;
+    }
+    shutdown(Client, SD_SEND);
+
+    if (hThread)
+    {
+        ok(WaitForSingleObject(hThread, 60000) == WAIT_OBJECT_0, "Receiver did not finish\n");
+        CyclesEnd = __rdtsc();
+        BusyEnd = GetBusyTime();
+        QueryPerformanceCounter(&End);
+        CloseHandle(hThread);
+
+        ok(Data.Received == Sent, "Received %I64u of %I64u bytes\n", Data.Received, Sent);
+        ok(Data.Corrupted == 0, "%u chunks were corrupted\n", Data.Corrupted);
+
+        /* Busy time (100 ns units, all CPUs) converted with the measured TSC rate.
+           It covers both ends of the connection and the pattern fill */
+        CyclesPerSecond = (double)(CyclesEnd - CyclesStart) * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1);
+        trace("Buffer size %d, %d byte sends: %I64d KB per second, %.2f CPU cycles per byte\n",
+              BufferSize, ChunkSize,
+              (LONGLONG)(Data.Received / 1024) * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1),
+              (double)(BusyEnd - BusyStart) / 10000000 * CyclesPerSecond / max(Data.Received, 1));
+    }
+
+    closesocket(Client);
+    closesocket(Server);
+    HeapFree(GetProcessHeap(), 0, Buffer);
+}
+
+static
+DWORD
+WINAPI
+EchoThread(LPVOID lpParameter)
+{
+    SOCKET Socket = (SOCKET)lpParameter;
+    char *Buffer;
+    int Ret;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, MAX_MESSAGE);
+    if (!Buffer)
+        return 1;
+
+    while ((Ret = recv(Socket, Buffer, MAX_MESSAGE, 0)) > 0)
+    {
+        if (send(Socket, Buffer, Ret, 0) != Ret)
+            break;
+    }
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    return 0;
+}
+
+static
+void
+RunRequestResponse(int MessageSize)
+{
+    SOCKET Client, Server;
+    HANDLE hThread;
+    LARGE_INTEGER Frequency, Start, End;
+    char *Request, *Response;
+    BOOL NoDelay = TRUE;
+    UINT RoundTrips, i, Errors = 0;
+    int Received, Ret;
+
+    Request = HeapAlloc(GetProcessHeap(), 0, MessageSize);
+    Response = HeapAlloc(GetProcessHeap(), 0, MessageSize);
+    if (!Request || !Response || !CreateConnectedPair(&Client, &Server, 0))
+    {
+        skip("No connection\n");
+        if (Request) HeapFree(GetProcessHeap(), 0, Request);
+        if (Response) HeapFree(GetProcessHeap(), 0, Response);
+        return;
+    }
+
+    /* Large messages move much more data per round trip */
+    RoundTrips = min(ROUND_TRIPS, ECHO_BYTES / MessageSize);
+
+    setsockopt(Client, IPPROTO_TCP, TCP_NODELAY, (char *)&NoDelay, sizeof(NoDelay));
+    setsockopt(Server, IPPROTO_TCP, TCP_NODELAY, (char *)&NoDelay, sizeof(NoDelay));
+
+    hThread = CreateThread(NULL, 0, EchoThread, (LPVOID)Server, 0, NULL);
+    ok(hThread != NULL, "CreateThread failed\n");
+    if (!hThread)
+    {
+        closesocket(Client);
+        closesocket(Server);
+        HeapFree(GetProcessHeap(), 0, Request);
+        HeapFree(GetProcessHeap(), 0, Response);
+        return;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < RoundTrips; i++)
+    {
+        memset(Request, (UCHAR)i, MessageSize);
+        if (send(Client, Request, MessageSize, 0) != MessageSize)
+        {
+            ok(0, "send failed with %d\n", WSAGetLastError());
+            break;
+        }
+
+        for (Received = 0; Received < MessageSize; Received += Ret)
+        {
+            Ret = recv(Client, Response + Received, MessageSize - Received, 0);
+            if (Ret <= 0)
+                break;
+        }
+        if (Received != MessageSize)
+        {
+            ok(0, "recv failed with %d\n", WSAGetLastError());
+            break;
+        }
+        if (memcmp(Request, Response, MessageSize))
+            Errors++;
+    }
+    QueryPerformanceCounter(&End);
+
+    ok(i == RoundTrips, "Only %u of %u round trips\n", i, RoundTrips);
+    ok(Errors == 0, "%u responses were wrong\n", Errors);
+    trace("%6d byte request/response: %I64d round trips per second, %I64d us each, %I64d KB per second\n",
+          MessageSize,
+          i * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1),
+          (End.QuadPart - Start.QuadPart) * 1000000 / (max(i, 1) * Frequency.QuadPart),
+          (LONGLONG)i * MessageSize / 1024 * Frequency.QuadPart / max(End.QuadPart - Start.QuadPart, 1));
+
+    closesocket(Client);
+    ok(WaitForSingleObject(hThread, 10000) == WAIT_OBJECT_0, "Echo thread did not finish\n");
+    CloseHandle(hThread);
+    closesocket(Server);
+    HeapFree(GetProcessHeap(), 0, Request);
+    HeapFree(GetProcessHeap(), 0, Response);
+}
+
+static
+void
+Test_BufferOptions(void)
+{
+    SOCKET Client, Server;
+    int Value, Size = 1024 * 1024;
+    int Len;
+
+    if (!CreateConnectedPair(&Client, &Server, 0))
+    {
+        skip("No connection\n");
+        return;
+    }
+
+    /* Connected stream sockets accept sizes beyond 64 KB */
+    ok(setsockopt(Client, SOL_SOCKET, SO_SNDBUF, (char *)&Size, sizeof(Size)) == 0,
+       "setsockopt(SO_SNDBUF) failed with %d\n", WSAGetLastError());
+    ok(setsockopt(Server, SOL_SOCKET, SO_RCVBUF, (char *)&Size, sizeof(Size)) == 0,
+       "setsockopt(SO_RCVBUF) failed with %d\n", WSAGetLastError());
+
+    Value = 0;
+    Len = sizeof(Value);
+    ok(getsockopt(Server, SOL_SOCKET, SO_RCVBUF, (char *)&Value, &Len) == 0,
+       "getsockopt(SO_RCVBUF) failed with %d\n", WSAGetLastError());
+    ok(Value == Size, "SO_RCVBUF is %d, expected %d\n", Value, Size);
+
+    Value = 0;
+    Len = sizeof(Value);
+    ok(getsockopt(Client, SOL_SOCKET, SO_SNDBUF, (char *)&Value, &Len) == 0,
+       "getsockopt(SO_SNDBUF) failed with %d\n", WSAGetLastError());
+    ok(Value == Size, "SO_SNDBUF is %d, expected %d\n", Value, Size);
+
+    closesocket(Client);
+    closesocket(Server);
+
+    /* An unconnected stream socket keeps the sizes for its connection */
+    Client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    ok(Client != INVALID_SOCKET, "socket failed with %d\n", WSAGetLastError());
+    if (Client == INVALID_SOCKET)
+        return;
+
+    ok(setsockopt(Client, SOL_SOCKET, SO_RCVBUF, (char *)&Size, sizeof(Size)) == 0,
+       "setsockopt(SO_RCVBUF) failed with %d\n", WSAGetLastError());
+
+    Value = 0;
+    Len = sizeof(Value);
+    ok(getsockopt(Client, SOL_SOCKET, SO_RCVBUF, (char *)&Value, &Len) == 0,
+       "getsockopt(SO_RCVBUF) failed with %d\n", WSAGetLastError());
+    ok(Value == Size, "SO_RCVBUF is %d, expected %d\n", Value, Size);
+
+    closesocket(Client);
+}
+
+START_TEST(throughput)
+{
+    WSADATA wsaData;
+
+    ok(WSAStartup(MAKEWORD(2, 2), &wsaData) == 0, "WSAStartup failed\n");
+
+    Test_BufferOptions();
+
+    /* Large sends are transmitted from the caller's pages, small ones are copied */
+    RunTransfer(0, CHUNK_SIZE);
+    RunTransfer(64 * 1024, CHUNK_SIZE);
+    RunTransfer(1024 * 1024, CHUNK_SIZE);
+    RunTransfer(1024 * 1024, SMALL_CHUNK);
+
+    /* Loopback segments are as large as the IP packet allows */
+    RunRequestResponse(64);
+    RunRequestResponse(1024);
+    RunRequestResponse(16 * 1024);
+    RunRequestResponse(MAX_MESSAGE);
+
+    WSACleanup();
+}
@@ -0,0 +1,138 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Benchmark for UDP receive demultiplexing with many bound sockets
+ */
+
+#include "ws2_32.h"
+
+#define BOUND_SOCKETS   30000
+#define DATAGRAM_SIZE   64
+#define DATAGRAM_COUNT  10000
+
+/* Sends datagrams to Receiver one at a time and returns the microseconds
+   each took to arrive, which includes finding the socket for its port */
+static
+LONGLONG
+MeasureDelivery(SOCKET Sender, SOCKET Receiver, struct sockaddr_in *Addr)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    char Buffer[DATAGRAM_SIZE];
+    UINT i;
+
+    memset(Buffer, 0x55, sizeof(Buffer));
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < DATAGRAM_COUNT; i++)
+    {
+        if (sendto(Sender, Buffer, sizeof(Buffer), 0,
+                   (struct sockaddr *)Addr, sizeof(*Addr)) != sizeof(Buffer) ||
+            recv(Receiver, Buffer, sizeof(Buffer), 0) != sizeof(Buffer))
+        {
+            break;
+        }
+    }
+    QueryPerformanceCounter(&End);
+
+    ok(i == DATAGRAM_COUNT, "Only %u of %u datagrams delivered: %d\n",
+       i, DATAGRAM_COUNT, WSAGetLastError());
+
+    return (End.QuadPart - Start.QuadPart) * 1000000 / (max(i, 1) * Frequency.QuadPart);
+}
+
+static
+UINT
+BindSockets(SOCKET *Sockets, UINT Count, LONGLONG *Ticks)
+{
+    struct sockaddr_in addr;
+    LARGE_INTEGER Start, End;
+    UINT i;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    /* Port 0 takes an ephemeral port */
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < Count; i++)
+    {
+        Sockets[i] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (Sockets[i] == INVALID_SOCKET)
+            break;
+
+        if (bind(Sockets[i], (struct sockaddr *)&addr, sizeof(addr)))
+        {
+            closesocket(Sockets[i]);
+            break;
+        }
+    }
+    QueryPerformanceCounter(&End);
+
+    *Ticks = End.QuadPart - Start.QuadPart;
+    return i;
+}
+
+START_TEST(udpdemux)
+{
+    WSADATA wsaData;
+    SOCKET Sender, Receiver, *Sockets;
+    struct sockaddr_in addr;
+    LARGE_INTEGER Frequency;
+    LONGLONG Before, After, Ticks;
+    DWORD Timeout = 5000;
+    int addrlen = sizeof(addr);
+    UINT Bound, i;
+
+    ok(WSAStartup(MAKEWORD(2, 2), &wsaData) == 0, "WSAStartup failed\n");
+
+    Sockets = HeapAlloc(GetProcessHeap(), 0, BOUND_SOCKETS * sizeof(*Sockets));
+    Receiver = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    Sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Receiver != INVALID_SOCKET && Sender != INVALID_SOCKET,
+       "socket failed with %d\n", WSAGetLastError());
+    if (!Sockets || Receiver == INVALID_SOCKET || Sender == INVALID_SOCKET)
+    {
+        skip("No sockets\n");
+        goto cleanup;
+    }
+
+    setsockopt(Receiver, SOL_SOCKET, SO_RCVTIMEO, (char *)&Timeout, sizeof(Timeout));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(Receiver, (struct sockaddr *)&addr, sizeof(addr)) ||
+        getsockname(Receiver, (struct sockaddr *)&addr, &addrlen))
+    {
+        ok(0, "Failed to set up the receiver: %d\n", WSAGetLastError());
+        goto cleanup;
+    }
+
+    Before = MeasureDelivery(Sender, Receiver, &addr);
+
+    Bound = BindSockets(Sockets, BOUND_SOCKETS, &Ticks);
+    ok(Bound == BOUND_SOCKETS, "Only %u of %u sockets bound: %d\n",
+       Bound, BOUND_SOCKETS, WSAGetLastError());
+
+    QueryPerformanceFrequency(&Frequency);
+    trace("%u sockets bound to ephemeral ports, %I64d binds per second\n",
+          Bound, (LONGLONG)Bound * Frequency.QuadPart / max(Ticks, 1));
+
+    After = MeasureDelivery(Sender, Receiver, &addr);
+    trace("%d byte datagrams: %I64d us each, %I64d us with %u more sockets bound\n",
+          DATAGRAM_SIZE, Before, After, Bound);
+
+    for (i = 0; i < Bound; i++)
+        closesocket(Sockets[i]);
+
+cleanup:
+    if (Receiver != INVALID_SOCKET)
+        closesocket(Receiver);
+    if (Sender != INVALID_SOCKET)
+        closesocket(Sender);
+    if (Sockets)
+        HeapFree(GetProcessHeap(), 0, Sockets);
+
+    WSACleanup();
+}
@@ -0,0 +1,221 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Benchmark for the rate of received UDP datagrams
+ */
+
+#include "ws2_32.h"
+#include <iphlpapi.h>
+
+#define DATAGRAM_SIZE   64
+#define DATAGRAM_COUNT  100000
+#define IDLE_TIMEOUT    2000
+#define EXTERNAL_WAIT   60000
+
+typedef struct _SENDER_DATA
+{
+    SOCKET Socket;
+    struct sockaddr_in Addr;
+    UINT Sent;
+} SENDER_DATA, *PSENDER_DATA;
+
+static
+ULONG
+GetInDiscards(void)
+{
+    PMIB_IFTABLE Table;
+    ULONG Size = 0, Discards = 0, i;
+
+    /* Includes the packets the LAN receive rings had no room for */
+    if (GetIfTable(NULL, &Size, FALSE) != ERROR_INSUFFICIENT_BUFFER)
+        return 0;
+
+    Table = HeapAlloc(GetProcessHeap(), 0, Size);
+    if (!Table)
+        return 0;
+
+    if (GetIfTable(Table, &Size, FALSE) == NO_ERROR)
+    {
+        for (i = 0; i < Table->dwNumEntries; i++)
+            Discards += Table->table[i].dwInDiscards;
+    }
+
+    HeapFree(GetProcessHeap(), 0, Table);
+    return Discards;
+}
+
+static
+DWORD
+WINAPI
+SenderThread(LPVOID lpParameter)
+{
+    PSENDER_DATA Data = lpParameter;
+    char Buffer[DATAGRAM_SIZE];
+    UINT i;
+
+    for (i = 0; i < DATAGRAM_COUNT; i++)
+    {
+        memset(Buffer, (UCHAR)i, sizeof(Buffer));
+        if (sendto(Data->Socket, Buffer, sizeof(Buffer), 0,
+                   (struct sockaddr *)&Data->Addr, sizeof(Data->Addr)) == sizeof(Buffer))
+        {
+            Data->Sent++;
+        }
+    }
+
+    return 0;
+}
+
+/* Counts datagrams until none arrived for IDLE_TIMEOUT */
+static
+UINT
+ReceiveDatagrams(SOCKET Socket, DWORD FirstTimeout, LONGLONG *Ticks)
+{
+    char Buffer[2048];
+    LARGE_INTEGER Start, Last;
+    DWORD Timeout = FirstTimeout;
+    UINT Received = 0;
+
+    *Ticks = 0;
+    setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&Timeout, sizeof(Timeout));
+
+    while (recv(Socket, Buffer, sizeof(Buffer), 0) > 0)
+    {
+        QueryPerformanceCounter(&Last);
+        if (Received++ == 0)
+        {
+            Start = Last;
+            Timeout = IDLE_TIMEOUT;
+            setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&Timeout, sizeof(Timeout));
+        }
+    }
+
+    if (Received > 1)
+        *Ticks = Last.QuadPart - Start.QuadPart;
+
+    return Received;
+}
+
+static
+void
+RunLoopback(void)
+{
+    SOCKET Receiver;
+    SENDER_DATA Data;
+    HANDLE hThread;
+    LARGE_INTEGER Frequency;
+    LONGLONG Ticks;
+    ULONG Discards;
+    int BufferSize = 1024 * 1024;
+    int addrlen = sizeof(Data.Addr);
+    UINT Received;
+
+    Receiver = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    Data.Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Receiver != INVALID_SOCKET && Data.Socket != INVALID_SOCKET,
+       "socket failed with %d\n", WSAGetLastError());
+    if (Receiver == INVALID_SOCKET || Data.Socket == INVALID_SOCKET)
+        goto cleanup;
+
+    setsockopt(Receiver, SOL_SOCKET, SO_RCVBUF, (char *)&BufferSize, sizeof(BufferSize));
+
+    memset(&Data.Addr, 0, sizeof(Data.Addr));
+    Data.Addr.sin_family = AF_INET;
+    Data.Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(Receiver, (struct sockaddr *)&Data.Addr, sizeof(Data.Addr)) ||
+        getsockname(Receiver, (struct sockaddr *)&Data.Addr, &addrlen))
+    {
+        ok(0, "Failed to set up the receiver: %d\n", WSAGetLastError());
+        goto cleanup;
+    }
+
+    Data.Sent = 0;
+    Discards = GetInDiscards();
+    hThread = CreateThread(NULL, 0, SenderThread, &Data, 0, NULL);
+    ok(hThread != NULL, "CreateThread failed\n");
+    if (!hThread)
+        goto cleanup;
+
+    Received = ReceiveDatagrams(Receiver, IDLE_TIMEOUT, &Ticks);
+    ok(WaitForSingleObject(hThread, 60000) == WAIT_OBJECT_0, "Sender did not finish\n");
+    CloseHandle(hThread);
+
+    /* UDP may drop when the receiver falls behind, but not everything */
+    ok(Received > 0, "No datagrams received, %u sent\n", Data.Sent);
+
+    /* 127.0.0.1 goes through the loopback interface, so this is only a
+       baseline for the stack above the LAN receive ring */
+    QueryPerformanceFrequency(&Frequency);
+    trace("Loopback (does not use the LAN receive ring), %d byte datagrams: %u of %u received, %I64d per second, %lu discarded\n",
+          DATAGRAM_SIZE, Received, Data.Sent,
+          Received * Frequency.QuadPart / max(Ticks, 1),
+          GetInDiscards() - Discards);
+
+cleanup:
+    if (Receiver != INVALID_SOCKET)
+        closesocket(Receiver);
+    if (Data.Socket != INVALID_SOCKET)
+        closesocket(Data.Socket);
+}
+
+static
+void
+RunExternal(USHORT Port)
+{
+    SOCKET Receiver;
+    struct sockaddr_in addr;
+    LARGE_INTEGER Frequency;
+    LONGLONG Ticks;
+    ULONG Discards;
+    int BufferSize = 1024 * 1024;
+    UINT Received;
+
+    Receiver = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(Receiver != INVALID_SOCKET, "socket failed with %d\n", WSAGetLastError());
+    if (Receiver == INVALID_SOCKET)
+        return;
+
+    setsockopt(Receiver, SOL_SOCKET, SO_RCVBUF, (char *)&BufferSize, sizeof(BufferSize));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(Port);
+    if (bind(Receiver, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        ok(0, "bind failed with %d\n", WSAGetLastError());
+        closesocket(Receiver);
+        return;
+    }
+
+    trace("Waiting for datagrams on UDP port %u\n", Port);
+    Discards = GetInDiscards();
+    Received = ReceiveDatagrams(Receiver, EXTERNAL_WAIT, &Ticks);
+
+    QueryPerformanceFrequency(&Frequency);
+    trace("Port %u: %u datagrams received, %I64d per second, %lu discarded\n",
+          Port, Received,
+          Received * Frequency.QuadPart / max(Ticks, 1),
+          GetInDiscards() - Discards);
+
+    closesocket(Receiver);
+}
+
+START_TEST(udprate)
+{
+    WSADATA wsaData;
+    char Port[16];
+
+    ok(WSAStartup(MAKEWORD(2, 2), &wsaData) == 0, "WSAStartup failed\n");
+
+    RunLoopback();
+
+    /* Datagrams sent from another machine come in through the LAN adapter,
+       e.g. from the host to a QEMU e1000 NIC with a forwarded UDP port */
+    if (GetEnvironmentVariableA("UDPRATE_PORT", Port, sizeof(Port)))
+        RunExternal((USHORT)atoi(Port));
+    else
+        skip("Set UDPRATE_PORT to measure datagrams through the LAN receive ring\n");
+
+    WSACleanup();
+}
@@ -1,5 +1,6 @@
 #include <windows.h>
 #include <string.h>
+#include <stdio.h>
 
 BOOL WINAPI GdiAlphaBlend(HDC hdcDst, int xDst, int yDst, int widthDst, int heightDst,
                           HDC hdcSrc, int xSrc, int ySrc, int widthSrc, int heightSrc,
@@ -117,6 +118,95 @@ BOOL ConvertBitmapTo32Bpp(HDC hDC, BITMAP *bmp)
   return FALSE;
 }
 
+/* throughput benchmark, run by pressing 'B' */
+#define BENCH_LOOPS 200
+
+typedef struct
+{
+  const char *Name;
+  WORD DstBpp;
+  int Scale; /* destination size in percent of the source */
+  BYTE ConstAlpha;
+  BYTE AlphaFormat;
+} BENCH_CASE;
+
+static const BENCH_CASE BenchCases[] =
+{
+  { "32bpp, constant alpha",       32, 100, 128, 0 },
+  { "32bpp, per-pixel alpha",      32, 100, 255, AC_SRC_ALPHA },
+  { "32bpp, both alphas",          32, 100, 128, AC_SRC_ALPHA },
+  { "32bpp, per-pixel, stretched", 32, 150, 255, AC_SRC_ALPHA },
+  { "24bpp, per-pixel alpha",      24, 100, 255, AC_SRC_ALPHA },
+  { "16bpp, per-pixel alpha",      16, 100, 255, AC_SRC_ALPHA },
+  { "16bpp, per-pixel, shrunk",    16,  66, 255, AC_SRC_ALPHA },
+};
+
+void RunBenchmark(HWND HWnd)
+{
+  char Report[1024];
+  int Length = 0;
+  UINT i, j;
+  LARGE_INTEGER Frequency, Start, End;
+
+  QueryPerformanceFrequency(&Frequency);
+
+  for(i = 0; i < sizeof(BenchCases) / sizeof(BenchCases[0]); i++)
+  {
+    const BENCH_CASE *Case = &BenchCases[i];
+    BITMAPINFO bmi;
+    BLENDFUNCTION BlendFunc;
+    HBITMAP hbmDst;
+    HDC hdcDst;
+    PVOID pvBits;
+    int Width = bmp.bmWidth * Case->Scale / 100;
+    int Height = bmp.bmHeight * Case->Scale / 100;
+    double Seconds, MPixels;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = Width;
+    bmi.bmiHeader.biHeight = Height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = Case->DstBpp;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdcDst = CreateCompatibleDC(NULL);
+    hbmDst = CreateDIBSection(hdcDst, &bmi, DIB_RGB_COLORS, &pvBits, 0, 0);
+    if(!hdcDst || !hbmDst)
+    {
+      if(hdcDst) DeleteDC(hdcDst);
+      return;
+    }
+    SelectObject(hdcDst, hbmDst);
+    PatBlt(hdcDst, 0, 0, Width, Height, WHITENESS);
+
+    BlendFunc.BlendOp = AC_SRC_OVER;
+    BlendFunc.BlendFlags = 0;
+    BlendFunc.SourceConstantAlpha = Case->ConstAlpha;
+    BlendFunc.AlphaFormat = Case->AlphaFormat;
+
+    QueryPerformanceCounter(&Start);
+    for(j = 0; j < BENCH_LOOPS; j++)
+    {
+      GdiAlphaBlend(hdcDst, 0, 0, Width, Height,
+                    HMemDC2, 0, 0, bmp.bmWidth, bmp.bmHeight,
+                    BlendFunc);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    MPixels = (double)Width * Height * BENCH_LOOPS / 1000000.0;
+    Length += sprintf(Report + Length, "%s: %.1f Mpixels/s\n",
+                      Case->Name, Seconds > 0 ? MPixels / Seconds : 0.0);
+
+    DeleteDC(hdcDst);
+    DeleteObject(hbmDst);
+  }
+
+  MessageBoxA(HWnd, Report, "AlphaBlend throughput", MB_OK);
+}
+
 LRESULT CALLBACK MainWndProc(HWND HWnd, UINT Msg, WPARAM WParam,
    LPARAM LParam)
 {
@@ -197,6 +287,12 @@ LRESULT CALLBACK MainWndProc(HWND HWnd, UINT Msg, WPARAM WParam,
          EndPaint(HWnd, &ps);
          break;
       }
+      case WM_KEYDOWN:
+      {
+         if (WParam == 'B' && H32BppBitmap)
+            RunBenchmark(HWnd);
+         break;
+      }
       case WM_DESTROY:
       {
          /* clean up */
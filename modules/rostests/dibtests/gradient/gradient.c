@@ -0,0 +1,206 @@
+/*
+ * Draws horizontal, vertical and triangle gradients.
+ * Pressing 'B' runs a GradientFill throughput benchmark
+ * on 32, 24 and 16bpp DIB sections.
+ */
+
+#include <windows.h>
+#include <string.h>
+#include <stdio.h>
+
+BOOL WINAPI GdiGradientFill(HDC hdc, TRIVERTEX *pVertex, ULONG nVertex,
+                            PVOID pMesh, ULONG nMesh, ULONG ulMode);
+
+HINSTANCE HInst;
+const char* WndClassName = "GMainWnd";
+LRESULT CALLBACK MainWndProc(HWND HWnd, UINT Msg, WPARAM WParam,
+   LPARAM LParam);
+
+int APIENTRY WinMain(HINSTANCE HInstance, HINSTANCE HPrevInstance,
+    LPTSTR lpCmdLine, int nCmdShow)
+{
+   WNDCLASS wc;
+   MSG msg;
+
+   HInst = HInstance;
+
+   memset(&wc, 0, sizeof(WNDCLASS));
+
+   wc.style = CS_VREDRAW | CS_HREDRAW | CS_DBLCLKS;
+   wc.lpfnWndProc = MainWndProc;
+   wc.hInstance = HInstance;
+   wc.hCursor = LoadCursor(NULL, (LPCTSTR)IDC_ARROW);
+   wc.hbrBackground = (HBRUSH)(COLOR_BTNFACE + 1);
+   wc.lpszClassName = WndClassName;
+
+   if (RegisterClass(&wc))
+   {
+      HWND HWnd =
+         CreateWindow(
+            WndClassName, TEXT("GradientFill Rendering Demo"),
+            WS_OVERLAPPED | WS_SYSMENU | WS_CAPTION |
+            WS_VISIBLE | WS_CLIPSIBLINGS,
+            0, 0, 440, 200,
+            NULL, NULL, HInst, NULL
+            );
+
+      if (HWnd)
+      {
+         ShowWindow(HWnd, nCmdShow);
+         UpdateWindow(HWnd);
+
+         while (GetMessage(&msg, NULL, 0, 0))
+         {
+             TranslateMessage(&msg);
+             DispatchMessage(&msg);
+         }
+      }
+    }
+    return 0;
+}
+
+static void SetVertex(TRIVERTEX *Vertex, LONG x, LONG y, COLORREF Color)
+{
+  Vertex->x = x;
+  Vertex->y = y;
+  Vertex->Red = GetRValue(Color) << 8;
+  Vertex->Green = GetGValue(Color) << 8;
+  Vertex->Blue = GetBValue(Color) << 8;
+  Vertex->Alpha = 0;
+}
+
+static BOOL DrawGradient(HDC hdc, ULONG Mode, int x, int y, int Width, int Height)
+{
+  TRIVERTEX Vertices[3];
+  GRADIENT_RECT Rect = { 0, 1 };
+  GRADIENT_TRIANGLE Triangle = { 0, 1, 2 };
+
+  if (Mode == GRADIENT_FILL_TRIANGLE)
+  {
+    SetVertex(&Vertices[0], x, y, RGB(255, 0, 0));
+    SetVertex(&Vertices[1], x + Width, y + Height / 3, RGB(0, 255, 0));
+    SetVertex(&Vertices[2], x + Width / 4, y + Height, RGB(0, 0, 255));
+    return GdiGradientFill(hdc, Vertices, 3, &Triangle, 1, Mode);
+  }
+
+  SetVertex(&Vertices[0], x, y, RGB(0, 32, 128));
+  SetVertex(&Vertices[1], x + Width, y + Height, RGB(160, 200, 255));
+  return GdiGradientFill(hdc, Vertices, 2, &Rect, 1, Mode);
+}
+
+/* throughput benchmark, run by pressing 'B' */
+#define BENCH_LOOPS 200
+#define BENCH_WIDTH 640
+#define BENCH_HEIGHT 480
+
+typedef struct
+{
+  const char *Name;
+  WORD DstBpp;
+  ULONG Mode;
+} BENCH_CASE;
+
+static const BENCH_CASE BenchCases[] =
+{
+  { "32bpp, horizontal", 32, GRADIENT_FILL_RECT_H },
+  { "32bpp, vertical",   32, GRADIENT_FILL_RECT_V },
+  { "32bpp, triangle",   32, GRADIENT_FILL_TRIANGLE },
+  { "24bpp, horizontal", 24, GRADIENT_FILL_RECT_H },
+  { "24bpp, vertical",   24, GRADIENT_FILL_RECT_V },
+  { "24bpp, triangle",   24, GRADIENT_FILL_TRIANGLE },
+  { "16bpp, horizontal", 16, GRADIENT_FILL_RECT_H },
+  { "16bpp, vertical",   16, GRADIENT_FILL_RECT_V },
+  { "16bpp, triangle",   16, GRADIENT_FILL_TRIANGLE },
+};
+
+void RunBenchmark(HWND HWnd)
+{
+  char Report[1024];
+  int Length = 0;
+  UINT i, j;
+  LARGE_INTEGER Frequency, Start, End;
+
+  QueryPerformanceFrequency(&Frequency);
+
+  for(i = 0; i < sizeof(BenchCases) / sizeof(BenchCases[0]); i++)
+  {
+    const BENCH_CASE *Case = &BenchCases[i];
+    BITMAPINFO bmi;
+    HBITMAP hbmDst;
+    HDC hdcDst;
+    PVOID pvBits;
+    double Seconds, MPixels;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = BENCH_WIDTH;
+    bmi.bmiHeader.biHeight = BENCH_HEIGHT;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = Case->DstBpp;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdcDst = CreateCompatibleDC(NULL);
+    hbmDst = CreateDIBSection(hdcDst, &bmi, DIB_RGB_COLORS, &pvBits, 0, 0);
+    if(!hdcDst || !hbmDst)
+    {
+      if(hdcDst) DeleteDC(hdcDst);
+      return;
+    }
+    SelectObject(hdcDst, hbmDst);
+
+    QueryPerformanceCounter(&Start);
+    for(j = 0; j < BENCH_LOOPS; j++)
+    {
+      DrawGradient(hdcDst, Case->Mode, 0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&End);
+
+    /* a triangle covers about half of its bounding box */
+    Seconds = (double)(End.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    MPixels = (double)BENCH_WIDTH * BENCH_HEIGHT * BENCH_LOOPS / 1000000.0;
+    if (Case->Mode == GRADIENT_FILL_TRIANGLE)
+      MPixels /= 2;
+    Length += sprintf(Report + Length, "%s: %.1f Mpixels/s\n",
+                      Case->Name, Seconds > 0 ? MPixels / Seconds : 0.0);
+
+    DeleteDC(hdcDst);
+    DeleteObject(hbmDst);
+  }
+
+  MessageBoxA(HWnd, Report, "GradientFill throughput", MB_OK);
+}
+
+LRESULT CALLBACK MainWndProc(HWND HWnd, UINT Msg, WPARAM WParam,
+   LPARAM LParam)
+{
+   switch (Msg)
+   {
+      case WM_PAINT:
+      {
+         PAINTSTRUCT ps;
+         HDC Hdc = BeginPaint(HWnd, &ps);
+
+         DrawGradient(Hdc, GRADIENT_FILL_RECT_H, 10, 10, 128, 128);
+         DrawGradient(Hdc, GRADIENT_FILL_RECT_V, 148, 10, 128, 128);
+         DrawGradient(Hdc, GRADIENT_FILL_TRIANGLE, 286, 10, 128, 128);
+
+         EndPaint(HWnd, &ps);
+         break;
+      }
+      case WM_KEYDOWN:
+      {
+         if (WParam == 'B')
+            RunBenchmark(HWnd);
+         break;
+      }
+      case WM_DESTROY:
+      {
+         PostQuitMessage(0);
+         break;
+      }
+      default:
+         return DefWindowProc(HWnd, Msg, WParam, LParam);
+   }
+   return 0;
+}
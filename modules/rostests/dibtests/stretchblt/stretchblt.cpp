@@ -146,6 +146,89 @@ RECT RDest = {5, 5, 0, 0};
 enum {ID_ZOOM25, ID_ZOOM50, ID_ZOOM75, ID_ZOOM100,
       ID_ZOOM125, ID_ZOOM150, ID_ZOOM200, ID_ZOOM300};
 
+// throughput benchmark, run by pressing 'B'
+const int BENCH_LOOPS = 100;
+
+struct BENCH_CASE
+{
+   const char* Name;
+   WORD DstBpp;
+   int Scale; // destination size in percent of the source
+   int Mode;
+};
+
+static const BENCH_CASE BenchCases[] =
+{
+   { "32bpp, 150%, COLORONCOLOR", 32, 150, COLORONCOLOR },
+   { "32bpp, 50%, COLORONCOLOR",  32,  50, COLORONCOLOR },
+   { "32bpp, 50%, HALFTONE",      32,  50, HALFTONE },
+   { "24bpp, 150%, COLORONCOLOR", 24, 150, COLORONCOLOR },
+   { "24bpp, 50%, HALFTONE",      24,  50, HALFTONE },
+   { "16bpp, 150%, COLORONCOLOR", 16, 150, COLORONCOLOR },
+   { "8bpp, 150%, COLORONCOLOR",   8, 150, COLORONCOLOR },
+};
+
+void RunBenchmark(HWND HWnd)
+{
+   char report[1024];
+   int length = 0;
+   LARGE_INTEGER frequency, start, end;
+
+   QueryPerformanceFrequency(&frequency);
+
+   for (UINT i = 0; i < sizeof(BenchCases) / sizeof(BenchCases[0]); i++)
+   {
+      const BENCH_CASE& bench = BenchCases[i];
+      const int width = bmp.bmWidth * bench.Scale / 100;
+      const int height = bmp.bmHeight * bench.Scale / 100;
+
+      // the destination is a DIB section of the tested format
+      BITMAPINFO bmi;
+      memset(&bmi, 0, sizeof(bmi));
+      bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+      bmi.bmiHeader.biWidth = width;
+      bmi.bmiHeader.biHeight = height;
+      bmi.bmiHeader.biPlanes = 1;
+      bmi.bmiHeader.biBitCount = bench.DstBpp;
+      bmi.bmiHeader.biCompression = BI_RGB;
+
+      void* bits;
+      HDC HDstDC = CreateCompatibleDC(NULL);
+      HBITMAP HDstBmp =
+         CreateDIBSection(HDstDC, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+      if (!HDstDC || !HDstBmp)
+      {
+         if (HDstDC) DeleteDC(HDstDC);
+         return;
+      }
+      HBITMAP HOldDstBmp = static_cast<HBITMAP>(SelectObject(HDstDC, HDstBmp));
+      SetStretchBltMode(HDstDC, bench.Mode);
+
+      QueryPerformanceCounter(&start);
+      for (int j = 0; j < BENCH_LOOPS; j++)
+      {
+         StretchBlt(HDstDC, 0, 0, width, height,
+                    HMemDC, 0, 0, bmp.bmWidth, bmp.bmHeight,
+                    SRCCOPY);
+      }
+      GdiFlush();
+      QueryPerformanceCounter(&end);
+
+      const double seconds =
+         static_cast<double>(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+      const double mpixels =
+         static_cast<double>(width) * height * BENCH_LOOPS / 1000000.0;
+      length += sprintf(report + length, "%s: %.1f Mpixels/s\n",
+                        bench.Name, seconds > 0 ? mpixels / seconds : 0.0);
+
+      SelectObject(HDstDC, HOldDstBmp);
+      DeleteObject(HDstBmp);
+      DeleteDC(HDstDC);
+   }
+
+   MessageBox(HWnd, report, "StretchBlt throughput", MB_OK);
+}
+
 LRESULT CALLBACK MainWndProc(HWND HWnd, UINT Msg, WPARAM WParam,
    LPARAM LParam)
 {
@@ -359,6 +442,12 @@ LRESULT CALLBACK MainWndProc(HWND HWnd, UINT Msg, WPARAM WParam,
          EndPaint(HWnd, &ps);
          break;
       }
+      case WM_KEYDOWN:
+      {
+         if (WParam == 'B' && bmp.bmWidth)
+            RunBenchmark(HWnd);
+         break;
+      }
       case WM_DESTROY:
       {
          // clean up
@@ -14,6 +14,7 @@ KMT_TESTFUNC Test_ExFastMutex;
 KMT_TESTFUNC Test_ExHardError;
 KMT_TESTFUNC Test_ExHardErrorInteractive;
 KMT_TESTFUNC Test_ExInterlocked;
+KMT_TESTFUNC Test_ExLockPerf;
 KMT_TESTFUNC Test_ExPools;
 KMT_TESTFUNC Test_ExResource;
 KMT_TESTFUNC Test_ExSequencedList;
@@ -87,6 +88,7 @@ const KMT_TEST TestList[] =
     { "ExHardError",                        Test_ExHardError },
     { "-ExHardErrorInteractive",            Test_ExHardErrorInteractive },
     { "ExInterlocked",                      Test_ExInterlocked },
+    { "ExLockPerf",                         Test_ExLockPerf },
     { "ExPools",                            Test_ExPools },
     { "ExResource",                         Test_ExResource },
     { "ExSequencedList",                    Test_ExSequencedList },
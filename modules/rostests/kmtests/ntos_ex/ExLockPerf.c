@@ -0,0 +1,269 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Kernel-Mode Test Suite executive lock throughput benchmark
+ */
+
+#include <kmt_test.h>
+
+#define NDEBUG
+#include <debug.h>
+
+#define TAG_LOCKPERF 'fPkL'
+
+#define LOCK_PERF_ITERATIONS 20000
+#define LOCK_PERF_MAX_THREADS 8
+#define LOCK_PERF_HOLD_SPINS 32
+
+typedef enum _LOCK_PERF_TYPE
+{
+    ResourceExclusive,
+    ResourceShared,
+    PushLockExclusive,
+    PushLockShared,
+    MaxLockPerfType
+} LOCK_PERF_TYPE;
+
+static PCSTR LockPerfTypeNames[MaxLockPerfType] =
+{
+    "ERESOURCE exclusive",
+    "ERESOURCE shared",
+    "Push lock exclusive",
+    "Push lock shared",
+};
+
+typedef VOID (FASTCALL *PPUSH_LOCK_FUNCTION)(PULONG_PTR);
+static PPUSH_LOCK_FUNCTION pExfAcquirePushLockExclusive;
+static PPUSH_LOCK_FUNCTION pExfAcquirePushLockShared;
+static PPUSH_LOCK_FUNCTION pExfReleasePushLockExclusive;
+static PPUSH_LOCK_FUNCTION pExfReleasePushLockShared;
+
+typedef struct _LOCK_PERF_CONTEXT
+{
+    LOCK_PERF_TYPE Type;
+    ERESOURCE Resource;
+    ULONG_PTR PushLock;
+    KEVENT StartEvent;
+    volatile LONG Counter;
+    ULONG ExclusiveViolations;
+} LOCK_PERF_CONTEXT, *PLOCK_PERF_CONTEXT;
+
+static
+VOID
+LockPerfHold(
+    IN PLOCK_PERF_CONTEXT Context,
+    IN BOOLEAN Exclusive)
+{
+    LONG Counter;
+    ULONG i;
+
+    /* Keep the lock for a short while, like a file system would */
+    Counter = Context->Counter;
+    for (i = 0; i < LOCK_PERF_HOLD_SPINS; i++)
+        YieldProcessor();
+
+    if (Exclusive)
+    {
+        /* Nobody else may have touched the counter meanwhile */
+        if (Context->Counter != Counter)
+            Context->ExclusiveViolations++;
+        Context->Counter = Counter + 1;
+    }
+    else
+    {
+        InterlockedIncrement(&Context->Counter);
+    }
+}
+
+static
+VOID
+NTAPI
+LockPerfThread(
+    IN PVOID Parameter)
+{
+    PLOCK_PERF_CONTEXT Context = Parameter;
+    NTSTATUS Status;
+    ULONG i;
+
+    Status = KeWaitForSingleObject(&Context->StartEvent, Executive, KernelMode, FALSE, NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    for (i = 0; i < LOCK_PERF_ITERATIONS; i++)
+    {
+        KeEnterCriticalRegion();
+        switch (Context->Type)
+        {
+            case ResourceExclusive:
+                ExAcquireResourceExclusiveLite(&Context->Resource, TRUE);
+                LockPerfHold(Context, TRUE);
+                ExReleaseResourceLite(&Context->Resource);
+                break;
+
+            case ResourceShared:
+                ExAcquireResourceSharedLite(&Context->Resource, TRUE);
+                LockPerfHold(Context, FALSE);
+                ExReleaseResourceLite(&Context->Resource);
+                break;
+
+            case PushLockExclusive:
+                pExfAcquirePushLockExclusive(&Context->PushLock);
+                LockPerfHold(Context, TRUE);
+                pExfReleasePushLockExclusive(&Context->PushLock);
+                break;
+
+            case PushLockShared:
+                pExfAcquirePushLockShared(&Context->PushLock);
+                LockPerfHold(Context, FALSE);
+                pExfReleasePushLockShared(&Context->PushLock);
+                break;
+
+            default:
+                break;
+        }
+        KeLeaveCriticalRegion();
+    }
+}
+
+static
+BOOLEAN
+GetResourceLockInformation(
+    IN PERESOURCE Resource,
+    OUT PRTL_PROCESS_LOCK_INFORMATION LockInfo)
+{
+    PRTL_PROCESS_LOCKS Locks;
+    ULONG Length = PAGE_SIZE;
+    ULONG i;
+    NTSTATUS Status;
+    BOOLEAN Found = FALSE;
+
+    while (TRUE)
+    {
+        Locks = ExAllocatePoolWithTag(PagedPool, Length, TAG_LOCKPERF);
+        if (!Locks)
+            return FALSE;
+
+        Status = ZwQuerySystemInformation(SystemLocksInformation,
+                                          Locks,
+                                          Length,
+                                          &Length);
+        if (Status != STATUS_INFO_LENGTH_MISMATCH)
+            break;
+
+        ExFreePoolWithTag(Locks, TAG_LOCKPERF);
+        Length += PAGE_SIZE;
+    }
+
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        for (i = 0; i < Locks->NumberOfLocks; i++)
+        {
+            if (Locks->Locks[i].Address == Resource)
+            {
+                *LockInfo = Locks->Locks[i];
+                Found = TRUE;
+                break;
+            }
+        }
+    }
+
+    ExFreePoolWithTag(Locks, TAG_LOCKPERF);
+    return Found;
+}
+
+static
+VOID
+TestLockPerf(
+    IN PLOCK_PERF_CONTEXT Context,
+    IN LOCK_PERF_TYPE Type,
+    IN ULONG ThreadCount)
+{
+    PKTHREAD Threads[LOCK_PERF_MAX_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    RTL_PROCESS_LOCK_INFORMATION LockInfo;
+    ULONGLONG Ticks, AcquiresPerSecond;
+    NTSTATUS Status;
+    ULONG i;
+
+    Context->Type = Type;
+    Context->Counter = 0;
+    Context->ExclusiveViolations = 0;
+    Context->PushLock = 0;
+    Status = ExInitializeResourceLite(&Context->Resource);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    KeInitializeEvent(&Context->StartEvent, NotificationEvent, FALSE);
+
+    for (i = 0; i < ThreadCount; i++)
+        Threads[i] = KmtStartThread(LockPerfThread, Context);
+
+    KeQueryPerformanceCounter(&Frequency);
+    Start = KeQueryPerformanceCounter(NULL);
+    KeSetEvent(&Context->StartEvent, IO_NO_INCREMENT, FALSE);
+    for (i = 0; i < ThreadCount; i++)
+        KmtFinishThread(Threads[i], NULL);
+    End = KeQueryPerformanceCounter(NULL);
+
+    ok_eq_long(Context->Counter, (LONG)(ThreadCount * LOCK_PERF_ITERATIONS));
+    ok_eq_ulong(Context->ExclusiveViolations, 0UL);
+
+    Ticks = End.QuadPart - Start.QuadPart;
+    AcquiresPerSecond = Ticks ? ThreadCount * LOCK_PERF_ITERATIONS * (ULONGLONG)Frequency.QuadPart / Ticks : 0;
+
+    if (Type == ResourceExclusive || Type == ResourceShared)
+    {
+        /* Contended acquires are either blocking waits or successful spins */
+        if (!skip(GetResourceLockInformation(&Context->Resource, &LockInfo), "Resource not found\n"))
+        {
+            ok_eq_ulong(LockInfo.ContentionCount, Context->Resource.ContentionCount);
+            ok(LockInfo.EntryCount >= LockInfo.ContentionCount,
+               "EntryCount %lu < ContentionCount %lu\n", LockInfo.EntryCount, LockInfo.ContentionCount);
+            trace("%s, %lu threads: %I64u acquires per second, %lu contended, %lu blocked\n",
+                  LockPerfTypeNames[Type], ThreadCount, AcquiresPerSecond,
+                  LockInfo.EntryCount, LockInfo.ContentionCount);
+        }
+    }
+    else
+    {
+        trace("%s, %lu threads: %I64u acquires per second\n",
+              LockPerfTypeNames[Type], ThreadCount, AcquiresPerSecond);
+    }
+
+    Status = ExDeleteResourceLite(&Context->Resource);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+}
+
+START_TEST(ExLockPerf)
+{
+    PLOCK_PERF_CONTEXT Context;
+    LOCK_PERF_TYPE Type;
+    ULONG ThreadCount, MaxThreads;
+
+    pExfAcquirePushLockExclusive = KmtGetSystemRoutineAddress(L"ExfAcquirePushLockExclusive");
+    pExfAcquirePushLockShared = KmtGetSystemRoutineAddress(L"ExfAcquirePushLockShared");
+    pExfReleasePushLockExclusive = KmtGetSystemRoutineAddress(L"ExfReleasePushLockExclusive");
+    pExfReleasePushLockShared = KmtGetSystemRoutineAddress(L"ExfReleasePushLockShared");
+
+    Context = ExAllocatePoolWithTag(NonPagedPool, sizeof(*Context), TAG_LOCKPERF);
+    if (skip(Context != NULL, "No memory\n"))
+        return;
+
+    /* Go from no contention up to more threads than processors */
+    MaxThreads = min(2 * (ULONG)KeNumberProcessors, LOCK_PERF_MAX_THREADS);
+    for (Type = ResourceExclusive; Type < MaxLockPerfType; Type++)
+    {
+        if ((Type == PushLockExclusive || Type == PushLockShared) &&
+            skip(pExfAcquirePushLockExclusive && pExfAcquirePushLockShared &&
+                 pExfReleasePushLockExclusive && pExfReleasePushLockShared,
+                 "Push lock routines unavailable\n"))
+        {
+            continue;
+        }
+
+        for (ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount *= 2)
+        {
+            TestLockPerf(Context, Type, ThreadCount);
+        }
+    }
+
+    ExFreePoolWithTag(Context, TAG_LOCKPERF);
+}
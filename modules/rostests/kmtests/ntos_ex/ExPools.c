@@ -11,6 +11,10 @@
 #include <debug.h>
 
 #define TAG_POOLTEST 'tstP'
+#define TAG_POOLSTRESS 'tsSP'
+
+#define POOL_STRESS_ITERATIONS 20000
+#define POOL_STRESS_BATCH 16
 
 #define BASE_POOL_TYPE_MASK 1
 #define QUOTA_POOL_MASK 8
@@ -305,6 +309,174 @@ TestBigPoolExpansion(VOID)
     }
 }
 
+typedef struct _POOL_STRESS_CONTEXT
+{
+    KAFFINITY Affinity;
+    POOL_TYPE PoolType;
+    ULONG Allocations;
+    ULONG Failures;
+    LONGLONG Ticks;
+} POOL_STRESS_CONTEXT, *PPOOL_STRESS_CONTEXT;
+
+static
+VOID
+NTAPI
+PoolStressThread(
+    IN PVOID Context)
+{
+    PPOOL_STRESS_CONTEXT StressContext = Context;
+    PVOID Allocations[POOL_STRESS_BATCH];
+    LARGE_INTEGER Start, End;
+    SIZE_T AllocSize;
+    ULONG i, j;
+
+    KeSetSystemAffinityThread(StressContext->Affinity);
+
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; i < POOL_STRESS_ITERATIONS; i++)
+    {
+        // cover every small block size, including the ones bigger than
+        // the per-CPU lookaside lists
+        for (j = 0; j < POOL_STRESS_BATCH; j++)
+        {
+            AllocSize = 1 + ((i * POOL_STRESS_BATCH + j) * 72) % (PAGE_SIZE - 4 * sizeof(PVOID));
+            Allocations[j] = ExAllocatePoolWithTag(StressContext->PoolType, AllocSize, TAG_POOLSTRESS);
+            if (!Allocations[j])
+            {
+                StressContext->Failures++;
+                continue;
+            }
+            RtlFillMemory(Allocations[j], AllocSize, 0xCD);
+            StressContext->Allocations++;
+        }
+
+        for (j = 0; j < POOL_STRESS_BATCH; j++)
+        {
+            if (Allocations[j])
+                ExFreePoolWithTag(Allocations[j], TAG_POOLSTRESS);
+        }
+    }
+    End = KeQueryPerformanceCounter(NULL);
+    StressContext->Ticks = End.QuadPart - Start.QuadPart;
+
+    KeRevertToUserAffinityThread();
+}
+
+static
+BOOLEAN
+GetPoolTagUsage(
+    _In_ ULONG Tag,
+    _Out_ PSYSTEM_POOLTAG TagUsage)
+{
+    PSYSTEM_POOLTAG_INFORMATION TagInformation;
+    ULONG Length = PAGE_SIZE;
+    ULONG i;
+    NTSTATUS Status;
+    BOOLEAN Found = FALSE;
+
+    RtlZeroMemory(TagUsage, sizeof(*TagUsage));
+    while (TRUE)
+    {
+        TagInformation = ExAllocatePoolWithTag(PagedPool, Length, TAG_POOLTEST);
+        if (!TagInformation)
+            return FALSE;
+
+        Status = ZwQuerySystemInformation(SystemPoolTagInformation,
+                                          TagInformation,
+                                          Length,
+                                          &Length);
+        if (Status != STATUS_INFO_LENGTH_MISMATCH)
+            break;
+
+        ExFreePoolWithTag(TagInformation, TAG_POOLTEST);
+    }
+
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        for (i = 0; i < TagInformation->Count; i++)
+        {
+            if (TagInformation->TagInfo[i].TagUlong == Tag)
+            {
+                *TagUsage = TagInformation->TagInfo[i];
+                Found = TRUE;
+                break;
+            }
+        }
+    }
+
+    ExFreePoolWithTag(TagInformation, TAG_POOLTEST);
+    return Found;
+}
+
+static
+VOID
+TestPoolStress(VOID)
+{
+    POOL_TYPE PoolType;
+    PPOOL_STRESS_CONTEXT Contexts;
+    PKTHREAD *Threads;
+    LARGE_INTEGER Frequency;
+    SYSTEM_POOLTAG TagUsage;
+    ULONG Processor, ProcessorCount;
+    ULONGLONG AllocationsPerSecond;
+
+    ProcessorCount = KeNumberProcessors;
+    Contexts = ExAllocatePoolWithTag(NonPagedPool, ProcessorCount * sizeof(*Contexts), TAG_POOLTEST);
+    Threads = ExAllocatePoolWithTag(NonPagedPool, ProcessorCount * sizeof(*Threads), TAG_POOLTEST);
+    if (skip(Contexts != NULL && Threads != NULL, "No memory\n"))
+    {
+        if (Contexts) ExFreePoolWithTag(Contexts, TAG_POOLTEST);
+        if (Threads) ExFreePoolWithTag(Threads, TAG_POOLTEST);
+        return;
+    }
+
+    KeQueryPerformanceCounter(&Frequency);
+
+    for (PoolType = NonPagedPool; PoolType <= PagedPool; PoolType++)
+    {
+        // hammer the pool from one thread on every processor at the same time
+        RtlZeroMemory(Contexts, ProcessorCount * sizeof(*Contexts));
+        for (Processor = 0; Processor < ProcessorCount; Processor++)
+        {
+            Contexts[Processor].Affinity = (KAFFINITY)1 << Processor;
+            Contexts[Processor].PoolType = PoolType;
+            Threads[Processor] = KmtStartThread(PoolStressThread, &Contexts[Processor]);
+        }
+
+        for (Processor = 0; Processor < ProcessorCount; Processor++)
+        {
+            KmtFinishThread(Threads[Processor], NULL);
+            ok_eq_ulong(Contexts[Processor].Failures, 0UL);
+            ok_eq_ulong(Contexts[Processor].Allocations, (ULONG)POOL_STRESS_ITERATIONS * POOL_STRESS_BATCH);
+
+            AllocationsPerSecond = Contexts[Processor].Ticks ?
+                                   Contexts[Processor].Allocations * (ULONGLONG)Frequency.QuadPart / Contexts[Processor].Ticks :
+                                   0;
+            trace("PoolType %d, CPU %lu: %I64u allocations per second\n",
+                  PoolType, Processor, AllocationsPerSecond);
+        }
+
+        // the per-CPU tag counters must add up once merged
+        if (!skip(GetPoolTagUsage(TAG_POOLSTRESS, &TagUsage), "Tag not found\n"))
+        {
+            if (PoolType == NonPagedPool)
+            {
+                ok_eq_ulong(TagUsage.NonPagedAllocs, TagUsage.NonPagedFrees);
+                ok_eq_size(TagUsage.NonPagedUsed, 0);
+            }
+            else
+            {
+                ok_eq_ulong(TagUsage.PagedAllocs, TagUsage.PagedFrees);
+                ok_eq_size(TagUsage.PagedUsed, 0);
+            }
+        }
+    }
+
+    ExFreePoolWithTag(Threads, TAG_POOLTEST);
+    ExFreePoolWithTag(Contexts, TAG_POOLTEST);
+}
+
 START_TEST(ExPools)
 {
     PoolsTest();
@@ -312,4 +484,5 @@ START_TEST(ExPools)
     TestPoolTags();
     TestPoolQuota();
     TestBigPoolExpansion();
+    TestPoolStress();
 }
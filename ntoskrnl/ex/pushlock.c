@@ -15,6 +15,9 @@
 /* DATA **********************************************************************/
 
 ULONG ExPushLockSpinCount = 0;
+ULONG ExpPushLockSpinLimit = 0;
+ULONG ExPushLockSpinAcquireCount;
+ULONG ExPushLockWaitCount;
 
 #undef EX_PUSH_LOCK
 #undef PEX_PUSH_LOCK
@@ -51,6 +54,67 @@ ExpInitializePushLocks(VOID)
 #endif
 }
 
+#ifdef CONFIG_SMP
+/*++
+ * @name ExpSpinOnPushLock
+ *
+ *     The ExpSpinOnPushLock routine spins for a while on a contended pushlock,
+ *     before the caller goes through the trouble of queuing a wait block.
+ *
+ * @param PushLock
+ *        Pointer to the pushlock to spin on.
+ *
+ * @param Shared
+ *        Specifies whether the caller wants shared access.
+ *
+ * @return The last value of the pushlock.
+ *
+ * @remarks The spin is bounded by ExPushLockSpinCount, and adapts to how long
+ *          the pushlocks were held on the previous spins. It stops as soon as
+ *          someone queues a wait block, so that we don't jump ahead of them.
+ *
+ *--*/
+EX_PUSH_LOCK
+FASTCALL
+ExpSpinOnPushLock(IN PEX_PUSH_LOCK PushLock,
+                  IN BOOLEAN Shared)
+{
+    EX_PUSH_LOCK Value;
+    ULONG SpinLimit, Spins;
+    BOOLEAN Released = FALSE;
+
+    /* Get the current limit */
+    SpinLimit = ExpPushLockSpinLimit ? ExpPushLockSpinLimit : EX_SPIN_LIMIT_INITIAL;
+    if (SpinLimit > ExPushLockSpinCount) SpinLimit = ExPushLockSpinCount;
+
+    for (Spins = 0; Spins < SpinLimit; Spins++)
+    {
+        YieldProcessor();
+        Value.Ptr = *(PVOID volatile *)&PushLock->Ptr;
+
+        /* Somebody is waiting already, don't jump ahead of them */
+        if (Value.Waiting) break;
+
+        /* Check if we could acquire it now */
+        if (!(Value.Locked) || ((Shared) && (Value.Shared > 0)))
+        {
+            Released = TRUE;
+            break;
+        }
+    }
+
+    /* Tune the limit for next time. Races don't matter, it's only a hint */
+    ExpPushLockSpinLimit = ExpUpdateSpinLimit(ExpPushLockSpinLimit,
+                                              Spins,
+                                              Released);
+    if (Released) InterlockedIncrement((PLONG)&ExPushLockSpinAcquireCount);
+
+    /* Return the value we last saw */
+    Value.Ptr = *(PVOID volatile *)&PushLock->Ptr;
+    return Value;
+}
+#endif
+
 /*++
  * @name ExfWakePushLock
  *
@@ -474,6 +538,9 @@ ExfAcquirePushLockExclusive(PEX_PUSH_LOCK PushLock)
     BOOLEAN NeedWake;
     EX_PUSH_LOCK_WAIT_BLOCK Block;
     PEX_PUSH_LOCK_WAIT_BLOCK WaitBlock = &Block;
+#ifdef CONFIG_SMP
+    BOOLEAN Spun = FALSE;
+#endif
 
     /* Start main loop */
     for (;;)
@@ -500,6 +567,16 @@ ExfAcquirePushLockExclusive(PEX_PUSH_LOCK PushLock)
         }
         else
         {
+#ifdef CONFIG_SMP
+            /* Spin once if nobody is waiting, it might get released soon */
+            if (!(Spun) && (ExPushLockSpinCount) && !(OldValue.Waiting))
+            {
+                Spun = TRUE;
+                OldValue = ExpSpinOnPushLock(PushLock, FALSE);
+                continue;
+            }
+#endif
+
             /* We'll have to create a Waitblock */
             WaitBlock->Flags = EX_PUSH_LOCK_FLAGS_EXCLUSIVE |
                                EX_PUSH_LOCK_FLAGS_WAIT;
@@ -589,7 +666,8 @@ ExfAcquirePushLockExclusive(PEX_PUSH_LOCK PushLock)
                 ExpOptimizePushLockList(PushLock, TempValue);
             }
 
-            /* Set up the Wait Gate */
+            /* Account for the wait, and set up the Wait Gate */
+            InterlockedIncrement((PLONG)&ExPushLockWaitCount);
             KeInitializeGate(&WaitBlock->WakeGate);
 
 #ifdef CONFIG_SMP
@@ -648,6 +726,9 @@ ExfAcquirePushLockShared(PEX_PUSH_LOCK PushLock)
     BOOLEAN NeedWake;
     EX_PUSH_LOCK_WAIT_BLOCK Block;
     PEX_PUSH_LOCK_WAIT_BLOCK WaitBlock = &Block;
+#ifdef CONFIG_SMP
+    BOOLEAN Spun = FALSE;
+#endif
 
     /* Start main loop */
     for (;;)
@@ -687,6 +768,16 @@ ExfAcquirePushLockShared(PEX_PUSH_LOCK PushLock)
         }
         else
         {
+#ifdef CONFIG_SMP
+            /* Spin once if nobody is waiting, it might get released soon */
+            if (!(Spun) && (ExPushLockSpinCount) && !(OldValue.Waiting))
+            {
+                Spun = TRUE;
+                OldValue = ExpSpinOnPushLock(PushLock, TRUE);
+                continue;
+            }
+#endif
+
             /* We'll have to create a Waitblock */
             WaitBlock->Flags = EX_PUSH_LOCK_FLAGS_WAIT;
             WaitBlock->ShareCount = 0;
@@ -756,7 +847,8 @@ ExfAcquirePushLockShared(PEX_PUSH_LOCK PushLock)
                 ExpOptimizePushLockList(PushLock, OldValue);
             }
 
-            /* Set up the Wait Gate */
+            /* Account for the wait, and set up the Wait Gate */
+            InterlockedIncrement((PLONG)&ExPushLockWaitCount);
             KeInitializeGate(&WaitBlock->WakeGate);
 
 #ifdef CONFIG_SMP
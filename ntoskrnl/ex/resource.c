@@ -729,6 +729,196 @@ ExpWaitForResource(IN PERESOURCE Resource,
     }
 }
 
+#ifdef CONFIG_SMP
+/*++
+ * @name ExpSpinOnResource
+ *
+ *     The ExpSpinOnResource routine spins for a while on a contended resource,
+ *     hoping that its owner releases it before we need to block.
+ *
+ * @param Resource
+ *        Pointer to the resource to spin on.
+ *
+ * @param LockHandle
+ *        Pointer to in-stack queued spinlock, which is held on entry and exit,
+ *        but dropped while spinning.
+ *
+ * @param Shared
+ *        Specifies whether the caller wants shared access, in which case it
+ *        only waits for the exclusive owner to go away.
+ *
+ * @return None.
+ *
+ * @remarks We only spin if nobody is blocked on the resource yet, and if the
+ *          owner is running on another processor. The spin is bounded by a
+ *          limit that adapts to how long the owner kept the resource on the
+ *          previous spins. The caller must revalidate the resource state.
+ *
+ *--*/
+VOID
+FASTCALL
+ExpSpinOnResource(IN PERESOURCE Resource,
+                  IN PKLOCK_QUEUE_HANDLE LockHandle,
+                  IN BOOLEAN Shared)
+{
+    EX_RESOURCE_SPIN_STATE SpinState;
+    ERESOURCE_THREAD OwnerThread;
+    ULONG SpinLimit, Spins;
+    BOOLEAN Released = FALSE;
+
+    /* There's nothing to gain if someone is already blocked, or on UP */
+    if ((KeNumberProcessors == 1) ||
+        (IsExclusiveWaiting(Resource)) ||
+        (IsSharedWaiting(Resource)))
+    {
+        return;
+    }
+
+    /* Only spin if the owner is a thread currently running somewhere else */
+    OwnerThread = Resource->OwnerEntry.OwnerThread;
+    if (!(OwnerThread) ||
+        (OwnerThread & 3) ||
+        (((PKTHREAD)OwnerThread)->State != Running))
+    {
+        return;
+    }
+
+    /* Get the current spin limit */
+    SpinState.Long = (ULONG)Resource->CreatorBackTraceIndex;
+    SpinLimit = SpinState.SpinLimit ? SpinState.SpinLimit : EX_SPIN_LIMIT_INITIAL;
+
+    /* Drop the lock and spin until the resource looks available */
+    ExReleaseResourceLock(Resource, LockHandle);
+    for (Spins = 0; Spins < SpinLimit; Spins++)
+    {
+        YieldProcessor();
+
+        if (Shared)
+        {
+            /* We only care about the exclusive owner */
+            if (!(*(volatile USHORT *)&Resource->Flag & ResourceOwnedExclusive))
+            {
+                Released = TRUE;
+                break;
+            }
+        }
+        else if (!*(volatile ULONG *)&Resource->ActiveEntries)
+        {
+            /* Nobody owns it anymore */
+            Released = TRUE;
+            break;
+        }
+    }
+    ExAcquireResourceLock(Resource, LockHandle);
+
+    /* Tune the spin limit for next time and update the statistics */
+    SpinState.Long = (ULONG)Resource->CreatorBackTraceIndex;
+    SpinState.SpinLimit = (USHORT)ExpUpdateSpinLimit(SpinState.SpinLimit,
+                                                     Spins,
+                                                     Released);
+    if ((Released) && (SpinState.SpinAcquireCount != MAXUSHORT))
+    {
+        SpinState.SpinAcquireCount++;
+    }
+    Resource->CreatorBackTraceIndex = SpinState.Long;
+}
+#endif
+
+/*++
+ * @name ExQuerySystemLockInformation
+ *
+ *     The ExQuerySystemLockInformation routine returns information about
+ *     every resource in the system.
+ *
+ * @param LockInformation
+ *        Pointer to the buffer receiving the lock information. It must be
+ *        accessible at DISPATCH_LEVEL.
+ *
+ * @param LockInformationLength
+ *        Size of the buffer, in bytes.
+ *
+ * @param ReturnLength
+ *        Optional pointer receiving the size needed for all the resources.
+ *
+ * @return STATUS_SUCCESS or STATUS_INFO_LENGTH_MISMATCH if the buffer is too
+ *         small.
+ *
+ * @remarks ContentionCount only counts acquires which had to block, while
+ *          EntryCount also counts the ones which were satisfied by spinning.
+ *
+ *--*/
+NTSTATUS
+NTAPI
+ExQuerySystemLockInformation(OUT PRTL_PROCESS_LOCKS LockInformation,
+                             IN ULONG LockInformationLength,
+                             OUT PULONG ReturnLength OPTIONAL)
+{
+    PRTL_PROCESS_LOCK_INFORMATION LockInfo;
+    EX_RESOURCE_SPIN_STATE SpinState;
+    KLOCK_QUEUE_HANDLE LockHandle;
+    PLIST_ENTRY NextEntry;
+    PERESOURCE Resource;
+    ERESOURCE_THREAD OwnerThread;
+    ULONG RequiredLength;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    /* We need at least the header */
+    RequiredLength = FIELD_OFFSET(RTL_PROCESS_LOCKS, Locks);
+    if (LockInformationLength < RequiredLength)
+    {
+        if (ReturnLength) *ReturnLength = sizeof(RTL_PROCESS_LOCKS);
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    LockInformation->NumberOfLocks = 0;
+    LockInfo = &LockInformation->Locks[0];
+
+    /* Loop every resource in the system */
+    KeAcquireInStackQueuedSpinLock(&ExpResourceSpinLock, &LockHandle);
+    for (NextEntry = ExpSystemResourcesList.Flink;
+         NextEntry != &ExpSystemResourcesList;
+         NextEntry = NextEntry->Flink)
+    {
+        /* Account for it, even if it doesn't fit */
+        LockInformation->NumberOfLocks++;
+        RequiredLength += sizeof(RTL_PROCESS_LOCK_INFORMATION);
+        if (RequiredLength > LockInformationLength)
+        {
+            Status = STATUS_INFO_LENGTH_MISMATCH;
+            continue;
+        }
+
+        /* Get the resource and its spin statistics */
+        Resource = CONTAINING_RECORD(NextEntry, ERESOURCE, SystemResourcesList);
+        SpinState.Long = (ULONG)Resource->CreatorBackTraceIndex;
+
+        /* Fill out the information */
+        LockInfo->Address = Resource;
+        LockInfo->Type = RTL_RESOURCE_TYPE;
+        LockInfo->CreatorBackTraceIndex = 0;
+        LockInfo->OwnerThreadId = 0;
+        OwnerThread = Resource->OwnerEntry.OwnerThread;
+        if ((Resource->ActiveEntries) && (OwnerThread) && !(OwnerThread & 3))
+        {
+            LockInfo->OwnerThreadId =
+                HandleToUlong(((PETHREAD)OwnerThread)->Cid.UniqueThread);
+        }
+        LockInfo->ActiveCount = Resource->ActiveCount;
+        LockInfo->ContentionCount = Resource->ContentionCount;
+        LockInfo->EntryCount = Resource->ContentionCount +
+                               SpinState.SpinAcquireCount;
+        LockInfo->RecursionCount = 0;
+        LockInfo->NumberOfSharedWaiters = Resource->NumberOfSharedWaiters;
+        LockInfo->NumberOfExclusiveWaiters = Resource->NumberOfExclusiveWaiters;
+        LockInfo++;
+    }
+    KeReleaseInStackQueuedSpinLock(&LockHandle);
+
+    /* Return the length we needed */
+    if (ReturnLength) *ReturnLength = RequiredLength;
+    return Status;
+}
+
 /* FUNCTIONS *****************************************************************/
 
 /*++
@@ -773,6 +963,9 @@ ExAcquireResourceExclusiveLite(IN PERESOURCE Resource,
     KLOCK_QUEUE_HANDLE LockHandle;
     ERESOURCE_THREAD Thread;
     BOOLEAN Success;
+#ifdef CONFIG_SMP
+    BOOLEAN Spun = FALSE;
+#endif
 
     /* Sanity check */
     ASSERT((Resource->Flag & ResourceNeverExclusive) == 0);
@@ -813,6 +1006,16 @@ TryAcquire:
             }
             else
             {
+#ifdef CONFIG_SMP
+                /* Spin once, the owner might release it soon */
+                if (!Spun)
+                {
+                    Spun = TRUE;
+                    ExpSpinOnResource(Resource, &LockHandle, FALSE);
+                    goto TryAcquire;
+                }
+#endif
+
                 /* Check if it has exclusive waiters */
                 if (!Resource->ExclusiveWaiters)
                 {
@@ -889,6 +1092,9 @@ ExAcquireResourceSharedLite(IN PERESOURCE Resource,
     ERESOURCE_THREAD Thread;
     POWNER_ENTRY Owner = NULL;
     BOOLEAN FirstEntryBusy;
+#ifdef CONFIG_SMP
+    BOOLEAN Spun = FALSE;
+#endif
 
     /* Get the thread */
     Thread = ExGetCurrentResourceThread();
@@ -979,6 +1185,16 @@ ExAcquireResourceSharedLite(IN PERESOURCE Resource,
             ExReleaseResourceLock(Resource, &LockHandle);
             return FALSE;
         }
+
+#ifdef CONFIG_SMP
+        /* Spin once, the exclusive owner might release it soon */
+        if (!Spun)
+        {
+            Spun = TRUE;
+            ExpSpinOnResource(Resource, &LockHandle, TRUE);
+            continue;
+        }
+#endif
         
         /* Check if we have a shared waiters semaphore */
         if (!Resource->SharedWaiters)
@@ -1793,6 +2009,7 @@ ExReinitializeResourceLite(IN PERESOURCE Resource)
     Resource->ContentionCount = 0;
     Resource->NumberOfSharedWaiters = 0;
     Resource->NumberOfExclusiveWaiters = 0;
+    Resource->CreatorBackTraceIndex = 0;
     return STATUS_SUCCESS;
 }
 
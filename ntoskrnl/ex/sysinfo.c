@@ -695,6 +695,9 @@ QSI_DEF(SystemPerformanceInformation)
     Spi->IoReadOperationCount = IoReadOperationCount;
     Spi->IoWriteOperationCount = IoWriteOperationCount;
     Spi->IoOtherOperationCount = IoOtherOperationCount;
+    Spi->TransitionCount = 0;
+    Spi->PageReadCount = 0;
+    Spi->PageReadIoCount = 0;
     for (i = 0; i < KeNumberProcessors; i ++)
     {
         Prcb = KiProcessorBlock[i];
@@ -706,6 +709,9 @@ QSI_DEF(SystemPerformanceInformation)
             Spi->IoReadOperationCount += Prcb->IoReadOperationCount;
             Spi->IoWriteOperationCount += Prcb->IoWriteOperationCount;
             Spi->IoOtherOperationCount += Prcb->IoOtherOperationCount;
+            Spi->TransitionCount += Prcb->MmTransitionCount;
+            Spi->PageReadCount += Prcb->MmPageReadCount;
+            Spi->PageReadIoCount += Prcb->MmPageReadIoCount;
         }
     }
 
@@ -728,11 +734,8 @@ QSI_DEF(SystemPerformanceInformation)
     Spi->PeakCommitment = 0; /* FIXME */
     Spi->PageFaultCount = 0; /* FIXME */
     Spi->CopyOnWriteCount = 0; /* FIXME */
-    Spi->TransitionCount = 0; /* FIXME */
     Spi->CacheTransitionCount = 0; /* FIXME */
     Spi->DemandZeroCount = 0; /* FIXME */
-    Spi->PageReadCount = 0; /* FIXME */
-    Spi->PageReadIoCount = 0; /* FIXME */
     Spi->CacheReadCount = 0; /* FIXME */
     Spi->CacheIoCount = 0; /* FIXME */
     Spi->DirtyPagesWriteCount = 0; /* FIXME */
@@ -1251,9 +1254,36 @@ QSI_DEF(SystemModuleInformation)
 /* Class 12 - Locks Information */
 QSI_DEF(SystemLocksInformation)
 {
-    /* FIXME */
-    DPRINT1("NtQuerySystemInformation - SystemLocksInformation not implemented\n");
-    return STATUS_NOT_IMPLEMENTED;
+    PRTL_PROCESS_LOCKS LockInformation;
+    PMDL Mdl;
+    NTSTATUS Status;
+
+    /* We need at least the header */
+    if (Size < FIELD_OFFSET(RTL_PROCESS_LOCKS, Locks))
+    {
+        *ReqSize = sizeof(RTL_PROCESS_LOCKS);
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    /* The resource list is walked at DISPATCH_LEVEL, lock down the memory */
+    Status = ExLockUserBuffer(Buffer,
+                              Size,
+                              ExGetPreviousMode(),
+                              IoWriteAccess,
+                              (PVOID*)&LockInformation,
+                              &Mdl);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Failed to lock the user buffer: 0x%lx\n", Status);
+        return Status;
+    }
+
+    /* Let Ex fill it out */
+    Status = ExQuerySystemLockInformation(LockInformation, Size, ReqSize);
+
+    /* Release the locked user buffer */
+    ExUnlockUserBuffer(Mdl);
+    return Status;
 }
 
 /* Class 13 - Stack Trace Information */
@@ -2715,6 +2745,23 @@ QSI_DEF(SystemFirmwareTableInformation)
     return Status;
 }
 
+/* ReactOS private class - Working set aging statistics of the balancer */
+QSI_DEF(WorkingSetAgingInformation)
+{
+    KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+
+    DPRINT("NtQuerySystemInformation - SystemWorkingSetAgingInformation\n");
+
+    /* This looks at the pages of every process */
+    if (!SeSinglePrivilegeCheck(SeProfileSingleProcessPrivilege, PreviousMode) &&
+        !SeSinglePrivilegeCheck(SeDebugPrivilege, PreviousMode))
+    {
+        return STATUS_PRIVILEGE_NOT_HELD;
+    }
+
+    return MmQueryWorkingSetAging(Buffer, Size, ReqSize);
+}
+
 /* Query/Set Calls Table */
 typedef
 struct _QSSI_CALLS
@@ -2835,6 +2882,7 @@ NtQuerySystemInformation(
     KPROCESSOR_MODE PreviousMode;
     ULONG ResultLength = 0;
     ULONG Alignment = TYPE_ALIGNMENT(ULONG);
+    NTSTATUS (* Query) (PVOID,ULONG,PULONG);
     NTSTATUS FStatus = STATUS_NOT_IMPLEMENTED;
 
     PAGED_CODE();
@@ -2847,8 +2895,9 @@ NtQuerySystemInformation(
         /*
          * Check if the request is valid.
          */
-        if (SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
-            SystemInformationClass >= MAX_SYSTEM_INFO_CLASS)
+        if ((SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
+             SystemInformationClass >= MAX_SYSTEM_INFO_CLASS) &&
+            SystemInformationClass != SystemWorkingSetAgingInformation)
         {
             _SEH2_YIELD(return STATUS_INVALID_INFO_CLASS);
         }
@@ -2872,21 +2921,28 @@ NtQuerySystemInformation(
         /*
          * Check if the request is valid.
          */
-        if (SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
-            SystemInformationClass >= MAX_SYSTEM_INFO_CLASS)
+        if ((SystemInformationClass < MIN_SYSTEM_INFO_CLASS ||
+             SystemInformationClass >= MAX_SYSTEM_INFO_CLASS) &&
+            SystemInformationClass != SystemWorkingSetAgingInformation)
         {
             _SEH2_YIELD(return STATUS_INVALID_INFO_CLASS);
         }
 #endif
 
-        if (NULL != CallQS [SystemInformationClass].Query)
+        /* The private classes aren't part of the table */
+        if (SystemInformationClass == SystemWorkingSetAgingInformation)
+            Query = QSI_USE(WorkingSetAgingInformation);
+        else
+            Query = CallQS [SystemInformationClass].Query;
+
+        if (NULL != Query)
         {
             /*
              * Hand the request to a subhandler.
              */
-            FStatus = CallQS [SystemInformationClass].Query(SystemInformation,
-                                                            Length,
-                                                            &ResultLength);
+            FStatus = Query(SystemInformation,
+                            Length,
+                            &ResultLength);
 
             /* Save the result length to the caller */
             if (UnsafeResultLength)
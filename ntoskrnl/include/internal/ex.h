@@ -31,6 +31,9 @@ extern KSPIN_LOCK ExpPagedLookasideListLock;
 extern ULONG ExCriticalWorkerThreads;
 extern ULONG ExDelayedWorkerThreads;
 
+extern ULONG ExPushLockSpinCount;
+extern ULONG ExPushLockSpinAcquireCount;
+extern ULONG ExPushLockWaitCount;
 extern PVOID ExpDefaultErrorPort;
 extern PEPROCESS ExpDefaultErrorPortProcess;
 
@@ -125,6 +128,29 @@ typedef struct _HARDERROR_USER_PARAMETERS
     WCHAR Buffer[ANYSIZE_ARRAY];
 } HARDERROR_USER_PARAMETERS, *PHARDERROR_USER_PARAMETERS;
 
+//
+// Adaptive spinning for ERESOURCEs and push locks. The spin limit follows
+// the number of iterations recent spins needed to see the lock released,
+// and backs off when spinning doesn't pay off
+//
+#define EX_SPIN_LIMIT_MIN       16
+#define EX_SPIN_LIMIT_INITIAL   256
+#define EX_SPIN_LIMIT_MAX       4096
+
+//
+// ERESOURCE adaptive spin state and statistics, kept in the back trace index
+// which we don't otherwise use
+//
+typedef union _EX_RESOURCE_SPIN_STATE
+{
+    struct
+    {
+        USHORT SpinLimit;
+        USHORT SpinAcquireCount;
+    };
+    ULONG Long;
+} EX_RESOURCE_SPIN_STATE, *PEX_RESOURCE_SPIN_STATE;
+
 #define MAX_FAST_REFS           7
 
 #define ExAcquireRundownProtection                      _ExAcquireRundownProtection
@@ -297,11 +323,45 @@ VOID
 NTAPI
 ExpResourceInitialization(VOID);
 
+NTSTATUS
+NTAPI
+ExQuerySystemLockInformation(
+    OUT PRTL_PROCESS_LOCKS LockInformation,
+    IN ULONG LockInformationLength,
+    OUT PULONG ReturnLength OPTIONAL
+);
+
 INIT_FUNCTION
 VOID
 NTAPI
 ExInitPoolLookasidePointers(VOID);
 
+FORCEINLINE
+ULONG
+ExpUpdateSpinLimit(IN ULONG SpinLimit,
+                   IN ULONG Spins,
+                   IN BOOLEAN Acquired)
+{
+    /* Zero means we never had to spin yet */
+    if (!SpinLimit) SpinLimit = EX_SPIN_LIMIT_INITIAL;
+
+    if (Acquired)
+    {
+        /* Move towards twice what we needed this time */
+        SpinLimit += ((LONG)(2 * Spins) - (LONG)SpinLimit) / 8;
+    }
+    else
+    {
+        /* The owner held it for too long, spin less next time */
+        SpinLimit -= SpinLimit / 8;
+    }
+
+    /* Stay within bounds */
+    if (SpinLimit < EX_SPIN_LIMIT_MIN) SpinLimit = EX_SPIN_LIMIT_MIN;
+    if (SpinLimit > EX_SPIN_LIMIT_MAX) SpinLimit = EX_SPIN_LIMIT_MAX;
+    return SpinLimit;
+}
+
 /* Callback Functions ********************************************************/
 
 VOID
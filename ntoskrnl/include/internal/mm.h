@@ -661,6 +661,17 @@ MiReadPageFile(
     _In_ ULONG PageFileIndex,
     _In_ ULONG_PTR PageFileOffset);
 
+/* Largest number of pages brought in by a single paging file read */
+#define MI_MAX_PAGEFILE_READ_CLUSTER 16
+
+NTSTATUS
+NTAPI
+MiReadPageFileCluster(
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ PFN_COUNT PageCount,
+    _In_ ULONG PageFileIndex,
+    _In_ ULONG_PTR PageFileOffset);
+
 /* process.c ****************************************************************/
 
 NTSTATUS
@@ -836,6 +847,14 @@ VOID
 NTAPI
 MmRebalanceMemoryConsumers(VOID);
 
+NTSTATUS
+NTAPI
+MmQueryWorkingSetAging(
+    OUT PVOID Buffer,
+    IN ULONG Size,
+    OUT PULONG ReqSize
+);
+
 /* rmap.c **************************************************************/
 
 VOID
@@ -890,6 +909,13 @@ BOOLEAN
 NTAPI
 MmIsDirtyPageRmap(PFN_NUMBER Page);
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedRmap(
+    PFN_NUMBER Page,
+    PBOOLEAN Dirty
+);
+
 NTSTATUS
 NTAPI
 MmPageOutPhysicalAddress(PFN_NUMBER Page);
@@ -1225,6 +1251,13 @@ MmIsDirtyPage(
     PVOID Address
 );
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(
+    struct _EPROCESS *Process,
+    PVOID Address
+);
+
 /* wset.c ********************************************************************/
 
 NTSTATUS
@@ -1462,6 +1495,11 @@ NTAPI
 ExReturnPoolQuota(
     IN PVOID P);
 
+ULONG
+NTAPI
+ExpDrainPoolMagazines(
+    IN POOL_TYPE PoolType);
+
 
 /* mmsup.c *****************************************************************/
 
@@ -1134,6 +1134,320 @@ IopGetDriverPathInformation(IN PFILE_OBJECT FileObject,
     return STATUS_SUCCESS;
 }
 
+static
+NTSTATUS
+IopScatterGatherFile(IN HANDLE FileHandle,
+                     IN HANDLE Event OPTIONAL,
+                     IN PIO_APC_ROUTINE ApcRoutine OPTIONAL,
+                     IN PVOID ApcContext OPTIONAL,
+                     OUT PIO_STATUS_BLOCK IoStatusBlock,
+                     IN FILE_SEGMENT_ELEMENT SegmentArray[],
+                     IN ULONG Length,
+                     IN PLARGE_INTEGER ByteOffset OPTIONAL,
+                     IN PULONG Key OPTIONAL,
+                     IN BOOLEAN Write)
+{
+    NTSTATUS Status;
+    PFILE_OBJECT FileObject;
+    PIRP Irp;
+    PDEVICE_OBJECT DeviceObject;
+    PIO_STACK_LOCATION StackPtr;
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    PKEVENT EventObject = NULL;
+    LARGE_INTEGER CapturedByteOffset;
+    ULONG CapturedKey = 0;
+    BOOLEAN Synchronous = FALSE;
+    PFILE_SEGMENT_ELEMENT CapturedSegments = NULL;
+    PFN_COUNT PageCount, i;
+    PMDL Mdl;
+    OBJECT_HANDLE_INFORMATION ObjectHandleInfo;
+
+    PAGED_CODE();
+    CapturedByteOffset.QuadPart = 0;
+    IOTRACE(IO_API_DEBUG, "FileHandle: %p\n", FileHandle);
+
+    /* Get File Object */
+    if (Write)
+    {
+        Status = ObReferenceFileObjectForWrite(FileHandle,
+                                               PreviousMode,
+                                               &FileObject,
+                                               &ObjectHandleInfo);
+    }
+    else
+    {
+        Status = ObReferenceObjectByHandle(FileHandle,
+                                           FILE_READ_DATA,
+                                           IoFileObjectType,
+                                           PreviousMode,
+                                           (PVOID*)&FileObject,
+                                           NULL);
+    }
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Get the device object */
+    DeviceObject = IoGetRelatedDeviceObject(FileObject);
+
+    /*
+     * Scatter/gather is only allowed for non-cached handles, on devices which
+     * take an MDL, and for whole sectors
+     */
+    if (!(FileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) ||
+        (DeviceObject->Flags & DO_BUFFERED_IO) ||
+        ((DeviceObject->SectorSize != 0) &&
+         (Length % DeviceObject->SectorSize != 0)))
+    {
+        /* Release the file object and and fail */
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Allocate a buffer to capture the segments, one per page */
+    PageCount = BYTES_TO_PAGES(Length);
+    if (PageCount)
+    {
+        CapturedSegments = ExAllocatePoolWithTag(PagedPool,
+                                                 PageCount * sizeof(FILE_SEGMENT_ELEMENT),
+                                                 TAG_IO);
+        if (!CapturedSegments)
+        {
+            ObDereferenceObject(FileObject);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    /* Validate and capture the caller's parameters */
+    _SEH2_TRY
+    {
+        if (PreviousMode != KernelMode)
+        {
+            /* Probe the status block */
+            ProbeForWriteIoStatusBlock(IoStatusBlock);
+
+            /* Probe the segment array */
+            ProbeForRead(SegmentArray,
+                         PageCount * sizeof(FILE_SEGMENT_ELEMENT),
+                         TYPE_ALIGNMENT(FILE_SEGMENT_ELEMENT));
+
+            /* Capture and probe the byte offset and the key */
+            if (ByteOffset) CapturedByteOffset = ProbeForReadLargeInteger(ByteOffset);
+            if (Key) CapturedKey = ProbeForReadUlong(Key);
+        }
+        else
+        {
+            /* Kernel mode: capture directly */
+            if (ByteOffset) CapturedByteOffset = *ByteOffset;
+            if (Key) CapturedKey = *Key;
+        }
+
+        /* Capture the segments */
+        if (PageCount)
+        {
+            RtlCopyMemory(CapturedSegments,
+                          SegmentArray,
+                          PageCount * sizeof(FILE_SEGMENT_ELEMENT));
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        /* Release the file object and return the exception code */
+        if (CapturedSegments) ExFreePoolWithTag(CapturedSegments, TAG_IO);
+        ObDereferenceObject(FileObject);
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    /* Every segment must describe a whole, addressable page */
+    Status = STATUS_SUCCESS;
+    for (i = 0; i < PageCount; i++)
+    {
+        if ((CapturedSegments[i].Alignment & (PAGE_SIZE - 1)) ||
+            (CapturedSegments[i].Alignment != (ULONG_PTR)CapturedSegments[i].Alignment))
+        {
+            Status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+    }
+
+    /* Fail if ByteOffset is not sector size aligned */
+    if ((ByteOffset) &&
+        (DeviceObject->SectorSize != 0) &&
+        (CapturedByteOffset.QuadPart % DeviceObject->SectorSize != 0))
+    {
+        /* Unless this is a special offset for writes */
+        if (!(Write) ||
+            ((CapturedByteOffset.QuadPart != FILE_WRITE_TO_END_OF_FILE) &&
+             (CapturedByteOffset.QuadPart != FILE_USE_FILE_POINTER_POSITION ||
+              !BooleanFlagOn(FileObject->Flags, FO_SYNCHRONOUS_IO))))
+        {
+            Status = STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    if (!NT_SUCCESS(Status))
+    {
+        /* Release the file object and and fail */
+        if (CapturedSegments) ExFreePoolWithTag(CapturedSegments, TAG_IO);
+        ObDereferenceObject(FileObject);
+        return Status;
+    }
+
+    /* Check if this is an append operation */
+    if ((Write) &&
+        ((ObjectHandleInfo.GrantedAccess &
+         (FILE_APPEND_DATA | FILE_WRITE_DATA)) == FILE_APPEND_DATA))
+    {
+        /* Give the drivers something to understand */
+        CapturedByteOffset.u.LowPart = FILE_WRITE_TO_END_OF_FILE;
+        CapturedByteOffset.u.HighPart = -1;
+    }
+
+    /* Check for event */
+    if (Event)
+    {
+        /* Reference it */
+        Status = ObReferenceObjectByHandle(Event,
+                                           EVENT_MODIFY_STATE,
+                                           ExEventObjectType,
+                                           PreviousMode,
+                                           (PVOID*)&EventObject,
+                                           NULL);
+        if (!NT_SUCCESS(Status))
+        {
+            /* Fail */
+            if (CapturedSegments) ExFreePoolWithTag(CapturedSegments, TAG_IO);
+            ObDereferenceObject(FileObject);
+            return Status;
+        }
+
+        /* Otherwise reset the event */
+        KeClearEvent(EventObject);
+    }
+
+    /* Check if we should use Sync IO or not */
+    if (FileObject->Flags & FO_SYNCHRONOUS_IO)
+    {
+        /* Lock the file object */
+        Status = IopLockFileObject(FileObject, PreviousMode);
+        if (Status != STATUS_SUCCESS)
+        {
+            if (CapturedSegments) ExFreePoolWithTag(CapturedSegments, TAG_IO);
+            if (EventObject) ObDereferenceObject(EventObject);
+            ObDereferenceObject(FileObject);
+            return Status;
+        }
+
+        /* Check if we don't have a byte offset available */
+        if (!(ByteOffset) ||
+            ((CapturedByteOffset.u.LowPart == FILE_USE_FILE_POINTER_POSITION) &&
+             (CapturedByteOffset.u.HighPart == -1)))
+        {
+            /* Use the Current Byte Offset instead */
+            CapturedByteOffset = FileObject->CurrentByteOffset;
+        }
+
+        /* Remember we are sync. There is no fast I/O for scattered buffers */
+        Synchronous = TRUE;
+    }
+    else if (!ByteOffset)
+    {
+        /* Otherwise, this was async I/O without a byte offset, so fail */
+        if (CapturedSegments) ExFreePoolWithTag(CapturedSegments, TAG_IO);
+        if (EventObject) ObDereferenceObject(EventObject);
+        ObDereferenceObject(FileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Clear the File Object's event */
+    KeClearEvent(&FileObject->Event);
+
+    /* Allocate the IRP */
+    Irp = IoAllocateIrp(DeviceObject->StackSize, FALSE);
+    if (!Irp)
+    {
+        if (CapturedSegments) ExFreePoolWithTag(CapturedSegments, TAG_IO);
+        return IopCleanupFailedIrp(FileObject, EventObject, NULL);
+    }
+
+    /* Set the IRP */
+    Irp->Tail.Overlay.OriginalFileObject = FileObject;
+    Irp->Tail.Overlay.Thread = PsGetCurrentThread();
+    Irp->RequestorMode = PreviousMode;
+    Irp->Overlay.AsynchronousParameters.UserApcRoutine = ApcRoutine;
+    Irp->Overlay.AsynchronousParameters.UserApcContext = ApcContext;
+    Irp->UserIosb = IoStatusBlock;
+    Irp->UserEvent = EventObject;
+    Irp->PendingReturned = FALSE;
+    Irp->Cancel = FALSE;
+    Irp->CancelRoutine = NULL;
+    Irp->AssociatedIrp.SystemBuffer = NULL;
+    Irp->MdlAddress = NULL;
+    Irp->UserBuffer = NULL;
+
+    /* Set the Stack Data. Read and Write parameters share the same layout */
+    StackPtr = IoGetNextIrpStackLocation(Irp);
+    StackPtr->MajorFunction = Write ? IRP_MJ_WRITE : IRP_MJ_READ;
+    StackPtr->FileObject = FileObject;
+    if (Write && (FileObject->Flags & FO_WRITE_THROUGH))
+    {
+        StackPtr->Flags = SL_WRITE_THROUGH;
+    }
+    StackPtr->Parameters.Read.Key = CapturedKey;
+    StackPtr->Parameters.Read.Length = Length;
+    StackPtr->Parameters.Read.ByteOffset = CapturedByteOffset;
+
+    /*
+     * Describe all the segments with a single MDL: it covers the virtual range
+     * of the first segment, and holds the PFNs of every segment, in order.
+     * Drivers only ever see one request, completed once.
+     */
+    if (PageCount)
+    {
+        _SEH2_TRY
+        {
+            /* Allocate an MDL */
+            Mdl = IoAllocateMdl(CapturedSegments[0].Buffer,
+                                Length,
+                                FALSE,
+                                TRUE,
+                                Irp);
+            if (!Mdl)
+                ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+            MmProbeAndLockSelectedPages(Mdl,
+                                        CapturedSegments,
+                                        PreviousMode,
+                                        Write ? IoReadAccess : IoWriteAccess);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            /* Allocating failed, clean up and return the exception code */
+            ExFreePoolWithTag(CapturedSegments, TAG_IO);
+            IopCleanupAfterException(FileObject, Irp, EventObject, NULL);
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+
+        /* The PFNs are in the MDL now, we're done with the segments */
+        ExFreePoolWithTag(CapturedSegments, TAG_IO);
+    }
+
+    /* Set the deferred I/O flags */
+    Irp->Flags = (Write ? IRP_WRITE_OPERATION : IRP_READ_OPERATION) |
+                 IRP_DEFER_IO_COMPLETION;
+
+    /* The handle was opened without intermediate buffering, so bypass the cache */
+    Irp->Flags |= IRP_NOCACHE;
+
+    /* Perform the call */
+    return IopPerformSynchronousRequest(DeviceObject,
+                                        Irp,
+                                        FileObject,
+                                        TRUE,
+                                        PreviousMode,
+                                        Synchronous,
+                                        Write ? IopWriteTransfer : IopReadTransfer);
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
@@ -3002,7 +3316,7 @@ NtReadFile(IN HANDLE FileHandle,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 NTSTATUS
 NTAPI
@@ -3016,8 +3330,17 @@ NtReadFileScatter(IN HANDLE FileHandle,
                   IN PLARGE_INTEGER  ByteOffset,
                   IN PULONG Key OPTIONAL)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    /* Both directions share the same implementation */
+    return IopScatterGatherFile(FileHandle,
+                                Event,
+                                UserApcRoutine,
+                                UserApcContext,
+                                UserIoStatusBlock,
+                                BufferDescription,
+                                BufferLength,
+                                ByteOffset,
+                                Key,
+                                FALSE);
 }
 
 /*
@@ -4060,6 +4383,9 @@ NtWriteFile(IN HANDLE FileHandle,
                                         IopWriteTransfer);
 }
 
+/*
+ * @implemented
+ */
 NTSTATUS
 NTAPI
 NtWriteFileGather(IN HANDLE FileHandle,
@@ -4072,8 +4398,17 @@ NtWriteFileGather(IN HANDLE FileHandle,
                   IN PLARGE_INTEGER ByteOffset,
                   IN PULONG Key OPTIONAL)
 {
-    UNIMPLEMENTED;
-    return STATUS_NOT_IMPLEMENTED;
+    /* Both directions share the same implementation */
+    return IopScatterGatherFile(FileHandle,
+                                Event,
+                                UserApcRoutine,
+                                UserApcContext,
+                                UserIoStatusBlock,
+                                BufferDescription,
+                                BufferLength,
+                                ByteOffset,
+                                Key,
+                                TRUE);
 }
 
 /*
@@ -30,6 +30,39 @@ typedef struct _POOL_DPC_CONTEXT
     SIZE_T PoolTrackTableSizeExpansion;
 } POOL_DPC_CONTEXT, *PPOOL_DPC_CONTEXT;
 
+//
+// Per-CPU magazines sit between the PRCB lookaside lists (which only cover
+// the first NUMBER_POOL_LOOKASIDE_LISTS block sizes) and the pool descriptor,
+// and cache free blocks of every other size up to a page. They are refilled
+// from and flushed to the descriptor in batches, so that most allocations and
+// frees never touch the descriptor lock.
+//
+// Magazines only ever hold pointers to the pool headers, and live in nonpaged
+// memory, so that they can be manipulated at DISPATCH_LEVEL even for paged pool.
+//
+#define POOL_MAGAZINE_FIRST_BLOCK   (NUMBER_POOL_LOOKASIDE_LISTS + 1)
+#define POOL_MAGAZINE_COUNT         (POOL_LISTS_PER_PAGE - POOL_MAGAZINE_FIRST_BLOCK)
+#define POOL_MAGAZINE_MAX_DEPTH     8
+#define POOL_MAGAZINE_INDEX(x)      ((x) - POOL_MAGAZINE_FIRST_BLOCK)
+#define POOL_CPU_CACHE_CREATING     ((PPOOL_CPU_CACHE)1)
+
+typedef struct _POOL_MAGAZINE
+{
+    ULONG Depth;
+    PPOOL_HEADER Blocks[POOL_MAGAZINE_MAX_DEPTH];
+} POOL_MAGAZINE, *PPOOL_MAGAZINE;
+
+typedef struct _POOL_CPU_CACHE
+{
+    POOL_MAGAZINE Magazines[PagedPool + 1][POOL_MAGAZINE_COUNT];
+    ULONG AllocateHits;
+    ULONG AllocateMisses;
+    ULONG FreeHits;
+    ULONG Refills;
+    ULONG Flushes;
+    POOL_TRACKER_TABLE TagCounters[ANYSIZE_ARRAY];
+} POOL_CPU_CACHE, *PPOOL_CPU_CACHE;
+
 ULONG ExpNumberOfPagedPools;
 POOL_DESCRIPTOR NonPagedPoolDescriptor;
 PPOOL_DESCRIPTOR ExpPagedPoolDescriptor[16 + 1];
@@ -48,6 +81,8 @@ ULONG ExpPoolBigEntriesInUse;
 ULONG ExpPoolFlags;
 ULONG ExPoolFailures;
 ULONGLONG MiLastPoolDumpTime;
+PPOOL_CPU_CACHE ExpPoolCpuCache[MAXIMUM_PROCESSORS];
+BOOLEAN ExpPoolCpuCacheEnabled;
 
 /* Pool block/header/list access macros */
 #define POOL_ENTRY(x)       (PPOOL_HEADER)((ULONG_PTR)(x) - sizeof(POOL_HEADER))
@@ -462,6 +497,43 @@ ExpComputePartialHashForAddress(IN PVOID BaseAddress)
     return (Result >> 24) ^ (Result >> 16) ^ (Result >> 8) ^ Result;
 }
 
+VOID
+NTAPI
+ExpMergePoolTagCounters(IN PPOOL_TRACKER_TABLE Table,
+                        IN SIZE_T FirstEntry,
+                        IN SIZE_T EntryCount)
+{
+    ULONG Processor;
+    SIZE_T i;
+    PPOOL_CPU_CACHE Cache;
+    PPOOL_TRACKER_TABLE Counters;
+
+    //
+    // Loop every processor which has a cache, and add its counters into the
+    // caller's copy of the table. Individual processors can have more frees
+    // than allocations for a tag (when the memory was freed elsewhere), so
+    // only the sum makes sense.
+    //
+    // Note that Table[0] corresponds to the FirstEntry'th tracker entry.
+    //
+    for (Processor = 0; Processor < MAXIMUM_PROCESSORS; Processor++)
+    {
+        Cache = ExpPoolCpuCache[Processor];
+        if ((Cache == NULL) || (Cache == POOL_CPU_CACHE_CREATING)) continue;
+
+        for (i = 0; i < EntryCount; i++)
+        {
+            Counters = &Cache->TagCounters[FirstEntry + i];
+            Table[i].NonPagedAllocs += Counters->NonPagedAllocs;
+            Table[i].NonPagedFrees += Counters->NonPagedFrees;
+            Table[i].NonPagedBytes += Counters->NonPagedBytes;
+            Table[i].PagedAllocs += Counters->PagedAllocs;
+            Table[i].PagedFrees += Counters->PagedFrees;
+            Table[i].PagedBytes += Counters->PagedBytes;
+        }
+    }
+}
+
 #if DBG
 FORCEINLINE
 BOOLEAN
@@ -534,9 +606,15 @@ MiDumpPoolConsumers(BOOLEAN CalledFromDbg, ULONG Tag, ULONG Mask, ULONG Flags)
     //
     for (i = 0; i < PoolTrackTableSize; ++i)
     {
+        POOL_TRACKER_TABLE MergedEntry;
         PPOOL_TRACKER_TABLE TableEntry;
 
-        TableEntry = &PoolTrackTable[i];
+        //
+        // Work on a copy which includes the per-CPU counters for this tag
+        //
+        MergedEntry = PoolTrackTable[i];
+        ExpMergePoolTagCounters(&MergedEntry, i, 1);
+        TableEntry = &MergedEntry;
 
         //
         // We only care about tags which have allocated memory
@@ -751,6 +829,93 @@ ExpSeedHotTags(VOID)
     }
 }
 
+VOID
+NTAPI
+ExpInsertPoolTracker(IN ULONG Key,
+                     IN SIZE_T NumberOfBytes,
+                     IN POOL_TYPE PoolType);
+
+PPOOL_CPU_CACHE
+NTAPI
+ExpGetPoolCpuCache(IN BOOLEAN Create)
+{
+    ULONG Processor = KeGetCurrentProcessorNumber();
+    PPOOL_CPU_CACHE Cache;
+    SIZE_T CacheSize;
+
+    //
+    // Nothing to do until both pools are up
+    //
+    if (!ExpPoolCpuCacheEnabled) return NULL;
+
+    //
+    // Check if this processor already has a cache (or is busy building one)
+    //
+    Cache = ExpPoolCpuCache[Processor];
+    if (Cache == POOL_CPU_CACHE_CREATING) return NULL;
+    if ((Cache) || !(Create)) return Cache;
+
+    //
+    // Claim the slot, so that any pool call made while we build the cache (and
+    // other threads scheduled on this processor) simply use the global paths
+    //
+    if (InterlockedCompareExchangePointer((PVOID*)&ExpPoolCpuCache[Processor],
+                                          POOL_CPU_CACHE_CREATING,
+                                          NULL) != NULL)
+    {
+        return NULL;
+    }
+
+    //
+    // The cache holds the magazines as well as this processor's copy of the tag
+    // counters, which use the same layout (and indices) as PoolTrackTable
+    //
+    CacheSize = FIELD_OFFSET(POOL_CPU_CACHE, TagCounters) +
+                PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE);
+    Cache = MiAllocatePoolPages(NonPagedPool, CacheSize);
+    if (!Cache)
+    {
+        //
+        // We'll try again on the next call
+        //
+        InterlockedExchangePointer((PVOID*)&ExpPoolCpuCache[Processor], NULL);
+        return NULL;
+    }
+    RtlZeroMemory(Cache, CacheSize);
+
+    //
+    // Account for it like for any other big page allocation
+    //
+    InterlockedExchangeAdd((PLONG)&NonPagedPoolDescriptor.TotalBigPages,
+                           (LONG)BYTES_TO_PAGES(CacheSize));
+    ExpInsertPoolTracker('looP', ROUND_TO_PAGES(CacheSize), NonPagedPool);
+
+    //
+    // Publish it
+    //
+    InterlockedExchangePointer((PVOID*)&ExpPoolCpuCache[Processor], Cache);
+    return Cache;
+}
+
+FORCEINLINE
+PPOOL_TRACKER_TABLE
+ExpGetPoolTagCounters(IN PPOOL_TRACKER_TABLE Table,
+                      IN ULONG Hash)
+{
+    PPOOL_CPU_CACHE Cache;
+
+    //
+    // Keys always live in the global table, but the counters are kept per-CPU
+    // whenever the current processor has a cache, so that hot tags don't keep
+    // bouncing the same cache line between processors. They are merged back
+    // together in ExGetPoolTagInfo. We might get rescheduled on another CPU
+    // after this, which is harmless since the updates are still interlocked.
+    //
+    Cache = ExpGetPoolCpuCache(FALSE);
+    if ((Cache) && (Table == PoolTrackTable)) return &Cache->TagCounters[Hash];
+    return &Table[Hash];
+}
+
 VOID
 NTAPI
 ExpRemovePoolTracker(IN ULONG Key,
@@ -758,7 +923,7 @@ ExpRemovePoolTracker(IN ULONG Key,
                      IN POOL_TYPE PoolType)
 {
     ULONG Hash, Index;
-    PPOOL_TRACKER_TABLE Table, TableEntry;
+    PPOOL_TRACKER_TABLE Table, TableEntry, Counters;
     SIZE_T TableMask, TableSize;
 
     //
@@ -802,15 +967,16 @@ ExpRemovePoolTracker(IN ULONG Key,
             // Decrement the counters depending on if this was paged or nonpaged
             // pool
             //
+            Counters = ExpGetPoolTagCounters(Table, Hash);
             if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
             {
-                InterlockedIncrement(&TableEntry->NonPagedFrees);
-                InterlockedExchangeAddSizeT(&TableEntry->NonPagedBytes,
+                InterlockedIncrement(&Counters->NonPagedFrees);
+                InterlockedExchangeAddSizeT(&Counters->NonPagedBytes,
                                             -(SSIZE_T)NumberOfBytes);
                 return;
             }
-            InterlockedIncrement(&TableEntry->PagedFrees);
-            InterlockedExchangeAddSizeT(&TableEntry->PagedBytes,
+            InterlockedIncrement(&Counters->PagedFrees);
+            InterlockedExchangeAddSizeT(&Counters->PagedBytes,
                                         -(SSIZE_T)NumberOfBytes);
             return;
         }
@@ -850,7 +1016,7 @@ ExpInsertPoolTracker(IN ULONG Key,
 {
     ULONG Hash, Index;
     KIRQL OldIrql;
-    PPOOL_TRACKER_TABLE Table, TableEntry;
+    PPOOL_TRACKER_TABLE Table, TableEntry, Counters;
     SIZE_T TableMask, TableSize;
 
     //
@@ -873,7 +1039,6 @@ ExpInsertPoolTracker(IN ULONG Key,
     // ASSERT on ReactOS features not yet supported
     //
     ASSERT(!(PoolType & SESSION_POOL_MASK));
-    ASSERT(KeGetCurrentProcessorNumber() == 0);
 
     //
     // Why the double indirection? Because normally this function is also used
@@ -905,14 +1070,15 @@ ExpInsertPoolTracker(IN ULONG Key,
             // Increment the counters depending on if this was paged or nonpaged
             // pool
             //
+            Counters = ExpGetPoolTagCounters(Table, Hash);
             if ((PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
             {
-                InterlockedIncrement(&TableEntry->NonPagedAllocs);
-                InterlockedExchangeAddSizeT(&TableEntry->NonPagedBytes, NumberOfBytes);
+                InterlockedIncrement(&Counters->NonPagedAllocs);
+                InterlockedExchangeAddSizeT(&Counters->NonPagedBytes, NumberOfBytes);
                 return;
             }
-            InterlockedIncrement(&TableEntry->PagedAllocs);
-            InterlockedExchangeAddSizeT(&TableEntry->PagedBytes, NumberOfBytes);
+            InterlockedIncrement(&Counters->PagedAllocs);
+            InterlockedExchangeAddSizeT(&Counters->PagedBytes, NumberOfBytes);
             return;
         }
 
@@ -1262,6 +1428,11 @@ InitializePool(IN POOL_TYPE PoolType,
         ExpInsertPoolTracker('looP',
                              ROUND_TO_PAGES(PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE)),
                              NonPagedPool);
+
+        //
+        // Both pools are ready, so processors can now build their caches
+        //
+        ExpPoolCpuCacheEnabled = TRUE;
     }
 }
 
@@ -1279,38 +1450,618 @@ ExLockPool(IN PPOOL_DESCRIPTOR Descriptor)
         //
         return KeAcquireQueuedSpinLock(LockQueueNonPagedPoolLock);
     }
-    else
+    else
+    {
+        //
+        // Use the guarded mutex
+        //
+        KeAcquireGuardedMutex(Descriptor->LockAddress);
+        return APC_LEVEL;
+    }
+}
+
+FORCEINLINE
+VOID
+ExUnlockPool(IN PPOOL_DESCRIPTOR Descriptor,
+             IN KIRQL OldIrql)
+{
+    //
+    // Check if this is nonpaged pool
+    //
+    if ((Descriptor->PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
+    {
+        //
+        // Use the queued spin lock
+        //
+        KeReleaseQueuedSpinLock(LockQueueNonPagedPoolLock, OldIrql);
+    }
+    else
+    {
+        //
+        // Use the guarded mutex
+        //
+        KeReleaseGuardedMutex(Descriptor->LockAddress);
+    }
+}
+
+PPOOL_HEADER
+NTAPI
+ExpSplitPoolBlock(IN PPOOL_DESCRIPTOR PoolDesc,
+                  IN PPOOL_HEADER Entry,
+                  IN USHORT NeededSize)
+{
+    PPOOL_HEADER NextEntry, FragmentEntry;
+    USHORT BlockSize;
+
+    //
+    // The caller must own the pool lock, and the block must have just been
+    // removed from one of the descriptor's free lists
+    //
+    ASSERT(Entry->BlockSize >= NeededSize);
+    ASSERT(Entry->PoolType == 0);
+
+    //
+    // Check if this block is larger that what we need. The block could
+    // not possibly be smaller, due to the way we insert free blocks into
+    // multiple lists (and we would've asserted on a checked build if this
+    // was the case).
+    //
+    if (Entry->BlockSize != NeededSize)
+    {
+        //
+        // Is there an entry before this one?
+        //
+        if (Entry->PreviousSize == 0)
+        {
+            //
+            // There isn't anyone before us, so take the next block and
+            // turn it into a fragment that contains the leftover data
+            // that we don't need to satisfy the caller's request
+            //
+            FragmentEntry = POOL_BLOCK(Entry, NeededSize);
+            FragmentEntry->BlockSize = Entry->BlockSize - NeededSize;
+
+            //
+            // And make it point back to us
+            //
+            FragmentEntry->PreviousSize = NeededSize;
+
+            //
+            // Now get the block that follows the new fragment and check
+            // if it's still on the same page as us (and not at the end)
+            //
+            NextEntry = POOL_NEXT_BLOCK(FragmentEntry);
+            if (PAGE_ALIGN(NextEntry) != NextEntry)
+            {
+                //
+                // Adjust this next block to point to our newly created
+                // fragment block
+                //
+                NextEntry->PreviousSize = FragmentEntry->BlockSize;
+            }
+        }
+        else
+        {
+            //
+            // There is a free entry before us, which we know is smaller
+            // so we'll make this entry the fragment instead
+            //
+            FragmentEntry = Entry;
+
+            //
+            // And then we'll remove from it the actual size required.
+            // Now the entry is a leftover free fragment
+            //
+            Entry->BlockSize -= NeededSize;
+
+            //
+            // Now let's go to the next entry after the fragment (which
+            // used to point to our original free entry) and make it
+            // reference the new fragment entry instead.
+            //
+            // This is the entry that will actually end up holding the
+            // allocation!
+            //
+            Entry = POOL_NEXT_BLOCK(Entry);
+            Entry->PreviousSize = FragmentEntry->BlockSize;
+
+            //
+            // And now let's go to the entry after that one and check if
+            // it's still on the same page, and not at the end
+            //
+            NextEntry = POOL_BLOCK(Entry, NeededSize);
+            if (PAGE_ALIGN(NextEntry) != NextEntry)
+            {
+                //
+                // Make it reference the allocation entry
+                //
+                NextEntry->PreviousSize = NeededSize;
+            }
+        }
+
+        //
+        // Now our (allocation) entry is the right size
+        //
+        Entry->BlockSize = NeededSize;
+
+        //
+        // And the next entry is now the free fragment which contains
+        // the remaining difference between how big the original entry
+        // was, and the actual size the caller needs/requested.
+        //
+        FragmentEntry->PoolType = 0;
+        BlockSize = FragmentEntry->BlockSize;
+
+        //
+        // Now check if enough free bytes remained for us to have a
+        // "full" entry, which contains enough bytes for a linked list
+        // and thus can be used for allocations (up to 8 bytes...)
+        //
+        ExpCheckPoolLinks(&PoolDesc->ListHeads[BlockSize - 1]);
+        if (BlockSize != 1)
+        {
+            //
+            // Insert the free entry into the free list for this size
+            //
+            ExpInsertPoolTailList(&PoolDesc->ListHeads[BlockSize - 1],
+                                  POOL_FREE_BLOCK(FragmentEntry));
+            ExpCheckPoolLinks(POOL_FREE_BLOCK(FragmentEntry));
+        }
+    }
+
+    //
+    // Return the entry that now holds the allocation
+    //
+    return Entry;
+}
+
+PVOID
+NTAPI
+ExpReturnPoolBlock(IN PPOOL_DESCRIPTOR PoolDesc,
+                   IN PPOOL_HEADER Entry)
+{
+    PPOOL_HEADER NextEntry;
+    USHORT BlockSize;
+    BOOLEAN Combined = FALSE;
+
+    //
+    // The caller must own the pool lock. We'll combine the block with its free
+    // neighbours and put it back on the descriptor's free lists, unless this
+    // made up a whole free page, which we return so the caller can release it.
+    //
+
+    //
+    // Check if the next allocation is at the end of the page
+    //
+    ExpCheckPoolBlocks(Entry);
+    NextEntry = POOL_NEXT_BLOCK(Entry);
+    if (PAGE_ALIGN(NextEntry) != NextEntry)
+    {
+        //
+        // We may be able to combine the block if it's free
+        //
+        if (NextEntry->PoolType == 0)
+        {
+            //
+            // The next block is free, so we'll do a combine
+            //
+            Combined = TRUE;
+
+            //
+            // Make sure there's actual data in the block -- anything smaller
+            // than this means we only have the header, so there's no linked list
+            // for us to remove
+            //
+            if ((NextEntry->BlockSize != 1))
+            {
+                //
+                // The block is at least big enough to have a linked list, so go
+                // ahead and remove it
+                //
+                ExpCheckPoolLinks(POOL_FREE_BLOCK(NextEntry));
+                ExpRemovePoolEntryList(POOL_FREE_BLOCK(NextEntry));
+                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Flink));
+                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Blink));
+            }
+
+            //
+            // Our entry is now combined with the next entry
+            //
+            Entry->BlockSize = Entry->BlockSize + NextEntry->BlockSize;
+        }
+    }
+
+    //
+    // Now check if there was a previous entry on the same page as us
+    //
+    if (Entry->PreviousSize)
+    {
+        //
+        // Great, grab that entry and check if it's free
+        //
+        NextEntry = POOL_PREV_BLOCK(Entry);
+        if (NextEntry->PoolType == 0)
+        {
+            //
+            // It is, so we can do a combine
+            //
+            Combined = TRUE;
+
+            //
+            // Make sure there's actual data in the block -- anything smaller
+            // than this means we only have the header so there's no linked list
+            // for us to remove
+            //
+            if ((NextEntry->BlockSize != 1))
+            {
+                //
+                // The block is at least big enough to have a linked list, so go
+                // ahead and remove it
+                //
+                ExpCheckPoolLinks(POOL_FREE_BLOCK(NextEntry));
+                ExpRemovePoolEntryList(POOL_FREE_BLOCK(NextEntry));
+                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Flink));
+                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Blink));
+            }
+
+            //
+            // Combine our original block (which might've already been combined
+            // with the next block), into the previous block
+            //
+            NextEntry->BlockSize = NextEntry->BlockSize + Entry->BlockSize;
+
+            //
+            // And now we'll work with the previous block instead
+            //
+            Entry = NextEntry;
+        }
+    }
+
+    //
+    // By now, it may have been possible for our combined blocks to actually
+    // have made up a full page (if there were only 2-3 allocations on the
+    // page, they could've all been combined).
+    //
+    if ((PAGE_ALIGN(Entry) == Entry) &&
+        (PAGE_ALIGN(POOL_NEXT_BLOCK(Entry)) == POOL_NEXT_BLOCK(Entry)))
+    {
+        //
+        // In this case, let the caller free the page once it has released the
+        // pool lock
+        //
+        return Entry;
+    }
+
+    //
+    // Otherwise, we now have a free block (or a combination of 2 or 3)
+    //
+    Entry->PoolType = 0;
+    BlockSize = Entry->BlockSize;
+    ASSERT(BlockSize != 1);
+
+    //
+    // Check if we actually did combine it with anyone
+    //
+    if (Combined)
+    {
+        //
+        // Get the first combined block (either our original to begin with, or
+        // the one after the original, depending if we combined with the previous)
+        //
+        NextEntry = POOL_NEXT_BLOCK(Entry);
+
+        //
+        // As long as the next block isn't on a page boundary, have it point
+        // back to us
+        //
+        if (PAGE_ALIGN(NextEntry) != NextEntry) NextEntry->PreviousSize = BlockSize;
+    }
+
+    //
+    // Insert this new free block
+    //
+    ExpInsertPoolHeadList(&PoolDesc->ListHeads[BlockSize - 1], POOL_FREE_BLOCK(Entry));
+    ExpCheckPoolLinks(POOL_FREE_BLOCK(Entry));
+    return NULL;
+}
+
+FORCEINLINE
+ULONG
+ExpPoolMagazineDepth(IN USHORT BlockSize)
+{
+    //
+    // Bound each magazine to about a page worth of blocks, but always cache at
+    // least two of them so that refills and flushes still come in batches
+    //
+    return max(2, min(POOL_MAGAZINE_MAX_DEPTH, POOL_LISTS_PER_PAGE / BlockSize));
+}
+
+VOID
+NTAPI
+ExpFlushPoolBlocks(IN PPOOL_DESCRIPTOR PoolDesc,
+                   IN PPOOL_HEADER *Blocks,
+                   IN ULONG Count)
+{
+    PVOID FreePages[POOL_MAGAZINE_MAX_DEPTH];
+    ULONG i, PageCount = 0;
+    SIZE_T NumberOfBytes = 0;
+    KIRQL OldIrql;
+    ASSERT(Count <= POOL_MAGAZINE_MAX_DEPTH);
+
+    //
+    // Update performance counters for the whole batch
+    //
+    for (i = 0; i < Count; i++) NumberOfBytes += Blocks[i]->BlockSize * POOL_BLOCK_SIZE;
+    InterlockedExchangeAdd((PLONG)&PoolDesc->RunningDeAllocs, Count);
+    InterlockedExchangeAddSizeT(&PoolDesc->TotalBytes, -(SSIZE_T)NumberOfBytes);
+
+    //
+    // Give all the blocks back to the descriptor with a single lock acquisition,
+    // and remember which pages became entirely free
+    //
+    OldIrql = ExLockPool(PoolDesc);
+    for (i = 0; i < Count; i++)
+    {
+        FreePages[PageCount] = ExpReturnPoolBlock(PoolDesc, Blocks[i]);
+        if (FreePages[PageCount]) PageCount++;
+    }
+    ExUnlockPool(PoolDesc, OldIrql);
+
+    //
+    // Now that the lock is released, free these pages
+    //
+    for (i = 0; i < PageCount; i++)
+    {
+        InterlockedExchangeAdd((PLONG)&PoolDesc->TotalPages, -1);
+        MiFreePoolPages(FreePages[i]);
+    }
+}
+
+BOOLEAN
+NTAPI
+ExpPushPoolMagazine(IN POOL_TYPE PoolType,
+                    IN PPOOL_HEADER Entry,
+                    OUT PPOOL_HEADER *FlushBlocks,
+                    OUT PULONG FlushCount)
+{
+    PPOOL_CPU_CACHE Cache;
+    PPOOL_MAGAZINE Magazine;
+    ULONG Depth, i;
+    KIRQL OldIrql;
+
+    //
+    // Magazines are only ever touched at DISPATCH_LEVEL on their own processor
+    //
+    *FlushCount = 0;
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    Cache = ExpGetPoolCpuCache(TRUE);
+    if (!Cache)
+    {
+        KeLowerIrql(OldIrql);
+        return FALSE;
+    }
+
+    //
+    // If the magazine is full, take out its oldest half so that the caller can
+    // flush it back to the descriptor, and keep the most recently used blocks
+    //
+    Magazine = &Cache->Magazines[PoolType][POOL_MAGAZINE_INDEX(Entry->BlockSize)];
+    Depth = ExpPoolMagazineDepth(Entry->BlockSize);
+    if (Magazine->Depth == Depth)
+    {
+        *FlushCount = Depth / 2;
+        for (i = 0; i < *FlushCount; i++) FlushBlocks[i] = Magazine->Blocks[i];
+        RtlMoveMemory(&Magazine->Blocks[0],
+                      &Magazine->Blocks[*FlushCount],
+                      (Depth - *FlushCount) * sizeof(PPOOL_HEADER));
+        Magazine->Depth -= *FlushCount;
+        Cache->Flushes++;
+    }
+
+    //
+    // Cache the block
+    //
+    Magazine->Blocks[Magazine->Depth++] = Entry;
+    Cache->FreeHits++;
+    KeLowerIrql(OldIrql);
+    return TRUE;
+}
+
+PPOOL_HEADER
+NTAPI
+ExpRefillPoolMagazine(IN PPOOL_DESCRIPTOR PoolDesc,
+                      IN POOL_TYPE PoolType,
+                      IN USHORT BlockSize)
+{
+    PPOOL_HEADER Blocks[POOL_MAGAZINE_MAX_DEPTH], Entry;
+    PPOOL_CPU_CACHE Cache;
+    PPOOL_MAGAZINE Magazine;
+    PLIST_ENTRY ListHead;
+    ULONG Count = 0, Wanted, Depth, i;
+    KIRQL OldIrql;
+
+    //
+    // We want one block for the caller, plus half a magazine
+    //
+    Depth = ExpPoolMagazineDepth(BlockSize);
+    Wanted = Depth / 2 + 1;
+
+    //
+    // Carve all of them out of the descriptor's free lists under a single lock
+    // acquisition, the same way ExAllocatePoolWithTag does. If there isn't
+    // enough free memory, we'll just return what we got, and the caller will
+    // go and allocate a fresh page.
+    //
+    OldIrql = ExLockPool(PoolDesc);
+    ListHead = &PoolDesc->ListHeads[BlockSize];
+    while ((Count < Wanted) && (ListHead != &PoolDesc->ListHeads[POOL_LISTS_PER_PAGE]))
+    {
+        if (ExpIsPoolListEmpty(ListHead))
+        {
+            ListHead++;
+            continue;
+        }
+
+        ExpCheckPoolLinks(ListHead);
+        Entry = POOL_ENTRY(ExpRemovePoolHeadList(ListHead));
+        ExpCheckPoolLinks(ListHead);
+        ExpCheckPoolBlocks(Entry);
+        Entry = ExpSplitPoolBlock(PoolDesc, Entry, BlockSize);
+
+        //
+        // Mark it as allocated so that it won't get combined with its neighbours
+        // while it sits in the magazine
+        //
+        Entry->PoolType = PoolType + 1;
+        ExpCheckPoolBlocks(Entry);
+        Blocks[Count++] = Entry;
+    }
+    ExUnlockPool(PoolDesc, OldIrql);
+    if (!Count) return NULL;
+
+    //
+    // As far as the descriptor is concerned, these are all allocated now
+    //
+    InterlockedExchangeAddSizeT(&PoolDesc->TotalBytes, Count * BlockSize * POOL_BLOCK_SIZE);
+    InterlockedExchangeAdd((PLONG)&PoolDesc->RunningAllocs, Count);
+
+    //
+    // Stock the magazine of whatever processor we're running on now with all
+    // but the first block, and flush back anything that doesn't fit anymore
+    //
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    Cache = ExpGetPoolCpuCache(TRUE);
+    i = 1;
+    if (Cache)
+    {
+        Magazine = &Cache->Magazines[PoolType][POOL_MAGAZINE_INDEX(BlockSize)];
+        while ((i < Count) && (Magazine->Depth < Depth))
+        {
+            Magazine->Blocks[Magazine->Depth++] = Blocks[i++];
+        }
+        Cache->Refills++;
+    }
+    KeLowerIrql(OldIrql);
+    if (i < Count) ExpFlushPoolBlocks(PoolDesc, &Blocks[i], Count - i);
+
+    //
+    // And return the first block to the caller
+    //
+    return Blocks[0];
+}
+
+ULONG
+NTAPI
+ExpDrainPoolMagazines(IN POOL_TYPE PoolType)
+{
+    PPOOL_HEADER Blocks[POOL_MAGAZINE_MAX_DEPTH];
+    PPOOL_CPU_CACHE Cache;
+    PPOOL_MAGAZINE Magazine;
+    ULONG Processor, Index, Count, Drained = 0;
+    BOOLEAN AllProcessors;
+    KAFFINITY PreviousAffinity = 0;
+    PKTHREAD Thread = KeGetCurrentThread();
+    KIRQL OldIrql;
+
+    if (!ExpPoolCpuCacheEnabled) return 0;
+
+    //
+    // A magazine can only be touched from its own processor, so we have to go
+    // and run on each of them in turn. Callers at DISPATCH_LEVEL can't do that,
+    // and only get back what the current processor has cached. These can only
+    // be nonpaged pool callers, whose descriptor lock works at DISPATCH_LEVEL.
+    //
+    AllProcessors = (KeGetCurrentIrql() < DISPATCH_LEVEL);
+
+    //
+    // The caller may have pinned itself to some processors already, remember
+    // that so that it doesn't come back from a failed allocation running anywhere
+    //
+    if (AllProcessors && Thread->SystemAffinityActive) PreviousAffinity = Thread->Affinity;
+
+    for (Processor = 0; Processor < (ULONG)KeNumberProcessors; Processor++)
+    {
+        if (AllProcessors) KeSetSystemAffinityThread(AFFINITY_MASK(Processor));
+
+        //
+        // Empty one magazine at a time, and flush it with the IRQL lowered again,
+        // since the paged pool descriptor lock is a guarded mutex
+        //
+        for (Index = 0; Index < POOL_MAGAZINE_COUNT; Index++)
+        {
+            KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+            Cache = ExpGetPoolCpuCache(FALSE);
+            Count = 0;
+            if (Cache)
+            {
+                Magazine = &Cache->Magazines[PoolType][Index];
+                Count = Magazine->Depth;
+                RtlCopyMemory(Blocks, Magazine->Blocks, Count * sizeof(PPOOL_HEADER));
+                Magazine->Depth = 0;
+            }
+            KeLowerIrql(OldIrql);
+
+            if (!Cache) break;
+            if (Count)
+            {
+                ExpFlushPoolBlocks(PoolVector[PoolType], Blocks, Count);
+                Drained += Count;
+            }
+        }
+
+        if (!AllProcessors) break;
+    }
+    if (AllProcessors)
     {
-        //
-        // Use the guarded mutex
-        //
-        KeAcquireGuardedMutex(Descriptor->LockAddress);
-        return APC_LEVEL;
+        if (PreviousAffinity)
+            KeSetSystemAffinityThread(PreviousAffinity);
+        else
+            KeRevertToUserAffinityThread();
     }
+
+    return Drained;
 }
 
-FORCEINLINE
-VOID
-ExUnlockPool(IN PPOOL_DESCRIPTOR Descriptor,
-             IN KIRQL OldIrql)
+PPOOL_HEADER
+NTAPI
+ExpPopPoolMagazine(IN PPOOL_DESCRIPTOR PoolDesc,
+                   IN POOL_TYPE PoolType,
+                   IN USHORT BlockSize)
 {
+    PPOOL_CPU_CACHE Cache;
+    PPOOL_MAGAZINE Magazine;
+    PPOOL_HEADER Entry;
+    KIRQL OldIrql;
+
     //
-    // Check if this is nonpaged pool
+    // Magazines are only ever touched at DISPATCH_LEVEL on their own processor
     //
-    if ((Descriptor->PoolType & BASE_POOL_TYPE_MASK) == NonPagedPool)
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+    Cache = ExpGetPoolCpuCache(TRUE);
+    if (!Cache)
     {
-        //
-        // Use the queued spin lock
-        //
-        KeReleaseQueuedSpinLock(LockQueueNonPagedPoolLock, OldIrql);
+        KeLowerIrql(OldIrql);
+        return NULL;
     }
-    else
+
+    //
+    // Grab the most recently freed block, if we have one
+    //
+    Magazine = &Cache->Magazines[PoolType][POOL_MAGAZINE_INDEX(BlockSize)];
+    if (Magazine->Depth)
     {
-        //
-        // Use the guarded mutex
-        //
-        KeReleaseGuardedMutex(Descriptor->LockAddress);
+        Entry = Magazine->Blocks[--Magazine->Depth];
+        Cache->AllocateHits++;
+        KeLowerIrql(OldIrql);
+        return Entry;
     }
+
+    //
+    // The magazine is empty, so go refill it from the descriptor
+    //
+    Cache->AllocateMisses++;
+    KeLowerIrql(OldIrql);
+    return ExpRefillPoolMagazine(PoolDesc, PoolType, BlockSize);
 }
 
 VOID
@@ -1333,6 +2084,13 @@ ExpGetPoolTagInfoTarget(IN PKDPC Dpc,
                       PoolTrackTable,
                       Context->PoolTrackTableSize * sizeof(POOL_TRACKER_TABLE));
 
+        //
+        // And fold in the counters that each processor kept on its own
+        //
+        ExpMergePoolTagCounters(Context->PoolTrackTable,
+                                0,
+                                Context->PoolTrackTableSize);
+
         //
         // This is here because ReactOS does not yet support expansion
         //
@@ -1861,7 +2619,7 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
 {
     PPOOL_DESCRIPTOR PoolDesc;
     PLIST_ENTRY ListHead;
-    PPOOL_HEADER Entry, NextEntry, FragmentEntry;
+    PPOOL_HEADER Entry, FragmentEntry;
     KIRQL OldIrql;
     USHORT BlockSize, i;
     ULONG OriginalType;
@@ -1931,6 +2689,16 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
         // Allocate pages for it
         //
         Entry = MiAllocatePoolPages(OriginalType, NumberOfBytes);
+
+        //
+        // Blocks cached in the per-CPU magazines may make up whole free pages,
+        // so give them back and try once more before we fail
+        //
+        if (!(Entry) && (ExpDrainPoolMagazines(PoolType)))
+        {
+            Entry = MiAllocatePoolPages(OriginalType, NumberOfBytes);
+        }
+
         if (!Entry)
         {
 #if DBG
@@ -2085,6 +2853,33 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
         }
     }
 
+    //
+    // Bigger blocks come from the per-CPU magazines instead
+    //
+    if ((i >= POOL_MAGAZINE_FIRST_BLOCK) && (ExpPoolCpuCacheEnabled))
+    {
+        Entry = ExpPopPoolMagazine(PoolDesc, PoolType, i);
+        if (Entry)
+        {
+            //
+            // Write down its pool type, and track it
+            //
+            ASSERT(Entry->BlockSize == i);
+            Entry->PoolType = OriginalType + 1;
+            ExpInsertPoolTracker(Tag,
+                                 Entry->BlockSize * POOL_BLOCK_SIZE,
+                                 OriginalType);
+
+            //
+            // Return the pool allocation
+            //
+            Entry->PoolTag = Tag;
+            (POOL_FREE_BLOCK(Entry))->Flink = NULL;
+            (POOL_FREE_BLOCK(Entry))->Blink = NULL;
+            return POOL_FREE_BLOCK(Entry);
+        }
+    }
+
     //
     // Loop in the free lists looking for a block if this size. Start with the
     // list optimized for this kind of size lookup
@@ -2131,112 +2926,9 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
             ASSERT(Entry->PoolType == 0);
 
             //
-            // Check if this block is larger that what we need. The block could
-            // not possibly be smaller, due to the reason explained above (and
-            // we would've asserted on a checked build if this was the case).
+            // Carve out the part of the block that we need
             //
-            if (Entry->BlockSize != i)
-            {
-                //
-                // Is there an entry before this one?
-                //
-                if (Entry->PreviousSize == 0)
-                {
-                    //
-                    // There isn't anyone before us, so take the next block and
-                    // turn it into a fragment that contains the leftover data
-                    // that we don't need to satisfy the caller's request
-                    //
-                    FragmentEntry = POOL_BLOCK(Entry, i);
-                    FragmentEntry->BlockSize = Entry->BlockSize - i;
-
-                    //
-                    // And make it point back to us
-                    //
-                    FragmentEntry->PreviousSize = i;
-
-                    //
-                    // Now get the block that follows the new fragment and check
-                    // if it's still on the same page as us (and not at the end)
-                    //
-                    NextEntry = POOL_NEXT_BLOCK(FragmentEntry);
-                    if (PAGE_ALIGN(NextEntry) != NextEntry)
-                    {
-                        //
-                        // Adjust this next block to point to our newly created
-                        // fragment block
-                        //
-                        NextEntry->PreviousSize = FragmentEntry->BlockSize;
-                    }
-                }
-                else
-                {
-                    //
-                    // There is a free entry before us, which we know is smaller
-                    // so we'll make this entry the fragment instead
-                    //
-                    FragmentEntry = Entry;
-
-                    //
-                    // And then we'll remove from it the actual size required.
-                    // Now the entry is a leftover free fragment
-                    //
-                    Entry->BlockSize -= i;
-
-                    //
-                    // Now let's go to the next entry after the fragment (which
-                    // used to point to our original free entry) and make it
-                    // reference the new fragment entry instead.
-                    //
-                    // This is the entry that will actually end up holding the
-                    // allocation!
-                    //
-                    Entry = POOL_NEXT_BLOCK(Entry);
-                    Entry->PreviousSize = FragmentEntry->BlockSize;
-
-                    //
-                    // And now let's go to the entry after that one and check if
-                    // it's still on the same page, and not at the end
-                    //
-                    NextEntry = POOL_BLOCK(Entry, i);
-                    if (PAGE_ALIGN(NextEntry) != NextEntry)
-                    {
-                        //
-                        // Make it reference the allocation entry
-                        //
-                        NextEntry->PreviousSize = i;
-                    }
-                }
-
-                //
-                // Now our (allocation) entry is the right size
-                //
-                Entry->BlockSize = i;
-
-                //
-                // And the next entry is now the free fragment which contains
-                // the remaining difference between how big the original entry
-                // was, and the actual size the caller needs/requested.
-                //
-                FragmentEntry->PoolType = 0;
-                BlockSize = FragmentEntry->BlockSize;
-
-                //
-                // Now check if enough free bytes remained for us to have a
-                // "full" entry, which contains enough bytes for a linked list
-                // and thus can be used for allocations (up to 8 bytes...)
-                //
-                ExpCheckPoolLinks(&PoolDesc->ListHeads[BlockSize - 1]);
-                if (BlockSize != 1)
-                {
-                    //
-                    // Insert the free entry into the free list for this size
-                    //
-                    ExpInsertPoolTailList(&PoolDesc->ListHeads[BlockSize - 1],
-                                          POOL_FREE_BLOCK(FragmentEntry));
-                    ExpCheckPoolLinks(POOL_FREE_BLOCK(FragmentEntry));
-                }
-            }
+            Entry = ExpSplitPoolBlock(PoolDesc, Entry, i);
 
             //
             // We have found an entry for this allocation, so set the pool type
@@ -2273,6 +2965,15 @@ ExAllocatePoolWithTag(IN POOL_TYPE PoolType,
     // There were no free entries left, so we have to allocate a new fresh page
     //
     Entry = MiAllocatePoolPages(OriginalType, PAGE_SIZE);
+
+    //
+    // Same as above, the magazines may be holding on to whole pages
+    //
+    if (!(Entry) && (ExpDrainPoolMagazines(PoolType)))
+    {
+        Entry = MiAllocatePoolPages(OriginalType, PAGE_SIZE);
+    }
+
     if (!Entry)
     {
 #if DBG
@@ -2448,13 +3149,15 @@ NTAPI
 ExFreePoolWithTag(IN PVOID P,
                   IN ULONG TagToFree)
 {
-    PPOOL_HEADER Entry, NextEntry;
+    PPOOL_HEADER Entry;
     USHORT BlockSize;
     KIRQL OldIrql;
     POOL_TYPE PoolType;
     PPOOL_DESCRIPTOR PoolDesc;
     ULONG Tag;
-    BOOLEAN Combined = FALSE;
+    PVOID FreePage;
+    PPOOL_HEADER FlushBlocks[POOL_MAGAZINE_MAX_DEPTH];
+    ULONG FlushCount;
     PFN_NUMBER PageCount, RealPageCount;
     PKPRCB Prcb = KeGetCurrentPrcb();
     PGENERAL_LOOKASIDE LookasideList;
@@ -2712,9 +3415,17 @@ ExFreePoolWithTag(IN PVOID P,
     }
 
     //
-    // Get the pointer to the next entry
+    // Bigger blocks go to the per-CPU magazines, which might hand us back a
+    // batch of older blocks to return to the descriptor
     //
-    NextEntry = POOL_BLOCK(Entry, BlockSize);
+    if ((BlockSize >= POOL_MAGAZINE_FIRST_BLOCK) && (ExpPoolCpuCacheEnabled))
+    {
+        if (ExpPushPoolMagazine(PoolType, Entry, FlushBlocks, &FlushCount))
+        {
+            if (FlushCount) ExpFlushPoolBlocks(PoolDesc, FlushBlocks, FlushCount);
+            return;
+        }
+    }
 
     //
     // Update performance counters
@@ -2723,145 +3434,20 @@ ExFreePoolWithTag(IN PVOID P,
     InterlockedExchangeAddSizeT(&PoolDesc->TotalBytes, -BlockSize * POOL_BLOCK_SIZE);
 
     //
-    // Acquire the pool lock
+    // Acquire the pool lock and give the block back to the descriptor
     //
     OldIrql = ExLockPool(PoolDesc);
+    FreePage = ExpReturnPoolBlock(PoolDesc, Entry);
+    ExUnlockPool(PoolDesc, OldIrql);
 
     //
-    // Check if the next allocation is at the end of the page
-    //
-    ExpCheckPoolBlocks(Entry);
-    if (PAGE_ALIGN(NextEntry) != NextEntry)
-    {
-        //
-        // We may be able to combine the block if it's free
-        //
-        if (NextEntry->PoolType == 0)
-        {
-            //
-            // The next block is free, so we'll do a combine
-            //
-            Combined = TRUE;
-
-            //
-            // Make sure there's actual data in the block -- anything smaller
-            // than this means we only have the header, so there's no linked list
-            // for us to remove
-            //
-            if ((NextEntry->BlockSize != 1))
-            {
-                //
-                // The block is at least big enough to have a linked list, so go
-                // ahead and remove it
-                //
-                ExpCheckPoolLinks(POOL_FREE_BLOCK(NextEntry));
-                ExpRemovePoolEntryList(POOL_FREE_BLOCK(NextEntry));
-                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Flink));
-                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Blink));
-            }
-
-            //
-            // Our entry is now combined with the next entry
-            //
-            Entry->BlockSize = Entry->BlockSize + NextEntry->BlockSize;
-        }
-    }
-
-    //
-    // Now check if there was a previous entry on the same page as us
-    //
-    if (Entry->PreviousSize)
-    {
-        //
-        // Great, grab that entry and check if it's free
-        //
-        NextEntry = POOL_PREV_BLOCK(Entry);
-        if (NextEntry->PoolType == 0)
-        {
-            //
-            // It is, so we can do a combine
-            //
-            Combined = TRUE;
-
-            //
-            // Make sure there's actual data in the block -- anything smaller
-            // than this means we only have the header so there's no linked list
-            // for us to remove
-            //
-            if ((NextEntry->BlockSize != 1))
-            {
-                //
-                // The block is at least big enough to have a linked list, so go
-                // ahead and remove it
-                //
-                ExpCheckPoolLinks(POOL_FREE_BLOCK(NextEntry));
-                ExpRemovePoolEntryList(POOL_FREE_BLOCK(NextEntry));
-                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Flink));
-                ExpCheckPoolLinks(ExpDecodePoolLink((POOL_FREE_BLOCK(NextEntry))->Blink));
-            }
-
-            //
-            // Combine our original block (which might've already been combined
-            // with the next block), into the previous block
-            //
-            NextEntry->BlockSize = NextEntry->BlockSize + Entry->BlockSize;
-
-            //
-            // And now we'll work with the previous block instead
-            //
-            Entry = NextEntry;
-        }
-    }
-
-    //
-    // By now, it may have been possible for our combined blocks to actually
-    // have made up a full page (if there were only 2-3 allocations on the
-    // page, they could've all been combined).
+    // If this freed up a whole page, update the performance counter and free it
     //
-    if ((PAGE_ALIGN(Entry) == Entry) &&
-        (PAGE_ALIGN(POOL_NEXT_BLOCK(Entry)) == POOL_NEXT_BLOCK(Entry)))
+    if (FreePage)
     {
-        //
-        // In this case, release the pool lock, update the performance counter,
-        // and free the page
-        //
-        ExUnlockPool(PoolDesc, OldIrql);
         InterlockedExchangeAdd((PLONG)&PoolDesc->TotalPages, -1);
-        MiFreePoolPages(Entry);
-        return;
-    }
-
-    //
-    // Otherwise, we now have a free block (or a combination of 2 or 3)
-    //
-    Entry->PoolType = 0;
-    BlockSize = Entry->BlockSize;
-    ASSERT(BlockSize != 1);
-
-    //
-    // Check if we actually did combine it with anyone
-    //
-    if (Combined)
-    {
-        //
-        // Get the first combined block (either our original to begin with, or
-        // the one after the original, depending if we combined with the previous)
-        //
-        NextEntry = POOL_NEXT_BLOCK(Entry);
-
-        //
-        // As long as the next block isn't on a page boundary, have it point
-        // back to us
-        //
-        if (PAGE_ALIGN(NextEntry) != NextEntry) NextEntry->PreviousSize = BlockSize;
+        MiFreePoolPages(FreePage);
     }
-
-    //
-    // Insert this new free block, and release the pool lock
-    //
-    ExpInsertPoolHeadList(&PoolDesc->ListHeads[BlockSize - 1], POOL_FREE_BLOCK(Entry));
-    ExpCheckPoolLinks(POOL_FREE_BLOCK(Entry));
-    ExUnlockPool(PoolDesc, OldIrql);
 }
 
 /*
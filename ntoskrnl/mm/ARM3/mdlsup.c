@@ -1690,16 +1690,101 @@ MmProbeAndLockProcessPages(IN OUT PMDL MemoryDescriptorList,
 
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
 MmProbeAndLockSelectedPages(IN OUT PMDL MemoryDescriptorList,
-                            IN LARGE_INTEGER PageList[],
+                            IN PFILE_SEGMENT_ELEMENT SegmentArray,
                             IN KPROCESSOR_MODE AccessMode,
                             IN LOCK_OPERATION Operation)
 {
-    UNIMPLEMENTED;
+    PFN_NUMBER MdlBuffer[(sizeof(MDL) / sizeof(PFN_NUMBER)) + 1];
+    PMDL PageMdl = (PMDL)MdlBuffer;
+    PPFN_NUMBER MdlPages;
+    PFN_COUNT PageCount, i;
+    ULONG ByteCount, Flags = 0;
+    NTSTATUS Status = STATUS_SUCCESS;
+    DPRINT("Probing selected pages for MDL: %p\n", MemoryDescriptorList);
+
+    //
+    // Sanity checks
+    //
+    ASSERT(MemoryDescriptorList->ByteOffset == 0);
+    ASSERT((MemoryDescriptorList->MdlFlags & (MDL_PAGES_LOCKED |
+                                              MDL_MAPPED_TO_SYSTEM_VA |
+                                              MDL_SOURCE_IS_NONPAGED_POOL |
+                                              MDL_PARTIAL |
+                                              MDL_IO_SPACE)) == 0);
+
+    //
+    // Get the page count and PFN array of the caller's MDL
+    //
+    MdlPages = (PPFN_NUMBER)(MemoryDescriptorList + 1);
+    ByteCount = MemoryDescriptorList->ByteCount;
+    PageCount = ADDRESS_AND_SIZE_TO_SPAN_PAGES(MmGetMdlVirtualAddress(MemoryDescriptorList),
+                                               ByteCount);
+
+    //
+    // Probe and lock each page on its own, through a one page MDL
+    //
+    for (i = 0; i < PageCount; i++)
+    {
+        MmInitializeMdl(PageMdl,
+                        SegmentArray[i].Buffer,
+                        PAGE_SIZE);
+
+        //
+        // Pages have to be page-aligned
+        //
+        if (PageMdl->ByteOffset != 0)
+        {
+            Status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        _SEH2_TRY
+        {
+            MmProbeAndLockPages(PageMdl, AccessMode, Operation);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+        if (!NT_SUCCESS(Status)) break;
+
+        //
+        // Copy the PFN and remember the per-page flags and owner
+        //
+        MdlPages[i] = *(PPFN_NUMBER)(PageMdl + 1);
+        Flags |= PageMdl->MdlFlags & (MDL_WRITE_OPERATION | MDL_IO_SPACE);
+        MemoryDescriptorList->Process = PageMdl->Process;
+    }
+
+    //
+    // Mark whatever we got as locked
+    //
+    MemoryDescriptorList->MdlFlags |= (Flags | MDL_PAGES_LOCKED);
+    if (NT_SUCCESS(Status)) return;
+
+    //
+    // Failure: unlock the pages we already locked, if any
+    //
+    DPRINT1("Selected pages probe failed: %lx\n", Status);
+    if (i != 0)
+    {
+        MemoryDescriptorList->ByteCount = i * PAGE_SIZE;
+        MmUnlockPages(MemoryDescriptorList);
+        MemoryDescriptorList->ByteCount = ByteCount;
+    }
+
+    //
+    // Undo the flags and raise the error
+    //
+    MemoryDescriptorList->MdlFlags &= ~(MDL_PAGES_LOCKED | MDL_WRITE_OPERATION | MDL_IO_SPACE);
+    MemoryDescriptorList->Process = NULL;
+    ExRaiseStatus(Status);
 }
 
 /*
@@ -633,6 +633,10 @@ extern PFN_NUMBER MiLowNonPagedPoolThreshold;
 extern PFN_NUMBER MiHighNonPagedPoolThreshold;
 extern PFN_NUMBER MmMinimumFreePages;
 extern PFN_NUMBER MmPlentyFreePages;
+extern PFN_COUNT MmPageFileReadClusterSize;
+extern ULONG MmPageFileClusterReadAhead;
+extern ULONG MmPageFileClusterHits;
+extern ULONG MmPageFileClusterWasted;
 extern SIZE_T MmMinimumStackCommitInBytes;
 extern PFN_COUNT MiExpansionPoolPagesInitialCharge;
 extern PFN_NUMBER MmResidentAvailablePages;
@@ -22,6 +22,17 @@
 BOOLEAN UserPdeFault = FALSE;
 #endif
 
+/* Paging file read clustering, see MiResolvePageFileFault */
+#define MI_MIN_PAGEFILE_READ_CLUSTER    2
+#define MI_PAGEFILE_CLUSTER_WINDOW      64
+
+PFN_COUNT MmPageFileReadClusterSize = MI_MAX_PAGEFILE_READ_CLUSTER / 2;
+ULONG MmPageFileClusterReadAhead;
+ULONG MmPageFileClusterHits;
+ULONG MmPageFileClusterWasted;
+static ULONG MiPageFileClusterWindowReadAhead;
+static ULONG MiPageFileClusterWindowHits;
+
 /* PRIVATE FUNCTIONS **********************************************************/
 
 static
@@ -877,6 +888,143 @@ MiCompleteProtoPteFault(IN BOOLEAN StoreInstruction,
     return STATUS_SUCCESS;
 }
 
+static
+VOID
+MiUpdatePageFileClusterSize(VOID)
+{
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* Wait until enough pages were read ahead to tell */
+    if (MiPageFileClusterWindowReadAhead < MI_PAGEFILE_CLUSTER_WINDOW) return;
+
+    /* Read more when at least half of them get used, less when most are wasted */
+    if ((MiPageFileClusterWindowHits * 2) >= MiPageFileClusterWindowReadAhead)
+    {
+        MmPageFileReadClusterSize = min(MmPageFileReadClusterSize * 2,
+                                        MI_MAX_PAGEFILE_READ_CLUSTER);
+    }
+    else if ((MiPageFileClusterWindowHits * 4) < MiPageFileClusterWindowReadAhead)
+    {
+        MmPageFileReadClusterSize = max(MmPageFileReadClusterSize / 2,
+                                        MI_MIN_PAGEFILE_READ_CLUSTER);
+    }
+
+    DPRINT("Paging file read cluster is now %lu pages (%lu hits out of %lu)\n",
+           MmPageFileReadClusterSize,
+           MiPageFileClusterWindowHits,
+           MiPageFileClusterWindowReadAhead);
+
+    MiPageFileClusterWindowReadAhead = 0;
+    MiPageFileClusterWindowHits = 0;
+}
+
+static
+PFN_COUNT
+MiBuildPageFileCluster(_In_ PMMPTE PointerPte,
+                       _In_opt_ PMMVAD Vad,
+                       _In_ PEPROCESS CurrentProcess,
+                       _Out_writes_to_(MI_MAX_PAGEFILE_READ_CLUSTER - 1, return) PPFN_NUMBER Pages)
+{
+    PMMPTE ClusterPte, LastPte;
+    MMPTE TempPte = *PointerPte;
+    ULONG PageFileIndex = TempPte.u.Soft.PageFileLow;
+    ULONG_PTR PageFileOffset = TempPte.u.Soft.PageFileHigh;
+    PFN_COUNT Count = 0;
+    PFN_NUMBER Page;
+    PMMPFN Pfn1;
+
+    /* We must hold the PFN lock */
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* The cluster includes the faulting page, and doesn't go past the VAD */
+    LastPte = PointerPte + MmPageFileReadClusterSize - 1;
+    if ((Vad) && (LastPte > MiAddressToPte(Vad->EndingVpn << PAGE_SHIFT)))
+    {
+        LastPte = MiAddressToPte(Vad->EndingVpn << PAGE_SHIFT);
+    }
+
+    for (ClusterPte = PointerPte + 1; ClusterPte <= LastPte; ClusterPte++)
+    {
+        /* Don't go past the page table */
+        if (MiIsPteOnPdeBoundary(ClusterPte)) break;
+
+        /* The page must follow the previous one in the same paging file */
+        TempPte = *ClusterPte;
+        if ((TempPte.u.Hard.Valid == 1) ||
+            (TempPte.u.Soft.Prototype == 1) ||
+            (TempPte.u.Soft.Transition == 1) ||
+            (TempPte.u.Soft.PageFileLow != PageFileIndex) ||
+            (TempPte.u.Soft.PageFileHigh != PageFileOffset + Count + 1))
+        {
+            break;
+        }
+
+        /* Only read ahead into pages nobody else needs, not into other standby pages */
+        if ((MmFreePageListHead.Total + MmZeroedPageListHead.Total) < MmPlentyFreePages) break;
+
+        /* Get a page and make the PTE point to it while it's read */
+        Page = MiRemoveAnyPage(MI_GET_NEXT_PROCESS_COLOR(CurrentProcess));
+        MiInitializePfn(Page, ClusterPte, FALSE);
+        Pfn1 = MI_PFN_ELEMENT(Page);
+        ASSERT(Pfn1->u1.Event == NULL);
+        ASSERT(Pfn1->u3.e1.ReadInProgress == 0);
+        Pfn1->u3.e1.ReadInProgress = 1;
+
+        MI_MAKE_TRANSITION_PTE(&TempPte, Page, TempPte.u.Soft.Protection);
+        MI_WRITE_INVALID_PTE(ClusterPte, TempPte);
+
+        Pages[Count++] = Page;
+    }
+
+    return Count;
+}
+
+static
+VOID
+MiCompletePageFileCluster(_In_reads_(PageCount) PPFN_NUMBER Pages,
+                          _In_ PFN_COUNT PageCount,
+                          _In_ NTSTATUS Status)
+{
+    PFN_COUNT i;
+    PFN_NUMBER PteFrame;
+    PMMPFN Pfn1;
+    PKEVENT Event;
+
+    /* We must hold the PFN lock */
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    for (i = 0; i < PageCount; i++)
+    {
+        Pfn1 = MI_PFN_ELEMENT(Pages[i]);
+        ASSERT(Pfn1->u3.e1.ReadInProgress == 1);
+        ASSERT(Pfn1->u3.e1.WriteInProgress == 0);
+        Pfn1->u3.e1.ReadInProgress = 0;
+
+        /* Wake up whoever faulted on it meanwhile, they will retry the fault */
+        Event = Pfn1->u1.Event;
+        Pfn1->u1.Event = NULL;
+        if (Event) KeSetEvent(Event, IO_NO_INCREMENT, FALSE);
+
+        if (!NT_SUCCESS(Status))
+        {
+            /* Put the paging file PTE back and get rid of the page */
+            PteFrame = Pfn1->u4.PteFrame;
+            MI_WRITE_INVALID_PTE(Pfn1->PteAddress, Pfn1->OriginalPte);
+            MI_SET_PFN_DELETED(Pfn1);
+            MiDecrementShareCount(Pfn1, Pages[i]);
+            MiDecrementShareCount(MI_PFN_ELEMENT(PteFrame), PteFrame);
+            continue;
+        }
+
+        /* Leave the PTE in transition, the page goes to the standby list */
+        MiDecrementShareCount(Pfn1, Pages[i]);
+        MmPageFileClusterReadAhead++;
+        MiPageFileClusterWindowReadAhead++;
+    }
+
+    MiUpdatePageFileClusterSize();
+}
+
 static
 NTSTATUS
 NTAPI
@@ -884,16 +1032,19 @@ MiResolvePageFileFault(_In_ BOOLEAN StoreInstruction,
                        _In_ PVOID FaultingAddress,
                        _In_ PMMPTE PointerPte,
                        _In_ PEPROCESS CurrentProcess,
+                       _In_opt_ PMMVAD Vad,
                        _Inout_ KIRQL *OldIrql)
 {
     ULONG Color;
     PFN_NUMBER Page;
-    NTSTATUS Status;
+    NTSTATUS Status, ClusterStatus;
     MMPTE TempPte = *PointerPte;
     PMMPFN Pfn1;
     ULONG PageFileIndex = TempPte.u.Soft.PageFileLow;
     ULONG_PTR PageFileOffset = TempPte.u.Soft.PageFileHigh;
     ULONG Protection = TempPte.u.Soft.Protection;
+    PFN_NUMBER ClusterPages[MI_MAX_PAGEFILE_READ_CLUSTER];
+    PFN_COUNT ClusterCount;
 
     /* Things we don't support yet */
     ASSERT(CurrentProcess > HYDRA_PROCESS);
@@ -926,15 +1077,34 @@ MiResolvePageFileFault(_In_ BOOLEAN StoreInstruction,
 
     MI_WRITE_INVALID_PTE(PointerPte, TempPte);
 
+    /* Also bring in the pages following it in the paging file, with the same I/O */
+    ClusterPages[0] = Page;
+    ClusterCount = 1 + MiBuildPageFileCluster(PointerPte,
+                                              Vad,
+                                              CurrentProcess,
+                                              &ClusterPages[1]);
+
     /* Release the PFN lock while we proceed */
     MiReleasePfnLock(*OldIrql);
 
     /* Do the paging IO */
-    Status = MiReadPageFile(Page, PageFileIndex, PageFileOffset);
+    Status = MiReadPageFileCluster(ClusterPages, ClusterCount, PageFileIndex, PageFileOffset);
+    ClusterStatus = Status;
+    if (!NT_SUCCESS(Status) && (ClusterCount > 1))
+    {
+        /* Don't let the read ahead fail the fault, retry with this page only */
+        Status = MiReadPageFile(Page, PageFileIndex, PageFileOffset);
+    }
 
     /* Lock the PFN database again */
     *OldIrql = MiAcquirePfnLock();
 
+    /* Send the pages we read ahead to the standby list */
+    if (ClusterCount > 1)
+    {
+        MiCompletePageFileCluster(&ClusterPages[1], ClusterCount - 1, ClusterStatus);
+    }
+
     /* Nobody should have changed that while we were not looking */
     ASSERT(Pfn1->u3.e1.ReadInProgress == 1);
     ASSERT(Pfn1->u3.e1.WriteInProgress == 0);
@@ -1035,6 +1205,14 @@ MiResolveTransitionFault(IN BOOLEAN StoreInstruction,
     }
     else
     {
+        /* Private standby pages come from paging file read ahead */
+        if ((Pfn1->u3.e1.PageLocation == StandbyPageList) &&
+            (Pfn1->u3.e1.PrototypePte == 0))
+        {
+            MmPageFileClusterHits++;
+            MiPageFileClusterWindowHits++;
+        }
+
         /* Otherwise, the page is removed from its list */
         DPRINT("Transition page in free/zero list\n");
         MiUnlinkPageFromList(Pfn1);
@@ -1597,7 +1775,7 @@ MiDispatchFault(IN ULONG FaultCode,
         LockIrql = MiAcquirePfnLock();
 
         /* Resolve */
-        Status = MiResolvePageFileFault(!MI_IS_NOT_PRESENT_FAULT(FaultCode), Address, PointerPte, Process, &LockIrql);
+        Status = MiResolvePageFileFault(!MI_IS_NOT_PRESENT_FAULT(FaultCode), Address, PointerPte, Process, Vad, &LockIrql);
 
         /* And now release the lock and leave*/
         MiReleasePfnLock(LockIrql);
@@ -289,8 +289,7 @@ MiUnlinkPageFromList(IN PMMPFN Pfn)
         MiDecrementAvailablePages();
 
         /* Decrease transition page counter */
-        ASSERT(Pfn->u3.e1.PrototypePte == 1); /* Only supported ARM3 case */
-        MmTransitionSharedPages--;
+        if (Pfn->u3.e1.PrototypePte) MmTransitionSharedPages--;
     }
     else if (ListHead == &MmModifiedPageListHead)
     {
@@ -470,6 +469,71 @@ MiRemovePageByColor(IN PFN_NUMBER PageIndex,
     return PageIndex;
 }
 
+static
+PFN_NUMBER
+MiRepurposeStandbyPage(VOID)
+{
+    PFN_NUMBER PageIndex, PteFrame;
+    PMMPFN Pfn1;
+    PMMPTE PointerPte;
+    MMPTE OriginalPte;
+    USHORT OldColor, OldCache;
+    ULONG Priority;
+    KIRQL OldIrql;
+    PEPROCESS Process = PsGetCurrentProcess();
+
+    /* Make sure PFN lock is held */
+    MI_ASSERT_PFN_LOCK_HELD();
+
+    /* Lowest priority first */
+    for (Priority = 0; Priority < 8; Priority++)
+    {
+        for (PageIndex = MmStandbyPageListByPriority[Priority].Flink;
+             PageIndex != LIST_HEAD;
+             PageIndex = Pfn1->u1.Flink)
+        {
+            /* Prototype PTEs live in paged pool, only private pages can be taken back here */
+            Pfn1 = MI_PFN_ELEMENT(PageIndex);
+            if (Pfn1->u3.e1.PrototypePte) continue;
+
+            /* These come from paging file read ahead, nobody faulted them in */
+            ASSERT(Pfn1->u3.e2.ReferenceCount == 0);
+            ASSERT(Pfn1->u2.ShareCount == 0);
+            ASSERT(Pfn1->u3.e1.ReadInProgress == 0);
+            MmPageFileClusterWasted++;
+
+            /* Unlinking loses the original PTE, so grab it first */
+            OriginalPte = Pfn1->OriginalPte;
+            PteFrame = Pfn1->u4.PteFrame;
+            MiUnlinkPageFromList(Pfn1);
+
+            /* Put the paging file PTE back, the page table can belong to any process */
+            PointerPte = MiMapPageInHyperSpace(Process, PteFrame, &OldIrql);
+            PointerPte = (PMMPTE)((ULONG_PTR)PointerPte + BYTE_OFFSET(Pfn1->PteAddress));
+            ASSERT(PointerPte->u.Soft.Transition == 1);
+            ASSERT(PointerPte->u.Trans.PageFrameNumber == PageIndex);
+            MI_WRITE_INVALID_PTE(PointerPte, OriginalPte);
+            MiUnmapPageInHyperSpace(Process, PointerPte, OldIrql);
+
+            /* The page table doesn't reference this page anymore */
+            MiDecrementShareCount(MI_PFN_ELEMENT(PteFrame), PteFrame);
+
+            /* Zero flags but restore color and cache, like a page from the free list */
+            OldColor = Pfn1->u3.e1.PageColor;
+            OldCache = Pfn1->u3.e1.CacheAttribute;
+            Pfn1->u3.e2.ShortFlags = 0;
+            Pfn1->u3.e1.PageColor = OldColor;
+            Pfn1->u3.e1.CacheAttribute = OldCache;
+
+            DPRINT("Repurposed standby page %lx\n", PageIndex);
+            return PageIndex;
+        }
+    }
+
+    /* Nothing we can take */
+    return 0;
+}
+
 PFN_NUMBER
 NTAPI
 MiRemoveAnyPage(IN ULONG Color)
@@ -500,11 +564,13 @@ MiRemoveAnyPage(IN ULONG Color)
                 ASSERT_LIST_INVARIANT(&MmZeroedPageListHead);
                 PageIndex = MmZeroedPageListHead.Flink;
                 Color = PageIndex & MmSecondaryColorMask;
-                ASSERT(PageIndex != LIST_HEAD);
                 if (PageIndex == LIST_HEAD)
                 {
-                    /* FIXME: Should check the standby list */
+                    /* Only standby pages are left, take one back */
                     ASSERT(MmZeroedPageListHead.Total == 0);
+                    PageIndex = MiRepurposeStandbyPage();
+                    ASSERT(PageIndex != 0);
+                    return PageIndex;
                 }
             }
         }
@@ -560,11 +626,14 @@ MiRemoveZeroPage(IN ULONG Color)
                 ASSERT_LIST_INVARIANT(&MmFreePageListHead);
                 PageIndex = MmFreePageListHead.Flink;
                 Color = PageIndex & MmSecondaryColorMask;
-                ASSERT(PageIndex != LIST_HEAD);
                 if (PageIndex == LIST_HEAD)
                 {
-                    /* FIXME: Should check the standby list */
-                    ASSERT(MmZeroedPageListHead.Total == 0);
+                    /* Only standby pages are left, take one back and zero it */
+                    ASSERT(MmFreePageListHead.Total == 0);
+                    PageIndex = MiRepurposeStandbyPage();
+                    ASSERT(PageIndex != 0);
+                    MiZeroPhysicalPage(PageIndex);
+                    return PageIndex;
                 }
             }
         }
@@ -734,11 +803,10 @@ MiInsertStandbyListAtFront(IN PFN_NUMBER PageFrameIndex)
     Pfn1 = MI_PFN_ELEMENT(PageFrameIndex);
     ASSERT(Pfn1->u4.MustBeCached == 0);
     ASSERT(Pfn1->u3.e2.ReferenceCount == 0);
-    ASSERT(Pfn1->u3.e1.PrototypePte == 1);
     ASSERT(Pfn1->u3.e1.Rom != 1);
 
-    /* One more transition page on a list */
-    MmTransitionSharedPages++;
+    /* One more transition page on a list. Private ones come from paging file read ahead */
+    if (Pfn1->u3.e1.PrototypePte) MmTransitionSharedPages++;
 
     /* Get the standby page list and increment its count */
     ListHead = &MmStandbyPageListByPriority [Pfn1->u4.Priority];
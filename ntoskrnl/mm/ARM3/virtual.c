@@ -436,6 +436,9 @@ MiDeletePte(IN PMMPTE PointerPte,
                 /* And it should be in standby or modified list */
                 ASSERT((Pfn1->u3.e1.PageLocation == ModifiedPageList) || (Pfn1->u3.e1.PageLocation == StandbyPageList));
 
+                /* Private standby pages come from paging file read ahead, this one was never used */
+                if (Pfn1->u3.e1.PageLocation == StandbyPageList) MmPageFileClusterWasted++;
+
                 /* Unlink it and set its reference count to one */
                 MiUnlinkPageFromList(Pfn1);
                 Pfn1->u3.e2.ReferenceCount++;
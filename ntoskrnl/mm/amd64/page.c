@@ -448,6 +448,44 @@ MmSetDirtyPage(PEPROCESS Process, PVOID Address)
     MiFlushTlb(Pte, Address);
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(PEPROCESS Process, PVOID Address)
+{
+    KAPC_STATE ApcState;
+    BOOLEAN Attached = FALSE;
+    BOOLEAN Accessed = FALSE;
+    PMMPTE Pte;
+
+    /* The balancer looks at all processes, so attach to reach their page tables */
+    if (Address < MmSystemRangeStart &&
+        Process && Process != PsGetCurrentProcess())
+    {
+        KeStackAttachProcess(&Process->Pcb, &ApcState);
+        Attached = TRUE;
+    }
+
+    Pte = MiGetPteForProcess(Process, Address, FALSE);
+    if (Pte)
+    {
+        /* Clear the accessed bit, and drop the TLB entries only if it was set.
+           Other processors running the process may hold it as well */
+        Accessed = InterlockedBitTestAndReset64((PVOID)Pte, 5) && Pte->u.Hard.Valid;
+        if (Accessed)
+        {
+            if (KeNumberProcessors == 1)
+                __invlpg(Address);
+            else
+                KeFlushEntireTb(TRUE, TRUE);
+        }
+    }
+
+    if (Attached)
+        KeUnstackDetachProcess(&ApcState);
+
+    return Accessed;
+}
+
 VOID
 NTAPI
 MmDeleteVirtualMapping(
@@ -45,6 +45,19 @@ static HANDLE MiBalancerThreadHandle = NULL;
 static KEVENT MiBalancerEvent;
 static KTIMER MiBalancerTimer;
 
+/* The balancer's clock over the user pages, see MmTrimUserMemory */
+#define MI_WS_AGE_MAX   (SYSTEM_WS_AGE_BUCKETS - 1)
+#define MI_WS_TRIM_AGE  2
+
+static PFN_NUMBER MiClockHand;
+static ULONG MiClockRevolutions;
+static ULONG MiClockPagesScanned;
+static ULONG MiClockPagesReferenced;
+static ULONG MiClockCleanPagesTrimmed;
+static ULONG MiClockDirtyPagesTrimmed;
+
+extern FAST_MUTEX RmapListLock;
+
 /* FUNCTIONS ****************************************************************/
 
 VOID
@@ -174,38 +187,245 @@ MiTrimMemoryConsumer(ULONG Consumer, ULONG InitialTarget)
     }
 }
 
-NTSTATUS
-MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
+static
+VOID
+MiTrimUserMemoryClock(ULONG Pass, ULONG Target, PULONG NrFreedPages)
 {
+    PFN_NUMBER StartPage;
     PFN_NUMBER CurrentPage;
     PFN_NUMBER NextPage;
+    ULONG Scanned;
+    ULONG Age;
+    BOOLEAN Accessed;
+    BOOLEAN Dirty;
+    BOOLEAN Locked;
+    BOOLEAN Wrapped = FALSE;
+    BOOLEAN Trim;
+    PMMPFN Pfn1;
+    KIRQL OldIrql;
     NTSTATUS Status;
 
-    (*NrFreedPages) = 0;
+    /* Start where the previous sweep stopped */
+    StartPage = MiClockHand ? MmGetLRUNextUserPage(MiClockHand) : 0;
+    if (StartPage == 0)
+        StartPage = MmGetLRUFirstUserPage();
 
-    CurrentPage = MmGetLRUFirstUserPage();
-    while (CurrentPage != 0 && Target > 0)
+    CurrentPage = StartPage;
+    for (Scanned = 0; CurrentPage != 0 && *NrFreedPages < Target; Scanned++)
     {
-        Status = MmPageOutPhysicalAddress(CurrentPage);
-        if (NT_SUCCESS(Status))
+        MiClockHand = CurrentPage;
+
+        /* Collect the accessed bits of all the mappings */
+        Accessed = MmTestAndClearAccessedRmap(CurrentPage, &Dirty);
+        if (Accessed) MiClockPagesReferenced++;
+
+        /* Referenced pages get a second chance, the others grow older */
+        OldIrql = MiAcquirePfnLock();
+        Pfn1 = MiGetPfnEntry(CurrentPage);
+        Locked = Pfn1->Wsle.u1.e1.LockedInWs || Pfn1->Wsle.u1.e1.LockedInMemory;
+        if (Accessed || Locked)
+            Pfn1->Wsle.u1.e1.Age = 0;
+        else if ((Pass == 0) && (Pfn1->Wsle.u1.e1.Age < MI_WS_AGE_MAX))
+            Pfn1->Wsle.u1.e1.Age++;
+        Age = Pfn1->Wsle.u1.e1.Age;
+        MiReleasePfnLock(OldIrql);
+
+        switch (Pass)
         {
-            DPRINT("Succeeded\n");
-            Target--;
-            (*NrFreedPages)++;
+            case 0:
+                /* Old and clean pages only, they don't cost a write */
+                Trim = !Accessed && !Locked && !Dirty && (Age >= MI_WS_TRIM_AGE);
+                break;
+
+            case 1:
+                /* Anything that wasn't referenced since the last look */
+                Trim = !Accessed && !Locked && (Age != 0);
+                break;
+
+            default:
+                /* Last resort, take whatever we can get */
+                Trim = TRUE;
+                break;
+        }
+
+        if (Trim)
+        {
+            Status = MmPageOutPhysicalAddress(CurrentPage);
+            if (NT_SUCCESS(Status))
+            {
+                DPRINT("Succeeded\n");
+                (*NrFreedPages)++;
+                if (Dirty)
+                    MiClockDirtyPagesTrimmed++;
+                else
+                    MiClockCleanPagesTrimmed++;
+            }
         }
 
         NextPage = MmGetLRUNextUserPage(CurrentPage);
-        if (NextPage <= CurrentPage)
+        if (NextPage == 0)
         {
-            /* We wrapped around, so we're done */
+            /* Wrap around to the first user page */
+            NextPage = MmGetLRUFirstUserPage();
+            MiClockRevolutions++;
+            Wrapped = TRUE;
+        }
+
+        if (Wrapped && (NextPage >= StartPage))
+        {
+            /* We went around the whole clock, so we're done */
+            Scanned++;
             break;
         }
         CurrentPage = NextPage;
     }
 
+    MiClockPagesScanned += Scanned;
+}
+
+NTSTATUS
+MmTrimUserMemory(ULONG Target, ULONG Priority, PULONG NrFreedPages)
+{
+    ULONG Pass;
+
+    (*NrFreedPages) = 0;
+
+    /*
+     * Sweep the user pages like a clock. The first revolution ages the pages
+     * that weren't referenced since the previous sweep, and only takes the old
+     * clean ones, which are the cheapest to get back. If that's not enough,
+     * take anything that wasn't referenced lately, and then anything at all.
+     */
+#ifdef _M_ARM
+    /* The accessed bits can't be tested on ARM yet, so there is nothing to age */
+    Pass = 2;
+#else
+    Pass = 0;
+#endif
+    for (; (Pass < 3) && (*NrFreedPages < Target); Pass++)
+    {
+        MiTrimUserMemoryClock(Pass, Target, NrFreedPages);
+    }
+
     return STATUS_SUCCESS;
 }
 
+NTSTATUS
+NTAPI
+MmQueryWorkingSetAging(OUT PVOID Buffer,
+                       IN ULONG Size,
+                       OUT PULONG ReqSize)
+{
+    PSYSTEM_WS_AGING_INFORMATION AgingInfo = (PSYSTEM_WS_AGING_INFORMATION)Buffer;
+    PSYSTEM_WS_AGING_PROCESS_INFORMATION ProcessInfo;
+    PEPROCESS *Processes;
+    PEPROCESS Process;
+    PMM_RMAP_ENTRY Entry;
+    PFN_NUMBER Page;
+    ULONG Histogram[SYSTEM_WS_AGE_BUCKETS];
+    ULONG UserPages = 0;
+    ULONG Count = 0;
+    ULONG Age;
+    ULONG i;
+    KIRQL OldIrql;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    PAGED_CODE();
+
+    /* Count the processes to know how much room we need */
+    for (Process = PsGetNextProcess(NULL); Process; Process = PsGetNextProcess(Process))
+        Count++;
+
+    *ReqSize = FIELD_OFFSET(SYSTEM_WS_AGING_INFORMATION, Processes[Count]);
+    if (Size < *ReqSize)
+    {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    /* The caller's buffer may fault, so gather everything in nonpaged pool first */
+    Processes = ExAllocatePoolWithTag(NonPagedPool,
+                                      Count * (sizeof(PEPROCESS) + sizeof(*ProcessInfo)),
+                                      TAG_MM);
+    if (!Processes)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    ProcessInfo = (PSYSTEM_WS_AGING_PROCESS_INFORMATION)&Processes[Count];
+    RtlZeroMemory(ProcessInfo, Count * sizeof(*ProcessInfo));
+    RtlZeroMemory(Histogram, sizeof(Histogram));
+
+    i = 0;
+    for (Process = PsGetNextProcess(NULL); Process; Process = PsGetNextProcess(Process))
+    {
+        /* Processes created since we counted are left out */
+        if (i == Count)
+        {
+            ObDereferenceObject(Process);
+            break;
+        }
+
+        Processes[i] = Process;
+        ProcessInfo[i].UniqueProcessId = Process->UniqueProcessId;
+        ProcessInfo[i].TrimCount = Process->Vm.TrimCount;
+        ProcessInfo[i].LastTrimTime = Process->Vm.LastTrimTime;
+        i++;
+    }
+    Count = i;
+
+    /* Account the age of each user page to every process mapping it */
+    for (Page = MmGetLRUFirstUserPage(); Page != 0; Page = MmGetLRUNextUserPage(Page))
+    {
+        OldIrql = MiAcquirePfnLock();
+        Age = MiGetPfnEntry(Page)->Wsle.u1.e1.Age;
+        MiReleasePfnLock(OldIrql);
+
+        UserPages++;
+        Histogram[Age]++;
+
+        ExAcquireFastMutex(&RmapListLock);
+        for (Entry = MmGetRmapListHeadPage(Page); Entry != NULL; Entry = Entry->Next)
+        {
+            /* This also skips the segment entries */
+            if (Entry->Address >= MmSystemRangeStart)
+                continue;
+
+            /* The process pointers are only compared, never dereferenced */
+            for (i = 0; i < Count; i++)
+            {
+                if (Processes[i] == Entry->Process)
+                {
+                    ProcessInfo[i].AgeHistogram[Age]++;
+                    break;
+                }
+            }
+        }
+        ExReleaseFastMutex(&RmapListLock);
+    }
+
+    /* Now hand everything to the caller */
+    _SEH2_TRY
+    {
+        AgingInfo->UserPages = UserPages;
+        AgingInfo->ClockRevolutions = MiClockRevolutions;
+        AgingInfo->PagesScanned = MiClockPagesScanned;
+        AgingInfo->PagesReferenced = MiClockPagesReferenced;
+        AgingInfo->CleanPagesTrimmed = MiClockCleanPagesTrimmed;
+        AgingInfo->DirtyPagesTrimmed = MiClockDirtyPagesTrimmed;
+        RtlCopyMemory(AgingInfo->AgeHistogram, Histogram, sizeof(Histogram));
+        AgingInfo->NumberOfProcesses = Count;
+        RtlCopyMemory(AgingInfo->Processes, ProcessInfo, Count * sizeof(*ProcessInfo));
+        *ReqSize = FIELD_OFFSET(SYSTEM_WS_AGING_INFORMATION, Processes[Count]);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    ExFreePoolWithTag(Processes, TAG_MM);
+    return Status;
+}
+
 static BOOLEAN
 MiIsBalancerThread(VOID)
 {
@@ -375,6 +595,13 @@ MiBalancerThread(PVOID Unused)
                 MiReleasePfnLock(OldIrql);
             }
 #endif
+            /* Give the pool blocks cached per-CPU back, they may free up whole pages */
+            if (MmAvailablePages < MiMinimumAvailablePages)
+            {
+                ExpDrainPoolMagazines(NonPagedPool);
+                ExpDrainPoolMagazines(PagedPool);
+            }
+
             do
             {
                 ULONG OldTarget = InitialTarget;
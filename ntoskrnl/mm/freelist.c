@@ -89,6 +89,9 @@ MmInsertLRULastUserPage(PFN_NUMBER Pfn)
     ASSERT(!RtlCheckBit(&MiUserPfnBitMap, (ULONG)Pfn));
     OldIrql = MiAcquirePfnLock();
     RtlSetBit(&MiUserPfnBitMap, (ULONG)Pfn);
+
+    /* A new user page starts young for the balancer's clock */
+    MiGetPfnEntry(Pfn)->Wsle.u1.e1.Age = 0;
     MiReleasePfnLock(OldIrql);
 }
 
@@ -568,6 +568,46 @@ MmSetDirtyPage(PEPROCESS Process, PVOID Address)
     }
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(PEPROCESS Process, PVOID Address)
+{
+    PULONG Pt;
+    ULONG Pte;
+
+    if (Address < MmSystemRangeStart && Process == NULL)
+    {
+        DPRINT1("MmTestAndClearAccessedPage is called for user space without a process.\n");
+        KeBugCheck(MEMORY_MANAGEMENT);
+    }
+
+    Pt = MmGetPageTableForProcess(Process, Address, FALSE);
+    if (Pt == NULL)
+    {
+        return FALSE;
+    }
+
+    do
+    {
+        Pte = *Pt;
+    } while (Pte != InterlockedCompareExchangePte(Pt, Pte & ~PA_ACCESSED, Pte));
+
+    if ((Pte & (PA_PRESENT | PA_ACCESSED)) == (PA_PRESENT | PA_ACCESSED))
+    {
+        /* The TLBs may still hold the entry with the accessed bit set,
+         * drop it so that the next access is noticed again. Other processors
+         * can hold it too, and another process' entry can't be dropped from here */
+        if (MmUnmapPageTable(Pt) && (KeNumberProcessors == 1))
+            KeInvalidateTlbEntry(Address);
+        else
+            KeFlushEntireTb(TRUE, TRUE);
+        return TRUE;
+    }
+
+    MmUnmapPageTable(Pt);
+    return FALSE;
+}
+
 BOOLEAN
 NTAPI
 MmIsPagePresent(PEPROCESS Process, PVOID Address)
@@ -202,12 +202,23 @@ MiReadPageFile(
     _In_ PFN_NUMBER Page,
     _In_ ULONG PageFileIndex,
     _In_ ULONG_PTR PageFileOffset)
+{
+    return MiReadPageFileCluster(&Page, 1, PageFileIndex, PageFileOffset);
+}
+
+NTSTATUS
+NTAPI
+MiReadPageFileCluster(
+    _In_reads_(PageCount) PPFN_NUMBER Pages,
+    _In_ PFN_COUNT PageCount,
+    _In_ ULONG PageFileIndex,
+    _In_ ULONG_PTR PageFileOffset)
 {
     LARGE_INTEGER file_offset;
     IO_STATUS_BLOCK Iosb;
     NTSTATUS Status;
     KEVENT Event;
-    UCHAR MdlBase[sizeof(MDL) + sizeof(ULONG)];
+    UCHAR MdlBase[sizeof(MDL) + MI_MAX_PAGEFILE_READ_CLUSTER * sizeof(PFN_NUMBER)];
     PMDL Mdl = (PMDL)MdlBase;
     PMMPAGING_FILE PagingFile;
 
@@ -220,6 +231,7 @@ MiReadPageFile(
     }
 
     ASSERT(PageFileIndex < MAX_PAGING_FILES);
+    ASSERT((PageCount != 0) && (PageCount <= MI_MAX_PAGEFILE_READ_CLUSTER));
 
     PagingFile = MmPagingFile[PageFileIndex];
 
@@ -229,8 +241,9 @@ MiReadPageFile(
         KeBugCheck(MEMORY_MANAGEMENT);
     }
 
-    MmInitializeMdl(Mdl, NULL, PAGE_SIZE);
-    MmBuildMdlFromPages(Mdl, &Page);
+    /* The pages are consecutive in the paging file, so a single read brings them all in */
+    MmInitializeMdl(Mdl, NULL, PageCount << PAGE_SHIFT);
+    MmBuildMdlFromPages(Mdl, Pages);
     Mdl->MdlFlags |= MDL_PAGES_LOCKED;
 
     file_offset.QuadPart = PageFileOffset * PAGE_SIZE;
@@ -250,6 +263,11 @@ MiReadPageFile(
     {
         MmUnmapLockedPages (Mdl->MappedSystemVa, Mdl);
     }
+
+    /* Account the paging I/O */
+    InterlockedExchangeAdd(&KeGetCurrentPrcb()->MmPageReadCount, PageCount);
+    InterlockedIncrement(&KeGetCurrentPrcb()->MmPageReadIoCount);
+
     return(Status);
 }
 
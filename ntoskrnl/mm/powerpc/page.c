@@ -241,6 +241,13 @@ MmSetDirtyPage(PEPROCESS Process, PVOID Address)
 {
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedPage(PEPROCESS Process, PVOID Address)
+{
+    return FALSE;
+}
+
 BOOLEAN
 NTAPI
 MmIsPagePresent(PEPROCESS Process, PVOID Address)
@@ -184,6 +184,13 @@ MmPageOutPhysicalAddress(PFN_NUMBER Page)
 
     if (Address < MmSystemRangeStart)
     {
+        if (NT_SUCCESS(Status))
+        {
+            /* Account the trim to the process for the balancer statistics */
+            InterlockedIncrement((PLONG)&AddressSpace->TrimCount);
+            KeQuerySystemTime(&AddressSpace->LastTrimTime);
+        }
+
         ExReleaseRundownProtection(&Process->RundownProtect);
         ObDereferenceObject(Process);
     }
@@ -262,6 +269,35 @@ MmIsDirtyPageRmap(PFN_NUMBER Page)
     return(FALSE);
 }
 
+BOOLEAN
+NTAPI
+MmTestAndClearAccessedRmap(PFN_NUMBER Page, PBOOLEAN Dirty)
+{
+    PMM_RMAP_ENTRY current_entry;
+    BOOLEAN Accessed = FALSE;
+
+    *Dirty = FALSE;
+
+    ExAcquireFastMutex(&RmapListLock);
+    current_entry = MmGetRmapListHeadPage(Page);
+    while (current_entry != NULL)
+    {
+        if (!RMAP_IS_SEGMENT(current_entry->Address))
+        {
+#ifndef _M_ARM
+            /* Every mapping must be looked at, so that all the accessed bits get cleared */
+            if (MmTestAndClearAccessedPage(current_entry->Process, current_entry->Address))
+                Accessed = TRUE;
+#endif
+            if (!*Dirty && MmIsDirtyPage(current_entry->Process, current_entry->Address))
+                *Dirty = TRUE;
+        }
+        current_entry = current_entry->Next;
+    }
+    ExReleaseFastMutex(&RmapListLock);
+    return Accessed;
+}
+
 VOID
 NTAPI
 MmInsertRmap(PFN_NUMBER Page, PEPROCESS Process,
@@ -61,7 +61,22 @@ typedef struct _IDENTIFY_DEVICE_DATA {
   USHORT ReservedWords69[6];
   USHORT QueueDepth  :5;
   USHORT ReservedWord75  :11;
-  USHORT ReservedWords76[4];
+  struct {
+    USHORT Reserved0  :1;
+    USHORT SataGen1  :1;
+    USHORT SataGen2  :1;
+    USHORT SataGen3  :1;
+    USHORT Reserved1  :4;
+    USHORT NCQ  :1;
+    USHORT HIPM  :1;
+    USHORT PhyEvents  :1;
+    USHORT NcqUnload  :1;
+    USHORT NcqPriority  :1;
+    USHORT HostAutoPS  :1;
+    USHORT DeviceAutoPS  :1;
+    USHORT ReadLogDMA  :1;
+  } SerialAtaCapabilities;
+  USHORT ReservedWords77[3];
   USHORT MajorRevision;
   USHORT MinorRevision;
   struct {
@@ -271,6 +286,8 @@ typedef struct _IDENTIFY_DEVICE_DATA {
 #define IDE_COMMAND_WRITE_DMA_QUEUED_FUA_EXT  0x3E
 #define IDE_COMMAND_VERIFY                    0x40
 #define IDE_COMMAND_VERIFY_EXT                0x42
+#define IDE_COMMAND_READ_FPDMA_QUEUED         0x60
+#define IDE_COMMAND_WRITE_FPDMA_QUEUED        0x61
 #define IDE_COMMAND_EXECUTE_DEVICE_DIAGNOSTIC 0x90
 #define IDE_COMMAND_SET_DRIVE_PARAMETERS      0x91
 #define IDE_COMMAND_ATAPI_PACKET              0xA0
@@ -315,6 +315,11 @@ typedef enum _SYSTEM_INFORMATION_CLASS
     MaxSystemInfoClass,
 } SYSTEM_INFORMATION_CLASS;
 
+//
+// ReactOS private System Information Classes, kept clear of the Windows ones
+//
+#define SystemWorkingSetAgingInformation ((SYSTEM_INFORMATION_CLASS)0x1000)
+
 //
 //  System Information Classes for NtQueryMutant
 //
@@ -1178,6 +1183,30 @@ typedef struct _SYSTEM_MEMORY_INFORMATION
     SYSTEM_MEMORY_INFO Memory[1];
 } SYSTEM_MEMORY_INFORMATION, *PSYSTEM_MEMORY_INFORMATION;
 
+// ReactOS private class - Working set aging statistics
+#define SYSTEM_WS_AGE_BUCKETS 4
+
+typedef struct _SYSTEM_WS_AGING_PROCESS_INFORMATION
+{
+    HANDLE UniqueProcessId;
+    ULONG AgeHistogram[SYSTEM_WS_AGE_BUCKETS];
+    ULONG TrimCount;
+    LARGE_INTEGER LastTrimTime;
+} SYSTEM_WS_AGING_PROCESS_INFORMATION, *PSYSTEM_WS_AGING_PROCESS_INFORMATION;
+
+typedef struct _SYSTEM_WS_AGING_INFORMATION
+{
+    ULONG UserPages;
+    ULONG ClockRevolutions;
+    ULONG PagesScanned;
+    ULONG PagesReferenced;
+    ULONG CleanPagesTrimmed;
+    ULONG DirtyPagesTrimmed;
+    ULONG AgeHistogram[SYSTEM_WS_AGE_BUCKETS];
+    ULONG NumberOfProcesses;
+    SYSTEM_WS_AGING_PROCESS_INFORMATION Processes[1];
+} SYSTEM_WS_AGING_INFORMATION, *PSYSTEM_WS_AGING_INFORMATION;
+
 // Class 26
 typedef struct _SYSTEM_GDI_DRIVER_INFORMATION
 {
@@ -936,6 +936,7 @@ typedef struct _MMSUPPORT
 #if (NTDDI_VERSION >= NTDDI_LONGHORN)
     PVOID AccessLog;
 #endif
+    ULONG TrimCount; // ReactOS: pages the balancer trimmed from this working set
 } MMSUPPORT, *PMMSUPPORT;
 
 //
@@ -149,6 +149,11 @@ DEFINE_GUID(GUID_DEVINTERFACE_HIDDEN_VOLUME,
 #define OBSOLETE_IOCTL_STORAGE_RESET_BUS \
   CTL_CODE(IOCTL_STORAGE_BASE, 0x0400, METHOD_BUFFERED, FILE_READ_ACCESS | FILE_WRITE_ACCESS)
 
+#ifdef __REACTOS__
+#define IOCTL_STORAGE_GET_ELEVATOR_STATISTICS \
+  CTL_CODE(IOCTL_STORAGE_BASE, 0x0800, METHOD_BUFFERED, FILE_ANY_ACCESS)
+#endif
+
 #define OBSOLETE_IOCTL_STORAGE_RESET_DEVICE \
   CTL_CODE(IOCTL_STORAGE_BASE, 0x0401, METHOD_BUFFERED, FILE_READ_ACCESS | FILE_WRITE_ACCESS)
 
@@ -234,6 +239,25 @@ typedef struct _STORAGE_DEVICE_NUMBER {
   ULONG PartitionNumber;
 } STORAGE_DEVICE_NUMBER, *PSTORAGE_DEVICE_NUMBER;
 
+#ifdef __REACTOS__
+/* Bucket n counts requests completed in less than 32 << n microseconds,
+   the last one all slower requests */
+#define STORAGE_ELEVATOR_LATENCY_BUCKETS 16
+
+typedef struct _STORAGE_ELEVATOR_STATISTICS {
+  ULONG MaxOutstanding;
+  ULONG Outstanding;
+  ULONG QueueDepth;
+  ULONG PeakQueueDepth;
+  ULONG ReadCount;
+  ULONG WriteCount;
+  ULONG QueuedCount;
+  ULONG MergedCount;
+  ULONG TransferCount;
+  ULONG LatencyHistogram[STORAGE_ELEVATOR_LATENCY_BUCKETS];
+} STORAGE_ELEVATOR_STATISTICS, *PSTORAGE_ELEVATOR_STATISTICS;
+#endif
+
 typedef struct _STORAGE_BUS_RESET_REQUEST {
   UCHAR PathId;
 } STORAGE_BUS_RESET_REQUEST, *PSTORAGE_BUS_RESET_REQUEST;
@@ -99,6 +99,11 @@
 
 /* TCP connection options */
 #define TCP_SOCKET_NODELAY 1
+#define TCP_SOCKET_WINDOW  6
+#ifdef __REACTOS__
+/* ReactOS extension: size of the connection's send buffer */
+#define TCP_SOCKET_SEND_BUFFER 0x1000
+#endif
 
 typedef struct IFEntry
 {
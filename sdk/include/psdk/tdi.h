@@ -137,6 +137,11 @@ typedef struct _TDI_REQUEST_SET_EVENT {
 #define TDI_SEND_NO_RESPONSE_EXPECTED     0x0080
 #define TDI_SEND_NON_BLOCKING             0x0100
 #define TDI_SEND_AND_DISCONNECT           0x0200
+#ifdef __REACTOS__
+/* ReactOS extension: the transport may reference the send buffer until the
+   data is acknowledged, and completes the request only then */
+#define TDI_SEND_NO_COPY                  0x1000
+#endif
 
 /* Disconnect Flags */
 #define TDI_DISCONNECT_WAIT               0x0001
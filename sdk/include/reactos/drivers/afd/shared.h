@@ -126,6 +126,15 @@ typedef struct _AFD_EVENT_SELECT_INFO {
     ULONG				Events;
 } AFD_EVENT_SELECT_INFO, *PAFD_EVENT_SELECT_INFO;
 
+/* Persistent readiness registration, reported through the completion
+ * port the socket is associated with. It stays armed until Events is set
+ * to 0 or the socket is closed; a reported event is not queued again
+ * until its re-enabling function (recv, send, accept) has been called. */
+typedef struct _AFD_POLL_REGISTER_INFO {
+    ULONG				Events;
+    PVOID				Context;
+} AFD_POLL_REGISTER_INFO, *PAFD_POLL_REGISTER_INFO;
+
 typedef struct _AFD_ENUM_NETWORK_EVENTS_INFO {
     HANDLE Event;
     ULONG PollEvents;
@@ -261,6 +270,7 @@ typedef struct _AFD_TDI_HANDLE_DATA
 #define AFD_DEFER_ACCEPT		35
 #define AFD_GET_PENDING_CONNECT_DATA	41
 #define AFD_VALIDATE_GROUP		42
+#define AFD_POLL_REGISTER		43
 
 /* AFD IOCTLs */
 
@@ -336,6 +346,8 @@ typedef struct _AFD_TDI_HANDLE_DATA
   _AFD_CONTROL_CODE(AFD_ENUM_NETWORK_EVENTS, METHOD_NEITHER)
 #define IOCTL_AFD_VALIDATE_GROUP \
   _AFD_CONTROL_CODE(AFD_VALIDATE_GROUP, METHOD_NEITHER)
+#define IOCTL_AFD_POLL_REGISTER \
+  _AFD_CONTROL_CODE(AFD_POLL_REGISTER, METHOD_NEITHER)
 
 typedef struct _AFD_SOCKET_INFORMATION {
     BOOL CommandChannel;
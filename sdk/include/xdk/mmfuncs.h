@@ -576,6 +576,16 @@ NTAPI
 MmAddPhysicalMemory(
   _In_ PPHYSICAL_ADDRESS StartAddress,
   _Inout_ PLARGE_INTEGER NumberOfBytes);
+
+_IRQL_requires_max_ (APC_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+MmProbeAndLockSelectedPages(
+  _Inout_ PMDL MemoryDescriptorList,
+  _In_ PFILE_SEGMENT_ELEMENT SegmentArray,
+  _In_ KPROCESSOR_MODE AccessMode,
+  _In_ LOCK_OPERATION Operation);
 $endif (_NTDDK_)
 $if (_NTIFS_)
 
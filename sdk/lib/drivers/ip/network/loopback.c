@@ -113,7 +113,8 @@ NDIS_STATUS LoopRegisterAdapter(
   Loopback = IPCreateInterface(&BindInfo);
   if (!Loopback) return NDIS_STATUS_RESOURCES;
     
-  Loopback->MTU = 16384;
+  /* Nothing is fragmented on the way back in, so allow the largest IP packet */
+  Loopback->MTU = 0xFFFF;
 
   Loopback->Name.Buffer = L"Loopback";
   Loopback->Name.MaximumLength = Loopback->Name.Length =
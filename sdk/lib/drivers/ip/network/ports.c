@@ -10,6 +10,9 @@
 
 #include "precomp.h"
 
+/* For RtlRandomEx */
+#include <ntifs.h>
+
 NTSTATUS PortsStartup( PPORT_SET PortSet,
 		   UINT StartingPort,
 		   UINT PortsToManage ) {
@@ -25,9 +28,35 @@ NTSTATUS PortsStartup( PPORT_SET PortSet,
 			 PortSet->PortsToOversee );
     RtlClearAllBits( &PortSet->ProtoBitmap );
     KeInitializeSpinLock( &PortSet->Lock );
+
+    /* The first search starts at a random port of its range */
+    PortSet->NextPort = (ULONG)-1;
+    PortSet->Seed = KeQueryPerformanceCounter(NULL).LowPart;
     return STATUS_SUCCESS;
 }
 
+/* Finds a free port between Lowest and Highest, relative to StartingPort.
+ * Searches run on from the last allocated port, so they skip the ports
+ * that are in use. Called with the port set lock held */
+static ULONG FindClearPort( PPORT_SET PortSet, ULONG Lowest, ULONG Highest,
+                            ULONG Random ) {
+    ULONG Hint = PortSet->NextPort, Port;
+
+    if ((Hint < Lowest) || (Hint > Highest))
+        Hint = Lowest + Random % (Highest - Lowest + 1);
+
+    /* This wraps around to the start of the bitmap, not of the range */
+    Port = RtlFindClearBits( &PortSet->ProtoBitmap, 1, Hint );
+    if ((Port == (ULONG)-1) || (Port < Lowest) || (Port > Highest))
+        Port = RtlFindClearBits( &PortSet->ProtoBitmap, 1, Lowest );
+    if ((Port == (ULONG)-1) || (Port < Lowest) || (Port > Highest))
+        return (ULONG)-1;
+
+    RtlSetBit( &PortSet->ProtoBitmap, Port );
+    PortSet->NextPort = Port + 1;
+    return Port;
+}
+
 VOID PortsShutdown( PPORT_SET PortSet ) {
     ExFreePoolWithTag( PortSet->ProtoBitBuffer, PORT_SET_TAG );
 }
@@ -67,13 +96,14 @@ BOOLEAN AllocatePort( PPORT_SET PortSet, ULONG Port ) {
 }
 
 ULONG AllocateAnyPort( PPORT_SET PortSet ) {
-    ULONG AllocatedPort;
+    ULONG AllocatedPort, Random;
     KIRQL OldIrql;
 
+    Random = RtlRandomEx( &PortSet->Seed );
+
     KeAcquireSpinLock( &PortSet->Lock, &OldIrql );
-    AllocatedPort = RtlFindClearBits( &PortSet->ProtoBitmap, 1, 0 );
+    AllocatedPort = FindClearPort( PortSet, 0, PortSet->PortsToOversee - 1, Random );
     if( AllocatedPort != (ULONG)-1 ) {
-	RtlSetBit( &PortSet->ProtoBitmap, AllocatedPort );
 	AllocatedPort += PortSet->StartingPort;
 	KeReleaseSpinLock( &PortSet->Lock, OldIrql );
 	return htons(AllocatedPort);
@@ -84,7 +114,7 @@ ULONG AllocateAnyPort( PPORT_SET PortSet ) {
 }
 
 ULONG AllocatePortFromRange( PPORT_SET PortSet, ULONG Lowest, ULONG Highest ) {
-    ULONG AllocatedPort;
+    ULONG AllocatedPort, Random;
     KIRQL OldIrql;
 
     if ((Lowest < PortSet->StartingPort) ||
@@ -95,11 +125,11 @@ ULONG AllocatePortFromRange( PPORT_SET PortSet, ULONG Lowest, ULONG Highest ) {
 
     Lowest -= PortSet->StartingPort;
     Highest -= PortSet->StartingPort;
+    Random = RtlRandomEx( &PortSet->Seed );
 
     KeAcquireSpinLock( &PortSet->Lock, &OldIrql );
-    AllocatedPort = RtlFindClearBits( &PortSet->ProtoBitmap, 1, Lowest );
-    if( AllocatedPort != (ULONG)-1 && AllocatedPort <= Highest) {
-	RtlSetBit( &PortSet->ProtoBitmap, AllocatedPort );
+    AllocatedPort = FindClearPort( PortSet, Lowest, Highest, Random );
+    if( AllocatedPort != (ULONG)-1 ) {
 	AllocatedPort += PortSet->StartingPort;
 	KeReleaseSpinLock( &PortSet->Lock, OldIrql );
 	return htons(AllocatedPort);
@@ -104,6 +104,16 @@ FlushSendQueue(PCONNECTION_ENDPOINT Connection, const NTSTATUS Status, const BOO
         while ((Entry = ExInterlockedRemoveHeadList(&Connection->SendRequest, &Connection->Lock)))
         {
             Bucket = CONTAINING_RECORD( Entry, TDI_BUCKET, Entry );    
+
+            /* lwIP still sends the part it took, complete it once that is acknowledged */
+            if ((Bucket->Flags & TDI_SEND_NO_COPY) && Bucket->Information && Connection->SocketContext)
+            {
+                Bucket->Status = STATUS_SUCCESS;
+                ExInterlockedInsertTailList(&Connection->SendAckRequest,
+                                            &Bucket->Entry,
+                                            &Connection->Lock);
+                continue;
+            }
         
             TI_DbgPrint(DEBUG_TCP,
                         ("Completing Send request: %x %x\n",
@@ -114,6 +124,18 @@ FlushSendQueue(PCONNECTION_ENDPOINT Connection, const NTSTATUS Status, const BOO
         
             CompleteBucket(Connection, Bucket, FALSE);
         }
+
+        /* Zero-copy data can only be given back once the PCB let go of it */
+        while (!Connection->SocketContext &&
+               (Entry = ExInterlockedRemoveHeadList(&Connection->SendAckRequest, &Connection->Lock)))
+        {
+            Bucket = CONTAINING_RECORD( Entry, TDI_BUCKET, Entry );
+
+            Bucket->Status = Status;
+            Bucket->Information = 0;
+
+            CompleteBucket(Connection, Bucket, FALSE);
+        }
     }
     else
     {
@@ -122,12 +144,79 @@ FlushSendQueue(PCONNECTION_ENDPOINT Connection, const NTSTATUS Status, const BOO
             Entry = RemoveHeadList(&Connection->SendRequest);
             
             Bucket = CONTAINING_RECORD(Entry, TDI_BUCKET, Entry);
+
+            if ((Bucket->Flags & TDI_SEND_NO_COPY) && Bucket->Information && Connection->SocketContext)
+            {
+                Bucket->Status = STATUS_SUCCESS;
+                InsertTailList(&Connection->SendAckRequest, &Bucket->Entry);
+                continue;
+            }
             
             Bucket->Information = 0;
             Bucket->Status = Status;
             
             CompleteBucket(Connection, Bucket, FALSE);
         }
+
+        while (!Connection->SocketContext && !IsListEmpty(&Connection->SendAckRequest))
+        {
+            Entry = RemoveHeadList(&Connection->SendAckRequest);
+
+            Bucket = CONTAINING_RECORD(Entry, TDI_BUCKET, Entry);
+
+            Bucket->Information = 0;
+            Bucket->Status = Status;
+
+            CompleteBucket(Connection, Bucket, FALSE);
+        }
+    }
+
+    DereferenceObject(Connection);
+}
+
+VOID
+CompleteAcknowledgedSends(PCONNECTION_ENDPOINT Connection, const BOOLEAN interlocked)
+{
+    PTDI_BUCKET Bucket;
+    PLIST_ENTRY Entry;
+
+    ReferenceObject(Connection);
+
+    /* The interlocked variant runs in the tcpip thread, which holds the lwIP core lock */
+    if (interlocked)
+    {
+        while ((Entry = ExInterlockedRemoveHeadList(&Connection->SendAckRequest, &Connection->Lock)))
+        {
+            Bucket = CONTAINING_RECORD( Entry, TDI_BUCKET, Entry );
+
+            if (!LibTCPSendAcknowledged(Connection, Bucket->Sequence, TRUE))
+            {
+                ExInterlockedInsertHeadList(&Connection->SendAckRequest,
+                                            &Bucket->Entry,
+                                            &Connection->Lock);
+                break;
+            }
+
+            TI_DbgPrint(DEBUG_TCP,
+                        ("Completing acknowledged Send request: %x\n",
+                         Bucket->Request));
+
+            CompleteBucket(Connection, Bucket, FALSE);
+        }
+    }
+    else
+    {
+        while (!IsListEmpty(&Connection->SendAckRequest))
+        {
+            Bucket = CONTAINING_RECORD(Connection->SendAckRequest.Flink, TDI_BUCKET, Entry);
+
+            if (!LibTCPSendAcknowledged(Connection, Bucket->Sequence, FALSE))
+                break;
+
+            RemoveEntryList(&Bucket->Entry);
+
+            CompleteBucket(Connection, Bucket, FALSE);
+        }
     }
 
     DereferenceObject(Connection);
@@ -368,6 +457,9 @@ TCPSendEventHandler(void *arg, const u16_t space)
     
     ReferenceObject(Connection);
 
+    /* Zero-copy sends complete once the peer acknowledged all of their data */
+    CompleteAcknowledgedSends(Connection, TRUE);
+
     while ((Entry = ExInterlockedRemoveHeadList(&Connection->SendRequest, &Connection->Lock)))
     {
         UINT SendLen = 0;
@@ -392,9 +484,33 @@ TCPSendEventHandler(void *arg, const u16_t space)
          ("Connection->SocketContext: %x\n",
           Connection->SocketContext));
         
-        Status = TCPTranslateError(LibTCPSend(Connection,
-                                              SendBuffer,
-                                              SendLen, &BytesSent, TRUE));
+        if (Bucket->Flags & TDI_SEND_NO_COPY)
+        {
+            /* Continue where the previous (partial) write stopped */
+            Status = TCPTranslateError(LibTCPSendNoCopy(Connection,
+                                                        (PCHAR)SendBuffer + Bucket->Information,
+                                                        SendLen - Bucket->Information,
+                                                        &BytesSent,
+                                                        &Bucket->Sequence,
+                                                        TRUE));
+            if (Status == STATUS_SUCCESS)
+            {
+                Bucket->Information += BytesSent;
+                if (Bucket->Information < SendLen)
+                    Status = STATUS_PENDING;
+            }
+            else if (Status != STATUS_PENDING && Bucket->Information)
+            {
+                /* Report the part lwIP already took, once it is acknowledged */
+                Status = STATUS_SUCCESS;
+            }
+        }
+        else
+        {
+            Status = TCPTranslateError(LibTCPSend(Connection,
+                                                  SendBuffer,
+                                                  SendLen, &BytesSent, TRUE));
+        }
         
         TI_DbgPrint(DEBUG_TCP,("TCP Bytes: %d\n", BytesSent));
         
@@ -405,6 +521,14 @@ TCPSendEventHandler(void *arg, const u16_t space)
                                         &Connection->Lock);
             break;
         }
+        else if ((Bucket->Flags & TDI_SEND_NO_COPY) && Status == STATUS_SUCCESS)
+        {
+            /* lwIP references the data until it is acknowledged */
+            Bucket->Status = STATUS_SUCCESS;
+            ExInterlockedInsertTailList(&Connection->SendAckRequest,
+                                        &Bucket->Entry,
+                                        &Connection->Lock);
+        }
         else
         {
             TI_DbgPrint(DEBUG_TCP,
@@ -7,6 +7,30 @@
 #include "lwip/api.h"
 #include "lwip/tcpip.h"
 
+static
+err_t
+TCPLoopbackInput(struct netif *netif, struct pbuf *p)
+{
+    struct pbuf *q;
+
+    /* The sender keeps its segment for retransmission and the receiver
+     * rewrites the headers in place, so it gets its own copy. Input is
+     * still queued to the tcpip thread since we hold the core lock */
+    q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+    if (!q)
+        return ERR_MEM;
+
+    pbuf_copy(q, p);
+
+    if (netif->input(q, netif) != ERR_OK)
+    {
+        pbuf_free(q);
+        return ERR_MEM;
+    }
+
+    return ERR_OK;
+}
+
 err_t
 TCPSendDataCallback(struct netif *netif, struct pbuf *p, struct ip_addr *dest)
 {
@@ -20,6 +44,11 @@ TCPSendDataCallback(struct netif *netif, struct pbuf *p, struct ip_addr *dest)
 
     /* The caller frees the pbuf struct */
 
+    /* Hand loopback segments straight to lwIP input, instead of building
+     * an IP packet that the loopback adapter copies and feeds back */
+    if (netif->state == Loopback)
+        return TCPLoopbackInput(netif, p);
+
     if (((*(u8_t*)p->payload) & 0xF0) == 0x40)
     {
         Header = p->payload;
@@ -107,6 +136,10 @@ TCPInterfaceInit(struct netif *netif)
     netif->name[1] = 'n';
     
     netif->flags |= NETIF_FLAG_BROADCAST;
+
+    /* Loopback packets never leave memory */
+    if (IF == Loopback)
+        NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_DISABLE_ALL);
     
     TCPUpdateInterfaceLinkStatus(IF);
     
@@ -40,17 +40,7 @@ DisconnectTimeoutDpc(PKDPC Dpc,
     /* We timed out waiting for pending sends so force it to shutdown */
     TCPTranslateError(LibTCPShutdown(Connection, 0, 1));
 
-    while (!IsListEmpty(&Connection->SendRequest))
-    {
-        Entry = RemoveHeadList(&Connection->SendRequest);
-        
-        Bucket = CONTAINING_RECORD(Entry, TDI_BUCKET, Entry);
-        
-        Bucket->Information = 0;
-        Bucket->Status = STATUS_FILE_CLOSED;
-        
-        CompleteBucket(Connection, Bucket, FALSE);
-    }
+    FlushSendQueue(Connection, STATUS_FILE_CLOSED, FALSE);
     
     while (!IsListEmpty(&Connection->ShutdownRequest))
     {
@@ -102,6 +92,7 @@ PCONNECTION_ENDPOINT TCPAllocateConnectionEndpoint( PVOID ClientContext )
     InitializeListHead(&Connection->ReceiveRequest);
     InitializeListHead(&Connection->SendRequest);
     InitializeListHead(&Connection->ShutdownRequest);
+    InitializeListHead(&Connection->SendAckRequest);
     InitializeListHead(&Connection->PacketQueue);
 
     /* Initialize disconnect timer */
@@ -521,6 +512,75 @@ NTSTATUS TCPReceiveData
     return Status;
 }
 
+static
+NTSTATUS
+TCPSendDataNoCopy(
+  PCONNECTION_ENDPOINT Connection,
+  PCHAR BufferData,
+  ULONG SendLength,
+  PULONG BytesSent,
+  ULONG Flags,
+  PTCP_COMPLETION_ROUTINE Complete,
+  PVOID Context )
+{
+    NTSTATUS Status = STATUS_PENDING;
+    PTDI_BUCKET Bucket;
+    ULONG Sent;
+
+    /* lwIP will reference the buffer, so the request stays queued until the data is acknowledged.
+     * Freed in CompleteAcknowledgedSends or FlushSendQueue */
+    Bucket = ExAllocateFromNPagedLookasideList(&TdiBucketLookasideList);
+    if (!Bucket)
+    {
+        TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Failed to allocate bucket\n"));
+        return STATUS_NO_MEMORY;
+    }
+
+    Bucket->Request.RequestNotifyObject = Complete;
+    Bucket->Request.RequestContext = Context;
+    Bucket->Flags = Flags;
+    Bucket->Information = 0;
+
+    /* Don't overtake requests that are still waiting for buffer space */
+    if (IsListEmpty(&Connection->SendRequest))
+    {
+        Status = TCPTranslateError(LibTCPSendNoCopy(Connection,
+                                                    BufferData,
+                                                    SendLength,
+                                                    &Sent,
+                                                    &Bucket->Sequence,
+                                                    FALSE));
+        if (Status == STATUS_SUCCESS)
+            Bucket->Information = Sent;
+    }
+
+    TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Zero-copy send: %x, %d of %d\n",
+                           Status, Bucket->Information, SendLength));
+
+    if (Status == STATUS_SUCCESS && Bucket->Information == SendLength)
+    {
+        Bucket->Status = STATUS_SUCCESS;
+        InsertTailList(&Connection->SendAckRequest, &Bucket->Entry);
+
+        /* The ACK may have come in before we queued the request */
+        CompleteAcknowledgedSends(Connection, FALSE);
+    }
+    else if (Status == STATUS_SUCCESS || Status == STATUS_PENDING)
+    {
+        /* TCPSendEventHandler writes the rest when there is room */
+        InsertTailList(&Connection->SendRequest, &Bucket->Entry);
+    }
+    else
+    {
+        ExFreeToNPagedLookasideList(&TdiBucketLookasideList, Bucket);
+        return Status;
+    }
+
+    /* Completion reports the byte count */
+    *BytesSent = 0;
+    return STATUS_PENDING;
+}
+
 NTSTATUS TCPSendData
 ( PCONNECTION_ENDPOINT Connection,
   PCHAR BufferData,
@@ -534,6 +594,10 @@ NTSTATUS TCPSendData
     PTDI_BUCKET Bucket;
     KIRQL OldIrql;
 
+    /* The tcpip thread takes the connection lock while it holds the lwIP core lock.
+     * Holding the core lock across the send also keeps TCPSendEventHandler from
+     * running before a pending request is queued */
+    LibTCPLockCore();
     LockObject(Connection, &OldIrql);
 
     TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Called for %d bytes (on socket %x)\n",
@@ -543,6 +607,16 @@ NTSTATUS TCPSendData
     TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Connection->SocketContext = %x\n",
                            Connection->SocketContext));
 
+    if (Flags & TDI_SEND_NO_COPY)
+    {
+        Status = TCPSendDataNoCopy(Connection, BufferData, SendLength, BytesSent, Flags, Complete, Context);
+
+        UnlockObject(Connection, OldIrql);
+        LibTCPUnlockCore();
+
+        return Status;
+    }
+
     Status = TCPTranslateError(LibTCPSend(Connection,
                                           BufferData,
                                           SendLength,
@@ -559,18 +633,21 @@ NTSTATUS TCPSendData
         if (!Bucket)
         {
             UnlockObject(Connection, OldIrql);
+            LibTCPUnlockCore();
             TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Failed to allocate bucket\n"));
             return STATUS_NO_MEMORY;
         }
         
         Bucket->Request.RequestNotifyObject = Complete;
         Bucket->Request.RequestContext = Context;
+        Bucket->Flags = Flags;
         
         InsertTailList( &Connection->SendRequest, &Bucket->Entry );
         TI_DbgPrint(DEBUG_TCP,("[IP, TCPSendData] Queued write irp\n"));
     }
 
     UnlockObject(Connection, OldIrql);
+    LibTCPUnlockCore();
 
     TI_DbgPrint(DEBUG_TCP, ("[IP, TCPSendData] Leaving. Status = %x\n", Status));
 
@@ -640,21 +717,24 @@ NTSTATUS TCPGetSockAddress
 BOOLEAN TCPRemoveIRP( PCONNECTION_ENDPOINT Endpoint, PIRP Irp )
 {
     PLIST_ENTRY Entry;
-    PLIST_ENTRY ListHead[5];
+    PLIST_ENTRY ListHead[6];
     KIRQL OldIrql;
     PTDI_BUCKET Bucket;
     UINT i = 0;
-    BOOLEAN Found = FALSE;
+    BOOLEAN Found = FALSE, Aborted = FALSE;
 
     ListHead[0] = &Endpoint->SendRequest;
     ListHead[1] = &Endpoint->ReceiveRequest;
     ListHead[2] = &Endpoint->ConnectRequest;
     ListHead[3] = &Endpoint->ListenRequest;
     ListHead[4] = &Endpoint->ShutdownRequest;
+    ListHead[5] = &Endpoint->SendAckRequest;
 
+    /* Unpinning a zero-copy send needs the lwIP core lock, which comes first */
+    LibTCPLockCore();
     LockObject(Endpoint, &OldIrql);
 
-    for( i = 0; i < 5; i++ )
+    for( i = 0; i < 6 && !Found; i++ )
     {
         for( Entry = ListHead[i]->Flink;
              Entry != ListHead[i];
@@ -663,6 +743,15 @@ BOOLEAN TCPRemoveIRP( PCONNECTION_ENDPOINT Endpoint, PIRP Irp )
             Bucket = CONTAINING_RECORD( Entry, TDI_BUCKET, Entry );
             if( Bucket->Request.RequestContext == Irp )
             {
+                /* lwIP may still point into a zero-copy buffer, give it a copy first.
+                 * If there is no memory for that, the PCB has been aborted instead */
+                if ((ListHead[i] == &Endpoint->SendRequest || ListHead[i] == &Endpoint->SendAckRequest) &&
+                    (Bucket->Flags & TDI_SEND_NO_COPY) && Bucket->Information &&
+                    LibTCPUnpinSendData(Endpoint) != ERR_OK)
+                {
+                    Aborted = TRUE;
+                }
+
                 RemoveEntryList( &Bucket->Entry );
                 ExFreeToNPagedLookasideList(&TdiBucketLookasideList, Bucket);
                 Found = TRUE;
@@ -673,6 +762,12 @@ BOOLEAN TCPRemoveIRP( PCONNECTION_ENDPOINT Endpoint, PIRP Irp )
 
     UnlockObject(Endpoint, OldIrql);
 
+    /* Fail the other requests the way the tcpip thread does when lwIP reports an error */
+    if (Aborted)
+        TCPFinEventHandler(Endpoint, ERR_ABRT);
+
+    LibTCPUnlockCore();
+
     return Found;
 }
 
@@ -691,6 +786,34 @@ TCPSetNoDelay(
     return STATUS_SUCCESS;
 }
 
+NTSTATUS
+TCPSetReceiveWindow(
+    PCONNECTION_ENDPOINT Connection,
+    ULONG Size)
+{
+    if (!Connection)
+        return STATUS_UNSUCCESSFUL;
+
+    if (Connection->SocketContext == NULL)
+        return STATUS_UNSUCCESSFUL;
+
+    return TCPTranslateError(LibTCPSetReceiveWindow(Connection, Size));
+}
+
+NTSTATUS
+TCPSetSendBuffer(
+    PCONNECTION_ENDPOINT Connection,
+    ULONG Size)
+{
+    if (!Connection)
+        return STATUS_UNSUCCESSFUL;
+
+    if (Connection->SocketContext == NULL)
+        return STATUS_UNSUCCESSFUL;
+
+    return TCPTranslateError(LibTCPSetSendBuffer(Connection, Size));
+}
+
 NTSTATUS
 TCPGetSocketStatus(
     PCONNECTION_ENDPOINT Connection,
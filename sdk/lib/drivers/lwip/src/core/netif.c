@@ -147,6 +147,7 @@ netif_add(struct netif *netif, ip_addr_t *ipaddr, ip_addr_t *netmask,
   ip_addr_set_zero(&netif->netmask);
   ip_addr_set_zero(&netif->gw);
   netif->flags = 0;
+  NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_ENABLE_ALL);
 #if LWIP_DHCP
   /* netif not under DHCP control by default */
   netif->dhcp = NULL;
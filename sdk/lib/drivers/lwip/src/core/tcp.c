@@ -172,7 +172,7 @@ tcp_close_shutdown(struct tcp_pcb *pcb, u8_t rst_on_unacked_data)
   err_t err;
 
   if (rst_on_unacked_data && ((pcb->state == ESTABLISHED) || (pcb->state == CLOSE_WAIT))) {
-    if ((pcb->refused_data != NULL) || (pcb->rcv_wnd != TCP_WND)) {
+    if ((pcb->refused_data != NULL) || (pcb->rcv_wnd != TCP_WND_MAX(pcb))) {
       /* Not all data received by application, send RST to tell the remote
          side about this. */
       LWIP_ASSERT("pcb->flags & TF_RXCLOSED", pcb->flags & TF_RXCLOSED);
@@ -580,7 +580,7 @@ u32_t tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
 {
   u32_t new_right_edge = pcb->rcv_nxt + pcb->rcv_wnd;
 
-  if (TCP_SEQ_GEQ(new_right_edge, pcb->rcv_ann_right_edge + LWIP_MIN((TCP_WND / 2), pcb->mss))) {
+  if (TCP_SEQ_GEQ(new_right_edge, pcb->rcv_ann_right_edge + LWIP_MIN((TCP_WND_MAX(pcb) / 2), pcb->mss))) {
     /* we can advertise more window */
     pcb->rcv_ann_wnd = pcb->rcv_wnd;
     return new_right_edge - pcb->rcv_ann_right_edge;
@@ -592,8 +592,10 @@ u32_t tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
     } else {
       /* keep the right edge of window constant */
       u32_t new_rcv_ann_wnd = pcb->rcv_ann_right_edge - pcb->rcv_nxt;
+#if !LWIP_WND_SCALE
       LWIP_ASSERT("new_rcv_ann_wnd <= 0xffff", new_rcv_ann_wnd <= 0xffff);
-      pcb->rcv_ann_wnd = (u16_t)new_rcv_ann_wnd;
+#endif
+      pcb->rcv_ann_wnd = (tcpwnd_size_t)new_rcv_ann_wnd;
     }
     return 0;
   }
@@ -616,11 +618,11 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
   LWIP_ASSERT("don't call tcp_recved for listen-pcbs",
     pcb->state != LISTEN);
   LWIP_ASSERT("tcp_recved: len would wrap rcv_wnd\n",
-              len <= 0xffff - pcb->rcv_wnd );
+              len <= (tcpwnd_size_t)~0 - pcb->rcv_wnd );
 
   pcb->rcv_wnd += len;
-  if (pcb->rcv_wnd > TCP_WND) {
-    pcb->rcv_wnd = TCP_WND;
+  if (pcb->rcv_wnd > TCP_WND_MAX(pcb)) {
+    pcb->rcv_wnd = TCP_WND_MAX(pcb);
   }
 
   wnd_inflation = tcp_update_rcv_ann_wnd(pcb);
@@ -634,8 +636,76 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
     tcp_output(pcb);
   }
 
-  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"U16_F" (%"U16_F").\n",
-         len, pcb->rcv_wnd, TCP_WND - pcb->rcv_wnd));
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"U32_F" (%"U32_F").\n",
+         len, (u32_t)pcb->rcv_wnd, (u32_t)(TCP_WND_MAX(pcb) - pcb->rcv_wnd)));
+}
+
+/**
+ * Set the receive window offered by a pcb (SO_RCVBUF). Shrinking the
+ * window never moves the right edge that has already been announced,
+ * growing it is announced right away.
+ *
+ * @param pcb the tcp_pcb to change the receive window of
+ * @param wnd the new receive window in bytes
+ */
+void
+tcp_setrcvwnd(struct tcp_pcb *pcb, tcpwnd_size_t wnd)
+{
+  tcpwnd_size_t old_max;
+
+  LWIP_ASSERT("don't call tcp_setrcvwnd for listen-pcbs",
+    pcb->state != LISTEN);
+
+  wnd = LWIP_MAX(wnd, pcb->mss);
+#if LWIP_WND_SCALE
+  wnd = LWIP_MIN(wnd, 0xFFFFUL << TCP_RCV_SCALE);
+#endif
+
+  old_max = TCP_WND_MAX(pcb);
+  pcb->rcv_wnd_max = wnd;
+  if (TCP_WND_MAX(pcb) > old_max) {
+    pcb->rcv_wnd += TCP_WND_MAX(pcb) - old_max;
+  } else if (pcb->rcv_wnd > TCP_WND_MAX(pcb)) {
+    pcb->rcv_wnd = TCP_WND_MAX(pcb);
+  }
+
+  if ((pcb->state != CLOSED) && (pcb->state != SYN_SENT) &&
+      (tcp_update_rcv_ann_wnd(pcb) >= TCP_WND_UPDATE_THRESHOLD)) {
+    tcp_ack_now(pcb);
+    tcp_output(pcb);
+  }
+
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_setrcvwnd: wnd %"U32_F" (max %"U32_F").\n",
+         (u32_t)pcb->rcv_wnd, (u32_t)TCP_WND_MAX(pcb)));
+}
+
+/**
+ * Set the send buffer space of a pcb (SO_SNDBUF). Data that is already
+ * queued is kept, if it exceeds the new size, no new data is accepted
+ * until enough of it has been acknowledged.
+ *
+ * @param pcb the tcp_pcb to change the send buffer of
+ * @param len the new send buffer size in bytes
+ */
+void
+tcp_setsndbuf(struct tcp_pcb *pcb, tcpwnd_size_t len)
+{
+  tcpwnd_size_t used;
+
+  LWIP_ASSERT("don't call tcp_setsndbuf for listen-pcbs",
+    pcb->state != LISTEN);
+
+  len = LWIP_MAX(len, 2 * pcb->mss);
+#if LWIP_WND_SCALE
+  len = LWIP_MIN(len, 0xFFFFUL << TCP_RCV_SCALE);
+#endif
+
+  used = (pcb->snd_buf_max > pcb->snd_buf) ? pcb->snd_buf_max - pcb->snd_buf : 0;
+  pcb->snd_buf_max = len;
+  pcb->snd_buf = (len > used) ? len - used : 0;
+
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_setsndbuf: snd_buf %"U32_F" (max %"U32_F").\n",
+         (u32_t)pcb->snd_buf, (u32_t)pcb->snd_buf_max));
 }
 
 /**
@@ -743,8 +813,8 @@ tcp_connect(struct tcp_pcb *pcb, ip_addr_t *ipaddr, u16_t port,
   pcb->snd_nxt = iss;
   pcb->lastack = iss - 1;
   pcb->snd_lbb = iss - 1;
-  pcb->rcv_wnd = TCP_WND;
-  pcb->rcv_ann_wnd = TCP_WND;
+  pcb->rcv_wnd = TCP_WND_MAX(pcb);
+  pcb->rcv_ann_wnd = TCP_WND_MAX(pcb);
   pcb->rcv_ann_right_edge = pcb->rcv_nxt;
   pcb->snd_wnd = TCP_WND;
   /* As initial send MSS, we use TCP_MSS but limit it to 536.
@@ -788,7 +858,7 @@ void
 tcp_slowtmr(void)
 {
   struct tcp_pcb *pcb, *prev;
-  u16_t eff_wnd;
+  tcpwnd_size_t eff_wnd;
   u8_t pcb_remove;      /* flag if a PCB should be removed */
   u8_t pcb_reset;       /* flag if a RST should be sent when removing */
   err_t err;
@@ -867,9 +937,9 @@ tcp_slowtmr_start:
             pcb->ssthresh = (pcb->mss << 1);
           }
           pcb->cwnd = pcb->mss;
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"U16_F
-                                       " ssthresh %"U16_F"\n",
-                                       pcb->cwnd, pcb->ssthresh));
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"U32_F
+                                       " ssthresh %"U32_F"\n",
+                                       (u32_t)pcb->cwnd, (u32_t)pcb->ssthresh));
  
           /* The following needs to be called AFTER cwnd is set to one
              mss - STJ */
@@ -1098,7 +1168,7 @@ tcp_process_refused_data(struct tcp_pcb *pcb)
     if (refused_flags & PBUF_FLAG_TCP_FIN) {
       /* correct rcv_wnd as the application won't call tcp_recved()
          for the FIN's seqno */
-      if (pcb->rcv_wnd != TCP_WND) {
+      if (pcb->rcv_wnd != TCP_WND_MAX(pcb)) {
         pcb->rcv_wnd++;
       }
       TCP_EVENT_CLOSED(pcb, err);
@@ -1307,9 +1377,13 @@ tcp_alloc(u8_t prio)
     memset(pcb, 0, sizeof(struct tcp_pcb));
     pcb->prio = prio;
     pcb->snd_buf = TCP_SND_BUF;
+    pcb->snd_buf_max = TCP_SND_BUF;
     pcb->snd_queuelen = 0;
-    pcb->rcv_wnd = TCP_WND;
-    pcb->rcv_ann_wnd = TCP_WND;
+    /* Start with a window that does not require scaling, it is
+       opened up once window scaling has been negotiated. */
+    pcb->rcv_wnd_max = TCP_WND;
+    pcb->rcv_wnd = TCPWND16(TCP_WND);
+    pcb->rcv_ann_wnd = TCPWND16(TCP_WND);
     pcb->tos = 0;
     pcb->ttl = TCP_TTL;
     /* As initial send MSS, we use TCP_MSS but limit it to 536.
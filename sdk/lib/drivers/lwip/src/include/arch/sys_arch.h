@@ -7,6 +7,15 @@ typedef struct _sys_sem_t
     int Valid;
 } sys_sem_t;
 
+typedef struct _sys_mutex_t
+{
+    KSPIN_LOCK Lock;
+    KIRQL OldIrql;
+    PKTHREAD Owner;
+    ULONG RecursionCount;
+    int Valid;
+} sys_mutex_t;
+
 typedef struct _sys_mbox_t
 {
     KSPIN_LOCK Lock;
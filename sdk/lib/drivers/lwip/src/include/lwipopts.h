@@ -10,7 +10,11 @@
 
 /* Define LWIP_COMPAT_MUTEX if the port has no mutexes and binary semaphores
  should be used instead */
-#define LWIP_COMPAT_MUTEX               1
+#define LWIP_COMPAT_MUTEX               0
+
+/* Lets rostcp.c call the raw API from the caller's thread while holding the
+ * core lock, instead of going through the tcpip thread (see sys_arch.c) */
+#define LWIP_TCPIP_CORE_LOCKING         1
 
 #define MEM_ALIGNMENT                   4
 
@@ -56,18 +60,31 @@
 
 #define SO_REUSE_RXTOALL                1
 
-/* FIXME: These MSS and TCP Window definitions assume an MTU
- * of 1500. We need to add some code to lwIP which would allow us
- * to change these values based upon the interface we are 
- * using. Currently ReactOS only supports Ethernet so we're
- * fine for now but it does need to be fixed later when we
- * add support for other transport mediums */
-#define TCP_MSS                         1460
+/* TCP_MSS is the largest MSS of any interface, which is the loopback
+ * one (its MTU of 65535 less the IP and TCP headers). Connections use
+ * the MSS of the interface they go through, tcp_eff_send_mss() limits
+ * it to the MTU. The queue limits below are sized for Ethernet
+ * segments, which are the smallest ones we send */
+#define TCP_MSS                         (0xFFFF - 40)
+#define TCP_ETH_MSS                     1460
+
+/* Window scaling (RFC 7323) lets a connection keep more than 64k in
+ * flight. TCP_WND and TCP_SND_BUF are the defaults, SO_RCVBUF and
+ * SO_SNDBUF may raise them per connection up to TCP_WND_LIMIT */
+#define LWIP_WND_SCALE                  1
+
+#define TCP_RCV_SCALE                   4
 
-#define TCP_WND                         0xFFFF
+#define TCP_WND_LIMIT                   (0xFFFFUL << TCP_RCV_SCALE)
+
+#define TCP_WND                         0x40000
 
 #define TCP_SND_BUF                     TCP_WND
 
+#define TCP_SND_QUEUELEN                ((4 * (TCP_WND_LIMIT) + (TCP_ETH_MSS - 1))/(TCP_ETH_MSS))
+#define TCP_WND_UPDATE_THRESHOLD        LWIP_MIN((TCP_WND / 4), (TCP_ETH_MSS * 4))
+#define TCP_OVERSIZE                    TCP_ETH_MSS
+
 #define TCP_MAXRTX                      8
 
 #define TCP_SYNMAXRTX                   4
@@ -80,6 +97,10 @@
 
 #define LWIP_NETIF_API                  1
 
+/* Loopback packets never leave memory, so that interface neither
+ * generates nor checks checksums (see TCPInterfaceInit) */
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
+
 #define LWIP_SOCKET                     0
 
 #define LWIP_NETCONN                    0
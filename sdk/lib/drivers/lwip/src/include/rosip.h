@@ -40,11 +40,6 @@ struct lwip_callback_msg
             PCONNECTION_ENDPOINT Connection;
             u8_t Backlog;
         } Listen;
-        struct {
-            PCONNECTION_ENDPOINT Connection;
-            void *Data;
-            u16_t DataLength;
-        } Send;
         struct {
             PCONNECTION_ENDPOINT Connection;
             struct ip_addr *IpAddress;
@@ -72,10 +67,6 @@ struct lwip_callback_msg
         struct {
             struct tcp_pcb *NewPcb;
         } Listen;
-        struct {
-            err_t Error;
-            u32_t Information;
-        } Send;
         struct {
             err_t Error;
         } Connect;
@@ -98,10 +89,15 @@ extern void TCPFinEventHandler(void *arg, const err_t err);
 extern void TCPRecvEventHandler(void *arg);
 
 /* TCP functions */
+void        LibTCPLockCore(void);
+void        LibTCPUnlockCore(void);
 PTCP_PCB    LibTCPSocket(void *arg);
 err_t       LibTCPBind(PCONNECTION_ENDPOINT Connection, struct ip_addr *const ipaddr, const u16_t port);
 PTCP_PCB    LibTCPListen(PCONNECTION_ENDPOINT Connection, const u8_t backlog);
-err_t       LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u16_t len, u32_t *sent, const int safe);
+err_t       LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u32_t len, u32_t *sent, const int safe);
+err_t       LibTCPSendNoCopy(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u32_t len, u32_t *sent, u32_t *const seqno, const int safe);
+int         LibTCPSendAcknowledged(PCONNECTION_ENDPOINT Connection, const u32_t seqno, const int safe);
+err_t       LibTCPUnpinSendData(PCONNECTION_ENDPOINT Connection);
 err_t       LibTCPConnect(PCONNECTION_ENDPOINT Connection, struct ip_addr *const ipaddr, const u16_t port);
 err_t       LibTCPShutdown(PCONNECTION_ENDPOINT Connection, const int shut_rx, const int shut_tx);
 err_t       LibTCPClose(PCONNECTION_ENDPOINT Connection, const int safe, const int callback);
@@ -110,6 +106,8 @@ err_t       LibTCPGetPeerName(PTCP_PCB pcb, struct ip_addr *const ipaddr, u16_t
 err_t       LibTCPGetHostName(PTCP_PCB pcb, struct ip_addr *const ipaddr, u16_t *const port);
 void        LibTCPAccept(PTCP_PCB pcb, struct tcp_pcb *listen_pcb, void *arg);
 void        LibTCPSetNoDelay(PTCP_PCB pcb, BOOLEAN Set);
+err_t       LibTCPSetReceiveWindow(PCONNECTION_ENDPOINT Connection, const u32_t size);
+err_t       LibTCPSetSendBuffer(PCONNECTION_ENDPOINT Connection, const u32_t size);
 void        LibTCPGetSocketStatus(PTCP_PCB pcb, PULONG State);
 
 /* IP functions */
@@ -1,6 +1,7 @@
 #include "lwip/sys.h"
 #include "lwip/netif.h"
 #include "lwip/tcpip.h"
+#include "lwip/tcp_impl.h"
 
 #include "rosip.h"
 
@@ -28,6 +29,20 @@ static const char * const tcp_state_str[] = {
  * a lot of unnecessary thread swapping and it could definitely be faster, but I don't want
  * to going messing around in lwIP because I have no desire to create another mess like oskittcp */
 
+/* The exception are the data paths (send, freeing received data and buffer sizes), which
+ * take the core lock (LWIP_TCPIP_CORE_LOCKING) and call the raw API from the caller's thread.
+ * The tcpip thread holds the same lock while it processes messages and timers, and all of
+ * our event handlers take the connection lock under it. So the core lock always comes first:
+ * a caller that needs both takes the core lock (LibTCPLockCore) before the connection lock,
+ * and nothing takes the core lock while it holds only the connection lock. Connection
+ * setup and teardown still go through the tcpip thread: registering a PCB arms the lwIP
+ * timers, and closing calls back into TCPFinEventHandler, which takes the connection lock
+ * our callers already hold. */
+
+/* Large sends may be queued without copying (LibTCPSendNoCopy). The segments then point
+ * into the caller's locked pages until the peer acknowledges them, so before we hand a PCB
+ * over to lwIP for good, or cancel such a send, we replace those pages with copies. */
+
 extern KEVENT TerminationEvent;
 extern NPAGED_LOOKASIDE_LIST MessageLookasideList;
 extern NPAGED_LOOKASIDE_LIST QueueEntryLookasideList;
@@ -137,6 +152,17 @@ NTSTATUS LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHA
             Copied = pbuf_copy_partial(p, RecvBuffer, ReadLength, Offset);
             ASSERT(Copied == ReadLength);
 
+            if (qp != NULL)
+            {
+                /* We may be outside the tcpip thread here. The core lock is
+                 * never taken under the connection lock */
+                LOCK_TCPIP_CORE();
+                pbuf_free(qp->p);
+                UNLOCK_TCPIP_CORE();
+
+                ExFreeToNPagedLookasideList(&QueueEntryLookasideList, qp);
+            }
+
             LockObject(Connection, &OldIrql);
 
             /* Update trackers */
@@ -144,18 +170,8 @@ NTSTATUS LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHA
             RecvBuffer += ReadLength;
             (*Received) += ReadLength;
 
-            if (qp != NULL)
-            {
-                /* Use this special pbuf free callback function because we're outside tcpip thread */
-                pbuf_free_callback(qp->p);
-
-                ExFreeToNPagedLookasideList(&QueueEntryLookasideList, qp);
-            }
-            else
-            {
-                /* If we get here, it means we've filled the buffer */
-                ASSERT(RecvLen == 0);
-            }
+            /* If we kept part of the packet, it means we've filled the buffer */
+            ASSERT(qp != NULL || RecvLen == 0);
 
             ASSERT((*Received) != 0);
             Status = STATUS_SUCCESS;
@@ -202,6 +218,56 @@ WaitForEventSafely(PRKEVENT Event)
     }
 }
 
+static
+err_t
+LibTCPUnpinSegments(struct tcp_seg *seg)
+{
+    struct pbuf *p, *q;
+
+    for (; seg != NULL; seg = seg->next)
+    {
+        /* The first pbuf holds the headers, zero-copy data is chained behind it as PBUF_ROM */
+        for (p = seg->p; p->next != NULL; p = p->next)
+        {
+            if (p->next->type != PBUF_ROM)
+                continue;
+
+            q = pbuf_alloc(PBUF_RAW, p->next->len, PBUF_RAM);
+            if (!q)
+                return ERR_MEM;
+
+            MEMCPY(q->payload, p->next->payload, p->next->len);
+            q->tot_len = p->next->tot_len;
+            q->next = p->next->next;
+
+            p->next->next = NULL;
+            pbuf_free(p->next);
+            p->next = q;
+        }
+    }
+
+    return ERR_OK;
+}
+
+/* Must be called in the tcpip thread (or with the core lock held) before the PCB is detached
+ * from its connection while it may still hold data of zero-copy sends */
+static
+err_t
+LibTCPUnpinPcb(PTCP_PCB pcb)
+{
+    err_t Error;
+
+    /* Listening PCBs are smaller and never hold data */
+    if (pcb->state == LISTEN)
+        return ERR_OK;
+
+    Error = LibTCPUnpinSegments(pcb->unacked);
+    if (Error == ERR_OK)
+        Error = LibTCPUnpinSegments(pcb->unsent);
+
+    return Error;
+}
+
 static
 err_t
 InternalSendEventHandler(void *arg, PTCP_PCB pcb, const u16_t space)
@@ -219,6 +285,7 @@ err_t
 InternalRecvEventHandler(void *arg, PTCP_PCB pcb, struct pbuf *p, const err_t err)
 {
     PCONNECTION_ENDPOINT Connection = arg;
+    err_t Error = ERR_OK;
 
     /* Make sure the socket didn't get closed */
     if (!arg)
@@ -249,6 +316,10 @@ InternalRecvEventHandler(void *arg, PTCP_PCB pcb, struct pbuf *p, const err_t er
         /* If we already did a send shutdown, we're in TIME_WAIT so we can't use this PCB anymore */
         if (Connection->SendShutdown)
         {
+            /* Our FIN may still be unacknowledged along with the data before it */
+            if (LibTCPUnpinPcb(pcb) != ERR_OK)
+                Error = ERR_ABRT;
+
             Connection->SocketContext = NULL;
             tcp_arg(pcb, NULL);
         }
@@ -261,9 +332,13 @@ InternalRecvEventHandler(void *arg, PTCP_PCB pcb, struct pbuf *p, const err_t er
         {
             TCPFinEventHandler(Connection, ERR_CLSD);
         }
+
+        /* We could not copy the data still referenced, drop the PCB instead */
+        if (Error == ERR_ABRT)
+            tcp_abort(pcb);
     }
 
-    return ERR_OK;
+    return Error;
 }
 
 /* This function MUST return an error value that is not ERR_ABRT or ERR_OK if the connection
@@ -472,36 +547,41 @@ LibTCPListen(PCONNECTION_ENDPOINT Connection, const u8_t backlog)
     return NULL;
 }
 
-static
 void
-LibTCPSendCallback(void *arg)
+LibTCPLockCore(void)
 {
-    struct lwip_callback_msg *msg = arg;
-    PTCP_PCB pcb = msg->Input.Send.Connection->SocketContext;
-    ULONG SendLength;
+    LOCK_TCPIP_CORE();
+}
+
+void
+LibTCPUnlockCore(void)
+{
+    UNLOCK_TCPIP_CORE();
+}
+
+static
+err_t
+LibTCPSendLocked(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u32_t len, u32_t *sent, const int copy, const int output)
+{
+    PTCP_PCB pcb = Connection->SocketContext;
+    ULONG SendLength, ChunkLength, Sent;
     UCHAR SendFlags;
+    err_t Error;
 
-    ASSERT(msg);
+    *sent = 0;
 
-    if (!msg->Input.Send.Connection->SocketContext)
-    {
-        msg->Output.Send.Error = ERR_CLSD;
-        goto done;
-    }
+    if (!pcb)
+        return ERR_CLSD;
 
-    if (msg->Input.Send.Connection->SendShutdown)
-    {
-        msg->Output.Send.Error = ERR_CLSD;
-        goto done;
-    }
+    if (Connection->SendShutdown)
+        return ERR_CLSD;
 
-    SendFlags = TCP_WRITE_FLAG_COPY;
-    SendLength = msg->Input.Send.DataLength;
+    SendFlags = copy ? TCP_WRITE_FLAG_COPY : 0;
+    SendLength = len;
     if (tcp_sndbuf(pcb) == 0)
     {
         /* No buffer space so return pending */
-        msg->Output.Send.Error = ERR_INPROGRESS;
-        goto done;
+        return ERR_INPROGRESS;
     }
     else if (tcp_sndbuf(pcb) < SendLength)
     {
@@ -512,61 +592,141 @@ LibTCPSendCallback(void *arg)
         SendFlags |= TCP_WRITE_FLAG_MORE;
     }
 
-    msg->Output.Send.Error = tcp_write(pcb,
-                                       msg->Input.Send.Data,
-                                       SendLength,
-                                       SendFlags);
-    if (msg->Output.Send.Error == ERR_OK)
+    /* tcp_write takes at most 64k at a time, only the last piece may push */
+    Sent = 0;
+    do
+    {
+        ChunkLength = min(SendLength - Sent, 0xFFFF);
+        Error = tcp_write(pcb,
+                          (PUCHAR)dataptr + Sent,
+                          (u16_t)ChunkLength,
+                          (Sent + ChunkLength < SendLength) ?
+                              SendFlags | TCP_WRITE_FLAG_MORE : SendFlags);
+        if (Error != ERR_OK)
+            break;
+
+        Sent += ChunkLength;
+    } while (Sent < SendLength);
+
+    if (Sent != 0)
     {
-        /* Queued successfully so try to send it */
-        tcp_output((PTCP_PCB)msg->Input.Send.Connection->SocketContext);
-        msg->Output.Send.Information = SendLength;
+        /* Queued successfully (maybe partially) so try to send it */
+        if (output)
+            tcp_output(pcb);
+
+        *sent = Sent;
+        return ERR_OK;
     }
-    else if (msg->Output.Send.Error == ERR_MEM)
+    else if (Error == ERR_MEM)
     {
         /* The queue is too long */
-        msg->Output.Send.Error = ERR_INPROGRESS;
+        return ERR_INPROGRESS;
     }
 
-done:
-    KeSetEvent(&msg->Event, IO_NO_INCREMENT, FALSE);
+    return Error;
 }
 
 err_t
-LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u16_t len, u32_t *sent, const int safe)
+LibTCPSend(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u32_t len, u32_t *sent, const int safe)
 {
     err_t ret;
-    struct lwip_callback_msg *msg;
 
-    msg = ExAllocateFromNPagedLookasideList(&MessageLookasideList);
-    if (msg)
+    /* Safe callers are the sent event handler in the tcpip thread. tcp_input calls
+     * tcp_output once it returns, so all the sends it queued go out together */
+    if (safe)
+        return LibTCPSendLocked(Connection, dataptr, len, sent, TRUE, FALSE);
+
+    LOCK_TCPIP_CORE();
+    ret = LibTCPSendLocked(Connection, dataptr, len, sent, TRUE, TRUE);
+    UNLOCK_TCPIP_CORE();
+
+    return ret;
+}
+
+/* Queues the data without copying it. lwIP references the caller's buffer until the peer
+ * acknowledges it, so it must stay valid until LibTCPSendAcknowledged returns TRUE for the
+ * sequence number returned in *seqno, or until the connection is torn down */
+err_t
+LibTCPSendNoCopy(PCONNECTION_ENDPOINT Connection, void *const dataptr, const u32_t len, u32_t *sent, u32_t *const seqno, const int safe)
+{
+    err_t ret;
+
+    if (!safe)
+        LOCK_TCPIP_CORE();
+
+    ret = LibTCPSendLocked(Connection, dataptr, len, sent, FALSE, !safe);
+    if (ret == ERR_OK)
+        *seqno = ((PTCP_PCB)Connection->SocketContext)->snd_lbb;
+
+    if (!safe)
+        UNLOCK_TCPIP_CORE();
+
+    return ret;
+}
+
+/* Returns TRUE once no queued segment holds data before seqno. lwIP keeps partially
+ * acknowledged segments whole, so no part of a buffer is released early */
+int
+LibTCPSendAcknowledged(PCONNECTION_ENDPOINT Connection, const u32_t seqno, const int safe)
+{
+    PTCP_PCB pcb;
+    u32_t oldest;
+    int ret = TRUE;
+
+    if (!safe)
+        LOCK_TCPIP_CORE();
+
+    pcb = Connection->SocketContext;
+    if (pcb)
     {
-        KeInitializeEvent(&msg->Event, NotificationEvent, FALSE);
-        msg->Input.Send.Connection = Connection;
-        msg->Input.Send.Data = dataptr;
-        msg->Input.Send.DataLength = len;
+        /* Retransmissions move segments from unacked back to unsent */
+        if (pcb->unacked)
+        {
+            oldest = ntohl(pcb->unacked->tcphdr->seqno);
+            if (pcb->unsent && TCP_SEQ_LT(ntohl(pcb->unsent->tcphdr->seqno), oldest))
+                oldest = ntohl(pcb->unsent->tcphdr->seqno);
 
-        if (safe)
-            LibTCPSendCallback(msg);
-        else
-            tcpip_callback_with_block(LibTCPSendCallback, msg, 1);
+            ret = TCP_SEQ_LEQ(seqno, oldest);
+        }
+        else if (pcb->unsent)
+        {
+            ret = TCP_SEQ_LEQ(seqno, ntohl(pcb->unsent->tcphdr->seqno));
+        }
+    }
 
-        if (WaitForEventSafely(&msg->Event))
-            ret = msg->Output.Send.Error;
-        else
-            ret = ERR_CLSD;
+    if (!safe)
+        UNLOCK_TCPIP_CORE();
 
-        if (ret == ERR_OK)
-            *sent = msg->Output.Send.Information;
-        else
-            *sent = 0;
+    return ret;
+}
 
-        ExFreeToNPagedLookasideList(&MessageLookasideList, msg);
+/* Used when a zero-copy send is cancelled before its data was acknowledged. If the data
+ * cannot be copied, the PCB is detached and aborted and the caller must finish the
+ * connection with TCPFinEventHandler once it has dropped the connection lock */
+err_t
+LibTCPUnpinSendData(PCONNECTION_ENDPOINT Connection)
+{
+    PTCP_PCB pcb;
+    err_t ret = ERR_OK;
 
-        return ret;
+    LOCK_TCPIP_CORE();
+
+    pcb = Connection->SocketContext;
+    if (pcb)
+    {
+        ret = LibTCPUnpinPcb(pcb);
+        if (ret != ERR_OK)
+        {
+            /* lwIP would keep sending from the caller's pages, reset the connection instead */
+            Connection->SocketContext = NULL;
+            tcp_arg(pcb, NULL);
+            tcp_abort(pcb);
+        }
     }
 
-    return ERR_MEM;
+    UNLOCK_TCPIP_CORE();
+
+    return ret;
 }
 
 static
@@ -647,6 +807,15 @@ LibTCPShutdownCallback(void *arg)
      * PCB without telling us if we shutdown TX and RX. To avoid these problems, we'll clear the
      * socket context if we have called shutdown for TX and RX.
      */
+    /* Once both directions are shut the PCB is not ours anymore (see below) */
+    if ((msg->Input.Shutdown.shut_rx || msg->Input.Shutdown.Connection->ReceiveShutdown) &&
+        (msg->Input.Shutdown.shut_tx || msg->Input.Shutdown.Connection->SendShutdown))
+    {
+        msg->Output.Shutdown.Error = LibTCPUnpinPcb(pcb);
+        if (msg->Output.Shutdown.Error)
+            goto done;
+    }
+
     if (msg->Input.Shutdown.shut_rx) {
         msg->Output.Shutdown.Error = tcp_shutdown(pcb, TRUE, FALSE);
     }
@@ -741,9 +910,18 @@ LibTCPCloseCallback(void *arg)
     msg->Input.Close.Connection->SocketContext = NULL;
     tcp_arg(pcb, NULL);
 
-    /* This may generate additional callbacks but we don't care,
-     * because they're too inconsistent to rely on */
-    msg->Output.Close.Error = tcp_close(pcb);
+    if (LibTCPUnpinPcb(pcb) != ERR_OK)
+    {
+        /* lwIP would keep sending from the caller's pages, reset the connection instead */
+        tcp_abort(pcb);
+        msg->Output.Close.Error = ERR_OK;
+    }
+    else
+    {
+        /* This may generate additional callbacks but we don't care,
+         * because they're too inconsistent to rely on */
+        msg->Output.Close.Error = tcp_close(pcb);
+    }
 
     if (msg->Output.Close.Error)
     {
@@ -841,6 +1019,51 @@ LibTCPSetNoDelay(
         pcb->flags &= ~TF_NODELAY;
 }
 
+static
+err_t
+LibTCPSetBuffer(PCONNECTION_ENDPOINT Connection, const u32_t size, const int receive)
+{
+    PTCP_PCB pcb;
+    err_t ret = ERR_OK;
+
+    LOCK_TCPIP_CORE();
+
+    pcb = Connection->SocketContext;
+    if (!pcb)
+    {
+        ret = ERR_CLSD;
+    }
+    else if (pcb->state == LISTEN)
+    {
+        /* Listening PCBs don't carry any buffers */
+        ret = ERR_VAL;
+    }
+    else if (receive)
+    {
+        tcp_setrcvwnd(pcb, size);
+    }
+    else
+    {
+        tcp_setsndbuf(pcb, size);
+    }
+
+    UNLOCK_TCPIP_CORE();
+
+    return ret;
+}
+
+err_t
+LibTCPSetReceiveWindow(PCONNECTION_ENDPOINT Connection, const u32_t size)
+{
+    return LibTCPSetBuffer(Connection, size, TRUE);
+}
+
+err_t
+LibTCPSetSendBuffer(PCONNECTION_ENDPOINT Connection, const u32_t size)
+{
+    return LibTCPSetBuffer(Connection, size, FALSE);
+}
+
 void
 LibTCPGetSocketStatus(
     PTCP_PCB pcb,
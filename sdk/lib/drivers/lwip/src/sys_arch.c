@@ -129,6 +129,71 @@ sys_arch_sem_wait(sys_sem_t* sem, u32_t timeout)
     return SYS_ARCH_TIMEOUT;
 }
 
+err_t
+sys_mutex_new(sys_mutex_t *mutex)
+{
+    /* The only mutex is the core lock. It may be taken at DISPATCH_LEVEL and the
+     * connection spin locks are taken under it (see rostcp.c), so it has to be
+     * a spin lock too */
+    KeInitializeSpinLock(&mutex->Lock);
+
+    mutex->Owner = NULL;
+    mutex->RecursionCount = 0;
+    mutex->Valid = 1;
+
+    return ERR_OK;
+}
+
+void
+sys_mutex_lock(sys_mutex_t *mutex)
+{
+    KIRQL OldIrql;
+
+    /* Event handlers running under the core lock may call back into code that takes it */
+    if (mutex->Owner == KeGetCurrentThread())
+    {
+        mutex->RecursionCount++;
+        return;
+    }
+
+    KeAcquireSpinLock(&mutex->Lock, &OldIrql);
+
+    mutex->OldIrql = OldIrql;
+    mutex->Owner = KeGetCurrentThread();
+    mutex->RecursionCount = 1;
+}
+
+void
+sys_mutex_unlock(sys_mutex_t *mutex)
+{
+    ASSERT(mutex->Owner == KeGetCurrentThread());
+    ASSERT(mutex->RecursionCount != 0);
+
+    if (--mutex->RecursionCount != 0)
+        return;
+
+    mutex->Owner = NULL;
+    KeReleaseSpinLock(&mutex->Lock, mutex->OldIrql);
+}
+
+void
+sys_mutex_free(sys_mutex_t *mutex)
+{
+    ASSERT(mutex->Owner == NULL);
+
+    sys_mutex_set_invalid(mutex);
+}
+
+int sys_mutex_valid(sys_mutex_t *mutex)
+{
+    return mutex->Valid;
+}
+
+void sys_mutex_set_invalid(sys_mutex_t *mutex)
+{
+    mutex->Valid = 0;
+}
+
 err_t
 sys_mbox_new(sys_mbox_t *mbox, int size)
 {    
@@ -11,37 +11,21 @@
 #define NDEBUG
 #include <debug.h>
 
-typedef union
-{
-  ULONG ul;
-  struct
-  {
-    UCHAR red;
-    UCHAR green;
-    UCHAR blue;
-    UCHAR alpha;
-  } col;
-} NICEPIXEL32;
-
-static __inline UCHAR
-Clamp8(ULONG val)
-{
-  return (val > 255) ? 255 : (UCHAR)val;
-}
-
 BOOLEAN
 DIB_XXBPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
                      XLATEOBJ* ColorTranslation, BLENDOBJ* BlendObj)
 {
-  INT DstX, DstY, SrcX, SrcY;
+  INT DstX, DstY;
   BLENDFUNCTION BlendFunc;
-  register NICEPIXEL32 DstPixel32;
-  register NICEPIXEL32 SrcPixel32;
-  UCHAR Alpha, SrcBpp = BitsPerFormat(Source->iBitmapFormat);
+  ULONG DstPixel32, SrcPixel32, Alpha;
+  UCHAR SrcBpp = BitsPerFormat(Source->iBitmapFormat);
   EXLATEOBJ* pexlo;
   EXLATEOBJ exloSrcRGB, exloDstRGB, exloRGBSrc;
   PFN_DIB_PutPixel pfnDibPutPixel = DibFunctionsForBitmapFormat[Dest->iBitmapFormat].DIB_PutPixel;
+  PULONG Src;
+  BOOLEAN DirectSource;
+  DIB_DDA DdaX, DdaY;
 
   DPRINT("DIB_16BPP_AlphaBlend: srcRect: (%d,%d)-(%d,%d), dstRect: (%d,%d)-(%d,%d)\n",
     SourceRect->left, SourceRect->top, SourceRect->right, SourceRect->bottom,
@@ -81,37 +65,51 @@ DIB_XXBPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
   EXLATEOBJ_vInitialize(&exloDstRGB, pexlo->ppalDst, &gpalRGB, 0, 0, 0);
   EXLATEOBJ_vInitialize(&exloRGBSrc, &gpalRGB, pexlo->ppalSrc, 0, 0, 0);
 
-  SrcY = SourceRect->top;
-  DstY = DestRect->top;
-  while ( DstY < DestRect->bottom )
+  /* 32bpp RGB sources can be read without going through the XLATEOBJ */
+  DirectSource = (Source->iBitmapFormat == BMF_32BPP &&
+                  (exloSrcRGB.xlo.flXlate & XO_TRIVIAL) != 0);
+
+  DIB_DdaInit(&DdaY, SourceRect->top, SourceRect->bottom - SourceRect->top,
+              DestRect->bottom - DestRect->top);
+  for (DstY = DestRect->top; DstY < DestRect->bottom; DstY++)
   {
-    SrcX = SourceRect->left;
-    DstX = DestRect->left;
-    while(DstX < DestRect->right)
+    Src = (PULONG)((ULONG_PTR)Source->pvScan0 + (DdaY.Pos * Source->lDelta));
+    DIB_DdaInit(&DdaX, SourceRect->left, SourceRect->right - SourceRect->left,
+                DestRect->right - DestRect->left);
+    for (DstX = DestRect->left; DstX < DestRect->right; DstX++)
     {
-      SrcPixel32.ul = DIB_GetSource(Source, SrcX, SrcY, &exloSrcRGB.xlo);
-      SrcPixel32.col.red = (SrcPixel32.col.red * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel32.col.green = (SrcPixel32.col.green * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel32.col.blue = (SrcPixel32.col.blue * BlendFunc.SourceConstantAlpha) / 255;
+      if (DirectSource)
+        SrcPixel32 = Src[DdaX.Pos];
+      else
+        SrcPixel32 = DIB_GetSource(Source, DdaX.Pos, DdaY.Pos, &exloSrcRGB.xlo);
+
+      if (BlendFunc.SourceConstantAlpha != 255)
+        SrcPixel32 = DIB_ScalePixel32(SrcPixel32, BlendFunc.SourceConstantAlpha);
 
       Alpha = ((BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0) ?
-           (SrcPixel32.col.alpha * BlendFunc.SourceConstantAlpha) / 255 :
-           BlendFunc.SourceConstantAlpha ;
-
-      DstPixel32.ul = DIB_GetSource(Dest, DstX, DstY, &exloDstRGB.xlo);
-      DstPixel32.col.red = Clamp8((DstPixel32.col.red * (255 - Alpha)) / 255 + SrcPixel32.col.red) ;
-      DstPixel32.col.green = Clamp8((DstPixel32.col.green * (255 - Alpha)) / 255 + SrcPixel32.col.green) ;
-      DstPixel32.col.blue = Clamp8((DstPixel32.col.blue * (255 - Alpha)) / 255 + SrcPixel32.col.blue) ;
-      DstPixel32.ul = XLATEOBJ_iXlate(&exloRGBSrc.xlo, DstPixel32.ul);
-      pfnDibPutPixel(Dest, DstX, DstY, XLATEOBJ_iXlate(ColorTranslation, DstPixel32.ul));
-
-      DstX++;
-      SrcX = SourceRect->left + ((DstX-DestRect->left)*(SourceRect->right - SourceRect->left))
-                                            /(DestRect->right-DestRect->left);
+           (SrcPixel32 >> 24) : BlendFunc.SourceConstantAlpha;
+      SrcPixel32 &= 0x00FFFFFF;
+
+      /* Nothing to add and nothing to take away, leave the pixel alone */
+      if (Alpha != 0 || SrcPixel32 != 0)
+      {
+        if (Alpha == 255)
+        {
+          DstPixel32 = SrcPixel32;
+        }
+        else
+        {
+          DstPixel32 = DIB_GetSource(Dest, DstX, DstY, &exloDstRGB.xlo);
+          DstPixel32 = (DIB_BlendPixel32(DstPixel32, SrcPixel32, Alpha) & 0x00FFFFFF) |
+                       (DstPixel32 & 0xFF000000);
+        }
+        DstPixel32 = XLATEOBJ_iXlate(&exloRGBSrc.xlo, DstPixel32);
+        pfnDibPutPixel(Dest, DstX, DstY, XLATEOBJ_iXlate(ColorTranslation, DstPixel32));
+      }
+
+      DIB_DdaStep(&DdaX);
     }
-    DstY++;
-    SrcY = SourceRect->top + ((DstY-DestRect->top)*(SourceRect->bottom - SourceRect->top))
-                                            /(DestRect->bottom-DestRect->top);
+    DIB_DdaStep(&DdaY);
   }
 
   EXLATEOBJ_vCleanup(&exloDstRGB);
@@ -35,7 +35,7 @@ typedef ULONG (*PFN_DIB_GetPixel)(SURFOBJ*,LONG,LONG);
 typedef VOID (*PFN_DIB_HLine)(SURFOBJ*,LONG,LONG,LONG,ULONG);
 typedef VOID (*PFN_DIB_VLine)(SURFOBJ*,LONG,LONG,LONG,ULONG);
 typedef BOOLEAN (*PFN_DIB_BitBlt)(PBLTINFO);
-typedef BOOLEAN (*PFN_DIB_StretchBlt)(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4);
+typedef BOOLEAN (*PFN_DIB_StretchBlt)(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4,ULONG);
 typedef BOOLEAN (*PFN_DIB_TransparentBlt)(SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,XLATEOBJ*,ULONG);
 typedef BOOLEAN (*PFN_DIB_ColorFill)(SURFOBJ*, RECTL*, ULONG);
 typedef BOOLEAN (*PFN_DIB_AlphaBlend)(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
@@ -61,7 +61,7 @@ ULONG Dummy_GetPixel(SURFOBJ*,LONG,LONG);
 VOID Dummy_HLine(SURFOBJ*,LONG,LONG,LONG,ULONG);
 VOID Dummy_VLine(SURFOBJ*,LONG,LONG,LONG,ULONG);
 BOOLEAN Dummy_BitBlt(PBLTINFO);
-BOOLEAN Dummy_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4);
+BOOLEAN Dummy_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4,ULONG);
 BOOLEAN Dummy_TransparentBlt(SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,XLATEOBJ*,ULONG);
 BOOLEAN Dummy_ColorFill(SURFOBJ*, RECTL*, ULONG);
 BOOLEAN Dummy_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
@@ -123,7 +123,7 @@ BOOLEAN DIB_32BPP_TransparentBlt(SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,XLATEOBJ*,ULONG
 BOOLEAN DIB_32BPP_ColorFill(SURFOBJ*, RECTL*, ULONG);
 BOOLEAN DIB_32BPP_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
 
-BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4);
+BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4,ULONG);
 BOOLEAN DIB_XXBPP_FloodFillSolid(SURFOBJ*, BRUSHOBJ*, RECTL*, POINTL*, ULONG, UINT);
 BOOLEAN DIB_XXBPP_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
 
@@ -141,3 +141,81 @@ ULONG DIB_DoRop(ULONG Rop, ULONG Dest, ULONG Source, ULONG Pattern);
 #define DIB_GetSourceIndex(SourceSurf,sx,sy)                \
   DibFunctionsForBitmapFormat[SourceSurf->iBitmapFormat].   \
     DIB_GetPixel(SourceSurf, sx, sy)
+
+/* AlphaBlend helpers. Two 8 bit channels are handled at once, in the
+ * 0x00FF00FF lanes of a ULONG, so a pixel takes two multiplies instead of
+ * four and no divisions at all. */
+#define DIB_LANES_MASK 0x00FF00FF
+
+/* Exact x / 255 on each lane, for x <= 255 * 255 */
+FORCEINLINE
+ULONG
+DIB_DivideLanesBy255(ULONG x)
+{
+  x += 0x00010001 + ((x >> 8) & DIB_LANES_MASK);
+  return (x >> 8) & DIB_LANES_MASK;
+}
+
+/* Saturating add of two lane pairs */
+FORCEINLINE
+ULONG
+DIB_AddLanesSaturate(ULONG a, ULONG b)
+{
+  ULONG Sum = a + b;
+  Sum |= ((Sum >> 8) & 0x00010001) * 0xFF;
+  return Sum & DIB_LANES_MASK;
+}
+
+/* Each channel of Pixel multiplied by Factor / 255 */
+FORCEINLINE
+ULONG
+DIB_ScalePixel32(ULONG Pixel, ULONG Factor)
+{
+  return DIB_DivideLanesBy255((Pixel & DIB_LANES_MASK) * Factor) |
+         (DIB_DivideLanesBy255(((Pixel >> 8) & DIB_LANES_MASK) * Factor) << 8);
+}
+
+/* Dst * (255 - Alpha) / 255 + Src, saturated, on all four channels.
+ * Src must already be multiplied by the constant alpha. */
+FORCEINLINE
+ULONG
+DIB_BlendPixel32(ULONG Dst, ULONG Src, ULONG Alpha)
+{
+  Dst = DIB_ScalePixel32(Dst, 255 - Alpha);
+  return DIB_AddLanesSaturate(Dst & DIB_LANES_MASK, Src & DIB_LANES_MASK) |
+         (DIB_AddLanesSaturate((Dst >> 8) & DIB_LANES_MASK, (Src >> 8) & DIB_LANES_MASK) << 8);
+}
+
+/* Integer DDA walking Src over Dst steps, Pos = Start + (i * Src) / Dst */
+typedef struct _DIB_DDA
+{
+  LONG Pos;
+  LONG Step;
+  LONG Frac;
+  LONG Error;
+  LONG Denom;
+} DIB_DDA, *PDIB_DDA;
+
+FORCEINLINE
+VOID
+DIB_DdaInit(PDIB_DDA Dda, LONG Start, LONG Src, LONG Dst)
+{
+  Dda->Pos = Start;
+  Dda->Step = Src / Dst;
+  Dda->Frac = Src % Dst;
+  Dda->Error = 0;
+  Dda->Denom = Dst;
+}
+
+FORCEINLINE
+VOID
+DIB_DdaStep(PDIB_DDA Dda)
+{
+  Dda->Pos += Dda->Step;
+  Dda->Error += Dda->Frac;
+  if (Dda->Error >= Dda->Denom)
+  {
+    Dda->Error -= Dda->Denom;
+    Dda->Pos++;
+  }
+}
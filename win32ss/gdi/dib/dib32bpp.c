@@ -325,32 +325,19 @@ DIB_32BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
   return TRUE;
 }
 
-typedef union {
-  ULONG ul;
-  struct {
-    UCHAR red;
-    UCHAR green;
-    UCHAR blue;
-    UCHAR alpha;
-  } col;
-} NICEPIXEL32;
-
-static __inline UCHAR
-Clamp8(ULONG val)
-{
-  return (val > 255) ? 255 : (UCHAR)val;
-}
-
 BOOLEAN
 DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
                      XLATEOBJ* ColorTranslation, BLENDOBJ* BlendObj)
 {
-  INT Rows, Cols, SrcX, SrcY;
+  LONG Cols, DstWidth, DstHeight;
   register PULONG Dst;
+  PULONG Src;
   BLENDFUNCTION BlendFunc;
-  register NICEPIXEL32 DstPixel, SrcPixel;
-  UCHAR Alpha, SrcBpp;
+  ULONG DstPixel, SrcPixel, Alpha, ConstAlpha;
+  UCHAR SrcBpp;
+  BOOLEAN DirectSource, Stretch;
+  DIB_DDA DdaX, DdaY;
 
   DPRINT("DIB_32BPP_AlphaBlend: srcRect: (%d,%d)-(%d,%d), dstRect: (%d,%d)-(%d,%d)\n",
     SourceRect->left, SourceRect->top, SourceRect->right, SourceRect->bottom,
@@ -379,40 +366,61 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
     return FALSE;
   }
 
+  SrcBpp = BitsPerFormat(Source->iBitmapFormat);
+  ConstAlpha = BlendFunc.SourceConstantAlpha;
+  DstWidth = DestRect->right - DestRect->left;
+  DstHeight = DestRect->bottom - DestRect->top;
+  Stretch = (SourceRect->right - SourceRect->left != DstWidth);
+
+  /* Read 32bpp sources straight from the bits when no translation is needed */
+  DirectSource = (Source->iBitmapFormat == BMF_32BPP &&
+                  (ColorTranslation == NULL ||
+                   (ColorTranslation->flXlate & XO_TRIVIAL) != 0));
+
+  DIB_DdaInit(&DdaY, SourceRect->top, SourceRect->bottom - SourceRect->top, DstHeight);
   Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + (DestRect->top * Dest->lDelta) +
     (DestRect->left << 2));
-  SrcBpp = BitsPerFormat(Source->iBitmapFormat);
 
-  Rows = 0;
-   SrcY = SourceRect->top;
-   while (++Rows <= DestRect->bottom - DestRect->top)
+  while (DstHeight-- > 0)
   {
-    Cols = 0;
-    SrcX = SourceRect->left;
-    while (++Cols <= DestRect->right - DestRect->left)
+    Src = (PULONG)((ULONG_PTR)Source->pvScan0 + (DdaY.Pos * Source->lDelta)) +
+          SourceRect->left;
+    DIB_DdaInit(&DdaX, SourceRect->left, SourceRect->right - SourceRect->left, DstWidth);
+
+    for (Cols = 0; Cols < DstWidth; Cols++)
     {
-      SrcPixel.ul = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
-      SrcPixel.col.red = (SrcPixel.col.red * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.green = (SrcPixel.col.green * BlendFunc.SourceConstantAlpha)  / 255;
-      SrcPixel.col.blue = (SrcPixel.col.blue * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.alpha = (32 == SrcBpp) ?
-                        (SrcPixel.col.alpha * BlendFunc.SourceConstantAlpha) / 255 :
-                        BlendFunc.SourceConstantAlpha ;
+      if (!DirectSource)
+        SrcPixel = DIB_GetSource(Source, DdaX.Pos, DdaY.Pos, ColorTranslation);
+      else if (Stretch)
+        SrcPixel = Src[DdaX.Pos - SourceRect->left];
+      else
+        SrcPixel = Src[Cols];
+      DIB_DdaStep(&DdaX);
+
+      /* Premultiply by the constant alpha, which is a no-op at 255 */
+      if (ConstAlpha != 255)
+        SrcPixel = DIB_ScalePixel32(SrcPixel, ConstAlpha);
+      if (SrcBpp != 32)
+        SrcPixel = (SrcPixel & 0x00FFFFFF) | (ConstAlpha << 24);
 
       Alpha = ((BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0) ?
-           SrcPixel.col.alpha : BlendFunc.SourceConstantAlpha ;
-
-      DstPixel.ul = *Dst;
-      DstPixel.col.red = Clamp8((DstPixel.col.red * (255 - Alpha)) / 255 + SrcPixel.col.red) ;
-      DstPixel.col.green = Clamp8((DstPixel.col.green * (255 - Alpha)) / 255 + SrcPixel.col.green) ;
-      DstPixel.col.blue = Clamp8((DstPixel.col.blue * (255 - Alpha)) / 255 + SrcPixel.col.blue) ;
-      DstPixel.col.alpha = Clamp8((DstPixel.col.alpha * (255 - Alpha)) / 255 + SrcPixel.col.alpha) ;
-      *Dst++ = DstPixel.ul;
-      SrcX = SourceRect->left + (Cols*(SourceRect->right - SourceRect->left))/(DestRect->right - DestRect->left);
+           (SrcPixel >> 24) : ConstAlpha;
+
+      if (Alpha == 255)
+      {
+        Dst[Cols] = SrcPixel;
+      }
+      else if (Alpha != 0 || SrcPixel != 0)
+      {
+        /* Only a fully transparent pixel leaves the destination alone;
+           translucent black still darkens it */
+        DstPixel = Dst[Cols];
+        Dst[Cols] = DIB_BlendPixel32(DstPixel, SrcPixel, Alpha);
+      }
     }
-    Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Rows) * Dest->lDelta) +
-                (DestRect->left << 2));
-    SrcY = SourceRect->top + (Rows*(SourceRect->bottom - SourceRect->top))/(DestRect->bottom - DestRect->top);
+
+    Dst = (PULONG)((ULONG_PTR)Dst + Dest->lDelta);
+    DIB_DdaStep(&DdaY);
   }
 
   return TRUE;
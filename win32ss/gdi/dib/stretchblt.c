@@ -9,16 +9,72 @@
  */
 
 #include <win32k.h>
+#include "../diblib/DibLib_interface.h"
 
 #define NDEBUG
 #include <debug.h>
 
+static BOOLEAN
+DIB_StretchBltSrcCopy(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
+                      RECTL *DestRect, RECTL *SourceRect,
+                      XLATEOBJ *ColorTranslation, ULONG Mode)
+{
+  BLTDATA bltdata;
+
+  /* The DibLib loops don't clip against the source and can't mirror */
+  if (SourceSurf->iBitmapFormat < BMF_1BPP || SourceSurf->iBitmapFormat > BMF_32BPP ||
+      DestSurf->iBitmapFormat < BMF_1BPP || DestSurf->iBitmapFormat > BMF_32BPP ||
+      SourceRect->left < 0 || SourceRect->top < 0 ||
+      SourceRect->right > SourceSurf->sizlBitmap.cx ||
+      SourceRect->bottom > abs(SourceSurf->sizlBitmap.cy) ||
+      SourceRect->right <= SourceRect->left ||
+      SourceRect->bottom <= SourceRect->top ||
+      DestRect->right <= DestRect->left ||
+      DestRect->bottom <= DestRect->top)
+  {
+    return FALSE;
+  }
+
+  if (!ColorTranslation) ColorTranslation = &gexloTrivial.xlo;
+  bltdata.pxlo = ColorTranslation;
+  bltdata.pfnXlate = XLATEOBJ_pfnXlate(ColorTranslation);
+
+  bltdata.siDst.iFormat = DestSurf->iBitmapFormat;
+  bltdata.siDst.pvScan0 = DestSurf->pvScan0;
+  bltdata.siDst.lDelta = DestSurf->lDelta;
+  bltdata.siDst.jBpp = BitsPerFormat(DestSurf->iBitmapFormat);
+  bltdata.siDst.ptOrig.x = DestRect->left;
+  bltdata.siDst.ptOrig.y = DestRect->top;
+  bltdata.siDst.pjBase = bltdata.siDst.pvScan0;
+  bltdata.siDst.pjBase += DestRect->top * bltdata.siDst.lDelta;
+  bltdata.siDst.pjBase += DestRect->left * bltdata.siDst.jBpp / 8;
+
+  bltdata.siSrc.iFormat = SourceSurf->iBitmapFormat;
+  bltdata.siSrc.pvScan0 = SourceSurf->pvScan0;
+  bltdata.siSrc.lDelta = SourceSurf->lDelta;
+  bltdata.siSrc.jBpp = BitsPerFormat(SourceSurf->iBitmapFormat);
+  bltdata.siSrc.ptOrig.x = SourceRect->left;
+  bltdata.siSrc.ptOrig.y = SourceRect->top;
+
+  bltdata.ulWidth = DestRect->right - DestRect->left;
+  bltdata.ulHeight = DestRect->bottom - DestRect->top;
+  bltdata.ulSrcWidth = SourceRect->right - SourceRect->left;
+  bltdata.ulSrcHeight = SourceRect->bottom - SourceRect->top;
+
+  if (Mode == HALFTONE)
+    Dib_StretchBlt_HALFTONE(&bltdata);
+  else
+    Dib_StretchBlt_SRCCOPY(&bltdata);
+
+  return TRUE;
+}
+
 BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf, SURFOBJ *MaskSurf,
                             SURFOBJ *PatternSurface,
                             RECTL *DestRect, RECTL *SourceRect,
                             POINTL *MaskOrigin, BRUSHOBJ *Brush,
                             POINTL *BrushOrigin, XLATEOBJ *ColorTranslation,
-                            ROP4 ROP)
+                            ROP4 ROP, ULONG Mode)
 {
   LONG sx = 0;
   LONG sy = 0;
@@ -50,6 +106,14 @@ BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf, SURFOBJ *Ma
 
   ASSERT(IS_VALID_ROP4(ROP));
 
+  /* Plain copies go through the format specialized DibLib loops */
+  if (ROP == ROP4_SRCCOPY && MaskSurf == NULL &&
+      DIB_StretchBltSrcCopy(DestSurf, SourceSurf, DestRect, SourceRect,
+                            ColorTranslation, Mode))
+  {
+    return TRUE;
+  }
+
   fnDest_GetPixel = DibFunctionsForBitmapFormat[DestSurf->iBitmapFormat].DIB_GetPixel;
   fnDest_PutPixel = DibFunctionsForBitmapFormat[DestSurf->iBitmapFormat].DIB_PutPixel;
 
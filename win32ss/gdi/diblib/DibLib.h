@@ -49,8 +49,8 @@ extern const BYTE ajShift4[2];
 
 #define _ReadPixel_4(pjSource, jShift) (((*(pjSource)) >> (jShift)) & 15)
 #define _WritePixel_4(pjDest, jShift, ulColor) (void)(*(pjDest) = (UCHAR)((*(pjDest) & ~(15<<(jShift))) | ((ulColor)<<(jShift))))
-#define _NextPixel_4(ppj, pjShift) (void)((*(ppj) += (*(pjShift) & 1)), (*(pjShift)) -= 4, *(pjShift) &= 7)
-#define _NextPixelR2L_4(ppj, pjShift) (void)((*(pjShift)) -= 4, *(pjShift) &= 7, (*(ppj) -= (*(pjShift) & 1)))
+#define _NextPixel_4(ppj, pjShift) (void)((*(ppj) += (*(pjShift) == 0)), (*(pjShift)) -= 4, *(pjShift) &= 7)
+#define _NextPixelR2L_4(ppj, pjShift) (void)((*(pjShift)) -= 4, *(pjShift) &= 7, (*(ppj) -= (*(pjShift) == 0)))
 #define _SHIFT_4(x) x
 #define _CALCSHIFT_4(pShift, x) (void)(*(pShift) = ajShift4[(x) & 1])
 
@@ -7,28 +7,32 @@
 #define _SOURCE_BPP 0
 #endif
 
+#ifndef __DIB_TEMPLATE
+#define __DIB_TEMPLATE "DibLib_BitBlt.h"
+#endif
+
 #define _DEST_BPP 1
-#include "DibLib_BitBlt.h"
+#include __DIB_TEMPLATE
 #undef _DEST_BPP
 
 #define _DEST_BPP 4
-#include "DibLib_BitBlt.h"
+#include __DIB_TEMPLATE
 #undef _DEST_BPP
 
 #define _DEST_BPP 8
-#include "DibLib_BitBlt.h"
+#include __DIB_TEMPLATE
 #undef _DEST_BPP
 
 #define _DEST_BPP 16
-#include "DibLib_BitBlt.h"
+#include __DIB_TEMPLATE
 #undef _DEST_BPP
 
 #define _DEST_BPP 24
-#include "DibLib_BitBlt.h"
+#include __DIB_TEMPLATE
 #undef _DEST_BPP
 
 #define _DEST_BPP 32
-#include "DibLib_BitBlt.h"
+#include __DIB_TEMPLATE
 #undef _DEST_BPP
 
 #if (__USES_SOURCE == 0)
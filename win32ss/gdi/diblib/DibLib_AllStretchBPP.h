@@ -0,0 +1,97 @@
+
+/* Stretching never works on a single surface, so unlike DibLib_AllSrcBPP.h
+   this only generates the plain source / destination combinations. */
+#define __DIB_TEMPLATE "DibLib_StretchBlt.h"
+
+#ifndef __DIB_FUNCTION_NAME
+#define __DIB_FUNCTION_NAME __DIB_FUNCTION_NAME_SRCDST
+#endif
+
+#define _SOURCE_BPP 1
+#include "DibLib_AllDstBPP.h"
+#undef _SOURCE_BPP
+
+#define _SOURCE_BPP 4
+#include "DibLib_AllDstBPP.h"
+#undef _SOURCE_BPP
+
+#define _SOURCE_BPP 8
+#include "DibLib_AllDstBPP.h"
+#undef _SOURCE_BPP
+
+#define _SOURCE_BPP 16
+#include "DibLib_AllDstBPP.h"
+#undef _SOURCE_BPP
+
+#define _SOURCE_BPP 24
+#include "DibLib_AllDstBPP.h"
+#undef _SOURCE_BPP
+
+#define _SOURCE_BPP 32
+#include "DibLib_AllDstBPP.h"
+#undef _SOURCE_BPP
+
+PFN_DIBFUNCTION
+__PASTE(gapfn, __FUNCTIONNAME)[7][7] =
+{
+    {
+        0, 0, 0, 0, 0, 0, 0
+    },
+    {
+        0,
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 1, 1),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 4, 1),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 8, 1),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 16, 1),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 24, 1),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 32, 1),
+    },
+    {
+        0,
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 1, 4),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 4, 4),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 8, 4),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 16, 4),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 24, 4),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 32, 4),
+    },
+    {
+        0,
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 1, 8),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 4, 8),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 8, 8),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 16, 8),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 24, 8),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 32, 8),
+    },
+    {
+        0,
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 1, 16),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 4, 16),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 8, 16),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 16, 16),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 24, 16),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 32, 16),
+    },
+    {
+        0,
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 1, 24),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 4, 24),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 8, 24),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 16, 24),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 24, 24),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 32, 24),
+    },
+    {
+        0,
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 1, 32),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 4, 32),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 8, 32),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 16, 32),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 24, 32),
+        __DIB_FUNCTION_NAME_SRCDST(__FUNCTIONNAME, 32, 32),
+    },
+};
+
+#undef __DIB_FUNCTION_NAME
+#undef __DIB_TEMPLATE
@@ -0,0 +1,123 @@
+
+#define _DibFunction __DIB_FUNCTION_NAME(__FUNCTIONNAME, _SOURCE_BPP, _DEST_BPP)
+#define _ReadPixel(bpp, pj, jShift) __PASTE(_ReadPixel_, bpp)(pj, jShift)
+#define _WritePixel(pj, jShift, c) __PASTE(_WritePixel_, _DEST_BPP)(pj, jShift, c)
+#define _NextPixel(bpp, ppj, pjShift) __PASTE(_NextPixel_, bpp)(ppj, pjShift)
+#define _SHIFT(bpp, x) __PASTE(_SHIFT_, bpp)(x)
+#define _CALCSHIFT(bpp, pshift, x) __PASTE(_CALCSHIFT_, bpp)(pshift, x)
+
+/* Only RGB destinations can average colors, the others pick the nearest pixel */
+#define _STRETCH_AVERAGE (__STRETCH_HALFTONE && (_DEST_BPP >= 24))
+
+VOID
+FASTCALL
+_DibFunction(PBLTDATA pBltData)
+{
+    ULONG cRows, cLines, ulSource;
+    ULONG xSrc, ySrc, xErr, yErr;
+    ULONG cxStep, cxFrac, cyStep, cyFrac;
+    PBYTE pjDest, pjDestBase, pjSrcLine, pjSource;
+    _SHIFT(_DEST_BPP, BYTE jDstShift;)
+    _SHIFT(_SOURCE_BPP, BYTE jSrcShift;)
+#if _STRETCH_AVERAGE
+    ULONG cxBox, cyBox, x, y, ulBlue, ulGreen, ulRed, cPixels;
+    PBYTE pjBoxLine;
+#endif
+
+    /* Walk the source with an integer DDA, no division per pixel */
+    cxStep = pBltData->ulSrcWidth / pBltData->ulWidth;
+    cxFrac = pBltData->ulSrcWidth % pBltData->ulWidth;
+    cyStep = pBltData->ulSrcHeight / pBltData->ulHeight;
+    cyFrac = pBltData->ulSrcHeight % pBltData->ulHeight;
+
+    pjDestBase = pBltData->siDst.pjBase;
+    ySrc = pBltData->siSrc.ptOrig.y;
+    yErr = 0;
+
+    /* Loop all lines */
+    cLines = pBltData->ulHeight;
+    while (cLines--)
+    {
+        pjSrcLine = pBltData->siSrc.pvScan0 + (LONG)ySrc * pBltData->siSrc.lDelta;
+        pjDest = pjDestBase;
+        _CALCSHIFT(_DEST_BPP, &jDstShift, pBltData->siDst.ptOrig.x);
+        xSrc = pBltData->siSrc.ptOrig.x;
+        xErr = 0;
+
+#if _STRETCH_AVERAGE
+        /* Number of source lines that map to this destination line */
+        cyBox = cyStep + ((yErr + cyFrac) >= pBltData->ulHeight);
+        if (cyBox == 0) cyBox = 1;
+#endif
+
+        /* Loop all rows */
+        cRows = pBltData->ulWidth;
+        while (cRows--)
+        {
+#if _STRETCH_AVERAGE
+            cxBox = cxStep + ((xErr + cxFrac) >= pBltData->ulWidth);
+            if (cxBox == 0) cxBox = 1;
+
+            /* Average all source pixels that map to this destination pixel */
+            ulBlue = ulGreen = ulRed = 0;
+            pjBoxLine = pjSrcLine;
+            for (y = 0; y < cyBox; y++)
+            {
+                for (x = xSrc; x < xSrc + cxBox; x++)
+                {
+                    pjSource = pjBoxLine + x * _SOURCE_BPP / 8;
+                    _CALCSHIFT(_SOURCE_BPP, &jSrcShift, x);
+                    ulSource = _ReadPixel(_SOURCE_BPP, pjSource, jSrcShift);
+                    ulSource = _DibXlate(pBltData, ulSource);
+                    ulBlue += ulSource & 0xFF;
+                    ulGreen += (ulSource >> 8) & 0xFF;
+                    ulRed += (ulSource >> 16) & 0xFF;
+                }
+                pjBoxLine += pBltData->siSrc.lDelta;
+            }
+
+            cPixels = cxBox * cyBox;
+            if (cPixels > 1)
+            {
+                ulBlue = (ulBlue + cPixels / 2) / cPixels;
+                ulGreen = (ulGreen + cPixels / 2) / cPixels;
+                ulRed = (ulRed + cPixels / 2) / cPixels;
+            }
+            ulSource = ulBlue | (ulGreen << 8) | (ulRed << 16);
+#else
+            /* Read the nearest source pixel and xlate it */
+            pjSource = pjSrcLine + xSrc * _SOURCE_BPP / 8;
+            _CALCSHIFT(_SOURCE_BPP, &jSrcShift, xSrc);
+            ulSource = _ReadPixel(_SOURCE_BPP, pjSource, jSrcShift);
+            ulSource = _DibXlate(pBltData, ulSource);
+#endif
+
+            /* Write the pixel and go to the next dest pixel */
+            _WritePixel(pjDest, jDstShift, ulSource);
+            _NextPixel(_DEST_BPP, &pjDest, &jDstShift);
+
+            /* Step the source x position */
+            xSrc += cxStep;
+            xErr += cxFrac;
+            if (xErr >= pBltData->ulWidth)
+            {
+                xErr -= pBltData->ulWidth;
+                xSrc++;
+            }
+        }
+
+        pjDestBase += pBltData->siDst.lDelta;
+
+        /* Step the source y position */
+        ySrc += cyStep;
+        yErr += cyFrac;
+        if (yErr >= pBltData->ulHeight)
+        {
+            yErr -= pBltData->ulHeight;
+            ySrc++;
+        }
+    }
+}
+
+#undef _STRETCH_AVERAGE
+#undef _DibFunction
@@ -29,6 +29,8 @@ typedef struct
     PFN_DOROP apfnDoRop[2];
     ULONG ulSolidColor;
     LONG dy;
+    ULONG ulSrcWidth;
+    ULONG ulSrcHeight;
 } BLTDATA, *PBLTDATA;
 
 typedef
@@ -68,6 +70,9 @@ VOID FASTCALL Dib_MaskPatPaint(PBLTDATA pBltData);
 VOID FASTCALL Dib_MaskSrcPaint(PBLTDATA pBltData);
 VOID FASTCALL Dib_MaskBlt(PBLTDATA pBltData);
 
+VOID FASTCALL Dib_StretchBlt_SRCCOPY(PBLTDATA pBltData);
+VOID FASTCALL Dib_StretchBlt_HALFTONE(PBLTDATA pBltData);
+
 extern const UCHAR gajIndexPerRop[256];
 extern const PFN_DIBFUNCTION gapfnDibFunction[];
 extern const PFN_DIBFUNCTION gapfnMaskFunction[8];
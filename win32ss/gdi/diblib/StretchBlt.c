@@ -0,0 +1,31 @@
+
+#include "DibLib.h"
+
+#define __USES_SOURCE 1
+#define __USES_PATTERN 0
+#define __USES_DEST 0
+#define __USES_MASK 0
+
+#define __FUNCTIONNAME StretchBlt_SRCCOPY
+#define __STRETCH_HALFTONE 0
+#include "DibLib_AllStretchBPP.h"
+
+#undef __FUNCTIONNAME
+#undef __STRETCH_HALFTONE
+#define __FUNCTIONNAME StretchBlt_HALFTONE
+#define __STRETCH_HALFTONE 1
+#include "DibLib_AllStretchBPP.h"
+
+VOID
+FASTCALL
+Dib_StretchBlt_SRCCOPY(PBLTDATA pBltData)
+{
+    gapfnStretchBlt_SRCCOPY[pBltData->siDst.iFormat][pBltData->siSrc.iFormat](pBltData);
+}
+
+VOID
+FASTCALL
+Dib_StretchBlt_HALFTONE(PBLTDATA pBltData)
+{
+    gapfnStretchBlt_HALFTONE[pBltData->siDst.iFormat][pBltData->siSrc.iFormat](pBltData);
+}
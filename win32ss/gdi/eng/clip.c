@@ -153,6 +153,55 @@ CompareLeftUp(
     return Cmp;
 }
 
+/* Reverse the order of the rectangles from First up to (excluding) Last */
+static
+VOID
+IntEngReverseRects(
+    PRECTL First,
+    PRECTL Last)
+{
+    RECTL Temp;
+
+    while (First < --Last)
+    {
+        Temp = *First;
+        *First = *Last;
+        *Last = Temp;
+        First++;
+    }
+}
+
+/*
+ * Clip rectangles come from regions, so they are y-x banded: rectangles of
+ * the same band share top and bottom, and the bands don't overlap. Going
+ * from one enumeration direction to another is then only a matter of
+ * reversing the bands and/or the rectangles within each band, which is
+ * linear, instead of sorting all the rectangles again.
+ */
+static
+VOID
+IntEngReorderBands(
+    PRECTL Rects,
+    ULONG Count,
+    ULONG Change)
+{
+    PRECTL Band, Next, End = Rects + Count;
+
+    /* Reversing everything flips both the vertical and horizontal order */
+    if (Change & CD_UPWARDS)
+        IntEngReverseRects(Rects, End);
+
+    /* Flip the rectangles of each band back, or flip them on their own */
+    if ((Change & (CD_UPWARDS | CD_LEFTWARDS)) != (CD_UPWARDS | CD_LEFTWARDS))
+    {
+        for (Band = Rects; Band < End; Band = Next)
+        {
+            for (Next = Band + 1; (Next < End) && (Next->top == Band->top); Next++);
+            IntEngReverseRects(Band, Next);
+        }
+    }
+}
+
 VOID
 FASTCALL
 IntEngInitClipObj(XCLIPOBJ *Clip)
@@ -183,7 +232,8 @@ IntEngUpdateClipRegion(
         if(NewRects != NULL)
         {
             Clip->RectCount = count;
-            Clip->iDirection = CD_ANY;
+            /* Region rectangles are banded top to bottom, left to right */
+            Clip->iDirection = CD_RIGHTDOWN;
             RtlCopyMemory(NewRects, pRect, count * sizeof(RECTL));
 
             Clip->iDComplexity = DC_COMPLEX;
@@ -267,7 +317,14 @@ CLIPOBJ_cEnumStart(
     Clip->EnumPos = 0;
     Clip->EnumMax = (cMaxRects > 0) ? cMaxRects : Clip->RectCount;
 
-    if (CD_ANY != iDirection && Clip->iDirection != iDirection)
+    if (CD_ANY != iDirection && Clip->iDirection != iDirection &&
+        CD_ANY != Clip->iDirection && iDirection < CD_ANY)
+    {
+        /* We know the current order of the bands, just reorder them */
+        IntEngReorderBands(Clip->Rects, Clip->RectCount, Clip->iDirection ^ iDirection);
+        Clip->iDirection = iDirection;
+    }
+    else if (CD_ANY != iDirection && Clip->iDirection != iDirection)
     {
         switch (iDirection)
         {
@@ -126,9 +126,11 @@ typedef struct _SHARED_FACE_CACHE {
 } SHARED_FACE_CACHE, *PSHARED_FACE_CACHE;
 
 typedef struct _SHARED_FACE {
-  FT_Face       Face;
+  FT_Face       Face;           /* NULL until first use for cached fonts */
   LONG          RefCount;
   PSHARED_MEM   Memory;
+  FT_Long       FaceIndex;
+  UNICODE_STRING FileName;      /* where to load Face from */
   SHARED_FACE_CACHE EnglishUS;
   SHARED_FACE_CACHE UserLanguage;
 } SHARED_FACE, *PSHARED_FACE;
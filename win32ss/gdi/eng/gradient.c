@@ -13,8 +13,6 @@
 
 /* MACROS *********************************************************************/
 
-const LONG LINC[2] = {-1, 1};
-
 #define VERTEX(n) (pVertex + gt->n)
 #define COMPAREVERTEX(a, b) ((a)->x == (b)->x && (a)->y == (b)->y)
 
@@ -22,22 +20,133 @@ const LONG LINC[2] = {-1, 1};
 #define VCMPCLRS(a,b,c) \
   !(!VCMPCLR(a,b,c,Red) || !VCMPCLR(a,b,c,Green) || !VCMPCLR(a,b,c,Blue))
 
-/* Horizontal/Vertical gradients */
-#define HVINITCOL(Col, id) \
-  c[id] = v1->Col >> 8; \
-  dc[id] = abs((v2->Col >> 8) - c[id]); \
-  ec[id] = -(dy >> 1); \
-  ic[id] = LINC[(v2->Col >> 8) > c[id]]
-#define HVSTEPCOL(id) \
-  ec[id] += dc[id]; \
-  while(ec[id] > 0) \
+#define SMALLER(a,b)     (a->y < b->y) || (a->y == b->y && a->x < b->x)
+
+#define SWAP(a,b,c)  c = a;\
+                     a = b;\
+                     b = c
+
+/*
+ * Colors are stepped in fixed point: 8 bits of color and 16 bits of fraction.
+ * The 16 bit vertex colors fit without loss of precision.
+ */
+typedef struct _GRADIENTCOLOR
+{
+    LONG lRed;
+    LONG lGreen;
+    LONG lBlue;
+} GRADIENTCOLOR, *PGRADIENTCOLOR;
+
+/* A triangle edge, stepped one scanline at a time */
+typedef struct _GRADIENTEDGE
+{
+    LONGLONG llX;           /* 16.16 */
+    LONGLONG llStepX;
+    GRADIENTCOLOR gc;
+    GRADIENTCOLOR gcStep;
+} GRADIENTEDGE, *PGRADIENTEDGE;
+
+#define GC_INIT(gc, v) \
+  (gc).lRed   = (LONG)(v)->Red << 8; \
+  (gc).lGreen = (LONG)(v)->Green << 8; \
+  (gc).lBlue  = (LONG)(v)->Blue << 8
+
+/* Step per pixel over cSteps pixels, cSteps > 0 */
+#define GC_INITSTEP(gcStep, gc1, gc2, cSteps) \
+  (gcStep).lRed   = ((gc2).lRed - (gc1).lRed) / (cSteps); \
+  (gcStep).lGreen = ((gc2).lGreen - (gc1).lGreen) / (cSteps); \
+  (gcStep).lBlue  = ((gc2).lBlue - (gc1).lBlue) / (cSteps)
+
+#define GC_ADVANCE(gc, gcStep, n) \
+  (gc).lRed   += (gcStep).lRed * (n); \
+  (gc).lGreen += (gcStep).lGreen * (n); \
+  (gc).lBlue  += (gcStep).lBlue * (n)
+
+#define GC_STEP(gc, gcStep) \
+  (gc).lRed   += (gcStep).lRed; \
+  (gc).lGreen += (gcStep).lGreen; \
+  (gc).lBlue  += (gcStep).lBlue
+
+#define GC_RGB(gc) RGB((gc).lRed >> 16, (gc).lGreen >> 16, (gc).lBlue >> 16)
+
+/* Translate the current color, neighbouring pixels mostly share it */
+#define GC_NEXTCOLOR() \
+  cr = GC_RGB(gc); \
+  if (cr != crLast) \
   { \
-    c[id] += ic[id]; \
-    ec[id] -= dy; \
-  }
+    crLast = cr; \
+    iColor = XLATEOBJ_iXlate(pxlo, cr); \
+  } \
+  GC_STEP(gc, *pgcStep)
 
 /* FUNCTIONS ******************************************************************/
 
+/* Write the pixels x..xEnd-1 of one gradient scanline */
+static
+VOID
+FASTCALL
+IntGradientSpan(
+    IN SURFOBJ *pso,
+    IN XLATEOBJ *pxlo,
+    IN LONG x,
+    IN LONG xEnd,
+    IN LONG y,
+    IN GRADIENTCOLOR gc,
+    IN PGRADIENTCOLOR pgcStep)
+{
+    PBYTE pjLine = (PBYTE)pso->pvScan0 + y * pso->lDelta;
+    COLORREF cr, crLast = CLR_INVALID;
+    ULONG iColor = 0;
+
+    switch (pso->iBitmapFormat)
+    {
+        case BMF_32BPP:
+        {
+            PULONG pul = (PULONG)pjLine + x;
+            for (; x < xEnd; x++)
+            {
+                GC_NEXTCOLOR();
+                *pul++ = iColor;
+            }
+            break;
+        }
+
+        case BMF_24BPP:
+        {
+            PBYTE pj = pjLine + 3 * x;
+            for (; x < xEnd; x++)
+            {
+                GC_NEXTCOLOR();
+                *pj++ = (BYTE)iColor;
+                *pj++ = (BYTE)(iColor >> 8);
+                *pj++ = (BYTE)(iColor >> 16);
+            }
+            break;
+        }
+
+        case BMF_16BPP:
+        {
+            PUSHORT pus = (PUSHORT)pjLine + x;
+            for (; x < xEnd; x++)
+            {
+                GC_NEXTCOLOR();
+                *pus++ = (USHORT)iColor;
+            }
+            break;
+        }
+
+        default:
+        {
+            for (; x < xEnd; x++)
+            {
+                GC_NEXTCOLOR();
+                DibFunctionsForBitmapFormat[pso->iBitmapFormat].DIB_PutPixel(pso, x, y, iColor);
+            }
+            break;
+        }
+    }
+}
+
 BOOL
 FASTCALL
 IntEngGradientFillRect(
@@ -56,10 +165,11 @@ IntEngGradientFillRect(
     RECTL rcGradient, rcSG;
     RECT_ENUM RectEnum;
     BOOL EnumMore;
-    ULONG i;
+    ULONG i, cjPixel;
     POINTL Translate;
     INTENG_ENTER_LEAVE EnterLeave;
-    LONG y, dy, c[3], dc[3], ec[3], ic[3];
+    LONG y, dy;
+    GRADIENTCOLOR gc1, gc2, gcStep;
 
     v1 = (pVertex + gRect->UpperLeft);
     v2 = (pVertex + gRect->LowerRight);
@@ -87,69 +197,65 @@ IntEngGradientFillRect(
 
     if((v1->Red != v2->Red || v1->Green != v2->Green || v1->Blue != v2->Blue) && dy > 1)
     {
+        GC_INIT(gc1, v1);
+        GC_INIT(gc2, v2);
+        GC_INITSTEP(gcStep, gc1, gc2, dy);
+        cjPixel = BitsPerFormat(psoOutput->iBitmapFormat) / 8;
+
         CLIPOBJ_cEnumStart(pco, FALSE, CT_RECTANGLES, CD_RIGHTDOWN, 0);
         do
         {
             RECTL FillRect;
-            ULONG Color;
-
-            if (Horizontal)
-            {
-                EnumMore = CLIPOBJ_bEnum(pco, (ULONG) sizeof(RectEnum), (PVOID) &RectEnum);
-                for (i = 0; i < RectEnum.c && RectEnum.arcl[i].top <= rcSG.bottom; i++)
-                {
-                    if (RECTL_bIntersectRect(&FillRect, &RectEnum.arcl[i], &rcSG))
-                    {
-                        HVINITCOL(Red, 0);
-                        HVINITCOL(Green, 1);
-                        HVINITCOL(Blue, 2);
+            GRADIENTCOLOR gc;
 
-                        for (y = rcSG.left; y < FillRect.right; y++)
-                        {
-                            if (y >= FillRect.left)
-                            {
-                                Color = XLATEOBJ_iXlate(pxlo, RGB(c[0], c[1], c[2]));
-                                DibFunctionsForBitmapFormat[psoOutput->iBitmapFormat].DIB_VLine(
-                                    psoOutput, y + Translate.x, FillRect.top + Translate.y, FillRect.bottom + Translate.y, Color);
-                            }
-                            HVSTEPCOL(0);
-                            HVSTEPCOL(1);
-                            HVSTEPCOL(2);
-                        }
-                    }
-                }
-
-                continue;
-            }
-
-            /* vertical */
             EnumMore = CLIPOBJ_bEnum(pco, (ULONG) sizeof(RectEnum), (PVOID) &RectEnum);
             for (i = 0; i < RectEnum.c && RectEnum.arcl[i].top <= rcSG.bottom; i++)
             {
-                if (RECTL_bIntersectRect(&FillRect, &RectEnum.arcl[i], &rcSG))
+                if (!RECTL_bIntersectRect(&FillRect, &RectEnum.arcl[i], &rcSG))
+                    continue;
+
+                RECTL_vOffsetRect(&FillRect, Translate.x, Translate.y);
+
+                if (Horizontal)
                 {
-                    HVINITCOL(Red, 0);
-                    HVINITCOL(Green, 1);
-                    HVINITCOL(Blue, 2);
+                    PBYTE pjFirst, pjLine;
+
+                    /* All scanlines are the same, generate the first one... */
+                    gc = gc1;
+                    GC_ADVANCE(gc, gcStep, FillRect.left - Translate.x - rcSG.left);
+                    IntGradientSpan(psoOutput, pxlo, FillRect.left, FillRect.right, FillRect.top, gc, &gcStep);
 
-                    for (y = rcSG.top; y < FillRect.bottom; y++)
+                    /* ...and copy it to the others */
+                    pjFirst = (PBYTE)psoOutput->pvScan0 + FillRect.top * psoOutput->lDelta;
+                    for (y = FillRect.top + 1; y < FillRect.bottom; y++)
                     {
-                        if (y >= FillRect.top)
+                        if (cjPixel == 0)
                         {
-                            Color = XLATEOBJ_iXlate(pxlo, RGB(c[0], c[1], c[2]));
-                            DibFunctionsForBitmapFormat[psoOutput->iBitmapFormat].DIB_HLine(psoOutput,
-                                                                                            FillRect.left + Translate.x,
-                                                                                            FillRect.right + Translate.x,
-                                                                                            y + Translate.y,
-                                                                                            Color);
+                            IntGradientSpan(psoOutput, pxlo, FillRect.left, FillRect.right, y, gc, &gcStep);
+                            continue;
                         }
-                        HVSTEPCOL(0);
-                        HVSTEPCOL(1);
-                        HVSTEPCOL(2);
+
+                        pjLine = (PBYTE)psoOutput->pvScan0 + y * psoOutput->lDelta;
+                        RtlCopyMemory(pjLine + FillRect.left * cjPixel,
+                                      pjFirst + FillRect.left * cjPixel,
+                                      (FillRect.right - FillRect.left) * cjPixel);
                     }
+                    continue;
                 }
-            }
 
+                /* vertical, one color per scanline */
+                gc = gc1;
+                GC_ADVANCE(gc, gcStep, FillRect.top - Translate.y - rcSG.top);
+                for (y = FillRect.top; y < FillRect.bottom; y++)
+                {
+                    DibFunctionsForBitmapFormat[psoOutput->iBitmapFormat].DIB_HLine(psoOutput,
+                                                                                    FillRect.left,
+                                                                                    FillRect.right,
+                                                                                    y,
+                                                                                    XLATEOBJ_iXlate(pxlo, GC_RGB(gc)));
+                    GC_STEP(gc, gcStep);
+                }
+            }
         }
         while (EnumMore);
 
@@ -184,126 +290,35 @@ IntEngGradientFillRect(
     return IntEngLeave(&EnterLeave);
 }
 
-/* Fill triangle with solid color */
-#define S_FILLLINE(linefrom,lineto) \
-  if(sx[lineto] < sx[linefrom]) \
-    DibFunctionsForBitmapFormat[psoOutput->iBitmapFormat].DIB_HLine(psoOutput, max(sx[lineto], FillRect.left), min(sx[linefrom], FillRect.right), sy, Color); \
-  else \
-    DibFunctionsForBitmapFormat[psoOutput->iBitmapFormat].DIB_HLine(psoOutput, max(sx[linefrom], FillRect.left), min(sx[lineto], FillRect.right), sy, Color);
-
-#define S_DOLINE(a,b,line) \
-  ex[line] += dx[line]; \
-  while(ex[line] > 0 && x[line] != destx[line]) \
-  { \
-    x[line] += incx[line]; \
-    sx[line] += incx[line]; \
-    ex[line] -= dy[line]; \
-  }
-
-#define S_GOLINE(a,b,line) \
-  if(y >= a->y && y <= b->y) \
-  {
-
-#define S_ENDLINE(a,b,line) \
-  }
-
-#define S_INITLINE(a,b,line) \
-  x[line] = a->x; \
-  sx[line] =  a->x + pptlDitherOrg->x; \
-  dx[line] = abs(b->x - a->x); \
-  dy[line] = abs(b->y - a->y); \
-  incx[line] = LINC[b->x > a->x]; \
-  ex[line] = -(dy[line]>>1); \
-  destx[line] = b->x
-
-/* Fill triangle with gradient */
-#define INITCOL(a,b,line,col,id) \
-  c[line][id] = a->col >> 8; \
-  dc[line][id] = abs((b->col >> 8) - c[line][id]); \
-  ec[line][id] = -(dy[line]>>1); \
-  ic[line][id] = LINC[(b->col >> 8) > c[line][id]]
-
-#define STEPCOL(a,b,line,col,id) \
-  ec[line][id] += dc[line][id]; \
-  while(ec[line][id] > 0) \
-  { \
-    c[line][id] += ic[line][id]; \
-    ec[line][id] -= dy[line]; \
-  }
-
-#define FINITCOL(linefrom,lineto,colid) \
-  gc[colid] = c[linefrom][colid]; \
-  gd[colid] = abs(c[lineto][colid] - gc[colid]); \
-  ge[colid] = -(gx >> 1); \
-  gi[colid] = LINC[c[lineto][colid] > gc[colid]]
-
-#define FDOCOL(linefrom,lineto,colid) \
-  ge[colid] += gd[colid]; \
-  while(ge[colid] > 0) \
-  { \
-    gc[colid] += gi[colid]; \
-    ge[colid] -= gx; \
-  }
-
-#define FILLLINE(linefrom,lineto) \
-  gx = abs(sx[lineto] - sx[linefrom]); \
-  gxi = LINC[sx[linefrom] < sx[lineto]]; \
-  FINITCOL(linefrom, lineto, 0); \
-  FINITCOL(linefrom, lineto, 1); \
-  FINITCOL(linefrom, lineto, 2); \
-  for(g = sx[linefrom]; g != sx[lineto]; g += gxi) \
-  { \
-    if(InY && g >= FillRect.left && g < FillRect.right) \
-    { \
-      Color = XLATEOBJ_iXlate(pxlo, RGB(gc[0], gc[1], gc[2])); \
-      DibFunctionsForBitmapFormat[psoOutput->iBitmapFormat].DIB_PutPixel(psoOutput, g, sy, Color); \
-    } \
-    FDOCOL(linefrom, lineto, 0); \
-    FDOCOL(linefrom, lineto, 1); \
-    FDOCOL(linefrom, lineto, 2); \
-  }
-
-#define DOLINE(a,b,line) \
-  STEPCOL(a, b, line, Red, 0); \
-  STEPCOL(a, b, line, Green, 1); \
-  STEPCOL(a, b, line, Blue, 2); \
-  ex[line] += dx[line]; \
-  while(ex[line] > 0 && x[line] != destx[line]) \
-  { \
-    x[line] += incx[line]; \
-    sx[line] += incx[line]; \
-    ex[line] -= dy[line]; \
-  }
-
-#define GOLINE(a,b,line) \
-  if(y >= a->y && y <= b->y) \
-  {
-
-#define ENDLINE(a,b,line) \
-  }
-
-#define INITLINE(a,b,line) \
-  x[line] = a->x; \
-  sx[line] =  a->x + pptlDitherOrg->x; \
-  dx[line] = abs(b->x - a->x); \
-  dy[line] = max(abs(b->y - a->y),1); \
-  incx[line] = LINC[b->x > a->x]; \
-  ex[line] = -(dy[line]>>1); \
-  destx[line] = b->x
-
-#define DOINIT(a, b, line) \
-  INITLINE(a, b, line); \
-  INITCOL(a, b, line, Red, 0); \
-  INITCOL(a, b, line, Green, 1); \
-  INITCOL(a, b, line, Blue, 2);
+/* Set up the edge from v1 to v2 at scanline y, v2->y > v1->y */
+static
+VOID
+FASTCALL
+IntGradientEdgeInit(
+    OUT PGRADIENTEDGE pEdge,
+    IN TRIVERTEX *v1,
+    IN TRIVERTEX *v2,
+    IN LONG y)
+{
+    LONG cy = v2->y - v1->y;
+    GRADIENTCOLOR gc2;
 
-#define SMALLER(a,b)     (a->y < b->y) || (a->y == b->y && a->x < b->x)
+    pEdge->llStepX = ((LONGLONG)(v2->x - v1->x) << 16) / cy;
+    pEdge->llX = ((LONGLONG)v1->x << 16) + 0x8000 + pEdge->llStepX * (y - v1->y);
 
-#define SWAP(a,b,c)  c = a;\
-                     a = b;\
-                     b = c
+    GC_INIT(pEdge->gc, v1);
+    GC_INIT(gc2, v2);
+    GC_INITSTEP(pEdge->gcStep, pEdge->gc, gc2, cy);
+    GC_ADVANCE(pEdge->gc, pEdge->gcStep, y - v1->y);
+}
 
-#define NLINES 3
+FORCEINLINE
+VOID
+IntGradientEdgeStep(PGRADIENTEDGE pEdge)
+{
+    pEdge->llX += pEdge->llStepX;
+    GC_STEP(pEdge->gc, pEdge->gcStep);
+}
 
 BOOL
 FASTCALL
@@ -320,18 +335,16 @@ IntEngGradientFillTriangle(
     SURFOBJ *psoOutput;
     PTRIVERTEX v1, v2, v3;
     RECT_ENUM RectEnum;
-    BOOL EnumMore;
+    BOOL EnumMore, bSolid;
     ULONG i;
     POINTL Translate;
     INTENG_ENTER_LEAVE EnterLeave;
-    RECTL FillRect = { 0, 0, 0, 0 };
-    ULONG Color;
-
-    BOOL sx[NLINES];
-    LONG x[NLINES], dx[NLINES], dy[NLINES], incx[NLINES], ex[NLINES], destx[NLINES];
-    LONG c[NLINES][3], dc[NLINES][3], ec[NLINES][3], ic[NLINES][3]; /* colors on lines */
-    LONG g, gx, gxi, gc[3], gd[3], ge[3], gi[3]; /* colors in triangle */
-    LONG sy, y, bt;
+    RECTL rcEnter, FillRect;
+    ULONG Color = 0;
+    GRADIENTEDGE eLong, eShort;
+    PGRADIENTEDGE peLeft, peRight;
+    GRADIENTCOLOR gc, gcStep;
+    LONG y, yEnd, xLeft, xRight, xClipLeft, xClipRight;
 
     v1 = (pVertex + gTriangle->Vertex1);
     v2 = (pVertex + gTriangle->Vertex2);
@@ -355,101 +368,100 @@ IntEngGradientFillTriangle(
     }
 
     DPRINT("Triangle: (%i,%i) (%i,%i) (%i,%i)\n", v1->x, v1->y, v2->x, v2->y, v3->x, v3->y);
-    /* FIXME: commented out because of an endless loop - fix triangles first */
-    DPRINT("FIXME: IntEngGradientFillTriangle is broken\n");
 
-    if (!IntEngEnter(&EnterLeave, psoDest, &FillRect, FALSE, &Translate, &psoOutput))
+    /* Nothing to fill in a flat triangle */
+    if (v1->y == v3->y)
+    {
+        return TRUE;
+    }
+
+    rcEnter = *prclExtents;
+    if (!IntEngEnter(&EnterLeave, psoDest, &rcEnter, FALSE, &Translate, &psoOutput))
     {
         return FALSE;
     }
 
-    if (VCMPCLRS(v1, v2, v3))
+    bSolid = !VCMPCLRS(v1, v2, v3);
+    if (bSolid)
+    {
+        Color = XLATEOBJ_iXlate(pxlo, RGB(v1->Red >> 8, v1->Green >> 8, v1->Blue >> 8));
+    }
+
+    CLIPOBJ_cEnumStart(pco, FALSE, CT_RECTANGLES, CD_RIGHTDOWN, 0);
+    do
     {
-      CLIPOBJ_cEnumStart(pco, FALSE, CT_RECTANGLES, CD_RIGHTDOWN, 0);
-      do
-      {
         EnumMore = CLIPOBJ_bEnum(pco, (ULONG) sizeof(RectEnum), (PVOID) &RectEnum);
         for (i = 0; i < RectEnum.c && RectEnum.arcl[i].top <= prclExtents->bottom; i++)
         {
-          if (RECTL_bIntersectRect(&FillRect, &RectEnum.arcl[i], prclExtents))
-          {
-            BOOL InY;
+            if (!RECTL_bIntersectRect(&FillRect, &RectEnum.arcl[i], prclExtents))
+                continue;
 
-            DOINIT(v1, v3, 0);
-            DOINIT(v1, v2, 1);
-            DOINIT(v2, v3, 2);
+            /* Work in vertex coordinates, step the edges one scanline at a time */
+            RECTL_vOffsetRect(&FillRect, -pptlDitherOrg->x, -pptlDitherOrg->y);
+            y = max(v1->y, FillRect.top);
+            yEnd = min(v3->y, FillRect.bottom);
+            if (y >= yEnd)
+                continue;
 
-            y = v1->y;
-            sy = v1->y + pptlDitherOrg->y;
-            bt = min(v3->y + pptlDitherOrg->y, FillRect.bottom);
+            IntGradientEdgeInit(&eLong, v1, v3, y);
+            if (y < v2->y)
+                IntGradientEdgeInit(&eShort, v1, v2, y);
+            else
+                IntGradientEdgeInit(&eShort, v2, v3, y);
 
-            while (sy < bt)
+            for (; y < yEnd; y++)
             {
-              InY = !(sy < FillRect.top || sy >= FillRect.bottom);
-              GOLINE(v1, v3, 0);
-              DOLINE(v1, v3, 0);
-              ENDLINE(v1, v3, 0);
-
-              GOLINE(v1, v2, 1);
-              DOLINE(v1, v2, 1);
-              FILLLINE(0, 1);
-              ENDLINE(v1, v2, 1);
-
-              GOLINE(v2, v3, 2);
-              DOLINE(v2, v3, 2);
-              FILLLINE(0, 2);
-              ENDLINE(23, v3, 2);
-
-              y++;
-              sy++;
-            }
-          }
-        }
-      } while (EnumMore);
+                if (y == v2->y)
+                {
+                    /* Switch to the lower short edge */
+                    IntGradientEdgeInit(&eShort, v2, v3, y);
+                }
 
-      return IntEngLeave(&EnterLeave);
-    }
+                if (eLong.llX <= eShort.llX)
+                {
+                    peLeft = &eLong;
+                    peRight = &eShort;
+                }
+                else
+                {
+                    peLeft = &eShort;
+                    peRight = &eLong;
+                }
 
-    /* fill triangle with one solid color */
+                xLeft = (LONG)(peLeft->llX >> 16);
+                xRight = (LONG)(peRight->llX >> 16);
+                xClipLeft = max(xLeft, FillRect.left);
+                xClipRight = min(xRight, FillRect.right);
 
-    Color = XLATEOBJ_iXlate(pxlo, RGB(v1->Red >> 8, v1->Green >> 8, v1->Blue >> 8));
-    CLIPOBJ_cEnumStart(pco, FALSE, CT_RECTANGLES, CD_RIGHTDOWN, 0);
-    do
-    {
-      EnumMore = CLIPOBJ_bEnum(pco, (ULONG) sizeof(RectEnum), (PVOID) &RectEnum);
-      for (i = 0; i < RectEnum.c && RectEnum.arcl[i].top <= prclExtents->bottom; i++)
-      {
-        if (RECTL_bIntersectRect(&FillRect, &RectEnum.arcl[i], prclExtents))
-        {
-          S_INITLINE(v1, v3, 0);
-          S_INITLINE(v1, v2, 1);
-          S_INITLINE(v2, v3, 2);
-
-          y = v1->y;
-          sy = v1->y + pptlDitherOrg->y;
-          bt = min(v3->y + pptlDitherOrg->y, FillRect.bottom);
-
-          while (sy < bt)
-          {
-            S_GOLINE(v1, v3, 0);
-            S_DOLINE(v1, v3, 0);
-            S_ENDLINE(v1, v3, 0);
-
-            S_GOLINE(v1, v2, 1);
-            S_DOLINE(v1, v2, 1);
-            S_FILLLINE(0, 1);
-            S_ENDLINE(v1, v2, 1);
-
-            S_GOLINE(v2, v3, 2);
-            S_DOLINE(v2, v3, 2);
-            S_FILLLINE(0, 2);
-            S_ENDLINE(23, v3, 2);
-
-            y++;
-            sy++;
-          }
+                if (xClipLeft < xClipRight)
+                {
+                    if (bSolid)
+                    {
+                        DibFunctionsForBitmapFormat[psoOutput->iBitmapFormat].DIB_HLine(psoOutput,
+                            xClipLeft + pptlDitherOrg->x + Translate.x,
+                            xClipRight + pptlDitherOrg->x + Translate.x,
+                            y + pptlDitherOrg->y + Translate.y,
+                            Color);
+                    }
+                    else
+                    {
+                        gc = peLeft->gc;
+                        GC_INITSTEP(gcStep, peLeft->gc, peRight->gc, xRight - xLeft);
+                        GC_ADVANCE(gc, gcStep, xClipLeft - xLeft);
+                        IntGradientSpan(psoOutput,
+                                        pxlo,
+                                        xClipLeft + pptlDitherOrg->x + Translate.x,
+                                        xClipRight + pptlDitherOrg->x + Translate.x,
+                                        y + pptlDitherOrg->y + Translate.y,
+                                        gc,
+                                        &gcStep);
+                    }
+                }
+
+                IntGradientEdgeStep(&eLong);
+                IntGradientEdgeStep(&eShort);
+            }
         }
-      }
     } while (EnumMore);
 
     return IntEngLeave(&EnterLeave);
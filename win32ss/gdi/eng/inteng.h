@@ -93,6 +93,7 @@ IntEngStretchBlt(SURFOBJ *DestObj,
                  POINTL *pMaskOrigin,
                  BRUSHOBJ *Brush,
                  POINTL *BrushOrigin,
+                 ULONG Rop4,
                  ULONG Mode);
 
 BOOL APIENTRY
@@ -412,6 +412,7 @@ GdiAllocBatchCommand(
     else if (Cmd == GdiBCSelObj) cjSize = sizeof(GDIBSOBJECT);
     else if (Cmd == GdiBCDelRgn) cjSize = sizeof(GDIBSOBJECT);
     else if (Cmd == GdiBCDelObj) cjSize = sizeof(GDIBSOBJECT);
+    else if (Cmd == GdiBCRectangle) cjSize = sizeof(GDIBSRECTANGLE);
     else cjSize = 0;
 
     /* Unsupported operation */
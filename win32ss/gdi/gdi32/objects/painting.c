@@ -91,8 +91,43 @@ Rectangle(
     _In_ INT right,
     _In_ INT bottom)
 {
+    PDC_ATTR pdcattr;
+
     HANDLE_METADC(BOOL, Rectangle, FALSE, hdc, left, top, right, bottom);
 
+    /* Get the DC attribute */
+    pdcattr = GdiGetDcAttr(hdc);
+    if (pdcattr &&
+        !(pdcattr->ulDirty_ & DC_DIBSECTION) &&
+        (pdcattr->iMapMode == MM_TEXT))
+    {
+        PGDIBSRECTANGLE pgO;
+
+        pgO = GdiAllocBatchCommand(hdc, GdiBCRectangle);
+        if (pgO)
+        {
+            pgO->nLeft   = left;
+            pgO->nTop    = top;
+            pgO->nRight  = right;
+            pgO->nBottom = bottom;
+            /* Snapshot attributes */
+            pgO->hbrush          = pdcattr->hbrush;
+            pgO->hpen            = pdcattr->hpen;
+            pgO->crForegroundClr = pdcattr->crForegroundClr;
+            pgO->crBackgroundClr = pdcattr->crBackgroundClr;
+            pgO->crBrushClr      = pdcattr->crBrushClr;
+            pgO->crPenClr        = pdcattr->crPenClr;
+            pgO->ulForegroundClr = pdcattr->ulForegroundClr;
+            pgO->ulBackgroundClr = pdcattr->ulBackgroundClr;
+            pgO->ulBrushClr      = pdcattr->ulBrushClr;
+            pgO->ulPenClr        = pdcattr->ulPenClr;
+            /* The ROP2 and the modes are read at the flush, so changing
+               them has to flush first */
+            pdcattr->ulDirty_ |= DC_MODE_DIRTY;
+            return TRUE;
+        }
+    }
+
     return NtGdiRectangle(hdc, left, top, right, bottom);
 }
 
@@ -715,7 +715,8 @@ GreStretchBltMask(
                               BitmapMask ? &MaskPoint : NULL,
                               &DCDest->eboFill.BrushObject,
                               &BrushOrigin,
-                              rop4);
+                              rop4,
+                              DCDest->pdcattr->jStretchBltMode);
     if (UsesSource)
     {
         EXLATEOBJ_vCleanup(&exlo);
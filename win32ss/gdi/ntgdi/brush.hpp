@@ -24,19 +24,17 @@ public:
     operator new(
         _In_ size_t cjSize) throw()
     {
-        return ExAllocatePoolWithTag(PagedPool, cjSize, GDITAG_HMGR_BRUSH_TYPE);
-        //return BASEOBJECT::pvAllocate(GDIObjType_BRUSH_TYPE, cjSize);
+        /* Comes from the brush lookaside lists */
+        return GDIOBJ_pvAllocateBody(GDIObjType_BRUSH_TYPE, cjSize);
     }
 
     inline
     void
     operator delete(
-        void *pvObject)
+        void *pvObject,
+        size_t cjSize)
     {
-        /// HACK! better would be to extract the exact object type's tag
-        ExFreePool(pvObject);
-        //ExFreePoolWithTag(pvObject, GDITAG_HMGR_BRUSH_TYPE);
-        //BASEOBJECT::pvFree(GDIObjType_BRUSH_TYPE, cjSize);
+        GDIOBJ_vFreeBody(GDIObjType_BRUSH_TYPE, pvObject, cjSize);
     }
 
     BRUSH(
@@ -667,6 +667,32 @@ cleanup:
     return ret;
 }
 
+/* Also used to replay batched rectangles */
+BOOL
+FASTCALL
+IntGdiRectangle(PDC dc,
+                int LeftRect,
+                int TopRect,
+                int RightRect,
+                int BottomRect)
+{
+    /* Do we rotate or shear? */
+    if (!(dc->pdcattr->mxWorldToDevice.flAccel & XFORM_SCALE))
+    {
+        POINTL DestCoords[4];
+        ULONG PolyCounts = 4;
+
+        DestCoords[0].x = DestCoords[3].x = LeftRect;
+        DestCoords[0].y = DestCoords[1].y = TopRect;
+        DestCoords[1].x = DestCoords[2].x = RightRect;
+        DestCoords[2].y = DestCoords[3].y = BottomRect;
+        // Use IntGdiPolyPolygon so to support PATH.
+        return IntGdiPolyPolygon(dc, DestCoords, &PolyCounts, 1);
+    }
+
+    return IntRectangle(dc, LeftRect, TopRect, RightRect, BottomRect);
+}
+
 BOOL
 APIENTRY
 NtGdiRectangle(HDC  hDC,
@@ -685,23 +711,7 @@ NtGdiRectangle(HDC  hDC,
         return FALSE;
     }
 
-    /* Do we rotate or shear? */
-    if (!(dc->pdcattr->mxWorldToDevice.flAccel & XFORM_SCALE))
-    {
-        POINTL DestCoords[4];
-        ULONG PolyCounts = 4;
-
-        DestCoords[0].x = DestCoords[3].x = LeftRect;
-        DestCoords[0].y = DestCoords[1].y = TopRect;
-        DestCoords[1].x = DestCoords[2].x = RightRect;
-        DestCoords[2].y = DestCoords[3].y = BottomRect;
-        // Use IntGdiPolyPolygon so to support PATH.
-        ret = IntGdiPolyPolygon(dc, DestCoords, &PolyCounts, 1);
-    }
-    else
-    {
-        ret = IntRectangle(dc, LeftRect, TopRect, RightRect, BottomRect );
-    }
+    ret = IntGdiRectangle(dc, LeftRect, TopRect, RightRect, BottomRect);
 
     DC_UnlockDc(dc);
 
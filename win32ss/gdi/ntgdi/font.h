@@ -1,6 +1,26 @@
 #pragma once
 
 
+/*
+ * FONT_METADATA --- what the font list needs to know about a font entry
+ * without loading its face. Stored in the font metadata cache file.
+ */
+typedef struct FONT_METADATA
+{
+    FONTFAMILYINFO  Info;                               /* enumeration data */
+    TEXTMETRICW     TextMetric;                         /* at the default size */
+    WCHAR           FamilyName[LF_FULLFACESIZE];        /* localized family name */
+    WCHAR           FullName[LF_FULLFACESIZE];          /* localized full name */
+    WCHAR           EnglishFamilyName[LF_FULLFACESIZE];
+    WCHAR           EnglishFullName[LF_FULLFACESIZE];
+    CHAR            FaceFamilyName[LF_FULLFACESIZE];    /* FT_Face family_name */
+    CHAR            FaceStyleName[LF_FULLFACESIZE];     /* FT_Face style_name */
+    LONG            FaceIndex;
+    LONG            OriginalWeight;
+    BYTE            OriginalItalic;
+    BYTE            CharSet;
+} FONT_METADATA, *PFONT_METADATA;
+
 typedef struct _FONT_ENTRY
 {
     LIST_ENTRY ListEntry;
@@ -8,6 +28,7 @@ typedef struct _FONT_ENTRY
     UNICODE_STRING FaceName;
     UNICODE_STRING StyleName;
     BYTE NotEnum;
+    PFONT_METADATA Metadata;    /* set if the entry was added from the metadata cache */
 } FONT_ENTRY, *PFONT_ENTRY;
 
 typedef struct _FONT_ENTRY_MEM
@@ -63,3 +84,27 @@ typedef struct GDI_LOAD_FONT
     PFONT_ENTRY_MEM     PrivateEntry;
 } GDI_LOAD_FONT, *PGDI_LOAD_FONT;
 
+/*
+ * The font metadata cache file: a FONT_METADATA_HEADER followed by
+ * FileCount FONT_METADATA_FILE records, each followed by FaceCount
+ * FONT_METADATA records in font list order.
+ */
+#define FONT_METADATA_MAGIC     0x4D544E46  /* 'FNTM' */
+#define FONT_METADATA_VERSION   1
+
+typedef struct FONT_METADATA_HEADER
+{
+    ULONG           Magic;
+    ULONG           Version;
+    ULONG           LanguageID;
+    ULONG           FileCount;
+} FONT_METADATA_HEADER, *PFONT_METADATA_HEADER;
+
+typedef struct FONT_METADATA_FILE
+{
+    LARGE_INTEGER   LastWriteTime;
+    LARGE_INTEGER   EndOfFile;
+    ULONG           FaceCount;
+    WCHAR           FileName[MAX_PATH];                 /* relative to the Fonts directory */
+    WCHAR           RegValueName[MAX_PATH];
+} FONT_METADATA_FILE, *PFONT_METADATA_FILE;
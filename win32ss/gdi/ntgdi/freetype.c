@@ -219,6 +219,8 @@ SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
         Ptr->Face = Face;
         Ptr->RefCount = 1;
         Ptr->Memory = Memory;
+        Ptr->FaceIndex = Face->face_index;
+        RtlInitUnicodeString(&Ptr->FileName, NULL);
         SharedFaceCache_Init(&Ptr->EnglishUS);
         SharedFaceCache_Init(&Ptr->UserLanguage);
 
@@ -228,6 +230,35 @@ SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
     return Ptr;
 }
 
+/* Creates a SharedFace whose Face is loaded from FileName on first use */
+static PSHARED_FACE
+SharedFace_CreateDeferred(PUNICODE_STRING FileName, FT_Long FaceIndex)
+{
+    PSHARED_FACE Ptr;
+    Ptr = ExAllocatePoolWithTag(PagedPool, sizeof(SHARED_FACE), TAG_FONT);
+    if (Ptr)
+    {
+        Ptr->FileName.Length = FileName->Length;
+        Ptr->FileName.MaximumLength = FileName->Length + sizeof(UNICODE_NULL);
+        Ptr->FileName.Buffer = ExAllocatePoolWithTag(PagedPool, Ptr->FileName.MaximumLength, TAG_USTR);
+        if (!Ptr->FileName.Buffer)
+        {
+            ExFreePoolWithTag(Ptr, TAG_FONT);
+            return NULL;
+        }
+        RtlCopyMemory(Ptr->FileName.Buffer, FileName->Buffer, FileName->Length);
+        Ptr->FileName.Buffer[FileName->Length / sizeof(WCHAR)] = UNICODE_NULL;
+        Ptr->Face = NULL;
+        Ptr->RefCount = 1;
+        Ptr->Memory = NULL;
+        Ptr->FaceIndex = FaceIndex;
+        SharedFaceCache_Init(&Ptr->EnglishUS);
+        SharedFaceCache_Init(&Ptr->UserLanguage);
+        DPRINT("Creating deferred SharedFace for %wZ (%ld)\n", FileName, FaceIndex);
+    }
+    return Ptr;
+}
+
 static PSHARED_MEM
 SharedMem_Create(PBYTE Buffer, ULONG BufferSize, BOOL IsMapping)
 {
@@ -325,10 +356,14 @@ SharedFace_Release(PSHARED_FACE Ptr)
     --Ptr->RefCount;
     if (Ptr->RefCount == 0)
     {
-        DPRINT("Releasing SharedFace for %s\n", Ptr->Face->family_name ? Ptr->Face->family_name : "<NULL>");
-        RemoveCacheEntries(Ptr->Face);
-        FT_Done_Face(Ptr->Face);
-        SharedMem_Release(Ptr->Memory);
+        if (Ptr->Face)
+        {
+            DPRINT("Releasing SharedFace for %s\n", Ptr->Face->family_name ? Ptr->Face->family_name : "<NULL>");
+            RemoveCacheEntries(Ptr->Face);
+            FT_Done_Face(Ptr->Face);
+            SharedMem_Release(Ptr->Memory);
+        }
+        RtlFreeUnicodeString(&Ptr->FileName);
         SharedFaceCache_Release(&Ptr->EnglishUS);
         SharedFaceCache_Release(&Ptr->UserLanguage);
         ExFreePoolWithTag(Ptr, TAG_FONT);
@@ -336,6 +371,112 @@ SharedFace_Release(PSHARED_FACE Ptr)
     IntUnLockFreeType();
 }
 
+/* Maps a font file into system space */
+static NTSTATUS
+IntMapFontFile(PUNICODE_STRING FileName, PVOID *pBuffer, SIZE_T *pViewSize)
+{
+    NTSTATUS Status;
+    HANDLE FileHandle;
+    IO_STATUS_BLOCK Iosb;
+    PVOID SectionObject;
+    LARGE_INTEGER SectionSize;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+
+    /* Open the font file */
+    InitializeObjectAttributes(&ObjectAttributes, FileName, 0, NULL, NULL);
+    Status = ZwOpenFile(
+                 &FileHandle,
+                 FILE_GENERIC_READ | SYNCHRONIZE,
+                 &ObjectAttributes,
+                 &Iosb,
+                 FILE_SHARE_READ,
+                 FILE_SYNCHRONOUS_IO_NONALERT);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT("Could not load font file: %wZ\n", FileName);
+        return Status;
+    }
+
+    SectionSize.QuadPart = 0LL;
+    Status = MmCreateSection(&SectionObject, SECTION_ALL_ACCESS,
+                             NULL, &SectionSize, PAGE_READONLY,
+                             SEC_COMMIT, FileHandle, NULL);
+    ZwClose(FileHandle);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT("Could not map file: %wZ\n", FileName);
+        return Status;
+    }
+
+    *pBuffer = NULL;
+    *pViewSize = 0;
+    Status = MmMapViewInSystemSpace(SectionObject, pBuffer, pViewSize);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT("Could not map file: %wZ\n", FileName);
+    }
+
+    /* The view keeps the section alive */
+    ObDereferenceObject(SectionObject);
+    return Status;
+}
+
+/*
+ * Loads the face of a SharedFace that was created from the font metadata
+ * cache. Must be called without the FreeType lock.
+ */
+static BOOL
+SharedFace_EnsureFace(PSHARED_FACE SharedFace)
+{
+    NTSTATUS Status;
+    FT_Error Error;
+    FT_Face Face;
+    PVOID Buffer;
+    SIZE_T ViewSize;
+    PSHARED_MEM Memory;
+
+    if (SharedFace->Face)
+        return TRUE;
+
+    ASSERT_FREETYPE_LOCK_NOT_HELD();
+    ASSERT(SharedFace->FileName.Buffer);
+
+    Status = IntMapFontFile(&SharedFace->FileName, &Buffer, &ViewSize);
+    if (!NT_SUCCESS(Status))
+        return FALSE;
+
+    Memory = SharedMem_Create(Buffer, ViewSize, TRUE);
+    if (!Memory)
+    {
+        MmUnmapViewInSystemSpace(Buffer);
+        return FALSE;
+    }
+
+    IntLockFreeType();
+    /* Another thread may have loaded it in the meantime */
+    if (!SharedFace->Face)
+    {
+        Error = FT_New_Memory_Face(g_FreeTypeLibrary, Buffer, ViewSize,
+                                   SharedFace->FaceIndex, &Face);
+        if (!Error)
+        {
+            SharedFace->Memory = Memory;
+            SharedMem_AddRef(Memory);
+            SharedFace->Face = Face;
+            DPRINT("Loaded deferred SharedFace for %s\n", Face->family_name ? Face->family_name : "<NULL>");
+        }
+        else
+        {
+            DPRINT1("Error reading font %wZ (error code: %d)\n", &SharedFace->FileName, Error);
+        }
+    }
+    /* Release our copy */
+    SharedMem_Release(Memory);
+    IntUnLockFreeType();
+
+    return SharedFace->Face != NULL;
+}
+
 
 static __inline void FTVectorToPOINTFX(FT_Vector *vec, POINTFX *pt)
 {
@@ -873,115 +1014,6 @@ SubstituteFontRecurse(LOGFONTW* pLogFont)
     return TRUE;    /* success */
 }
 
-/*
- * IntLoadSystemFonts
- *
- * Search the system font directory and adds each font found.
- */
-VOID FASTCALL
-IntLoadSystemFonts(VOID)
-{
-    OBJECT_ATTRIBUTES ObjectAttributes;
-    UNICODE_STRING Directory, FileName, TempString;
-    IO_STATUS_BLOCK Iosb;
-    HANDLE hDirectory;
-    BYTE *DirInfoBuffer;
-    PFILE_DIRECTORY_INFORMATION DirInfo;
-    BOOLEAN bRestartScan = TRUE;
-    NTSTATUS Status;
-    INT i;
-    static UNICODE_STRING SearchPatterns[] =
-    {
-        RTL_CONSTANT_STRING(L"*.ttf"),
-        RTL_CONSTANT_STRING(L"*.ttc"),
-        RTL_CONSTANT_STRING(L"*.otf"),
-        RTL_CONSTANT_STRING(L"*.otc"),
-        RTL_CONSTANT_STRING(L"*.fon"),
-        RTL_CONSTANT_STRING(L"*.fnt")
-    };
-
-    RtlInitUnicodeString(&Directory, L"\\SystemRoot\\Fonts\\");
-
-    InitializeObjectAttributes(
-        &ObjectAttributes,
-        &Directory,
-        OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
-        NULL,
-        NULL);
-
-    Status = ZwOpenFile(
-                 &hDirectory,
-                 SYNCHRONIZE | FILE_LIST_DIRECTORY,
-                 &ObjectAttributes,
-                 &Iosb,
-                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                 FILE_SYNCHRONOUS_IO_NONALERT | FILE_DIRECTORY_FILE);
-
-    if (NT_SUCCESS(Status))
-    {
-        for (i = 0; i < _countof(SearchPatterns); ++i)
-        {
-            DirInfoBuffer = ExAllocatePoolWithTag(PagedPool, 0x4000, TAG_FONT);
-            if (DirInfoBuffer == NULL)
-            {
-                ZwClose(hDirectory);
-                return;
-            }
-
-            FileName.Buffer = ExAllocatePoolWithTag(PagedPool, MAX_PATH * sizeof(WCHAR), TAG_FONT);
-            if (FileName.Buffer == NULL)
-            {
-                ExFreePoolWithTag(DirInfoBuffer, TAG_FONT);
-                ZwClose(hDirectory);
-                return;
-            }
-            FileName.Length = 0;
-            FileName.MaximumLength = MAX_PATH * sizeof(WCHAR);
-
-            while (1)
-            {
-                Status = ZwQueryDirectoryFile(
-                             hDirectory,
-                             NULL,
-                             NULL,
-                             NULL,
-                             &Iosb,
-                             DirInfoBuffer,
-                             0x4000,
-                             FileDirectoryInformation,
-                             FALSE,
-                             &SearchPatterns[i],
-                             bRestartScan);
-
-                if (!NT_SUCCESS(Status) || Status == STATUS_NO_MORE_FILES)
-                {
-                    break;
-                }
-
-                DirInfo = (PFILE_DIRECTORY_INFORMATION)DirInfoBuffer;
-                while (1)
-                {
-                    TempString.Buffer = DirInfo->FileName;
-                    TempString.Length =
-                        TempString.MaximumLength = DirInfo->FileNameLength;
-                    RtlCopyUnicodeString(&FileName, &Directory);
-                    RtlAppendUnicodeStringToString(&FileName, &TempString);
-                    IntGdiAddFontResource(&FileName, 0);
-                    if (DirInfo->NextEntryOffset == 0)
-                        break;
-                    DirInfo = (PFILE_DIRECTORY_INFORMATION)((ULONG_PTR)DirInfo + DirInfo->NextEntryOffset);
-                }
-
-                bRestartScan = FALSE;
-            }
-
-            ExFreePoolWithTag(FileName.Buffer, TAG_FONT);
-            ExFreePoolWithTag(DirInfoBuffer, TAG_FONT);
-        }
-        ZwClose(hDirectory);
-    }
-}
-
 static BYTE
 ItalicFromStyle(const char *style_name)
 {
@@ -1110,6 +1142,7 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
         EngSetLastError(ERROR_NOT_ENOUGH_MEMORY);
         return 0;   /* failure */
     }
+    Entry->Metadata = NULL;
 
     /* allocate a FONTGDI */
     FontGDI = EngAllocMem(FL_ZERO_MEMORY, sizeof(FONTGDI), GDITAG_RFONT);
@@ -1363,130 +1396,835 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
 
         for (i = 1; i < CharSetCount; ++i)
         {
-            /* Do not count charsets towards 'faces' loaded */
-            IntGdiLoadFontsFromMemory(pLoadFont, SharedFace, FontIndex, i);
+            /* Do not count charsets towards 'faces' loaded */
+            IntGdiLoadFontsFromMemory(pLoadFont, SharedFace, FontIndex, i);
+        }
+    }
+
+    return FaceCount;   /* number of loaded faces */
+}
+
+/* Records a font file in the Fonts registry key */
+static VOID
+IntStoreFontRegValue(PUNICODE_STRING FileName, PUNICODE_STRING ValueName)
+{
+    NTSTATUS Status;
+    HANDLE KeyHandle;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    SIZE_T DataSize;
+    LPWSTR pFileName;
+
+    InitializeObjectAttributes(&ObjectAttributes, &g_FontRegPath,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL, NULL);
+    Status = ZwOpenKey(&KeyHandle, KEY_WRITE, &ObjectAttributes);
+    if (NT_SUCCESS(Status))
+    {
+        pFileName = wcsrchr(FileName->Buffer, L'\\');
+        if (pFileName)
+        {
+            pFileName++;
+            DataSize = (wcslen(pFileName) + 1) * sizeof(WCHAR);
+            ZwSetValueKey(KeyHandle, ValueName, 0, REG_SZ,
+                          pFileName, DataSize);
+        }
+        ZwClose(KeyHandle);
+    }
+}
+
+/*
+ * IntGdiAddFontResourceEx
+ *
+ * Adds the font resource from the specified file to the system.
+ * If pRegValueName is not NULL, it receives the registry value name.
+ */
+static INT FASTCALL
+IntGdiAddFontResourceEx(PUNICODE_STRING FileName, DWORD Characteristics,
+                        PUNICODE_STRING pRegValueName)
+{
+    NTSTATUS Status;
+    PVOID Buffer;
+    SIZE_T ViewSize;
+    GDI_LOAD_FONT   LoadFont;
+    INT FontCount;
+    static const UNICODE_STRING TrueTypePostfix = RTL_CONSTANT_STRING(L" (TrueType)");
+
+    Status = IntMapFontFile(FileName, &Buffer, &ViewSize);
+    if (!NT_SUCCESS(Status))
+    {
+        return 0;
+    }
+
+    LoadFont.pFileName          = FileName;
+    LoadFont.Memory             = SharedMem_Create(Buffer, ViewSize, TRUE);
+    LoadFont.Characteristics    = Characteristics;
+    RtlInitUnicodeString(&LoadFont.RegValueName, NULL);
+    LoadFont.IsTrueType         = FALSE;
+    LoadFont.PrivateEntry       = NULL;
+    FontCount = IntGdiLoadFontsFromMemory(&LoadFont, NULL, -1, -1);
+
+    /* Release our copy */
+    IntLockFreeType();
+    SharedMem_Release(LoadFont.Memory);
+    IntUnLockFreeType();
+
+    if (FontCount > 0)
+    {
+        if (LoadFont.IsTrueType)
+        {
+            /* append " (TrueType)" */
+            UNICODE_STRING NewString;
+            USHORT Length;
+
+            Length = LoadFont.RegValueName.Length + TrueTypePostfix.Length;
+            NewString.Length = 0;
+            NewString.MaximumLength = Length + sizeof(WCHAR);
+            NewString.Buffer = ExAllocatePoolWithTag(PagedPool,
+                                                     NewString.MaximumLength,
+                                                     TAG_USTR);
+            NewString.Buffer[0] = UNICODE_NULL;
+
+            RtlAppendUnicodeStringToString(&NewString, &LoadFont.RegValueName);
+            RtlAppendUnicodeStringToString(&NewString, &TrueTypePostfix);
+            RtlFreeUnicodeString(&LoadFont.RegValueName);
+            LoadFont.RegValueName = NewString;
+        }
+
+        /* registry */
+        IntStoreFontRegValue(FileName, &LoadFont.RegValueName);
+
+        if (pRegValueName)
+        {
+            *pRegValueName = LoadFont.RegValueName;
+            return FontCount;
+        }
+    }
+    RtlFreeUnicodeString(&LoadFont.RegValueName);
+
+    return FontCount;
+}
+
+/*
+ * IntGdiAddFontResource
+ *
+ * Adds the font resource from the specified file to the system.
+ */
+
+INT FASTCALL
+IntGdiAddFontResource(PUNICODE_STRING FileName, DWORD Characteristics)
+{
+    return IntGdiAddFontResourceEx(FileName, Characteristics, NULL);
+}
+
+/*
+ * Font metadata cache
+ *
+ * IntLoadSystemFonts records what the font list needs to know about each
+ * system font file in g_FontMetadataPath. On the next start, the files
+ * whose size and time stamp did not change are added from the cache
+ * without being parsed. Their faces are loaded by SharedFace_EnsureFace
+ * when one of them is first considered for a logical font.
+ */
+
+static UNICODE_STRING g_FontMetadataPath =
+    RTL_CONSTANT_STRING(L"\\SystemRoot\\System32\\fntcache.dat");
+
+#define MAX_FONT_METADATA_SIZE  (16 * 1024 * 1024)
+
+typedef struct FONT_METADATA_BUFFER
+{
+    PBYTE   Buffer;
+    ULONG   Size;
+    ULONG   MaxSize;
+} FONT_METADATA_BUFFER, *PFONT_METADATA_BUFFER;
+
+static void FASTCALL
+FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
+                   LPCWSTR FullName, PFONTGDI FontGDI);
+
+static NTSTATUS
+IntGetFontLocalizedName(PUNICODE_STRING pNameW, PSHARED_FACE SharedFace,
+                        FT_UShort NameID, FT_UShort LangID);
+
+static VOID FASTCALL
+CleanupFontEntry(PFONT_ENTRY FontEntry);
+
+static VOID
+IntFreeFontMetadata(PFONT_METADATA_BUFFER Cache)
+{
+    if (Cache->Buffer)
+        ExFreePoolWithTag(Cache->Buffer, TAG_FONT);
+    Cache->Buffer = NULL;
+    Cache->Size = Cache->MaxSize = 0;
+}
+
+/* Returns zeroed space at the end of the buffer, growing it if needed */
+static PVOID
+IntReserveFontMetadata(PFONT_METADATA_BUFFER Cache, ULONG Size)
+{
+    PBYTE NewBuffer;
+    ULONG NewMaxSize;
+
+    if (Cache->MaxSize - Cache->Size < Size)
+    {
+        NewMaxSize = max(Cache->MaxSize * 2, 0x10000);
+        while (NewMaxSize - Cache->Size < Size)
+            NewMaxSize *= 2;
+        if (NewMaxSize > MAX_FONT_METADATA_SIZE)
+            return NULL;
+
+        NewBuffer = ExAllocatePoolWithTag(PagedPool, NewMaxSize, TAG_FONT);
+        if (!NewBuffer)
+            return NULL;
+
+        if (Cache->Buffer)
+        {
+            RtlCopyMemory(NewBuffer, Cache->Buffer, Cache->Size);
+            ExFreePoolWithTag(Cache->Buffer, TAG_FONT);
+        }
+        Cache->Buffer = NewBuffer;
+        Cache->MaxSize = NewMaxSize;
+    }
+
+    NewBuffer = Cache->Buffer + Cache->Size;
+    RtlZeroMemory(NewBuffer, Size);
+    Cache->Size += Size;
+    return NewBuffer;
+}
+
+/* The cache file is not trusted: every string read from it must end in a NUL */
+static VOID
+IntTerminateFontMetadata(PFONT_METADATA Metadata)
+{
+    LPENUMLOGFONTEXW EnumLogFont = &Metadata->Info.EnumLogFontEx;
+
+    EnumLogFont->elfLogFont.lfFaceName[LF_FACESIZE - 1] = UNICODE_NULL;
+    EnumLogFont->elfFullName[LF_FULLFACESIZE - 1] = UNICODE_NULL;
+    EnumLogFont->elfStyle[LF_FACESIZE - 1] = UNICODE_NULL;
+    EnumLogFont->elfScript[LF_FACESIZE - 1] = UNICODE_NULL;
+    Metadata->FamilyName[LF_FULLFACESIZE - 1] = UNICODE_NULL;
+    Metadata->FullName[LF_FULLFACESIZE - 1] = UNICODE_NULL;
+    Metadata->EnglishFamilyName[LF_FULLFACESIZE - 1] = UNICODE_NULL;
+    Metadata->EnglishFullName[LF_FULLFACESIZE - 1] = UNICODE_NULL;
+    Metadata->FaceFamilyName[LF_FULLFACESIZE - 1] = ANSI_NULL;
+    Metadata->FaceStyleName[LF_FULLFACESIZE - 1] = ANSI_NULL;
+}
+
+/* Reads and validates the cache file. Returns the number of file records. */
+static ULONG
+IntReadFontMetadata(PFONT_METADATA_BUFFER Cache)
+{
+    NTSTATUS Status;
+    HANDLE FileHandle;
+    IO_STATUS_BLOCK Iosb;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    FILE_STANDARD_INFORMATION FileInfo;
+    PFONT_METADATA_HEADER Header;
+    PFONT_METADATA_FILE File;
+    PFONT_METADATA Metadata;
+    ULONG Offset, i, j;
+
+    RtlZeroMemory(Cache, sizeof(*Cache));
+
+    InitializeObjectAttributes(&ObjectAttributes, &g_FontMetadataPath,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL, NULL);
+    Status = ZwOpenFile(&FileHandle,
+                        FILE_GENERIC_READ | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &Iosb,
+                        FILE_SHARE_READ,
+                        FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE);
+    if (!NT_SUCCESS(Status))
+        return 0;
+
+    Status = ZwQueryInformationFile(FileHandle, &Iosb, &FileInfo,
+                                    sizeof(FileInfo), FileStandardInformation);
+    if (NT_SUCCESS(Status) &&
+        FileInfo.EndOfFile.QuadPart >= sizeof(FONT_METADATA_HEADER) &&
+        FileInfo.EndOfFile.QuadPart <= MAX_FONT_METADATA_SIZE &&
+        IntReserveFontMetadata(Cache, FileInfo.EndOfFile.LowPart))
+    {
+        Status = ZwReadFile(FileHandle, NULL, NULL, NULL, &Iosb,
+                            Cache->Buffer, Cache->Size, NULL, NULL);
+        if (NT_SUCCESS(Status) && Iosb.Information != Cache->Size)
+            Status = STATUS_END_OF_FILE;
+    }
+    else
+    {
+        Status = STATUS_UNSUCCESSFUL;
+    }
+    ZwClose(FileHandle);
+
+    if (!NT_SUCCESS(Status))
+    {
+        IntFreeFontMetadata(Cache);
+        return 0;
+    }
+
+    /* A cache written for another version or language is useless */
+    Header = (PFONT_METADATA_HEADER)Cache->Buffer;
+    if (Header->Magic != FONT_METADATA_MAGIC ||
+        Header->Version != FONT_METADATA_VERSION ||
+        Header->LanguageID != gusLanguageID)
+    {
+        IntFreeFontMetadata(Cache);
+        return 0;
+    }
+
+    Offset = sizeof(FONT_METADATA_HEADER);
+    for (i = 0; i < Header->FileCount; ++i)
+    {
+        File = (PFONT_METADATA_FILE)(Cache->Buffer + Offset);
+        if (Cache->Size - Offset < sizeof(FONT_METADATA_FILE) ||
+            File->FaceCount == 0 ||
+            File->FaceCount > (Cache->Size - Offset - sizeof(FONT_METADATA_FILE)) / sizeof(FONT_METADATA))
+        {
+            DPRINT1("Invalid font metadata cache\n");
+            IntFreeFontMetadata(Cache);
+            return 0;
+        }
+        File->FileName[MAX_PATH - 1] = UNICODE_NULL;
+        File->RegValueName[MAX_PATH - 1] = UNICODE_NULL;
+        Metadata = (PFONT_METADATA)(File + 1);
+        for (j = 0; j < File->FaceCount; ++j)
+            IntTerminateFontMetadata(&Metadata[j]);
+        Offset += sizeof(FONT_METADATA_FILE) + File->FaceCount * sizeof(FONT_METADATA);
+    }
+
+    return Header->FileCount;
+}
+
+static VOID
+IntWriteFontMetadata(PFONT_METADATA_BUFFER Cache, ULONG FileCount)
+{
+    NTSTATUS Status;
+    HANDLE FileHandle;
+    IO_STATUS_BLOCK Iosb;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    PFONT_METADATA_HEADER Header = (PFONT_METADATA_HEADER)Cache->Buffer;
+
+    Header->Magic = FONT_METADATA_MAGIC;
+    Header->Version = FONT_METADATA_VERSION;
+    Header->LanguageID = gusLanguageID;
+    Header->FileCount = FileCount;
+
+    InitializeObjectAttributes(&ObjectAttributes, &g_FontMetadataPath,
+                               OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+                               NULL, NULL);
+    Status = ZwCreateFile(&FileHandle,
+                          FILE_GENERIC_WRITE | SYNCHRONIZE,
+                          &ObjectAttributes,
+                          &Iosb,
+                          NULL,
+                          FILE_ATTRIBUTE_NORMAL,
+                          0,
+                          FILE_OVERWRITE_IF,
+                          FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE,
+                          NULL,
+                          0);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT("Could not create %wZ: 0x%lx\n", &g_FontMetadataPath, Status);
+        return;
+    }
+
+    Status = ZwWriteFile(FileHandle, NULL, NULL, NULL, &Iosb,
+                         Cache->Buffer, Cache->Size, NULL, NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Could not write %wZ: 0x%lx\n", &g_FontMetadataPath, Status);
+    }
+    ZwClose(FileHandle);
+}
+
+static PFONT_METADATA_FILE
+IntFindFontMetadata(PFONT_METADATA_BUFFER Cache, ULONG FileCount,
+                    PUNICODE_STRING Name, PFILE_DIRECTORY_INFORMATION DirInfo)
+{
+    PFONT_METADATA_FILE File;
+    UNICODE_STRING FileName;
+    ULONG Offset = sizeof(FONT_METADATA_HEADER);
+
+    while (FileCount--)
+    {
+        File = (PFONT_METADATA_FILE)(Cache->Buffer + Offset);
+        Offset += sizeof(FONT_METADATA_FILE) + File->FaceCount * sizeof(FONT_METADATA);
+
+        if (File->EndOfFile.QuadPart != DirInfo->EndOfFile.QuadPart ||
+            File->LastWriteTime.QuadPart != DirInfo->LastWriteTime.QuadPart)
+        {
+            continue;
+        }
+
+        RtlInitUnicodeString(&FileName, File->FileName);
+        if (RtlEqualUnicodeString(&FileName, Name, TRUE))
+            return File;
+    }
+
+    return NULL;
+}
+
+static BOOL
+IntCopyFontName(PWSTR pszDest, PCWSTR pszSrc)
+{
+    return NT_SUCCESS(RtlStringCchCopyW(pszDest, LF_FULLFACESIZE, pszSrc));
+}
+
+/* Collects the metadata of a loaded font entry */
+static BOOL
+IntFillFontMetadata(PFONT_METADATA Metadata, PFONT_ENTRY Entry)
+{
+    PFONTGDI FontGDI = Entry->Font;
+    PSHARED_FACE SharedFace = FontGDI->SharedFace;
+    FT_Face Face = SharedFace->Face;
+    OUTLINETEXTMETRICW *Otm;
+    UNICODE_STRING Name;
+    NTSTATUS Status;
+    UINT Size;
+    BOOL Ret;
+
+    /* The names of a face must survive the round trip unchanged */
+    if (!NT_SUCCESS(RtlStringCbCopyA(Metadata->FaceFamilyName, sizeof(Metadata->FaceFamilyName),
+                                     Face->family_name ? Face->family_name : "")) ||
+        !NT_SUCCESS(RtlStringCbCopyA(Metadata->FaceStyleName, sizeof(Metadata->FaceStyleName),
+                                     Face->style_name ? Face->style_name : "")))
+    {
+        return FALSE;
+    }
+
+    Size = IntGetOutlineTextMetrics(FontGDI, 0, NULL);
+    Otm = ExAllocatePoolWithTag(PagedPool, Size, GDITAG_TEXT);
+    if (!Otm)
+        return FALSE;
+
+    Ret = (IntGetOutlineTextMetrics(FontGDI, Size, Otm) != 0);
+    if (Ret)
+    {
+        RtlCopyMemory(&Metadata->TextMetric, &Otm->otmTextMetrics, sizeof(TEXTMETRICW));
+        Ret = IntCopyFontName(Metadata->FamilyName,
+                              (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFamilyName)) &&
+              IntCopyFontName(Metadata->FullName,
+                              (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFaceName));
+    }
+    ExFreePoolWithTag(Otm, GDITAG_TEXT);
+    if (!Ret)
+        return FALSE;
+
+    FontFamilyFillInfo(&Metadata->Info, NULL, NULL, FontGDI);
+
+    /* The English names, as MatchFontNames looks them up */
+    RtlInitUnicodeString(&Name, NULL);
+    Status = IntGetFontLocalizedName(&Name, SharedFace, TT_NAME_ID_FONT_FAMILY, LANG_ENGLISH);
+    if (NT_SUCCESS(Status))
+    {
+        Ret = NT_SUCCESS(RtlStringCchCopyNW(Metadata->EnglishFamilyName, LF_FULLFACESIZE,
+                                            Name.Buffer, Name.Length / sizeof(WCHAR)));
+        RtlFreeUnicodeString(&Name);
+    }
+    Status = IntGetFontLocalizedName(&Name, SharedFace, TT_NAME_ID_FULL_NAME, LANG_ENGLISH);
+    if (NT_SUCCESS(Status))
+    {
+        Ret = Ret && NT_SUCCESS(RtlStringCchCopyNW(Metadata->EnglishFullName, LF_FULLFACESIZE,
+                                                   Name.Buffer, Name.Length / sizeof(WCHAR)));
+        RtlFreeUnicodeString(&Name);
+    }
+
+    Metadata->FaceIndex = Face->face_index;
+    Metadata->OriginalWeight = FontGDI->OriginalWeight;
+    Metadata->OriginalItalic = FontGDI->OriginalItalic;
+    Metadata->CharSet = FontGDI->CharSet;
+    return Ret;
+}
+
+/* Appends a record for the entries that were added after LastEntry */
+static BOOL
+IntRecordFontMetadata(PFONT_METADATA_BUFFER Cache, PUNICODE_STRING Name,
+                      PFILE_DIRECTORY_INFORMATION DirInfo,
+                      PUNICODE_STRING RegValueName, PLIST_ENTRY LastEntry)
+{
+    PFONT_METADATA_FILE File;
+    PFONT_METADATA Metadata;
+    PLIST_ENTRY ListEntry;
+    ULONG Offset = Cache->Size, FaceCount = 0;
+    BOOL Ret = TRUE;
+
+    if (Name->Length >= sizeof(File->FileName) ||
+        RegValueName->Length >= sizeof(File->RegValueName))
+    {
+        return FALSE;
+    }
+
+    File = IntReserveFontMetadata(Cache, sizeof(FONT_METADATA_FILE));
+    if (!File)
+        return FALSE;
+
+    File->LastWriteTime = DirInfo->LastWriteTime;
+    File->EndOfFile = DirInfo->EndOfFile;
+    RtlCopyMemory(File->FileName, Name->Buffer, Name->Length);
+    RtlCopyMemory(File->RegValueName, RegValueName->Buffer, RegValueName->Length);
+
+    IntLockGlobalFonts();
+    for (ListEntry = LastEntry->Flink; ListEntry != &g_FontListHead; ListEntry = ListEntry->Flink)
+    {
+        Metadata = IntReserveFontMetadata(Cache, sizeof(FONT_METADATA));
+        if (!Metadata ||
+            !IntFillFontMetadata(Metadata, CONTAINING_RECORD(ListEntry, FONT_ENTRY, ListEntry)))
+        {
+            Ret = FALSE;
+            break;
+        }
+        ++FaceCount;
+    }
+    IntUnLockGlobalFonts();
+
+    if (!Ret || FaceCount == 0)
+    {
+        /* Leave this file out, it will be parsed again next time */
+        Cache->Size = Offset;
+        return FALSE;
+    }
+
+    File = (PFONT_METADATA_FILE)(Cache->Buffer + Offset);
+    File->FaceCount = FaceCount;
+    return TRUE;
+}
+
+static VOID
+IntSetCachedFontName(PUNICODE_STRING pName, PCWSTR pszName)
+{
+    UNICODE_STRING Name;
+
+    if (pName->Buffer || !pszName[0])
+        return;
+
+    RtlInitUnicodeString(&Name, pszName);
+    pName->MaximumLength = Name.Length + sizeof(UNICODE_NULL);
+    pName->Buffer = ExAllocatePoolWithTag(PagedPool, pName->MaximumLength, TAG_USTR);
+    if (pName->Buffer)
+    {
+        RtlCopyMemory(pName->Buffer, Name.Buffer, pName->MaximumLength);
+        pName->Length = Name.Length;
+    }
+    else
+    {
+        pName->MaximumLength = 0;
+    }
+}
+
+static PFONT_ENTRY
+IntCreateFontEntryFromMetadata(PUNICODE_STRING FileName, PSHARED_FACE SharedFace,
+                               const FONT_METADATA *Metadata)
+{
+    PFONT_ENTRY Entry;
+    PFONTGDI FontGDI;
+    ANSI_STRING AnsiString;
+    NTSTATUS Status;
+
+    Entry = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_ENTRY), TAG_FONT);
+    if (!Entry)
+        return NULL;
+    RtlZeroMemory(Entry, sizeof(FONT_ENTRY));
+
+    Entry->Metadata = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_METADATA), TAG_FONT);
+    FontGDI = EngAllocMem(FL_ZERO_MEMORY, sizeof(FONTGDI), GDITAG_RFONT);
+    if (FontGDI)
+    {
+        FontGDI->Filename = ExAllocatePoolWithTag(PagedPool,
+                                                  FileName->Length + sizeof(UNICODE_NULL),
+                                                  GDITAG_PFF);
+    }
+
+    Status = STATUS_NO_MEMORY;
+    if (Entry->Metadata && FontGDI && FontGDI->Filename)
+    {
+        RtlInitAnsiString(&AnsiString, Metadata->FaceFamilyName);
+        Status = RtlAnsiStringToUnicodeString(&Entry->FaceName, &AnsiString, TRUE);
+    }
+    if (NT_SUCCESS(Status) &&
+        Metadata->FaceStyleName[0] && strcmp(Metadata->FaceStyleName, "Regular") != 0)
+    {
+        RtlInitAnsiString(&AnsiString, Metadata->FaceStyleName);
+        Status = RtlAnsiStringToUnicodeString(&Entry->StyleName, &AnsiString, TRUE);
+        if (!NT_SUCCESS(Status))
+            RtlFreeUnicodeString(&Entry->FaceName);
+    }
+    if (!NT_SUCCESS(Status))
+    {
+        if (FontGDI)
+        {
+            if (FontGDI->Filename)
+                ExFreePoolWithTag(FontGDI->Filename, GDITAG_PFF);
+            EngFreeMem(FontGDI);
         }
+        if (Entry->Metadata)
+            ExFreePoolWithTag(Entry->Metadata, TAG_FONT);
+        ExFreePoolWithTag(Entry, TAG_FONT);
+        return NULL;
     }
 
-    return FaceCount;   /* number of loaded faces */
+    RtlCopyMemory(Entry->Metadata, Metadata, sizeof(FONT_METADATA));
+    RtlCopyMemory(FontGDI->Filename, FileName->Buffer, FileName->Length);
+    FontGDI->Filename[FileName->Length / sizeof(WCHAR)] = UNICODE_NULL;
+
+    FontGDI->SharedFace = SharedFace;
+    FontGDI->CharSet = Metadata->CharSet;
+    FontGDI->OriginalItalic = Metadata->OriginalItalic;
+    FontGDI->RequestItalic = FALSE;
+    FontGDI->OriginalWeight = Metadata->OriginalWeight;
+    FontGDI->RequestWeight = FW_NORMAL;
+
+    IntLockFreeType();
+    SharedFace_AddRef(SharedFace);
+    IntUnLockFreeType();
+
+    Entry->Font = FontGDI;
+    return Entry;
 }
 
 /*
- * IntGdiAddFontResource
+ * IntGdiAddFontFromMetadata
  *
- * Adds the font resource from the specified file to the system.
+ * Adds the fonts of a system font file from its cached metadata,
+ * without loading any face. Either all or none of them are added.
  */
-
-INT FASTCALL
-IntGdiAddFontResource(PUNICODE_STRING FileName, DWORD Characteristics)
+static INT FASTCALL
+IntGdiAddFontFromMetadata(PUNICODE_STRING FileName, PFONT_METADATA_FILE File)
 {
-    NTSTATUS Status;
-    HANDLE FileHandle;
-    PVOID Buffer = NULL;
-    IO_STATUS_BLOCK Iosb;
-    PVOID SectionObject;
-    SIZE_T ViewSize = 0;
-    LARGE_INTEGER SectionSize;
-    OBJECT_ATTRIBUTES ObjectAttributes;
-    GDI_LOAD_FONT   LoadFont;
-    INT FontCount;
-    HANDLE KeyHandle;
-    static const UNICODE_STRING TrueTypePostfix = RTL_CONSTANT_STRING(L" (TrueType)");
+    PFONT_METADATA Metadata = (PFONT_METADATA)(File + 1);
+    PSHARED_FACE *SharedFaces;
+    PSHARED_FACE_CACHE Cache;
+    PFONT_ENTRY Entry;
+    LIST_ENTRY ListHead;
+    UNICODE_STRING ValueName;
+    ULONG i, j;
+    INT FaceCount = 0;
+
+    SharedFaces = ExAllocatePoolWithTag(PagedPool, File->FaceCount * sizeof(PSHARED_FACE), TAG_FONT);
+    if (!SharedFaces)
+        return 0;
 
-    /* Open the font file */
-    InitializeObjectAttributes(&ObjectAttributes, FileName, 0, NULL, NULL);
-    Status = ZwOpenFile(
-                 &FileHandle,
-                 FILE_GENERIC_READ | SYNCHRONIZE,
-                 &ObjectAttributes,
-                 &Iosb,
-                 FILE_SHARE_READ,
-                 FILE_SYNCHRONOUS_IO_NONALERT);
-    if (!NT_SUCCESS(Status))
+    InitializeListHead(&ListHead);
+    for (i = 0; i < File->FaceCount; ++i)
     {
-        DPRINT("Could not load font file: %wZ\n", FileName);
-        return 0;
+        /* The charsets of a face share its SharedFace */
+        SharedFaces[i] = NULL;
+        for (j = 0; j < i; ++j)
+        {
+            if (SharedFaces[j] && Metadata[j].FaceIndex == Metadata[i].FaceIndex)
+                break;
+        }
+        if (j == i)
+        {
+            SharedFaces[i] = SharedFace_CreateDeferred(FileName, Metadata[i].FaceIndex);
+            if (!SharedFaces[i])
+                break;
+
+            /* Localized names are known in advance */
+            Cache = (PRIMARYLANGID(gusLanguageID) == LANG_ENGLISH) ?
+                    &SharedFaces[i]->EnglishUS : &SharedFaces[i]->UserLanguage;
+            IntSetCachedFontName(&Cache->FontFamily, Metadata[i].FamilyName);
+            IntSetCachedFontName(&Cache->FullName, Metadata[i].FullName);
+            IntSetCachedFontName(&SharedFaces[i]->EnglishUS.FontFamily, Metadata[i].EnglishFamilyName);
+            IntSetCachedFontName(&SharedFaces[i]->EnglishUS.FullName, Metadata[i].EnglishFullName);
+            ++FaceCount;
+            j = i;
+        }
+
+        Entry = IntCreateFontEntryFromMetadata(FileName, SharedFaces[j], &Metadata[i]);
+        if (!Entry)
+            break;
+        InsertTailList(&ListHead, &Entry->ListEntry);
     }
 
-    SectionSize.QuadPart = 0LL;
-    Status = MmCreateSection(&SectionObject, SECTION_ALL_ACCESS,
-                             NULL, &SectionSize, PAGE_READONLY,
-                             SEC_COMMIT, FileHandle, NULL);
-    if (!NT_SUCCESS(Status))
+    /* The entries hold their own references */
+    for (j = 0; j <= i && j < File->FaceCount; ++j)
     {
-        DPRINT("Could not map file: %wZ\n", FileName);
-        ZwClose(FileHandle);
-        return 0;
+        if (SharedFaces[j])
+            SharedFace_Release(SharedFaces[j]);
     }
-    ZwClose(FileHandle);
+    ExFreePoolWithTag(SharedFaces, TAG_FONT);
 
-    Status = MmMapViewInSystemSpace(SectionObject, &Buffer, &ViewSize);
-    if (!NT_SUCCESS(Status))
+    if (i < File->FaceCount)
     {
-        DPRINT("Could not map file: %wZ\n", FileName);
-        ObDereferenceObject(SectionObject);
+        while (!IsListEmpty(&ListHead))
+        {
+            Entry = CONTAINING_RECORD(RemoveHeadList(&ListHead), FONT_ENTRY, ListEntry);
+            RtlFreeUnicodeString(&Entry->FaceName);
+            RtlFreeUnicodeString(&Entry->StyleName);
+            CleanupFontEntry(Entry);
+        }
         return 0;
     }
 
-    LoadFont.pFileName          = FileName;
-    LoadFont.Memory             = SharedMem_Create(Buffer, ViewSize, TRUE);
-    LoadFont.Characteristics    = Characteristics;
-    RtlInitUnicodeString(&LoadFont.RegValueName, NULL);
-    LoadFont.IsTrueType         = FALSE;
-    LoadFont.PrivateEntry       = NULL;
-    FontCount = IntGdiLoadFontsFromMemory(&LoadFont, NULL, -1, -1);
+    IntLockGlobalFonts();
+    while (!IsListEmpty(&ListHead))
+    {
+        InsertTailList(&g_FontListHead, RemoveHeadList(&ListHead));
+    }
+    IntUnLockGlobalFonts();
 
-    ObDereferenceObject(SectionObject);
+    RtlInitUnicodeString(&ValueName, File->RegValueName);
+    IntStoreFontRegValue(FileName, &ValueName);
 
-    /* Release our copy */
-    IntLockFreeType();
-    SharedMem_Release(LoadFont.Memory);
-    IntUnLockFreeType();
+    return FaceCount;
+}
 
-    if (FontCount > 0)
+/*
+ * IntLoadSystemFonts
+ *
+ * Search the system font directory and adds each font found.
+ * Fonts that are in the metadata cache are added without being loaded.
+ */
+VOID FASTCALL
+IntLoadSystemFonts(VOID)
+{
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    UNICODE_STRING Directory, FileName, TempString;
+    IO_STATUS_BLOCK Iosb;
+    HANDLE hDirectory;
+    BYTE *DirInfoBuffer;
+    PFILE_DIRECTORY_INFORMATION DirInfo;
+    BOOLEAN bRestartScan = TRUE;
+    NTSTATUS Status;
+    INT i;
+    FONT_METADATA_BUFFER Cache, NewCache;
+    PFONT_METADATA_FILE File;
+    PVOID Record;
+    ULONG Size, CacheFileCount, NewFileCount = 0;
+    BOOL bCacheChanged = FALSE;
+    PLIST_ENTRY LastEntry;
+    UNICODE_STRING RegValueName;
+    static UNICODE_STRING SearchPatterns[] =
     {
-        if (LoadFont.IsTrueType)
-        {
-            /* append " (TrueType)" */
-            UNICODE_STRING NewString;
-            USHORT Length;
+        RTL_CONSTANT_STRING(L"*.ttf"),
+        RTL_CONSTANT_STRING(L"*.ttc"),
+        RTL_CONSTANT_STRING(L"*.otf"),
+        RTL_CONSTANT_STRING(L"*.otc"),
+        RTL_CONSTANT_STRING(L"*.fon"),
+        RTL_CONSTANT_STRING(L"*.fnt")
+    };
 
-            Length = LoadFont.RegValueName.Length + TrueTypePostfix.Length;
-            NewString.Length = 0;
-            NewString.MaximumLength = Length + sizeof(WCHAR);
-            NewString.Buffer = ExAllocatePoolWithTag(PagedPool,
-                                                     NewString.MaximumLength,
-                                                     TAG_USTR);
-            NewString.Buffer[0] = UNICODE_NULL;
+    RtlInitUnicodeString(&Directory, L"\\SystemRoot\\Fonts\\");
 
-            RtlAppendUnicodeStringToString(&NewString, &LoadFont.RegValueName);
-            RtlAppendUnicodeStringToString(&NewString, &TrueTypePostfix);
-            RtlFreeUnicodeString(&LoadFont.RegValueName);
-            LoadFont.RegValueName = NewString;
-        }
+    /* NewCache collects the records for the fonts found this time */
+    CacheFileCount = IntReadFontMetadata(&Cache);
+    RtlZeroMemory(&NewCache, sizeof(NewCache));
+    IntReserveFontMetadata(&NewCache, sizeof(FONT_METADATA_HEADER));
 
-        /* registry */
-        InitializeObjectAttributes(&ObjectAttributes, &g_FontRegPath,
-                                   OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
-                                   NULL, NULL);
-        Status = ZwOpenKey(&KeyHandle, KEY_WRITE, &ObjectAttributes);
-        if (NT_SUCCESS(Status))
-        {
-            SIZE_T DataSize;
-            LPWSTR pFileName = wcsrchr(FileName->Buffer, L'\\');
-            if (pFileName)
+    InitializeObjectAttributes(
+        &ObjectAttributes,
+        &Directory,
+        OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+        NULL,
+        NULL);
+
+    Status = ZwOpenFile(
+                 &hDirectory,
+                 SYNCHRONIZE | FILE_LIST_DIRECTORY,
+                 &ObjectAttributes,
+                 &Iosb,
+                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                 FILE_SYNCHRONOUS_IO_NONALERT | FILE_DIRECTORY_FILE);
+
+    if (NT_SUCCESS(Status))
+    {
+        for (i = 0; i < _countof(SearchPatterns); ++i)
+        {
+            DirInfoBuffer = ExAllocatePoolWithTag(PagedPool, 0x4000, TAG_FONT);
+            if (DirInfoBuffer == NULL)
+            {
+                break;
+            }
+
+            FileName.Buffer = ExAllocatePoolWithTag(PagedPool, MAX_PATH * sizeof(WCHAR), TAG_FONT);
+            if (FileName.Buffer == NULL)
+            {
+                ExFreePoolWithTag(DirInfoBuffer, TAG_FONT);
+                break;
+            }
+            FileName.Length = 0;
+            FileName.MaximumLength = MAX_PATH * sizeof(WCHAR);
+
+            while (1)
             {
-                pFileName++;
-                DataSize = (wcslen(pFileName) + 1) * sizeof(WCHAR);
-                ZwSetValueKey(KeyHandle, &LoadFont.RegValueName, 0, REG_SZ,
-                              pFileName, DataSize);
+                Status = ZwQueryDirectoryFile(
+                             hDirectory,
+                             NULL,
+                             NULL,
+                             NULL,
+                             &Iosb,
+                             DirInfoBuffer,
+                             0x4000,
+                             FileDirectoryInformation,
+                             FALSE,
+                             &SearchPatterns[i],
+                             bRestartScan);
+
+                if (!NT_SUCCESS(Status) || Status == STATUS_NO_MORE_FILES)
+                {
+                    break;
+                }
+
+                DirInfo = (PFILE_DIRECTORY_INFORMATION)DirInfoBuffer;
+                while (1)
+                {
+                    TempString.Buffer = DirInfo->FileName;
+                    TempString.Length =
+                        TempString.MaximumLength = DirInfo->FileNameLength;
+                    RtlCopyUnicodeString(&FileName, &Directory);
+                    RtlAppendUnicodeStringToString(&FileName, &TempString);
+
+                    File = IntFindFontMetadata(&Cache, CacheFileCount, &TempString, DirInfo);
+                    if (File && IntGdiAddFontFromMetadata(&FileName, File) > 0)
+                    {
+                        /* Unchanged, keep the record */
+                        Size = sizeof(FONT_METADATA_FILE) + File->FaceCount * sizeof(FONT_METADATA);
+                        if (NewCache.Buffer && (Record = IntReserveFontMetadata(&NewCache, Size)))
+                        {
+                            RtlCopyMemory(Record, File, Size);
+                            ++NewFileCount;
+                        }
+                    }
+                    else
+                    {
+                        /* New or changed, parse it and record what we found */
+                        bCacheChanged = TRUE;
+                        IntLockGlobalFonts();
+                        LastEntry = g_FontListHead.Blink;
+                        IntUnLockGlobalFonts();
+
+                        RtlInitUnicodeString(&RegValueName, NULL);
+                        if (IntGdiAddFontResourceEx(&FileName, 0, &RegValueName) > 0 &&
+                            NewCache.Buffer &&
+                            IntRecordFontMetadata(&NewCache, &TempString, DirInfo,
+                                                  &RegValueName, LastEntry))
+                        {
+                            ++NewFileCount;
+                        }
+                        RtlFreeUnicodeString(&RegValueName);
+                    }
+                    if (DirInfo->NextEntryOffset == 0)
+                        break;
+                    DirInfo = (PFILE_DIRECTORY_INFORMATION)((ULONG_PTR)DirInfo + DirInfo->NextEntryOffset);
+                }
+
+                bRestartScan = FALSE;
             }
-            ZwClose(KeyHandle);
+
+            ExFreePoolWithTag(FileName.Buffer, TAG_FONT);
+            ExFreePoolWithTag(DirInfoBuffer, TAG_FONT);
         }
+        ZwClose(hDirectory);
     }
-    RtlFreeUnicodeString(&LoadFont.RegValueName);
 
-    return FontCount;
+    /* Rewrite the cache if the fonts have changed */
+    if (NewCache.Buffer && (bCacheChanged || NewFileCount != CacheFileCount))
+    {
+        IntWriteFontMetadata(&NewCache, NewFileCount);
+    }
+    IntFreeFontMetadata(&NewCache);
+    IntFreeFontMetadata(&Cache);
 }
 
 HANDLE FASTCALL
@@ -1551,6 +2289,9 @@ CleanupFontEntry(PFONT_ENTRY FontEntry)
     if (FontGDI->Filename)
         ExFreePoolWithTag(FontGDI->Filename, GDITAG_PFF);
 
+    if (FontEntry->Metadata)
+        ExFreePoolWithTag(FontEntry->Metadata, TAG_FONT);
+
     EngFreeMem(FontGDI);
     SharedFace_Release(SharedFace);
     ExFreePoolWithTag(FontEntry, TAG_FONT);
@@ -2162,7 +2903,13 @@ IntGetOutlineTextMetrics(PFONTGDI FontGDI,
     FONT_NAMES FontNames;
     PSHARED_FACE SharedFace = FontGDI->SharedFace;
     PSHARED_FACE_CACHE Cache;
-    FT_Face Face = SharedFace->Face;
+    FT_Face Face;
+
+    if (!SharedFace_EnsureFace(SharedFace))
+    {
+        return 0;
+    }
+    Face = SharedFace->Face;
 
     if (PRIMARYLANGID(gusLanguageID) == LANG_ENGLISH)
     {
@@ -2374,7 +3121,7 @@ IntGetFontLocalizedName(PUNICODE_STRING pNameW, PSHARED_FACE SharedFace,
     NTSTATUS Status = STATUS_NOT_FOUND;
     ANSI_STRING AnsiName;
     PSHARED_FACE_CACHE Cache;
-    FT_Face Face = SharedFace->Face;
+    FT_Face Face;
 
     RtlFreeUnicodeString(pNameW);
 
@@ -2398,6 +3145,12 @@ IntGetFontLocalizedName(PUNICODE_STRING pNameW, PSHARED_FACE SharedFace,
         return DuplicateUnicodeString(&Cache->FullName, pNameW);
     }
 
+    if (!SharedFace_EnsureFace(SharedFace))
+    {
+        return STATUS_NOT_FOUND;
+    }
+    Face = SharedFace->Face;
+
     BestIndex = -1;
     BestScore = 0;
 
@@ -2541,7 +3294,7 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     DWORD fs0;
     NTSTATUS status;
     PSHARED_FACE SharedFace = FontGDI->SharedFace;
-    FT_Face Face = SharedFace->Face;
+    FT_Face Face;
     UNICODE_STRING NameW;
 
     RtlInitUnicodeString(&NameW, NULL);
@@ -2558,6 +3311,7 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
         return;
     }
+    Face = SharedFace->Face;
 
     Lf = &Info->EnumLogFontEx.elfLogFont;
     TM = &Otm->otmTextMetrics;
@@ -2708,6 +3462,30 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     Info->NewTextMetricEx.ntmFontSig = fs;
 }
 
+/* Like FontFamilyFillInfo, but takes a face that is not loaded from its metadata */
+static void FASTCALL
+FontEntryFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
+                  LPCWSTR FullName, PFONT_ENTRY FontEntry)
+{
+    if (!FontEntry->Metadata || FontEntry->Font->SharedFace->Face)
+    {
+        FontFamilyFillInfo(Info, FaceName, FullName, FontEntry->Font);
+        return;
+    }
+
+    RtlCopyMemory(Info, &FontEntry->Metadata->Info, sizeof(FONTFAMILYINFO));
+    if (FaceName)
+    {
+        RtlStringCbCopyW(Info->EnumLogFontEx.elfLogFont.lfFaceName,
+                         sizeof(Info->EnumLogFontEx.elfLogFont.lfFaceName), FaceName);
+    }
+    if (FullName)
+    {
+        RtlStringCbCopyW(Info->EnumLogFontEx.elfFullName,
+                         sizeof(Info->EnumLogFontEx.elfFullName), FullName);
+    }
+}
+
 static BOOLEAN FASTCALL
 GetFontFamilyInfoForList(const LOGFONTW *LogFont,
                          PFONTFAMILYINFO Info,
@@ -2735,7 +3513,7 @@ GetFontFamilyInfoForList(const LOGFONTW *LogFont,
         }
 
         /* get one info entry */
-        FontFamilyFillInfo(&InfoEntry, NULL, NULL, FontGDI);
+        FontEntryFillInfo(&InfoEntry, NULL, NULL, CurrentEntry);
 
         if (LogFont->lfFaceName[0] != UNICODE_NULL)
         {
@@ -4362,10 +5140,13 @@ ftGdiGetFontData(
 #define GOT_PENALTY(name, value) Penalty += (value)
 
 // NOTE: See Table 1. of https://msdn.microsoft.com/en-us/library/ms969909.aspx
+// If bLowerBound is set, Otm is at an arbitrary size and the penalties that
+// depend on the size of a scalable font are left out.
 static UINT
 GetFontPenalty(const LOGFONTW *               LogFont,
                const OUTLINETEXTMETRICW *     Otm,
-               const char *             style_name)
+               const char *             style_name,
+               BOOL                     bLowerBound)
 {
     ULONG   Penalty = 0;
     BYTE    Byte;
@@ -4374,6 +5155,8 @@ GetFontPenalty(const LOGFONTW *               LogFont,
     const BYTE UserCharSet = CharSetFromLangID(gusLanguageID);
     const TEXTMETRICW * TM = &Otm->otmTextMetrics;
     WCHAR* ActualNameW;
+    const BOOL fSizeKnown = !bLowerBound ||
+                            !(TM->tmPitchAndFamily & (TMPF_TRUETYPE | TMPF_VECTOR));
 
     ASSERT(Otm);
     ASSERT(LogFont);
@@ -4588,7 +5371,7 @@ GetFontPenalty(const LOGFONTW *               LogFont,
             break;
     }
 
-    if (LogFont->lfWidth != 0)
+    if (LogFont->lfWidth != 0 && fSizeKnown)
     {
         if (LogFont->lfWidth != TM->tmAveCharWidth)
         {
@@ -4692,7 +5475,7 @@ GetFontPenalty(const LOGFONTW *               LogFont,
         GOT_PENALTY("DeviceFavor", 2);
     }
 
-    if (TM->tmAveCharWidth >= 5 && TM->tmHeight >= 5)
+    if (TM->tmAveCharWidth >= 5 && TM->tmHeight >= 5 && fSizeKnown)
     {
         if (TM->tmAveCharWidth / TM->tmHeight >= 3)
         {
@@ -4723,6 +5506,28 @@ GetFontPenalty(const LOGFONTW *               LogFont,
 
 #undef GOT_PENALTY
 
+/* The smallest penalty a font entry that is not loaded yet can get */
+static UINT
+GetFontPenaltyFromMetadata(const LOGFONTW *LogFont, const FONT_METADATA *Metadata)
+{
+    typedef struct METADATA_OTM
+    {
+        OUTLINETEXTMETRICW Otm;
+        WCHAR FamilyName[LF_FULLFACESIZE];
+        WCHAR FullName[LF_FULLFACESIZE];
+    } METADATA_OTM;
+    METADATA_OTM Buffer;
+
+    RtlZeroMemory(&Buffer.Otm, sizeof(Buffer.Otm));
+    RtlCopyMemory(&Buffer.Otm.otmTextMetrics, &Metadata->TextMetric, sizeof(TEXTMETRICW));
+    RtlCopyMemory(Buffer.FamilyName, Metadata->FamilyName, sizeof(Buffer.FamilyName));
+    RtlCopyMemory(Buffer.FullName, Metadata->FullName, sizeof(Buffer.FullName));
+    Buffer.Otm.otmpFamilyName = (LPSTR)FIELD_OFFSET(METADATA_OTM, FamilyName);
+    Buffer.Otm.otmpFaceName = (LPSTR)FIELD_OFFSET(METADATA_OTM, FullName);
+
+    return GetFontPenalty(LogFont, &Buffer.Otm, Metadata->FaceStyleName, TRUE);
+}
+
 static __inline VOID
 FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
                      const LOGFONTW *LogFont,
@@ -4752,6 +5557,18 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
 
         FontGDI = CurrentEntry->Font;
         ASSERT(FontGDI);
+
+        /* Only load the faces that could do better than the current match */
+        if (!FontGDI->SharedFace->Face && CurrentEntry->Metadata)
+        {
+            if (*MatchPenalty != 0xFFFFFFFF &&
+                GetFontPenaltyFromMetadata(LogFont, CurrentEntry->Metadata) >= *MatchPenalty)
+            {
+                continue;
+            }
+            if (!SharedFace_EnsureFace(FontGDI->SharedFace))
+                continue;
+        }
         Face = FontGDI->SharedFace->Face;
 
         /* get text metrics */
@@ -4776,7 +5593,7 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
 
             OldOtmSize = OtmSize;
 
-            Penalty = GetFontPenalty(LogFont, Otm, Face->style_name);
+            Penalty = GetFontPenalty(LogFont, Otm, Face->style_name, FALSE);
             if (*MatchPenalty == 0xFFFFFFFF || Penalty < *MatchPenalty)
             {
                 *FontObj = GDIToObj(FontGDI, FONT);
@@ -5145,8 +5962,8 @@ IntGdiGetFontResourceInfo(
             continue;
 
         IsEqual = FALSE;
-        FontFamilyFillInfo(&FamInfo[Count], FontEntry->FaceName.Buffer,
-                           NULL, FontEntry->Font);
+        FontEntryFillInfo(&FamInfo[Count], FontEntry->FaceName.Buffer,
+                          NULL, FontEntry);
         for (i = 0; i < Count; ++i)
         {
             if (EqualFamilyInfo(&FamInfo[i], &FamInfo[Count]))
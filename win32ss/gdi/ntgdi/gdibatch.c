@@ -6,6 +6,23 @@
 
 BOOL FASTCALL IntPatBlt( PDC,INT,INT,INT,INT,DWORD,PEBRUSHOBJ);
 BOOL APIENTRY IntExtTextOutW(IN PDC,IN INT,IN INT,IN UINT,IN OPTIONAL PRECTL,IN LPCWSTR,IN INT,IN OPTIONAL LPINT,IN DWORD);
+BOOL FASTCALL IntGdiRectangle(PDC,INT,INT,INT,INT);
+
+//
+// The fill brush realized by the last batched fill. Runs of fills with the
+// same brush and colors (FillRect loops) realize the brush only once.
+//
+typedef struct _GDIBATCHFILL
+{
+  BOOL bValid;
+  HANDLE hbrush;
+  COLORREF crForegroundClr;
+  COLORREF crBackgroundClr;
+  COLORREF crBrushClr;
+  ULONG ulForegroundClr;
+  ULONG ulBackgroundClr;
+  ULONG ulBrushClr;
+} GDIBATCHFILL, *PGDIBATCHFILL;
 
 
 //
@@ -62,12 +79,53 @@ SynchronizeDriver(FLONG Flags)
   return;
 }
 
+//
+// Update eboFill for the attribute snapshot set in the DC. Returns TRUE
+// when eboFill was realized for the snapshot and not for the DC's own brush.
+//
+static
+BOOL
+FASTCALL
+GdiBatchUpdateFillBrush(PDC dc, PGDIBATCHFILL pFill)
+{
+  PDC_ATTR pdcattr = dc->pdcattr;
+
+  if (pFill->bValid &&
+      pFill->hbrush          == pdcattr->hbrush &&
+      pFill->crForegroundClr == pdcattr->crForegroundClr &&
+      pFill->crBackgroundClr == pdcattr->crBackgroundClr &&
+      pFill->crBrushClr      == pdcattr->crBrushClr &&
+      pFill->ulForegroundClr == pdcattr->ulForegroundClr &&
+      pFill->ulBackgroundClr == pdcattr->ulBackgroundClr &&
+      pFill->ulBrushClr      == pdcattr->ulBrushClr)
+  {
+     // Still realized from the previous fill.
+     pdcattr->ulDirty_ &= ~(DIRTY_FILL | DC_BRUSH_DIRTY);
+     return TRUE;
+  }
+
+  if (!(pdcattr->ulDirty_ & (DIRTY_FILL | DC_BRUSH_DIRTY)))
+     return FALSE;
+
+  DC_vUpdateFillBrush(dc);
+
+  pFill->bValid          = TRUE;
+  pFill->hbrush          = pdcattr->hbrush;
+  pFill->crForegroundClr = pdcattr->crForegroundClr;
+  pFill->crBackgroundClr = pdcattr->crBackgroundClr;
+  pFill->crBrushClr      = pdcattr->crBrushClr;
+  pFill->ulForegroundClr = pdcattr->ulForegroundClr;
+  pFill->ulBackgroundClr = pdcattr->ulBackgroundClr;
+  pFill->ulBrushClr      = pdcattr->ulBrushClr;
+  return TRUE;
+}
+
 //
 // Process the batch.
 //
 ULONG
 FASTCALL
-GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
+GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr, PGDIBATCHFILL pFill)
 {
   ULONG Cmd = 0, Size = 0;
   PDC_ATTR pdcattr = NULL;
@@ -89,6 +147,12 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
   }
   _SEH2_END;
 
+  // Only fills keep eboFill as they leave it.
+  if (Cmd != GdiBCPatBlt && Cmd != GdiBCRectangle)
+  {
+     pFill->bValid = FALSE;
+  }
+
   switch(Cmd)
   {
      case GdiBCPatBlt:
@@ -133,8 +197,8 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
         dc->pdcattr->ulBackgroundClr = pgDPB->ulBackgroundClr;
         dc->pdcattr->ulBrushClr      = pgDPB->ulBrushClr;
         // Process dirty attributes if any.
-        if (dc->pdcattr->ulDirty_ & (DIRTY_FILL | DC_BRUSH_DIRTY))
-            DC_vUpdateFillBrush(dc);
+        if (GdiBatchUpdateFillBrush(dc, pFill))
+            flags |= DIRTY_FILL;
         if (dc->pdcattr->ulDirty_ & DIRTY_TEXT)
             DC_vUpdateTextBrush(dc);
         if (pdcattr->ulDirty_ & DIRTY_BACKGROUND)
@@ -158,6 +222,7 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
         PGDIBSPPATBLT pgDPB;
         EBRUSHOBJ eboFill;
         PBRUSH pbrush;
+        HBRUSH hbrLast;
         PPATRECT pRects;
         INT i;
         DWORD dwRop, flags;
@@ -201,19 +266,35 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
         if (pdcattr->ulDirty_ & DIRTY_BACKGROUND)
             DC_vUpdateBackgroundBrush(dc);
 
-        DPRINT1("GdiBCPolyPatBlt Testing\n");
         pRects = &pgDPB->pRect[0];
+        hbrLast = NULL;
+        pbrush = NULL;
 
         for (i = 0; i < pgDPB->Count; i++)
         {
-            pbrush = BRUSH_ShareLockBrush(pRects->hBrush);
+            /* Rects with the same brush share one realization */
+            if (pbrush == NULL || pRects->hBrush != hbrLast)
+            {
+                if (pbrush != NULL)
+                {
+                    /* Cleanup the brush object and unlock the brush */
+                    EBRUSHOBJ_vCleanup(&eboFill);
+                    BRUSH_ShareUnlockBrush(pbrush);
+                }
+
+                hbrLast = pRects->hBrush;
+                pbrush = BRUSH_ShareLockBrush(hbrLast);
+
+                /* Check if we could lock the brush */
+                if (pbrush != NULL)
+                {
+                    /* Initialize a brush object */
+                    EBRUSHOBJ_vInitFromDC(&eboFill, pbrush, dc);
+                }
+            }
 
-            /* Check if we could lock the brush */
             if (pbrush != NULL)
             {
-                /* Initialize a brush object */
-                EBRUSHOBJ_vInitFromDC(&eboFill, pbrush, dc);
-
                 IntPatBlt(
                     dc,
                     pRects->r.left,
@@ -222,14 +303,16 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
                     pRects->r.bottom,
                     dwRop,
                     &eboFill);
-
-                /* Cleanup the brush object and unlock the brush */
-                EBRUSHOBJ_vCleanup(&eboFill);
-                BRUSH_ShareUnlockBrush(pbrush);
             }
             pRects++;
         }
 
+        if (pbrush != NULL)
+        {
+            EBRUSHOBJ_vCleanup(&eboFill);
+            BRUSH_ShareUnlockBrush(pbrush);
+        }
+
         // Restore attributes and flags
         dc->pdcattr->crForegroundClr = crColor;
         dc->pdcattr->crBackgroundClr = crBkColor;
@@ -241,6 +324,68 @@ GdiFlushUserBatch(PDC dc, PGDIBATCHHDR pHdr)
         break;
      }
 
+     case GdiBCRectangle:
+     {
+        PGDIBSRECTANGLE pgRect;
+        DWORD flags, saveflags;
+        HBRUSH hOrgBrush;
+        HPEN hOrgPen;
+        COLORREF crColor, crBkColor, crBrushClr, crPenClr;
+        ULONG ulForegroundClr, ulBackgroundClr, ulBrushClr, ulPenClr;
+        if (!dc) break;
+        pgRect = (PGDIBSRECTANGLE) pHdr;
+        // Save current attributes and flags
+        crColor         = dc->pdcattr->crForegroundClr;
+        crBkColor       = dc->pdcattr->crBackgroundClr;
+        crBrushClr      = dc->pdcattr->crBrushClr;
+        crPenClr        = dc->pdcattr->crPenClr;
+        ulForegroundClr = dc->pdcattr->ulForegroundClr;
+        ulBackgroundClr = dc->pdcattr->ulBackgroundClr;
+        ulBrushClr      = dc->pdcattr->ulBrushClr;
+        ulPenClr        = dc->pdcattr->ulPenClr;
+        hOrgBrush       = dc->pdcattr->hbrush;
+        hOrgPen         = dc->pdcattr->hpen;
+        saveflags = dc->pdcattr->ulDirty_ & (DIRTY_FILL | DIRTY_LINE | DC_BRUSH_DIRTY | DC_PEN_DIRTY);
+        // Mark what the snapshot changes
+        flags = 0;
+        if (hOrgBrush != pgRect->hbrush || crBrushClr != pgRect->crBrushClr)
+            flags |= DIRTY_FILL;
+        if (hOrgPen != pgRect->hpen || crPenClr != pgRect->crPenClr)
+            flags |= DIRTY_LINE;
+        if (crColor != pgRect->crForegroundClr || crBkColor != pgRect->crBackgroundClr)
+            flags |= DIRTY_FILL | DIRTY_LINE;
+        // Set the attribute snapshot
+        dc->pdcattr->hbrush          = pgRect->hbrush;
+        dc->pdcattr->hpen            = pgRect->hpen;
+        dc->pdcattr->crForegroundClr = pgRect->crForegroundClr;
+        dc->pdcattr->crBackgroundClr = pgRect->crBackgroundClr;
+        dc->pdcattr->crBrushClr      = pgRect->crBrushClr;
+        dc->pdcattr->crPenClr        = pgRect->crPenClr;
+        dc->pdcattr->ulForegroundClr = pgRect->ulForegroundClr;
+        dc->pdcattr->ulBackgroundClr = pgRect->ulBackgroundClr;
+        dc->pdcattr->ulBrushClr      = pgRect->ulBrushClr;
+        dc->pdcattr->ulPenClr        = pgRect->ulPenClr;
+        dc->pdcattr->ulDirty_ |= flags;
+        // IntRectangle updates the pen, the fill may still be realized.
+        if (GdiBatchUpdateFillBrush(dc, pFill))
+            flags |= DIRTY_FILL;
+        /* Call the internal function */
+        IntGdiRectangle(dc, pgRect->nLeft, pgRect->nTop, pgRect->nRight, pgRect->nBottom);
+        // Restore attributes and flags
+        dc->pdcattr->hbrush          = hOrgBrush;
+        dc->pdcattr->hpen            = hOrgPen;
+        dc->pdcattr->crForegroundClr = crColor;
+        dc->pdcattr->crBackgroundClr = crBkColor;
+        dc->pdcattr->crBrushClr      = crBrushClr;
+        dc->pdcattr->crPenClr        = crPenClr;
+        dc->pdcattr->ulForegroundClr = ulForegroundClr;
+        dc->pdcattr->ulBackgroundClr = ulBackgroundClr;
+        dc->pdcattr->ulBrushClr      = ulBrushClr;
+        dc->pdcattr->ulPenClr        = ulPenClr;
+        dc->pdcattr->ulDirty_ |= saveflags | flags;
+        break;
+     }
+
      case GdiBCTextOut:
      {
         PGDIBSTEXTOUT pgO;
@@ -458,6 +603,7 @@ NtGdiFlushUserBatch(VOID)
     {
       PCHAR pHdr = (PCHAR)&pTeb->GdiTebBatch.Buffer[0];
       PDC pDC = NULL;
+      GDIBATCHFILL Fill;
 
       if (GDI_HANDLE_GET_TYPE(hDC) == GDILoObjType_LO_DC_TYPE && GreIsHandleValid(hDC))
       {
@@ -465,17 +611,20 @@ NtGdiFlushUserBatch(VOID)
       }
 
        // No need to init anything, just go!
+       Fill.bValid = FALSE;
        for (; GdiBatchCount > 0; GdiBatchCount--)
        {
            ULONG Size;
            // Process Gdi Batch!
-           Size = GdiFlushUserBatch(pDC, (PGDIBATCHHDR) pHdr);
+           Size = GdiFlushUserBatch(pDC, (PGDIBATCHHDR) pHdr, &Fill);
            if (!Size) break;
            pHdr += Size;
        }
 
        if (pDC)
        {
+           // Mode changes no longer have to flush first.
+           pDC->pdcattr->ulDirty_ &= ~DC_MODE_DIRTY;
            DC_UnlockDc(pDC);
        }
 
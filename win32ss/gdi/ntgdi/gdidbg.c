@@ -15,6 +15,7 @@
 
 extern ULONG gulFirstFree;
 extern ULONG gulFirstUnused;
+extern LONG glCachedFreeEntries;
 extern PENTRY gpentHmgr;
 
 ULONG gulLogUnique = 0;
@@ -389,6 +390,9 @@ DbgGdiHTIntegrityCheck(VOID)
 		}
 	}
 
+	/* Processes keep some deleted entries for themselves */
+	nDeleted += glCachedFreeEntries;
+
 	if (RESERVE_ENTRIES_COUNT + nDeleted + nFree + nUsed != GDI_HANDLE_COUNT)
 	{
 		r = 0;
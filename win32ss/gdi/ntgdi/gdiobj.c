@@ -148,7 +148,10 @@ PENTRY gpentHmgr;
 PULONG gpaulRefCount;
 volatile ULONG gulFirstFree;
 volatile ULONG gulFirstUnused;
+volatile LONG glCachedFreeEntries;
 static PPAGED_LOOKASIDE_LIST gpaLookasideList;
+static ULONG gcLookasideSets;
+static ULONG gacjLookasideSize[GDIObjTypeTotal];
 
 static VOID NTAPI GDIOBJ_vCleanup(PVOID ObjectBody);
 
@@ -242,13 +245,31 @@ static
 VOID
 InitLookasideList(UCHAR objt, ULONG cjSize)
 {
-    ExInitializePagedLookasideList(&gpaLookasideList[objt],
-                                   NULL,
-                                   NULL,
-                                   0,
-                                   cjSize,
-                                   GDITAG_HMGR_LOOKASIDE_START + (objt << 24),
-                                   0);
+    ULONG iSet;
+
+    for (iSet = 0; iSet < gcLookasideSets; iSet++)
+    {
+        ExInitializePagedLookasideList(&gpaLookasideList[iSet * GDIObjTypeTotal + objt],
+                                       NULL,
+                                       NULL,
+                                       0,
+                                       cjSize,
+                                       GDITAG_HMGR_LOOKASIDE_START + (objt << 24),
+                                       0);
+    }
+
+    gacjLookasideSize[objt] = cjSize;
+}
+
+/* Every processor has its own set of lookaside lists, so that allocations
+   on different processors don't fight for the same list header */
+static
+PPAGED_LOOKASIDE_LIST
+GetLookasideList(UCHAR objt)
+{
+    ULONG iSet = KeGetCurrentProcessorNumber() % gcLookasideSets;
+
+    return &gpaLookasideList[iSet * GDIObjTypeTotal + (objt & 0x1f)];
 }
 
 INIT_FUNCTION
@@ -305,9 +326,10 @@ InitGdiHandleTable(void)
 
     GdiHandleTable = (PVOID)gpentHmgr;
 
-    /* Initialize the lookaside lists */
+    /* Initialize the lookaside lists, one set per processor */
+    gcLookasideSets = max(KeNumberProcessors, 1);
     gpaLookasideList = ExAllocatePoolWithTag(NonPagedPool,
-                           GDIObjTypeTotal * sizeof(PAGED_LOOKASIDE_LIST),
+                           gcLookasideSets * GDIObjTypeTotal * sizeof(PAGED_LOOKASIDE_LIST),
                            TAG_GDIHNDTBLE);
     if(!gpaLookasideList)
         return STATUS_NO_MEMORY;
@@ -377,7 +399,7 @@ DecrementGdiHandleCount(ULONG ulProcessId)
 
 static
 PENTRY
-ENTRY_pentPopFreeEntry(VOID)
+ENTRY_pentPopGlobalFreeEntry(VOID)
 {
     ULONG iFirst, iNext, iPrev;
     PENTRY pentFree;
@@ -430,13 +452,141 @@ ENTRY_pentPopFreeEntry(VOID)
     return pentFree;
 }
 
+/* Pops up to cMax entries from the global free list with a single exchange */
+static
+ULONG
+ENTRY_cPopGlobalFreeEntries(PULONG aulIndex, ULONG cMax)
+{
+    ULONG iFirst, iNext, iPrev, cEntries;
+
+    do
+    {
+        /* Get the index and sequence number of the first free entry */
+        iFirst = InterlockedReadUlong(&gulFirstFree);
+
+        /* Walk the chain. If someone changes it meanwhile, the sequence
+           number changes too and the exchange below fails */
+        iNext = iFirst & GDI_HANDLE_INDEX_MASK;
+        for (cEntries = 0; (cEntries < cMax) && (iNext != 0); cEntries++)
+        {
+            aulIndex[cEntries] = iNext;
+            iNext = GDI_HANDLE_GET_INDEX(gpentHmgr[iNext].einfo.hFree);
+        }
+
+        if (cEntries == 0)
+            return 0;
+
+        /* Try to cut the chain off the list */
+        iNext |= (iFirst & ~GDI_HANDLE_INDEX_MASK) + 0x10000;
+        iPrev = InterlockedCompareExchange((LONG*)&gulFirstFree,
+                                           iNext,
+                                           iFirst);
+    }
+    while (iPrev != iFirst);
+
+    return cEntries;
+}
+
+/* Pushes a number of prepared free entries to the global free list at once */
+static
+VOID
+ENTRY_vPushGlobalFreeEntries(PULONG aulIndex, ULONG cEntries)
+{
+    ULONG iToFree, iFirst, iPrev, i;
+
+    ASSERT(cEntries > 0);
+
+    /* Link the entries to each other */
+    for (i = 0; i < cEntries - 1; i++)
+    {
+        gpentHmgr[aulIndex[i]].einfo.pobj = UlongToPtr(aulIndex[i + 1]);
+    }
+
+    do
+    {
+        /* Get the current first free index and sequence number */
+        iFirst = InterlockedReadUlong(&gulFirstFree);
+
+        /* Link the last entry to the first free entry */
+        gpentHmgr[aulIndex[cEntries - 1]].einfo.pobj = UlongToPtr(iFirst & GDI_HANDLE_INDEX_MASK);
+
+        /* Combine new index and increased sequence number in iToFree */
+        iToFree = aulIndex[0] | ((iFirst & ~GDI_HANDLE_INDEX_MASK) + 0x10000);
+
+        /* Try to atomically update the first free entry */
+        iPrev = InterlockedCompareExchange((LONG*)&gulFirstFree,
+                                           iToFree,
+                                           iFirst);
+    }
+    while (iPrev != iFirst);
+}
+
+FORCEINLINE
+PPROCESSINFO
+GetFreeEntryCacheProcess(VOID)
+{
+    PPROCESSINFO ppi = PsGetCurrentProcessWin32Process();
+
+    /* Terminating processes give their entries back, see GDI_CleanupForProcess */
+    if (!ppi || (ppi->W32PF_flags & W32PF_TERMINATED))
+        return NULL;
+
+    return ppi;
+}
+
+static
+PENTRY
+ENTRY_pentPopFreeEntry(VOID)
+{
+    PPROCESSINFO ppi;
+    PENTRY pentFree = NULL;
+    ULONG cEntries;
+
+    ppi = GetFreeEntryCacheProcess();
+    if (ppi)
+    {
+        KeEnterCriticalRegion();
+        ExAcquirePushLockExclusive(&ppi->pushlockGdiFreeEntries);
+
+        /* Refill the process cache from the global list */
+        if (ppi->cGdiFreeEntries == 0)
+        {
+            cEntries = ENTRY_cPopGlobalFreeEntries(ppi->aulGdiFreeEntries,
+                                                   GDI_FREE_ENTRY_BATCH);
+            ppi->cGdiFreeEntries = cEntries;
+            InterlockedExchangeAdd(&glCachedFreeEntries, cEntries);
+        }
+
+        if (ppi->cGdiFreeEntries > 0)
+        {
+            ppi->cGdiFreeEntries--;
+            pentFree = &gpentHmgr[ppi->aulGdiFreeEntries[ppi->cGdiFreeEntries]];
+            InterlockedDecrement(&glCachedFreeEntries);
+        }
+
+        ExReleasePushLockExclusive(&ppi->pushlockGdiFreeEntries);
+        KeLeaveCriticalRegion();
+
+        if (pentFree)
+        {
+            /* Sanity check: is entry really free? */
+            ASSERT(((ULONG_PTR)pentFree->einfo.pobj & ~GDI_HANDLE_INDEX_MASK) == 0);
+            return pentFree;
+        }
+    }
+
+    /* No free entries left, take an unused one */
+    return ENTRY_pentPopGlobalFreeEntry();
+}
+
 /* Pushes an entry of the handle table to the free list,
    The entry must not have any references left */
 static
 VOID
 ENTRY_vPushFreeEntry(PENTRY pentFree)
 {
-    ULONG iToFree, iFirst, iPrev, idxToFree;
+    ULONG idxToFree;
+    PPROCESSINFO ppi;
 
     DPRINT("Enter ENTRY_vPushFreeEntry\n");
 
@@ -447,28 +597,57 @@ ENTRY_vPushFreeEntry(PENTRY pentFree)
     pentFree->Objt = GDIObjType_DEF_TYPE;
     pentFree->ObjectOwner.ulObj = 0;
     pentFree->pUser = NULL;
+    pentFree->einfo.pobj = NULL;
 
     /* Increase reuse counter in entry and reference counter */
     InterlockedExchangeAdd((LONG*)&gpaulRefCount[idxToFree], REF_INC_REUSE);
     pentFree->FullUnique += 0x0100;
 
-    do
+    ppi = GetFreeEntryCacheProcess();
+    if (!ppi)
     {
-        /* Get the current first free index and sequence number */
-        iFirst = InterlockedReadUlong(&gulFirstFree);
+        ENTRY_vPushGlobalFreeEntries(&idxToFree, 1);
+        return;
+    }
 
-        /* Set the einfo.pobj member to the index of the first free entry */
-        pentFree->einfo.pobj = UlongToPtr(iFirst & GDI_HANDLE_INDEX_MASK);
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&ppi->pushlockGdiFreeEntries);
 
-        /* Combine new index and increased sequence number in iToFree */
-        iToFree = idxToFree | ((iFirst & ~GDI_HANDLE_INDEX_MASK) + 0x10000);
+    /* Give the oldest batch back when the process cache is full */
+    if (ppi->cGdiFreeEntries == ARRAYSIZE(ppi->aulGdiFreeEntries))
+    {
+        ENTRY_vPushGlobalFreeEntries(ppi->aulGdiFreeEntries, GDI_FREE_ENTRY_BATCH);
+        RtlMoveMemory(&ppi->aulGdiFreeEntries[0],
+                      &ppi->aulGdiFreeEntries[GDI_FREE_ENTRY_BATCH],
+                      (ppi->cGdiFreeEntries - GDI_FREE_ENTRY_BATCH) * sizeof(ULONG));
+        ppi->cGdiFreeEntries -= GDI_FREE_ENTRY_BATCH;
+        InterlockedExchangeAdd(&glCachedFreeEntries, -GDI_FREE_ENTRY_BATCH);
+    }
 
-        /* Try to atomically update the first free entry */
-        iPrev = InterlockedCompareExchange((LONG*)&gulFirstFree,
-                                           iToFree,
-                                           iFirst);
+    ppi->aulGdiFreeEntries[ppi->cGdiFreeEntries++] = idxToFree;
+    InterlockedIncrement(&glCachedFreeEntries);
+
+    ExReleasePushLockExclusive(&ppi->pushlockGdiFreeEntries);
+    KeLeaveCriticalRegion();
+}
+
+/* Gives the cached free entries of the process back to the global list */
+static
+VOID
+ENTRY_vFlushFreeEntryCache(PPROCESSINFO ppi)
+{
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&ppi->pushlockGdiFreeEntries);
+
+    if (ppi->cGdiFreeEntries > 0)
+    {
+        ENTRY_vPushGlobalFreeEntries(ppi->aulGdiFreeEntries, ppi->cGdiFreeEntries);
+        InterlockedExchangeAdd(&glCachedFreeEntries, -(LONG)ppi->cGdiFreeEntries);
+        ppi->cGdiFreeEntries = 0;
     }
-    while (iPrev != iFirst);
+
+    ExReleasePushLockExclusive(&ppi->pushlockGdiFreeEntries);
+    KeLeaveCriticalRegion();
 }
 
 static
@@ -561,7 +740,7 @@ GDIOBJ_AllocateObject(UCHAR objt, ULONG cjSize, FLONG fl)
     if (fl & BASEFLAG_LOOKASIDE)
     {
         /* Allocate the object from a lookaside list */
-        pobj = ExAllocateFromPagedLookasideList(&gpaLookasideList[objt & 0x1f]);
+        pobj = ExAllocateFromPagedLookasideList(GetLookasideList(objt));
     }
     else
     {
@@ -612,7 +791,7 @@ GDIOBJ_vFreeObject(POBJ pobj)
         /* Check if the object is allocated from a lookaside list */
         if (pobj->BaseFlags & BASEFLAG_LOOKASIDE)
         {
-            ExFreeToPagedLookasideList(&gpaLookasideList[objt], pobj);
+            ExFreeToPagedLookasideList(GetLookasideList(objt), pobj);
         }
         else
         {
@@ -621,6 +800,31 @@ GDIOBJ_vFreeObject(POBJ pobj)
     }
 }
 
+/* For objects that are not allocated with GDIOBJ_AllocateObject (C++ based objects) */
+PVOID
+NTAPI
+GDIOBJ_pvAllocateBody(UCHAR objt, SIZE_T cjSize)
+{
+    objt &= 0x1f;
+
+    if (cjSize == gacjLookasideSize[objt])
+        return ExAllocateFromPagedLookasideList(GetLookasideList(objt));
+
+    return ExAllocatePoolWithTag(PagedPool, cjSize, GDIOBJ_POOL_TAG(objt));
+}
+
+VOID
+NTAPI
+GDIOBJ_vFreeBody(UCHAR objt, PVOID pvBody, SIZE_T cjSize)
+{
+    objt &= 0x1f;
+
+    if (cjSize == gacjLookasideSize[objt])
+        ExFreeToPagedLookasideList(GetLookasideList(objt), pvBody);
+    else
+        ExFreePoolWithTag(pvBody, GDIOBJ_POOL_TAG(objt));
+}
+
 VOID
 NTAPI
 GDIOBJ_vDereferenceObject(POBJ pobj)
@@ -1555,6 +1759,11 @@ GDI_CleanupForProcess(struct _EPROCESS *Process)
     /* Get the current process Id */
     dwProcessId = PtrToUlong(PsGetCurrentProcessId());
 
+    /* The process doesn't cache entries anymore, give the cached ones back */
+    ppi = PsGetCurrentProcessWin32Process();
+    ASSERT(ppi->W32PF_flags & W32PF_TERMINATED);
+    ENTRY_vFlushFreeEntryCache(ppi);
+
     /* Loop all handles in the handle table */
     for (ulIndex = RESERVE_ENTRIES_COUNT; ulIndex < gulFirstUnused; ulIndex++)
     {
@@ -1575,7 +1784,6 @@ GDI_CleanupForProcess(struct _EPROCESS *Process)
     DbgGdiHTIntegrityCheck();
 #endif
 
-    ppi = PsGetCurrentProcessWin32Process();
     DPRINT("Completed cleanup for process %p\n", Process->UniqueProcessId);
     if (ppi->GDIHandleCount != 0)
     {
@@ -183,6 +183,19 @@ NTAPI
 GDIOBJ_vFreeObject(
     POBJ pobj);
 
+PVOID
+NTAPI
+GDIOBJ_pvAllocateBody(
+    UCHAR objt,
+    SIZE_T cjSize);
+
+VOID
+NTAPI
+GDIOBJ_vFreeBody(
+    UCHAR objt,
+    PVOID pvBody,
+    SIZE_T cjSize);
+
 VOID
 NTAPI
 GDIOBJ_vSetObjectAttr(
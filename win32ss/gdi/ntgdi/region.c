@@ -2556,6 +2556,80 @@ IntGdiGetRgnBox(
 }
 
 
+/*
+ * The rectangles of a region are y-x banded: they are sorted by top, the
+ * rectangles of a band share top and bottom and are sorted by left, and
+ * neither bands nor the rectangles within a band overlap. So both the
+ * band tops/bottoms and the lefts/rights within a band are ascending,
+ * which lets us binary search them instead of scanning the whole buffer.
+ */
+
+/* Returns the index of the first rectangle with a bottom below Y */
+static
+ULONG
+REGION_FindBand(
+    PREGION prgn,
+    INT Y)
+{
+    ULONG Low = 0, High = prgn->rdh.nCount, Middle;
+
+    while (Low < High)
+    {
+        Middle = Low + (High - Low) / 2;
+        if (prgn->Buffer[Middle].bottom <= Y)
+            Low = Middle + 1;
+        else
+            High = Middle;
+    }
+
+    return Low;
+}
+
+/* Returns the index of the first rectangle after the band starting at Start */
+static
+ULONG
+REGION_FindBandEnd(
+    PREGION prgn,
+    ULONG Start)
+{
+    ULONG Low = Start + 1, High = prgn->rdh.nCount, Middle;
+    INT Top = prgn->Buffer[Start].top;
+
+    while (Low < High)
+    {
+        Middle = Low + (High - Low) / 2;
+        if (prgn->Buffer[Middle].top <= Top)
+            Low = Middle + 1;
+        else
+            High = Middle;
+    }
+
+    return Low;
+}
+
+/* Returns the index of the first rectangle of a band with a right edge past X */
+static
+ULONG
+REGION_FindInBand(
+    PREGION prgn,
+    ULONG Start,
+    ULONG End,
+    INT X)
+{
+    ULONG Middle;
+
+    while (Start < End)
+    {
+        Middle = Start + (End - Start) / 2;
+        if (prgn->Buffer[Middle].right <= X)
+            Start = Middle + 1;
+        else
+            End = Middle;
+    }
+
+    return Start;
+}
+
 BOOL
 FASTCALL
 REGION_PtInRegion(
@@ -2563,15 +2637,18 @@ REGION_PtInRegion(
     INT X,
     INT Y)
 {
-    ULONG i;
-    PRECT r;
+    ULONG i, End;
 
     if (prgn->rdh.nCount > 0 && INRECT(prgn->rdh.rcBound, X, Y))
     {
-        r =  prgn->Buffer;
-        for (i = 0; i < prgn->rdh.nCount; i++)
+        /* Find the band containing Y, if any */
+        i = REGION_FindBand(prgn, Y);
+        if ((i < prgn->rdh.nCount) && (prgn->Buffer[i].top <= Y))
         {
-            if (INRECT(r[i], X, Y))
+            /* And the rectangle of that band that could contain X */
+            End = REGION_FindBandEnd(prgn, i);
+            i = REGION_FindInBand(prgn, i, End, X);
+            if ((i < End) && (prgn->Buffer[i].left <= X))
                 return TRUE;
         }
     }
@@ -2585,7 +2662,7 @@ REGION_RectInRegion(
     PREGION Rgn,
     const RECTL *rect)
 {
-    PRECTL pCurRect, pRectEnd;
+    ULONG i, j, End;
     RECT rc;
 
     /* Swap the coordinates to make right >= left and bottom >= top */
@@ -2615,24 +2692,17 @@ REGION_RectInRegion(
     /* This is (just) a useful optimization */
     if ((Rgn->rdh.nCount > 0) && EXTENTCHECK(&Rgn->rdh.rcBound, &rc))
     {
-        for (pCurRect = Rgn->Buffer, pRectEnd = pCurRect +
-                                                Rgn->rdh.nCount; pCurRect < pRectEnd; pCurRect++)
+        /* Skip the bands above the rectangle, then walk the ones it spans */
+        for (i = REGION_FindBand(Rgn, rc.top);
+             (i < Rgn->rdh.nCount) && (Rgn->Buffer[i].top < rc.bottom);
+             i = End)
         {
-            if (pCurRect->bottom <= rc.top)
-                continue;             /* Not far enough down yet */
+            End = REGION_FindBandEnd(Rgn, i);
 
-            if (pCurRect->top >= rc.bottom)
-                break;                /* Too far down */
-
-            if (pCurRect->right <= rc.left)
-                continue;              /* Not far enough over yet */
-
-            if (pCurRect->left >= rc.right)
-            {
-                continue;
-            }
-
-            return TRUE;
+            /* The first rectangle of the band that ends past our left edge */
+            j = REGION_FindInBand(Rgn, i, End, rc.left);
+            if ((j < End) && (Rgn->Buffer[j].left < rc.right))
+                return TRUE;
         }
     }
 
@@ -91,6 +91,7 @@ typedef enum _GDIBATCHCMD
     GdiBCSelObj,
     GdiBCDelObj,
     GdiBCDelRgn,
+    GdiBCRectangle,
 } GDIBATCHCMD, *PGDIBATCHCMD;
 
 typedef enum _TRANSFORMTYPE
@@ -472,6 +473,25 @@ typedef struct _GDIBSPATBLT
   ULONG ulBrushClr;
 } GDIBSPATBLT, *PGDIBSPATBLT;
 
+typedef struct _GDIBSRECTANGLE
+{
+  GDIBATCHHDR gbHdr;
+  int nLeft;
+  int nTop;
+  int nRight;
+  int nBottom;
+  HANDLE hbrush;
+  HANDLE hpen;
+  COLORREF crForegroundClr;
+  COLORREF crBackgroundClr;
+  COLORREF crBrushClr;
+  COLORREF crPenClr;
+  ULONG ulForegroundClr;
+  ULONG ulBackgroundClr;
+  ULONG ulBrushClr;
+  ULONG ulPenClr;
+} GDIBSRECTANGLE, *PGDIBSRECTANGLE;
+
 /* FIXME: this should go to some "public" GDI32 header */
 typedef struct _PATRECT
 {
@@ -726,6 +726,10 @@ typedef struct _WND
     PSBINFOEX pSBInfoex; // convert to PSBINFO
     /* Entry in the list of thread windows. */
     LIST_ENTRY ThreadListEntry;
+    /* Cached visible regions of the window and client area, see vis.c */
+    struct _REGION *prgnVisCache[2];
+    ULONG VisCacheGeneration[2];
+    UCHAR VisCacheFlags[2];
 } WND, *PWND;
 
 #define PWND_BOTTOM ((PWND)1)
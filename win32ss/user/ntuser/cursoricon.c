@@ -1946,7 +1946,8 @@ NoAlpha:
                                NULL,
                                NULL,
                                NULL,
-                               rop4);
+                               rop4,
+                               COLORONCOLOR);
 
         EXLATEOBJ_vCleanup(&exlo);
 
@@ -1976,7 +1977,8 @@ NoAlpha:
                                    NULL,
                                    NULL,
                                    NULL,
-                                   rop4);
+                                   rop4,
+                                   COLORONCOLOR);
 
             EXLATEOBJ_vCleanup(&exlo);
 
@@ -2005,7 +2007,8 @@ NoAlpha:
                                    NULL,
                                    NULL,
                                    NULL,
-                                   rop4);
+                                   rop4,
+                                   COLORONCOLOR);
 
             EXLATEOBJ_vCleanup(&exlo);
 
@@ -1606,6 +1606,7 @@ IntHideDesktop(PDESKTOP Desktop)
         return ERROR_INVALID_WINDOW_HANDLE;
     }
     DesktopWnd->style &= ~WS_VISIBLE;
+    VIS_InvalidateCache(DesktopWnd);
 
     return STATUS_SUCCESS;
 }
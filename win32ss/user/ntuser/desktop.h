@@ -41,6 +41,8 @@ typedef struct _DESKTOP
     /* Thread blocking input */
     PVOID BlockInputThread;
     LIST_ENTRY ShellHookWindows;
+    /* Bumped whenever a window's geometry, visibility or z-order changes */
+    ULONG VisRgnGeneration;
 } DESKTOP, *PDESKTOP;
 
 // Desktop flags
@@ -415,6 +415,8 @@ UserDeleteW32Thread(PTHREADINFO pti)
 
    MsqCleanupThreadMsgs(pti);
 
+   MsqFreeSentMessageCache(pti);
+
    ObDereferenceObject(pti->pEThread);
 
    ExFreePoolWithTag(pti, USERTAG_THREADINFO);
@@ -474,6 +476,16 @@ InitThreadCallback(PETHREAD Thread)
     InitializeListHead(&ptiCurrent->WindowListHead);
     InitializeListHead(&ptiCurrent->W32CallbackListHead);
     InitializeListHead(&ptiCurrent->PostedMessagesListHead);
+    ExInitializeFastMutex(&ptiCurrent->PostedMessagesLock);
+    for (i = 0; i < POSTWNDBUCKETS; i++)
+    {
+        InitializeListHead(&ptiCurrent->PostedWndListHeads[i]);
+    }
+    for (i = 0; i < POSTCLASSCOUNTS; i++)
+    {
+        InitializeListHead(&ptiCurrent->PostedClassListHeads[i]);
+    }
+    InitializeListHead(&ptiCurrent->SentMessagesCacheHead);
     InitializeListHead(&ptiCurrent->SentMessagesListHead);
     InitializeListHead(&ptiCurrent->PtiLink);
     for (i = 0; i < NB_HOOKS; i++)
@@ -1011,6 +1011,139 @@ co_IntWaitMessage( PWND Window,
     return FALSE;
 }
 
+static BOOL FASTCALL
+IntIsHooked(PTHREADINFO pti, INT HookId)
+{
+    if (pti->fsHooks & HOOKID_TO_FLAG(HookId))
+        return TRUE;
+
+    return pti->rpdesk && pti->rpdesk->pDeskInfo &&
+           (pti->rpdesk->pDeskInfo->fsHooks & HOOKID_TO_FLAG(HookId));
+}
+
+/*
+ * Fast path of GetMessage/PeekMessage, called with the user lock held shared.
+ * If the first thing co_IntPeekMessage would return is a plain posted message
+ * of our own queue, take it with only our posted message lock held, so that
+ * message retrieval doesn't wait for other threads holding the user lock.
+ * Anything else (sent messages, input, paint, timers, WM_QUIT, hooks, DDE)
+ * returns FALSE and is left to the exclusive path.
+ */
+static BOOL FASTCALL
+IntPeekPostedMessageShared( PMSG pMsg,
+                            HWND hWnd,
+                            UINT MsgFilterMin,
+                            UINT MsgFilterMax,
+                            UINT RemoveMsg,
+                            BOOL bGMSG )
+{
+    PTHREADINFO pti;
+    UINT ProcessMask;
+    LONG_PTR ExtraInfo = 0;
+    BOOL Present;
+
+    pti = PsGetCurrentThreadWin32Thread();
+    if (hWnd || !pti || !pti->MessageQueue || !pti->pcti)
+        return FALSE;
+
+    if (MsgFilterMax < MsgFilterMin)
+    {
+        MsgFilterMin = 0;
+        MsgFilterMax = 0;
+    }
+
+    ProcessMask = bGMSG ? GetWakeMask(MsgFilterMin, MsgFilterMax) : HIWORD(RemoveMsg);
+    if (!ProcessMask) ProcessMask = (QS_ALLPOSTMESSAGE|QS_ALLINPUT);
+
+    /* Sent messages are dispatched first, and hooks need callbacks */
+    if (!(ProcessMask & QS_POSTMESSAGE) ||
+        (pti->TIF_flags & TIF_INCLEANUP) ||
+        !IsListEmpty(&pti->SentMessagesListHead) ||
+        (pti->MessageQueue->QF_flags & QF_MOUSEMOVED) ||
+        IntIsHooked(pti, WH_GETMESSAGE) ||
+        IntIsHooked(pti, WH_FOREGROUNDIDLE))
+    {
+        return FALSE;
+    }
+
+    MsqLockPostedMessages(pti);
+
+    Present = MsqPeekMessage( pti,
+                              FALSE,
+                              NULL,
+                              MsgFilterMin,
+                              MsgFilterMax,
+                              ProcessMask,
+                              &ExtraInfo,
+                              NULL,
+                              pMsg );
+
+    if (Present && pMsg->message >= WM_DDE_FIRST && pMsg->message <= WM_DDE_LAST)
+    {
+        Present = FALSE;
+    }
+
+    if (Present)
+    {
+        pti->timeLast = EngGetTickCount32();
+        pti->pcti->tickLastMsgChecked = pti->timeLast;
+
+        pti->pcti->fsChangeBits &= ~(QS_POSTMESSAGE | QS_HOTKEY | QS_TIMER);
+        if (MsgFilterMin == 0 && MsgFilterMax == 0)
+        {
+            pti->pcti->fsChangeBits &= ~QS_ALLPOSTMESSAGE;
+        }
+        if (ProcessMask & QS_INPUT)
+        {
+            pti->pcti->fsChangeBits &= ~QS_INPUT;
+        }
+
+        if (RemoveMsg & PM_REMOVE)
+        {
+            /* This is the same message we just looked at */
+            MsqPeekMessage( pti,
+                            TRUE,
+                            NULL,
+                            MsgFilterMin,
+                            MsgFilterMax,
+                            ProcessMask,
+                            &ExtraInfo,
+                            NULL,
+                            pMsg );
+        }
+    }
+
+    MsqUnlockPostedMessages(pti);
+
+    if (!Present)
+        return FALSE;
+
+    /* Same bookkeeping as co_IntGetPeekMessage */
+    IdlePong();
+    if (pMsg->message != WM_PAINT)
+    {
+        if (!RtlEqualMemory(&pti->ptLast, &pMsg->pt, sizeof(POINT)))
+        {
+            pti->TIF_flags |= TIF_MSGPOSCHANGED;
+        }
+        pti->timeLast = pMsg->time;
+        pti->ptLast   = pMsg->pt;
+    }
+
+    if (++pti->pClientInfo->cSpins >= 100)
+    {
+        pti->pClientInfo->cSpins = 0;
+    }
+
+    /* PeekMessage yields after each call, unless asked not to */
+    if (!bGMSG && !(RemoveMsg & PM_NOYIELD))
+    {
+        IdlePing();
+    }
+
+    return TRUE;
+}
+
 BOOL APIENTRY
 co_IntGetPeekMessage( PMSG pMsg,
                       HWND hWnd,
@@ -2066,7 +2199,20 @@ NtUserPostMessage(HWND hWnd,
 {
     BOOL ret;
 
-    UserEnterExclusive();
+    /*
+     * Posting to a window only touches the target thread's posted messages,
+     * which are protected by its own lock. Broadcasts and DDE messages need
+     * the exclusive lock.
+     */
+    if (hWnd && hWnd != HWND_BROADCAST && hWnd != HWND_TOPMOST &&
+        !(Msg >= WM_DDE_FIRST && Msg <= WM_DDE_LAST))
+    {
+        UserEnterShared();
+    }
+    else
+    {
+        UserEnterExclusive();
+    }
 
     ret = UserPostMessage(hWnd, Msg, wParam, lParam);
 
@@ -2086,7 +2232,8 @@ NtUserPostThreadMessage(DWORD idThread,
     PTHREADINFO pThread;
     NTSTATUS Status;
 
-    UserEnterExclusive();
+    /* Only the target thread's posted messages are touched, see NtUserPostMessage */
+    UserEnterShared();
 
     Status = PsLookupThreadByThreadId(UlongToHandle(idThread), &peThread);
 
@@ -2141,14 +2288,22 @@ NtUserGetMessage(PMSG pMsg,
         return FALSE;
     }
 
-    UserEnterExclusive();
-
     RtlZeroMemory(&Msg, sizeof(MSG));
 
-    Ret = co_IntGetPeekMessage(&Msg, hWnd, MsgFilterMin, MsgFilterMax, PM_REMOVE, TRUE);
-
+    /* Try to get a posted message without waiting for the exclusive lock */
+    UserEnterShared();
+    Ret = IntPeekPostedMessageShared(&Msg, hWnd, MsgFilterMin, MsgFilterMax, PM_REMOVE, TRUE);
     UserLeave();
 
+    if (!Ret)
+    {
+        UserEnterExclusive();
+
+        Ret = co_IntGetPeekMessage(&Msg, hWnd, MsgFilterMin, MsgFilterMax, PM_REMOVE, TRUE);
+
+        UserLeave();
+    }
+
     if (Ret)
     {
         _SEH2_TRY
@@ -2186,14 +2341,29 @@ NtUserPeekMessage( PMSG pMsg,
         return FALSE;
     }
 
-    UserEnterExclusive();
-
     RtlZeroMemory(&Msg, sizeof(MSG));
 
-    Ret = co_IntGetPeekMessage(&Msg, hWnd, MsgFilterMin, MsgFilterMax, RemoveMsg, FALSE);
-
+    /* Try to get a posted message without waiting for the exclusive lock */
+    UserEnterShared();
+    Ret = IntPeekPostedMessageShared(&Msg, hWnd, MsgFilterMin, MsgFilterMax, RemoveMsg, FALSE);
     UserLeave();
 
+    if (Ret)
+    {
+        if (!(RemoveMsg & PM_NOYIELD))
+        {
+            ZwYieldExecution();
+        }
+    }
+    else
+    {
+        UserEnterExclusive();
+
+        Ret = co_IntGetPeekMessage(&Msg, hWnd, MsgFilterMin, MsgFilterMax, RemoveMsg, FALSE);
+
+        UserLeave();
+    }
+
     if (Ret)
     {
         _SEH2_TRY
@@ -9,19 +9,34 @@
  */
 
 #include <win32k.h>
+#include <dde.h>
 DBG_DEFAULT_CHANNEL(UserMsgQ);
 
 /* GLOBALS *******************************************************************/
 
 static PPAGED_LOOKASIDE_LIST pgMessageLookasideList;
 static PPAGED_LOOKASIDE_LIST pgSendMsgLookasideList;
-INT PostMsgCount = 0;
+LONG PostMsgCount = 0;
 INT SendMsgCount = 0;
 PUSER_MESSAGE_QUEUE gpqCursor;
 ULONG_PTR gdwMouseMoveExtraInfo = 0;
 DWORD gdwMouseMoveTimeStamp = 0;
 LIST_ENTRY usmList;
 
+/* Message ranges of the posted message classes, PostClassOther takes the rest */
+static const struct
+{
+   UINT First;
+   UINT Last;
+} PostClassRanges[PostClassOther] =
+{
+   { WM_KEYFIRST,   WM_KEYLAST   }, // PostClassKey
+   { WM_MOUSEFIRST, WM_MOUSELAST }, // PostClassMouse
+   { WM_TIMER,      WM_SYSTIMER  }, // PostClassTimer
+   { WM_DDE_FIRST,  WM_DDE_LAST  }, // PostClassDde
+   { WM_USER,       0xFFFFFFFF   }, // PostClassUser
+};
+
 /* FUNCTIONS *****************************************************************/
 
 INIT_FUNCTION
@@ -727,6 +742,49 @@ co_MsqInsertMouseMessage(MSG* Msg, DWORD flags, ULONG_PTR dwExtraInfo, BOOL Hook
    }
 }
 
+static __inline ULONG
+MsqPostedWndBucket(HWND hWnd)
+{
+   ULONG_PTR Value = (ULONG_PTR)hWnd;
+
+   /* The low word of a user handle is its index */
+   return (ULONG)(Value ^ (Value >> 16)) & (POSTWNDBUCKETS - 1);
+}
+
+static POST_CLASS_TYPES FASTCALL
+MsqPostedClass(UINT Msg)
+{
+   ULONG i;
+
+   for (i = 0; i < PostClassOther; i++)
+   {
+      if (Msg >= PostClassRanges[i].First && Msg <= PostClassRanges[i].Last)
+         return (POST_CLASS_TYPES)i;
+   }
+   return PostClassOther;
+}
+
+/* Returns TRUE if messages of the given class can be in the filter range */
+static BOOL FASTCALL
+MsqPostedClassInRange(ULONG Class, UINT MsgFilterLow, UINT MsgFilterHigh)
+{
+   ULONG i;
+
+   if (Class != PostClassOther)
+   {
+      return MsgFilterLow <= PostClassRanges[Class].Last &&
+             MsgFilterHigh >= PostClassRanges[Class].First;
+   }
+
+   /* There are gaps between all classes, so any range not within one class overlaps the others */
+   for (i = 0; i < PostClassOther; i++)
+   {
+      if (MsgFilterLow >= PostClassRanges[i].First && MsgFilterHigh <= PostClassRanges[i].Last)
+         return FALSE;
+   }
+   return TRUE;
+}
+
 PUSER_MESSAGE FASTCALL
 MsqCreateMessage(LPMSG Msg)
 {
@@ -740,31 +798,43 @@ MsqCreateMessage(LPMSG Msg)
 
    RtlZeroMemory(Message, sizeof(*Message));
    RtlMoveMemory(&Message->Msg, Msg, sizeof(MSG));
-   PostMsgCount++;
+   /* Hardware messages aren't indexed */
+   InitializeListHead(&Message->WndListEntry);
+   InitializeListHead(&Message->ClassListEntry);
+   InterlockedIncrement(&PostMsgCount);
    return Message;
 }
 
 VOID FASTCALL
 MsqDestroyMessage(PUSER_MESSAGE Message)
 {
-   TRACE("Post Destroy %d\n",PostMsgCount);
+   TRACE("Post Destroy %ld\n",PostMsgCount);
    if (Message->pti == NULL)
    {
       ERR("Double Free Message\n");
       return;
    }
    RemoveEntryList(&Message->ListEntry);
+   RemoveEntryList(&Message->WndListEntry);
+   RemoveEntryList(&Message->ClassListEntry);
    Message->pti = NULL;
    ExFreeToPagedLookasideList(pgMessageLookasideList, Message);
-   PostMsgCount--;
+   InterlockedDecrement(&PostMsgCount);
 }
 
 PUSER_SENT_MESSAGE FASTCALL
 AllocateUserMessage(BOOL KEvent)
 {
    PUSER_SENT_MESSAGE Message;
+   PTHREADINFO pti = PsGetCurrentThreadWin32Thread();
 
-   if(!(Message = ExAllocateFromPagedLookasideList(pgSendMsgLookasideList)))
+   /* Reuse a message this thread freed before */
+   if (pti && !IsListEmpty(&pti->SentMessagesCacheHead))
+   {
+      Message = CONTAINING_RECORD(RemoveHeadList(&pti->SentMessagesCacheHead), USER_SENT_MESSAGE, ListEntry);
+      pti->cSentMessagesCached--;
+   }
+   else if(!(Message = ExAllocateFromPagedLookasideList(pgSendMsgLookasideList)))
    {
        ERR("AllocateUserMessage(): Not enough memory to allocate a message");
        return NULL;
@@ -785,15 +855,42 @@ AllocateUserMessage(BOOL KEvent)
 VOID FASTCALL
 FreeUserMessage(PUSER_SENT_MESSAGE Message)
 {
+   PTHREADINFO pti = PsGetCurrentThreadWin32Thread();
+
    Message->pkCompletionEvent = NULL;
 
    /* Remove it from the list */
    RemoveEntryList(&Message->ListEntry);
 
-   ExFreeToPagedLookasideList(pgSendMsgLookasideList, Message);
+   /* Keep a few for the next AllocateUserMessage of this thread */
+   if (pti &&
+       !(pti->TIF_flags & TIF_INCLEANUP) &&
+       pti->cSentMessagesCached < SENTMSGCACHEDEPTH)
+   {
+      InsertHeadList(&pti->SentMessagesCacheHead, &Message->ListEntry);
+      pti->cSentMessagesCached++;
+   }
+   else
+   {
+      ExFreeToPagedLookasideList(pgSendMsgLookasideList, Message);
+   }
    SendMsgCount--;
 }
 
+VOID FASTCALL
+MsqFreeSentMessageCache(PTHREADINFO pti)
+{
+   PLIST_ENTRY CurrentEntry;
+
+   while (!IsListEmpty(&pti->SentMessagesCacheHead))
+   {
+      CurrentEntry = RemoveHeadList(&pti->SentMessagesCacheHead);
+      ExFreeToPagedLookasideList(pgSendMsgLookasideList,
+                                 CONTAINING_RECORD(CurrentEntry, USER_SENT_MESSAGE, ListEntry));
+   }
+   pti->cSentMessagesCached = 0;
+}
+
 VOID APIENTRY
 MsqRemoveWindowMessagesFromQueue(PWND Window)
 {
@@ -807,11 +904,12 @@ MsqRemoveWindowMessagesFromQueue(PWND Window)
    pti = Window->head.pti;
 
    /* remove the posted messages for this window */
-   CurrentEntry = pti->PostedMessagesListHead.Flink;
-   ListHead = &pti->PostedMessagesListHead;
+   ListHead = &pti->PostedWndListHeads[MsqPostedWndBucket(Window->head.h)];
+   CurrentEntry = ListHead->Flink;
    while (CurrentEntry != ListHead)
    {
-      PostedMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, ListEntry);
+      PostedMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, WndListEntry);
+      CurrentEntry = CurrentEntry->Flink;
 
       if (PostedMessage->Msg.hwnd == Window->head.h)
       {
@@ -822,11 +920,6 @@ MsqRemoveWindowMessagesFromQueue(PWND Window)
          }
          ClearMsgBitsMask(pti, PostedMessage->QS_Flags);
          MsqDestroyMessage(PostedMessage);
-         CurrentEntry = pti->PostedMessagesListHead.Flink;
-      }
-      else
-      {
-         CurrentEntry = CurrentEntry->Flink;
       }
    }
 
@@ -1358,22 +1451,31 @@ MsqPostMessage(PTHREADINFO pti,
 
    MessageQueue = pti->MessageQueue;
 
+   if (Msg->message == WM_HOTKEY) MessageBits |= QS_HOTKEY; // Justin Case, just set it.
+   Message->dwQEvent = dwQEvent;
+   Message->ExtraInfo = ExtraInfo;
+   Message->QS_Flags = MessageBits;
+   Message->pti = pti;
+
+   /* Other posters and the receiver may only hold the user lock shared */
+   MsqLockPostedMessages(pti);
+
    if (!HardwareMessage)
    {
+       Message->Sequence = pti->PostedSequence++;
        InsertTailList(&pti->PostedMessagesListHead, &Message->ListEntry);
+       InsertTailList(&pti->PostedWndListHeads[MsqPostedWndBucket(Msg->hwnd)], &Message->WndListEntry);
+       InsertTailList(&pti->PostedClassListHeads[MsqPostedClass(Msg->message)], &Message->ClassListEntry);
    }
    else
    {
        InsertTailList(&MessageQueue->HardwareMessagesListHead, &Message->ListEntry);
    }
 
-   if (Msg->message == WM_HOTKEY) MessageBits |= QS_HOTKEY; // Justin Case, just set it.
-   Message->dwQEvent = dwQEvent;
-   Message->ExtraInfo = ExtraInfo;
-   Message->QS_Flags = MessageBits;
-   Message->pti = pti;
    MsqWakeQueue(pti, MessageBits, TRUE);
-   TRACE("Post Message %d\n",PostMsgCount);
+
+   MsqUnlockPostedMessages(pti);
+   TRACE("Post Message %ld\n",PostMsgCount);
 }
 
 VOID FASTCALL
@@ -2114,50 +2216,93 @@ MsqPeekMessage(IN PTHREADINFO pti,
                   OUT DWORD *dwQEvent,
                   OUT PMSG Message)
 {
-   PUSER_MESSAGE CurrentMessage;
-   PLIST_ENTRY ListHead;
+   PUSER_MESSAGE CurrentMessage = NULL, Candidate;
+   PLIST_ENTRY ListHead, Entry;
    DWORD QS_Flags;
-   BOOL Ret = FALSE;
+   ULONG i;
 
-   ListHead = pti->PostedMessagesListHead.Flink;
+   if (IsListEmpty(&pti->PostedMessagesListHead)) return FALSE;
 
-   if (IsListEmpty(ListHead)) return FALSE;
-
-   while(ListHead != &pti->PostedMessagesListHead)
-   {
-      CurrentMessage = CONTAINING_RECORD(ListHead, USER_MESSAGE, ListEntry);
-      ListHead = ListHead->Flink;
 /*
  MSDN:
  1: any window that belongs to the current thread, and any messages on the current thread's message queue whose hwnd value is NULL.
  2: retrieves only messages on the current thread's message queue whose hwnd value is NULL.
  3: handle to the window whose messages are to be retrieved.
  */
-      if ( ( !Window || // 1
-            ( Window == PWND_BOTTOM && CurrentMessage->Msg.hwnd == NULL ) || // 2
-            ( Window != PWND_BOTTOM && Window->head.h == CurrentMessage->Msg.hwnd ) ) && // 3
-            ( ( ( MsgFilterLow == 0 && MsgFilterHigh == 0 ) && CurrentMessage->QS_Flags & QSflags ) ||
-              ( MsgFilterLow <= CurrentMessage->Msg.message && MsgFilterHigh >= CurrentMessage->Msg.message ) ) )
+#define MsqPostedMessageMatches(Message) \
+   ( ( !Window || /* 1 */ \
+       ( Window == PWND_BOTTOM && (Message)->Msg.hwnd == NULL ) || /* 2 */ \
+       ( Window != PWND_BOTTOM && Window->head.h == (Message)->Msg.hwnd ) ) && /* 3 */ \
+     ( ( ( MsgFilterLow == 0 && MsgFilterHigh == 0 ) && (Message)->QS_Flags & QSflags ) || \
+       ( MsgFilterLow <= (Message)->Msg.message && MsgFilterHigh >= (Message)->Msg.message ) ) )
+
+   if (Window)
+   {
+      /* Only look at the messages whose window handle has the same hash */
+      ListHead = &pti->PostedWndListHeads[MsqPostedWndBucket(Window == PWND_BOTTOM ? NULL : Window->head.h)];
+      for (Entry = ListHead->Flink; Entry != ListHead; Entry = Entry->Flink)
       {
-         *Message   = CurrentMessage->Msg;
-         *ExtraInfo = CurrentMessage->ExtraInfo;
-         QS_Flags   = CurrentMessage->QS_Flags;
-         if (dwQEvent) *dwQEvent = CurrentMessage->dwQEvent;
+         Candidate = CONTAINING_RECORD(Entry, USER_MESSAGE, WndListEntry);
+         if (MsqPostedMessageMatches(Candidate))
+         {
+            CurrentMessage = Candidate;
+            break;
+         }
+      }
+   }
+   else if (MsgFilterLow != 0 || MsgFilterHigh != 0)
+   {
+      /* Take the oldest match of the classes the range covers */
+      for (i = 0; i < POSTCLASSCOUNTS; i++)
+      {
+         if (!MsqPostedClassInRange(i, MsgFilterLow, MsgFilterHigh)) continue;
 
-         if (Remove)
+         ListHead = &pti->PostedClassListHeads[i];
+         for (Entry = ListHead->Flink; Entry != ListHead; Entry = Entry->Flink)
          {
-             if (CurrentMessage->pti != NULL)
-             {
-                MsqDestroyMessage(CurrentMessage);
-             }
-             ClearMsgBitsMask(pti, QS_Flags);
+            Candidate = CONTAINING_RECORD(Entry, USER_MESSAGE, ClassListEntry);
+            if (MsqPostedMessageMatches(Candidate))
+            {
+               if (!CurrentMessage || (LONG)(Candidate->Sequence - CurrentMessage->Sequence) < 0)
+                  CurrentMessage = Candidate;
+               break;
+            }
+         }
+      }
+   }
+   else
+   {
+      ListHead = &pti->PostedMessagesListHead;
+      for (Entry = ListHead->Flink; Entry != ListHead; Entry = Entry->Flink)
+      {
+         Candidate = CONTAINING_RECORD(Entry, USER_MESSAGE, ListEntry);
+         if (MsqPostedMessageMatches(Candidate))
+         {
+            CurrentMessage = Candidate;
+            break;
          }
-         Ret = TRUE;
-         break;
       }
    }
 
-   return Ret;
+#undef MsqPostedMessageMatches
+
+   if (!CurrentMessage) return FALSE;
+
+   *Message   = CurrentMessage->Msg;
+   *ExtraInfo = CurrentMessage->ExtraInfo;
+   QS_Flags   = CurrentMessage->QS_Flags;
+   if (dwQEvent) *dwQEvent = CurrentMessage->dwQEvent;
+
+   if (Remove)
+   {
+      if (CurrentMessage->pti != NULL)
+      {
+         MsqDestroyMessage(CurrentMessage);
+      }
+      ClearMsgBitsMask(pti, QS_Flags);
+   }
+
+   return TRUE;
 }
 
 NTSTATUS FASTCALL
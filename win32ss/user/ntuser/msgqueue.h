@@ -8,6 +8,9 @@
 typedef struct _USER_MESSAGE
 {
   LIST_ENTRY ListEntry;
+  LIST_ENTRY WndListEntry;   // Posted messages only, see MsqPeekMessage.
+  LIST_ENTRY ClassListEntry;
+  ULONG Sequence;
   MSG Msg;
   DWORD QS_Flags;
   LONG_PTR ExtraInfo;
@@ -214,6 +217,17 @@ LPARAM FASTCALL MsqSetMessageExtraInfo(LPARAM lParam);
 LPARAM FASTCALL MsqGetMessageExtraInfo(VOID);
 VOID APIENTRY MsqRemoveWindowMessagesFromQueue(PWND pWindow);
 
+/*
+ * Posting a message and taking a posted message off the own queue are done
+ * with the user lock held shared. Those paths serialize on the target thread
+ * with this lock instead. Owners of the exclusive user lock don't need it.
+ */
+#define MsqLockPostedMessages(pti) \
+  ExEnterCriticalRegionAndAcquireFastMutexUnsafe(&(pti)->PostedMessagesLock)
+
+#define MsqUnlockPostedMessages(pti) \
+  ExReleaseFastMutexUnsafeAndLeaveCriticalRegion(&(pti)->PostedMessagesLock)
+
 #define IntReferenceMessageQueue(MsgQueue) \
   InterlockedIncrement(&(MsgQueue)->References)
 
@@ -259,6 +273,7 @@ WPARAM FASTCALL MsqGetDownKeyState(PUSER_MESSAGE_QUEUE);
 BOOL FASTCALL IsThreadSuspended(PTHREADINFO);
 PUSER_SENT_MESSAGE FASTCALL AllocateUserMessage(BOOL);
 VOID FASTCALL FreeUserMessage(PUSER_SENT_MESSAGE);
+VOID FASTCALL MsqFreeSentMessageCache(PTHREADINFO);
 VOID FASTCALL MsqDestroyMessage(PUSER_MESSAGE);
 
 int UserShowCursor(BOOL bShow);
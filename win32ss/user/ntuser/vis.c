@@ -9,8 +9,18 @@
 #include <win32k.h>
 DBG_DEFAULT_CHANNEL(UserWinpos);
 
-PREGION FASTCALL
-VIS_ComputeVisibleRegion(
+#define VIS_CACHE_WINDOW        0
+#define VIS_CACHE_CLIENT        1
+
+#define VIS_CACHE_CLIPCHILDREN  0x1
+#define VIS_CACHE_CLIPSIBLINGS  0x2
+
+/* Visible region cache statistics */
+ULONG gcVisRgnCacheHits = 0;
+ULONG gcVisRgnRecomputes = 0;
+
+static PREGION FASTCALL
+IntComputeVisibleRegion(
    PWND Wnd,
    BOOLEAN ClientArea,
    BOOLEAN ClipChildren,
@@ -19,11 +29,6 @@ VIS_ComputeVisibleRegion(
    PREGION VisRgn, ClipRgn;
    PWND PreviousWindow, CurrentWindow, CurrentSibling;
 
-   if (!Wnd || !(Wnd->style & WS_VISIBLE))
-   {
-      return NULL;
-   }
-
    VisRgn = NULL;
 
    if (ClientArea)
@@ -141,6 +146,104 @@ VIS_ComputeVisibleRegion(
    return VisRgn;
 }
 
+PREGION FASTCALL
+VIS_ComputeVisibleRegion(
+   PWND Wnd,
+   BOOLEAN ClientArea,
+   BOOLEAN ClipChildren,
+   BOOLEAN ClipSiblings)
+{
+   PDESKTOP Desktop;
+   PREGION VisRgn, CacheRgn;
+   UINT Index;
+   UCHAR Flags;
+
+   if (!Wnd || !(Wnd->style & WS_VISIBLE))
+   {
+      return NULL;
+   }
+
+   Desktop = Wnd->head.rpdesk;
+   if (!Desktop)
+   {
+      return IntComputeVisibleRegion(Wnd, ClientArea, ClipChildren, ClipSiblings);
+   }
+
+   Index = ClientArea ? VIS_CACHE_CLIENT : VIS_CACHE_WINDOW;
+   Flags = (ClipChildren ? VIS_CACHE_CLIPCHILDREN : 0) |
+           (ClipSiblings ? VIS_CACHE_CLIPSIBLINGS : 0);
+
+   /*
+    * Nothing on this desktop moved, got shown, hidden or restacked since
+    * the cached region was computed, so a copy of it is still valid.
+    */
+   CacheRgn = Wnd->prgnVisCache[Index];
+   if (CacheRgn &&
+       Wnd->VisCacheGeneration[Index] == Desktop->VisRgnGeneration &&
+       Wnd->VisCacheFlags[Index] == Flags)
+   {
+      VisRgn = IntSysCreateRectpRgn(0, 0, 0, 0);
+      if (VisRgn)
+      {
+         IntGdiCombineRgn(VisRgn, CacheRgn, NULL, RGN_COPY);
+         gcVisRgnCacheHits++;
+      }
+      return VisRgn;
+   }
+
+   VisRgn = IntComputeVisibleRegion(Wnd, ClientArea, ClipChildren, ClipSiblings);
+   gcVisRgnRecomputes++;
+   if (!VisRgn)
+   {
+      return NULL;
+   }
+
+   /* Remember it for the next caller */
+   if (!CacheRgn)
+   {
+      CacheRgn = IntSysCreateRectpRgn(0, 0, 0, 0);
+      Wnd->prgnVisCache[Index] = CacheRgn;
+   }
+   if (CacheRgn)
+   {
+      IntGdiCombineRgn(CacheRgn, VisRgn, NULL, RGN_COPY);
+      Wnd->VisCacheGeneration[Index] = Desktop->VisRgnGeneration;
+      Wnd->VisCacheFlags[Index] = Flags;
+   }
+
+   return VisRgn;
+}
+
+VOID FASTCALL
+VIS_InvalidateCache(
+   PWND Wnd)
+{
+   PDESKTOP Desktop;
+
+   /* Any change can affect the siblings and children, drop the whole desktop */
+   Desktop = Wnd->head.rpdesk;
+   if (Desktop)
+   {
+      Desktop->VisRgnGeneration++;
+   }
+}
+
+VOID FASTCALL
+VIS_FreeCache(
+   PWND Wnd)
+{
+   UINT Index;
+
+   for (Index = 0; Index < ARRAYSIZE(Wnd->prgnVisCache); Index++)
+   {
+      if (Wnd->prgnVisCache[Index])
+      {
+         REGION_Delete(Wnd->prgnVisCache[Index]);
+         Wnd->prgnVisCache[Index] = NULL;
+      }
+   }
+}
+
 VOID FASTCALL
 co_VIS_WindowLayoutChanged(
    PWND Wnd,
@@ -11,5 +11,10 @@
 
 PREGION FASTCALL VIS_ComputeVisibleRegion(PWND Window, BOOLEAN ClientArea, BOOLEAN ClipChildren, BOOLEAN ClipSiblings);
 VOID FASTCALL co_VIS_WindowLayoutChanged(PWND Window, PREGION UncoveredRgn);
+VOID FASTCALL VIS_InvalidateCache(PWND Window);
+VOID FASTCALL VIS_FreeCache(PWND Window);
+
+extern ULONG gcVisRgnCacheHits;
+extern ULONG gcVisRgnRecomputes;
 
 /* EOF */
@@ -46,6 +46,23 @@ typedef enum _QS_ROS_TYPES
     QSRosEvent,
 } QS_ROS_TYPES, *PQS_ROS_TYPES;
 
+/* Posted messages are also indexed by window and by message class */
+#define POSTWNDBUCKETS 16
+#define POSTCLASSCOUNTS 6
+
+typedef enum _POST_CLASS_TYPES
+{
+    PostClassKey = 0,
+    PostClassMouse,
+    PostClassTimer,
+    PostClassDde,
+    PostClassUser,
+    PostClassOther,
+} POST_CLASS_TYPES, *PPOST_CLASS_TYPES;
+
+/* Number of sent messages a thread keeps for reuse */
+#define SENTMSGCACHEDEPTH 8
+
 extern BOOL ClientPfnInit;
 extern HINSTANCE hModClient;
 extern HANDLE hModuleWin;    // This Win32k Instance.
@@ -145,6 +162,15 @@ typedef struct _THREADINFO
     // Hard list QS_MOUSE|QS_KEY only
     // Accounting of queue bit sets, the rest are flags. QS_TIMER QS_PAINT counts are handled in thread information.
     DWORD nCntsQBits[QSIDCOUNTS]; // QS_KEY QS_MOUSEMOVE QS_MOUSEBUTTON QS_POSTMESSAGE QS_SENDMESSAGE QS_HOTKEY
+    /* Protects the posted messages and queue bits from shared user lock owners */
+    FAST_MUTEX PostedMessagesLock;
+    /* Posted messages by window handle hash and by message class, in posting order */
+    LIST_ENTRY PostedWndListHeads[POSTWNDBUCKETS];
+    LIST_ENTRY PostedClassListHeads[POSTCLASSCOUNTS];
+    ULONG PostedSequence;
+    /* Freed sent messages, only touched by the thread itself */
+    LIST_ENTRY SentMessagesCacheHead;
+    ULONG cSentMessagesCached;
 
     LIST_ENTRY WindowListHead;
     LIST_ENTRY W32CallbackListHead;
@@ -236,6 +262,9 @@ typedef struct _W32PROCESS
 
 #define CLIBS 32
 
+/* Number of GDI handle entries a process moves from or to the global free list at once */
+#define GDI_FREE_ENTRY_BATCH 16
+
 #ifdef __cplusplus
 typedef struct _PROCESSINFO : _W32PROCESS
 {
@@ -282,6 +311,10 @@ typedef struct _PROCESSINFO
     struct _GDI_POOL* pPoolDcAttr;
     struct _GDI_POOL* pPoolBrushAttr;
     struct _GDI_POOL* pPoolRgnAttr;
+    /* Free GDI handle entries, taken from and returned to the global list in batches */
+    EX_PUSH_LOCK pushlockGdiFreeEntries;
+    ULONG cGdiFreeEntries;
+    ULONG aulGdiFreeEntries[2 * GDI_FREE_ENTRY_BATCH];
 
 #if DBG
     BYTE DbgChannelLevel[DbgChCount];
@@ -128,6 +128,8 @@ IntSetStyle( PWND pwnd, ULONG set_bits, ULONG clear_bits )
     styleNew = (pwnd->style | set_bits) & ~clear_bits;
     if (styleNew == styleOld) return styleNew;
     pwnd->style = styleNew;
+    if ((styleOld ^ styleNew) & (WS_VISIBLE | WS_MINIMIZE | WS_CLIPSIBLINGS))
+       VIS_InvalidateCache(pwnd);
     if ((styleOld ^ styleNew) & WS_VISIBLE) // State Change.
     {
        if (styleOld & WS_VISIBLE) pwnd->head.pti->cVisWindows--;
@@ -564,6 +566,7 @@ LRESULT co_UserFreeWindow(PWND Window,
    Window->state2 |= WNDS2_INDESTROY;
    Window->style &= ~WS_VISIBLE;
    Window->head.pti->cVisWindows--;
+   VIS_InvalidateCache(Window);
 
 
    /* remove the window already at this point from the thread window list so we
@@ -717,6 +720,7 @@ LRESULT co_UserFreeWindow(PWND Window,
       GreDeleteObject(Window->hrgnClip);
       Window->hrgnClip = NULL;
    }
+   VIS_FreeCache(Window);
    Window->head.pti->cWindows--;
 
 //   ASSERT(Window != NULL);
@@ -929,6 +933,8 @@ IntLinkWindow(
 
         Wnd->spwndParent->spwndChild = Wnd;
     }
+
+    VIS_InvalidateCache(Wnd);
 }
 
 /*
@@ -1198,6 +1204,7 @@ co_IntSetParent(PWND Wnd, PWND WndNewParent)
        !(Wnd->style & WS_CLIPSIBLINGS) )
    {
       Wnd->style |= WS_CLIPSIBLINGS;
+      VIS_InvalidateCache(Wnd);
       DceResetActiveDCEs(Wnd);
    }
 
@@ -1318,6 +1325,8 @@ IntUnlinkWindow(PWND Wnd)
         Wnd->spwndParent->spwndChild = Wnd->spwndNext;
 
     Wnd->spwndPrev = Wnd->spwndNext = NULL;
+
+    VIS_InvalidateCache(Wnd);
 }
 
 /* FUNCTIONS *****************************************************************/
@@ -3704,6 +3713,8 @@ co_IntSetWindowLongPtr(HWND hWnd, DWORD Index, LONG_PTR NewValue, BOOL Ansi, ULO
                SetLayeredStatus(Window, 0);
             }
 
+            if ((Window->ExStyle ^ Style.styleNew) & WS_EX_TRANSPARENT)
+               VIS_InvalidateCache(Window);
             Window->ExStyle = (DWORD)Style.styleNew;
 
             co_IntSendMessage(hWnd, WM_STYLECHANGED, GWL_EXSTYLE, (LPARAM) &Style);
@@ -3757,6 +3768,8 @@ co_IntSetWindowLongPtr(HWND hWnd, DWORD Index, LONG_PTR NewValue, BOOL Ansi, ULO
                if (Style.styleNew & WS_VISIBLE) Window->head.pti->cVisWindows++;
                DceResetActiveDCEs( Window );
             }
+            if ((Style.styleOld ^ Style.styleNew) & (WS_VISIBLE | WS_MINIMIZE | WS_CLIPSIBLINGS))
+               VIS_InvalidateCache(Window);
             Window->style = (DWORD)Style.styleNew;
 
             if (!bAlter)
@@ -276,6 +276,8 @@ SelectWindowRgn(PWND Window, HRGN hRgnClip)
 
         Window->hrgnClip = hRgnClip;
     }
+
+    VIS_InvalidateCache(Window);
 }
 
 //
@@ -1506,6 +1508,8 @@ WinPosInternalMoveWindow(PWND Window, INT MoveX, INT MoveY)
    Window->rcClient.top += MoveY;
    Window->rcClient.bottom += MoveY;
 
+   VIS_InvalidateCache(Window);
+
    for(Child = Window->spwndChild; Child; Child = Child->spwndNext)
    {
       WinPosInternalMoveWindow(Child, MoveX, MoveY);
@@ -1821,6 +1825,11 @@ co_WinPosSetWindowPos(
       PosChanged = TRUE;
    }
 
+   if (!IntEqualRect(&Window->rcWindow, &NewWindowRect) ||
+       !IntEqualRect(&Window->rcClient, &NewClientRect))
+   {
+      VIS_InvalidateCache(Window);
+   }
    Window->rcWindow = NewWindowRect;
    Window->rcClient = NewClientRect;
 
@@ -1838,6 +1847,7 @@ co_WinPosSetWindowPos(
 
       Window->style &= ~WS_VISIBLE; //IntSetStyle( Window, 0, WS_VISIBLE );
       Window->head.pti->cVisWindows--;
+      VIS_InvalidateCache(Window);
       IntNotifyWinEvent(EVENT_OBJECT_HIDE, Window, OBJID_WINDOW, CHILDID_SELF, WEF_SETBYWNDPTI);
    }
    else if (WinPos.flags & SWP_SHOWWINDOW)
@@ -1850,6 +1860,7 @@ co_WinPosSetWindowPos(
 
       Window->style |= WS_VISIBLE; //IntSetStyle( Window, WS_VISIBLE, 0 );
       Window->head.pti->cVisWindows++;
+      VIS_InvalidateCache(Window);
       IntNotifyWinEvent(EVENT_OBJECT_SHOW, Window, OBJID_WINDOW, CHILDID_SELF, WEF_SETBYWNDPTI);
    }
 